@@ -0,0 +1,129 @@
+// APU synthesis throughput with all five channels active.
+//
+// Usage: bench_apu [seconds_of_audio] [rom.nes]
+// Drives the APU alone (CPU cycles/sec, with and without a band-limited
+// output buffer), then whole-console frames/sec with audio off and on.
+
+#include "bench_common.h"
+#include "nes/apu/apu2a03.h"
+#include "nes/apu/blip.h"
+#include "nes/nes.h"
+
+enum {
+    SAMPLE_RATE    = 48000,
+    FRAME_CYCLES   = 29781
+};
+
+static u8 dmc_data(void* user, u16 addr)
+{
+    (void)user;
+    return (u8)(addr * 2654435761u >> 24);
+}
+
+// A busy "song": every channel plays and the pitches change each frame.
+static void play_frame(APU2A03* a, int frame)
+{
+    if (frame == 0) {
+        APU2A03_Write(a, 0x4015, 0x1F);
+        APU2A03_Write(a, 0x4000, 0xBF);
+        APU2A03_Write(a, 0x4004, 0x7C);
+        APU2A03_Write(a, 0x4005, 0x00);
+        APU2A03_Write(a, 0x4008, 0xFF);
+        APU2A03_Write(a, 0x400C, 0x3F);
+        APU2A03_Write(a, 0x4010, 0x4E);     // loop, rate 72
+        APU2A03_Write(a, 0x4013, 0x20);
+        APU2A03_Write(a, 0x4015, 0x1F);
+    }
+
+    u8 note = (u8)(frame * 7);
+    APU2A03_Write(a, 0x4002, (u8)(0x80u + note));
+    APU2A03_Write(a, 0x4003, 0x08);
+    APU2A03_Write(a, 0x4006, (u8)(0x40u + note));
+    APU2A03_Write(a, 0x4007, 0x09);
+    APU2A03_Write(a, 0x400A, (u8)(0xC0u - note));
+    APU2A03_Write(a, 0x400B, 0x08);
+    APU2A03_Write(a, 0x400E, (u8)(frame & 0x8F));
+    APU2A03_Write(a, 0x400F, 0x08);
+}
+
+static double run_apu(int frames, Blip* out)
+{
+    APU2A03 a;
+    APU2A03_Init(&a);
+    APU2A03_SetDMCReader(&a, dmc_data, NULL);
+    APU2A03_SetOutput(&a, out);
+
+    u64 samples = 0;
+    double t0 = Bench_Now();
+    for (int f = 0; f < frames; f++) {
+        play_frame(&a, f);
+        // Instruction-sized steps, as the console loop advances the APU.
+        for (int c = 0; c < FRAME_CYCLES; c += 3) APU2A03_Advance(&a, 3u);
+        APU2A03_EndFrame(&a);
+        if (out) samples += (u64)Blip_ReadSamples(out, NULL, Blip_SamplesAvail(out));
+    }
+    double dt = Bench_Now() - t0;
+
+    APU2A03_SetOutput(&a, NULL);
+    if (out) printf("  (%llu samples)", (unsigned long long)samples);
+    return (double)frames * FRAME_CYCLES / dt;
+}
+
+static double run_console(const u8* rom, size_t rom_size, int frames, int sample_rate)
+{
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    if (!n) exit(1);
+    NES_Init(n);
+    n->quiet = true;
+    if (!NES_LoadROMFromMemory(n, rom, rom_size)) exit(1);
+    NES_Reset(n);
+    NES_EnableAudio(n, sample_rate);
+
+    double t0 = Bench_Now();
+    for (int f = 0; f < frames; f++) {
+        play_frame(&n->bus.apu, f);
+        NES_RunFrame(n);
+        NES_ReadAudio(n, NULL, NES_AudioAvail(n));
+    }
+    double dt = Bench_Now() - t0;
+
+    NES_Destroy(n);
+    free(n);
+    return (double)frames / dt;
+}
+
+int main(int argc, char** argv)
+{
+    int seconds = (argc > 1) ? atoi(argv[1]) : 60;
+    const char* rom_path = (argc > 2) ? argv[2] : NULL;
+    if (seconds <= 0) seconds = 60;
+    int frames = seconds * 60;
+
+    Blip blip;
+    if (!Blip_Init(&blip, APU_CLOCK_RATE, SAMPLE_RATE, SAMPLE_RATE / 5)) return 1;
+
+    printf("workload: %d frames, all channels active, %d Hz output\n", frames, SAMPLE_RATE);
+
+    printf("apu, no output:");
+    double off = run_apu(frames, NULL);
+    printf("  %.1f Mcycles/s (%.0fx real time)\n", off * 1e-6, off / APU_CLOCK_RATE);
+
+    printf("apu, blip output:");
+    double on = run_apu(frames, &blip);
+    printf("  %.1f Mcycles/s (%.0fx real time)\n", on * 1e-6, on / APU_CLOCK_RATE);
+    Blip_Destroy(&blip);
+
+    size_t rom_size = 0;
+    u8* rom = Bench_LoadROM(rom_path, &rom_size);
+    if (!rom) return 1;
+
+    int console_frames = frames / 4;
+    double fps_off = run_console(rom, rom_size, console_frames, 0);
+    double fps_on = run_console(rom, rom_size, console_frames, SAMPLE_RATE);
+    printf("console (%s): %.0f fps audio off, %.0f fps audio on (%.1f%% cost)\n",
+           rom_path ? rom_path : "synthetic", fps_off, fps_on,
+           100.0 * (fps_off / fps_on - 1.0));
+
+    free(rom);
+    return 0;
+}
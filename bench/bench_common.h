@@ -0,0 +1,216 @@
+#pragma once
+// Shared helpers for the programs in bench/.
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include "nes/common.h"
+#include "nes/util/file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+static inline double Bench_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Game-loop shaped workload: poll pad, branch on buttons, walk a table in RAM,
+// wait for NMI. Roughly what a title screen / menu loop does.
+static const u8 k_bench_prog[] = {
+    0xA9, 0x80,             // $8000 LDA #$80
+    0x8D, 0x00, 0x20,       //       STA $2000
+    0xA9, 0x01,             // $8005 main: LDA #$01
+    0x8D, 0x16, 0x40,       //       STA $4016
+    0xA9, 0x00,             //       LDA #$00
+    0x8D, 0x16, 0x40,       //       STA $4016
+    0xAD, 0x16, 0x40,       //       LDA $4016
+    0x29, 0x01,             //       AND #$01
+    0xF0, 0x04,             //       BEQ noa
+    0xE6, 0x20,             //       INC $20
+    0xE6, 0x20,             //       INC $20
+    0xA2, 0x00,             // noa:  LDX #$00
+    0xBD, 0x00, 0x03,       // fill: LDA $0300,X
+    0x65, 0x20,             //       ADC $20
+    0x9D, 0x00, 0x03,       //       STA $0300,X
+    0xE8,                   //       INX
+    0xD0, 0xF5,             //       BNE fill
+    0xA5, 0x21,             //       LDA $21
+    0xC5, 0x22,             // wait: CMP $22
+    0xF0, 0xFC,             //       BEQ wait
+    0xA5, 0x22,             //       LDA $22
+    0x85, 0x21,             //       STA $21
+    0x4C, 0x05, 0x80,       //       JMP main
+    0xE6, 0x22,             // nmi:  INC $22
+    0x40                    //       RTI
+};
+
+// NROM-128 image running prog from $8000; NMI/IRQ vectors point at
+// nmi_offset into prog (or at the reset entry when it is 0).
+static inline u8* Bench_MakeProgramROM(const u8* prog, size_t prog_size, u16 nmi_offset,
+                                       size_t* out_size)
+{
+    size_t size = 16u + 16u * 1024u + 8u * 1024u;
+    if (prog_size > 0x3FF0u) return NULL;
+    u8* rom = (u8*)calloc(1, size);
+    if (!rom) return NULL;
+
+    rom[0] = 'N'; rom[1] = 'E'; rom[2] = 'S'; rom[3] = 0x1A;
+    rom[4] = 1;
+    rom[5] = 1;
+
+    u8* prg = rom + 16;
+    memcpy(prg, prog, prog_size);
+    u16 nmi = (u16)(0x8000u + nmi_offset);
+    prg[0x3FFA] = (u8)(nmi & 0xFFu); prg[0x3FFB] = (u8)(nmi >> 8);
+    prg[0x3FFC] = 0x00;              prg[0x3FFD] = 0x80;
+    prg[0x3FFE] = (u8)(nmi & 0xFFu); prg[0x3FFF] = (u8)(nmi >> 8);
+
+    *out_size = size;
+    return rom;
+}
+
+static inline u8* Bench_MakeSyntheticROM(size_t* out_size)
+{
+    return Bench_MakeProgramROM(k_bench_prog, sizeof(k_bench_prog),
+                                (u16)(sizeof(k_bench_prog) - 3u), out_size);
+}
+
+// Reads path, or builds the synthetic ROM when path is NULL. Free with free().
+static inline u8* Bench_LoadROM(const char* path, size_t* out_size)
+{
+    if (!path || !*path) return Bench_MakeSyntheticROM(out_size);
+
+    unsigned char* data = NULL;
+    if (!File_ReadAllBytes(path, &data, out_size)) {
+        fprintf(stderr, "failed to read %s\n", path);
+        return NULL;
+    }
+    return (u8*)data;
+}
+
+// Summary of repeated measurements (rates, so higher is better).
+typedef struct BenchStats {
+    int    count;
+    double median;
+    double mean;
+    double stddev;      // sample standard deviation
+    double min;
+    double max;
+} BenchStats;
+
+static inline int Bench_CompareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts samples in place.
+static inline BenchStats Bench_Summarize(double* samples, int count)
+{
+    BenchStats st;
+    memset(&st, 0, sizeof(st));
+    if (count <= 0) return st;
+
+    qsort(samples, (size_t)count, sizeof(samples[0]), Bench_CompareDouble);
+    st.count = count;
+    st.min = samples[0];
+    st.max = samples[count - 1];
+    st.median = (count & 1) ? samples[count / 2]
+                            : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+    st.mean = sum / (double)count;
+
+    if (count > 1) {
+        double var = 0.0;
+        for (int i = 0; i < count; i++) var += (samples[i] - st.mean) * (samples[i] - st.mean);
+        st.stddev = sqrt(var / (double)(count - 1));
+    }
+    return st;
+}
+
+// One-sided Mann-Whitney U test: the probability, if both sets came from
+// the same distribution, of `a` looking at least this much smaller than `b`.
+// Exact for small tie-free samples, normal approximation (tie corrected)
+// otherwise.
+static inline double Bench_MannWhitneyLess(const double* a, int na, const double* b, int nb)
+{
+    if (na <= 0 || nb <= 0) return 1.0;
+
+    double u = 0.0;     // pairs with a < b, ties count half
+    bool ties = false;
+    for (int i = 0; i < na; i++) {
+        for (int k = 0; k < nb; k++) {
+            if (a[i] < b[k]) u += 1.0;
+            else if (a[i] == b[k]) { u += 0.5; ties = true; }
+        }
+    }
+
+    int cells = na * nb;
+    if (!ties && na <= 20 && nb <= 20) {
+        // counts[m][n][u]: orderings of m a's and n b's with u (a < b) pairs,
+        // built up one element at a time; only the (na, *) row is kept.
+        int stride = cells + 1;
+        double* prev = (double*)calloc((size_t)(nb + 1) * (size_t)stride, sizeof(double));
+        double* cur = (double*)calloc((size_t)(nb + 1) * (size_t)stride, sizeof(double));
+        if (!prev || !cur) {
+            free(prev);
+            free(cur);
+            return 1.0;
+        }
+        for (int n = 0; n <= nb; n++) prev[n * stride] = 1.0;     // m = 0
+        for (int m = 1; m <= na; m++) {
+            memset(cur, 0, (size_t)(nb + 1) * (size_t)stride * sizeof(double));
+            cur[0] = 1.0;                                           // n = 0
+            for (int n = 1; n <= nb; n++) {
+                for (int v = 0; v <= m * n; v++) {
+                    // Smallest element is an a (beats all n b's) or a b.
+                    double c = cur[(n - 1) * stride + v];
+                    if (v >= n) c += prev[n * stride + v - n];
+                    cur[n * stride + v] = c;
+                }
+            }
+            double* t = prev; prev = cur; cur = t;
+        }
+
+        double total = 0.0, tail = 0.0;
+        for (int v = 0; v <= cells; v++) {
+            double c = prev[nb * stride + v];
+            total += c;
+            if ((double)v >= u) tail += c;
+        }
+        free(prev);
+        free(cur);
+        return total > 0.0 ? tail / total : 1.0;
+    }
+
+    // Tie correction from the pooled sample.
+    int n = na + nb;
+    double* pooled = (double*)malloc((size_t)n * sizeof(double));
+    if (!pooled) return 1.0;
+    memcpy(pooled, a, (size_t)na * sizeof(double));
+    memcpy(pooled + na, b, (size_t)nb * sizeof(double));
+    qsort(pooled, (size_t)n, sizeof(double), Bench_CompareDouble);
+    double tie_sum = 0.0;
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j < n && pooled[j] == pooled[i]) j++;
+        double t = (double)(j - i);
+        tie_sum += t * t * t - t;
+        i = j;
+    }
+    free(pooled);
+
+    double mean = 0.5 * (double)cells;
+    double var = (double)cells / 12.0 * ((double)(n + 1) - tie_sum / ((double)n * (double)(n - 1)));
+    if (var <= 0.0) return 1.0;
+    double z = (u - mean - 0.5) / sqrt(var);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
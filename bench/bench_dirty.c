@@ -0,0 +1,81 @@
+// Cost of dirty-page tracking on the guest write paths.
+//
+// Usage: bench_dirty [rom.nes] [frames]
+// `make bench` builds this twice: bench_dirty (NES_DIRTY_TRACKING=1) and
+// bench_dirty-notrack (NES_DIRTY_TRACKING=0). Compare the two outputs.
+
+#include "bench_common.h"
+#include "nes/state.h"
+#include <stdio.h>
+
+static double run_frames(Nes* n, int frames, bool consume)
+{
+    u64 pages = 0;
+    double t0 = Bench_Now();
+    for (int f = 0; f < frames; f++) {
+        n->input.p1 = (u8)(f & 1);
+        NES_RunFrame(n);
+        if (consume) {
+            for (int r = 0; r < NES_MEM_REGION_COUNT; r++) {
+                pages += NES_DirtyPageCount(n, (NesMemRegion)r);
+            }
+            NES_ClearAllDirty(n);
+        }
+    }
+    double dt = Bench_Now() - t0;
+    if (consume) printf("  dirty pages/frame: %.2f\n", (double)pages / (double)frames);
+    return (double)frames / dt;
+}
+
+static double ram_write_ns(Nes* n, u32 writes)
+{
+    volatile u8 sink = 0;
+    double t0 = Bench_Now();
+    for (u32 i = 0; i < writes; i++) {
+        Bus_CPUWrite(&n->bus, (u16)(i & 0x07FFu), (u8)i);
+    }
+    double dt = Bench_Now() - t0;
+    sink = Bus_CPURead(&n->bus, 0x0010);
+    (void)sink;
+    return dt * 1e9 / (double)writes;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rom_path = (argc > 1) ? argv[1] : NULL;
+    int frames = (argc > 2) ? atoi(argv[2]) : 600;
+    if (frames <= 0) frames = 600;
+
+    size_t rom_size = 0;
+    u8* rom = Bench_LoadROM(rom_path, &rom_size);
+    if (!rom) return 1;
+
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    if (!n || !NES_Init(n)) return 1;
+    n->quiet = true;
+    if (!NES_LoadROMFromMemory(n, rom, rom_size)) {
+        fprintf(stderr, "failed to load ROM\n");
+        return 1;
+    }
+    NES_Reset(n);
+
+    printf("workload: %s, %d frames, NES_DIRTY_TRACKING=%d\n",
+           rom_path ? rom_path : "synthetic", frames, NES_DIRTY_TRACKING);
+
+    run_frames(n, 60, false); // warm-up
+
+    double fps = run_frames(n, frames, false);
+    printf("frames/s (bitmaps unread)   : %10.1f\n", fps);
+
+    if (NES_DIRTY_TRACKING) {
+        double fps_consumed = run_frames(n, frames, true);
+        printf("frames/s (read+clear/frame) : %10.1f\n", fps_consumed);
+    }
+
+    printf("Bus_CPUWrite to RAM         : %10.3f ns/write\n", ram_write_ns(n, 50u * 1000u * 1000u));
+
+    NES_Destroy(n);
+    free(n);
+    free(rom);
+    return 0;
+}
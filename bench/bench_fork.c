@@ -0,0 +1,102 @@
+// Copy-on-write forks vs. savestate copies for tree-search style branching.
+//
+// Usage: bench_fork [rom.nes] [branches] [frames_per_branch]
+// Each branch starts from the same parent state, runs a few frames with its
+// own input and is thrown away.
+
+#include "bench_common.h"
+#include "nes/state.h"
+#include <stdio.h>
+
+static void load_parent(Nes* n, const u8* rom, size_t rom_size)
+{
+    NES_Init(n);
+    n->quiet = true;
+    if (!NES_LoadROMFromMemory(n, rom, rom_size)) {
+        fprintf(stderr, "failed to load ROM\n");
+        exit(1);
+    }
+    NES_Reset(n);
+    for (int i = 0; i < 60; i++) NES_RunFrame(n);
+}
+
+static u8 branch_input(int branch)
+{
+    return (u8)((u32)branch * 2654435761u >> 24);
+}
+
+int main(int argc, char** argv)
+{
+    const char* rom_path = (argc > 1) ? argv[1] : NULL;
+    int branches = (argc > 2) ? atoi(argv[2]) : 2000;
+    int frames = (argc > 3) ? atoi(argv[3]) : 1;
+    if (branches <= 0) branches = 2000;
+    if (frames < 0) frames = 1;
+
+    size_t rom_size = 0;
+    u8* rom = Bench_LoadROM(rom_path, &rom_size);
+    if (!rom) return 1;
+
+    Nes* parent = (Nes*)malloc(sizeof(Nes));
+    Nes* scratch = (Nes*)malloc(sizeof(Nes));
+    if (!parent || !scratch) return 1;
+    load_parent(parent, rom, rom_size);
+    load_parent(scratch, rom, rom_size);
+
+    size_t state_size = NES_StateSize(parent);
+    u8* state = (u8*)malloc(state_size);
+    if (!state) return 1;
+
+    printf("workload: %s, %d branches x %d frames, state %zu bytes, Nes %zu bytes\n",
+           rom_path ? rom_path : "synthetic", branches, frames, state_size, sizeof(Nes));
+
+    // Fork + run + discard
+    u64 shared = 0;
+    double t0 = Bench_Now();
+    for (int b = 0; b < branches; b++) {
+        Nes* child = NES_Fork(parent);
+        if (!child) return 1;
+        child->input.p1 = branch_input(b);
+        for (int f = 0; f < frames; f++) NES_RunFrame(child);
+        shared += NES_ForkSharedPages(child);
+        NES_FreeFork(child);
+    }
+    double fork_s = Bench_Now() - t0;
+
+    // Savestate copy + run (the scratch console is reused, nothing to discard)
+    t0 = Bench_Now();
+    for (int b = 0; b < branches; b++) {
+        NES_SaveState(parent, state, state_size);
+        NES_LoadState(scratch, state, state_size);
+        scratch->input.p1 = branch_input(b);
+        for (int f = 0; f < frames; f++) NES_RunFrame(scratch);
+    }
+    double copy_s = Bench_Now() - t0;
+
+    // Branch setup cost alone
+    t0 = Bench_Now();
+    for (int b = 0; b < branches; b++) NES_FreeFork(NES_Fork(parent));
+    double fork_only_s = Bench_Now() - t0;
+
+    t0 = Bench_Now();
+    for (int b = 0; b < branches; b++) {
+        NES_SaveState(parent, state, state_size);
+        NES_LoadState(scratch, state, state_size);
+    }
+    double copy_only_s = Bench_Now() - t0;
+
+    double n = (double)branches;
+    printf("fork + run + discard : %9.2f us/branch\n", fork_s * 1e6 / n);
+    printf("save + load + run    : %9.2f us/branch\n", copy_s * 1e6 / n);
+    printf("fork + discard       : %9.3f us/branch\n", fork_only_s * 1e6 / n);
+    printf("save + load          : %9.3f us/branch\n", copy_only_s * 1e6 / n);
+    printf("pages still shared at discard: %.1f avg\n", (double)shared / n);
+
+    free(state);
+    NES_Destroy(scratch);
+    NES_Destroy(parent);
+    free(scratch);
+    free(parent);
+    free(rom);
+    return 0;
+}
@@ -0,0 +1,223 @@
+#pragma once
+// Reader for the JSON written by bench_suite, used to load a baseline.
+//
+// Only the subset the suite emits is understood: objects, arrays, strings
+// without \u escapes, numbers, true/false/null. Each results[] entry yields
+// one BenchBaseline per metric with its raw samples.
+
+#include "bench_common.h"
+#include "nes/util/file.h"
+#include <ctype.h>
+
+enum { BENCH_MAX_SAMPLES = 100 };
+
+typedef struct BenchBaseline {
+    char scenario[320];
+    char metric[64];
+    double median;
+    int count;
+    double samples[BENCH_MAX_SAMPLES];
+} BenchBaseline;
+
+typedef struct BenchJson {
+    const char* p;
+    bool ok;
+} BenchJson;
+
+static inline void BenchJson_Skip(BenchJson* j)
+{
+    while (isspace((unsigned char)*j->p)) j->p++;
+}
+
+static inline bool BenchJson_Eat(BenchJson* j, char c)
+{
+    BenchJson_Skip(j);
+    if (*j->p != c) return false;
+    j->p++;
+    return true;
+}
+
+static inline bool BenchJson_String(BenchJson* j, char* out, size_t cap)
+{
+    if (!BenchJson_Eat(j, '"')) return j->ok = false;
+    size_t n = 0;
+    while (*j->p && *j->p != '"') {
+        char c = *j->p++;
+        if (c == '\\' && *j->p) c = *j->p++;
+        if (out && n + 1 < cap) out[n++] = c;
+    }
+    if (out) out[n] = '\0';
+    if (*j->p != '"') return j->ok = false;
+    j->p++;
+    return true;
+}
+
+static inline double BenchJson_Number(BenchJson* j)
+{
+    BenchJson_Skip(j);
+    char* end = NULL;
+    double v = strtod(j->p, &end);
+    if (end == j->p) j->ok = false;
+    else j->p = end;
+    return v;
+}
+
+static inline void BenchJson_Value(BenchJson* j);
+
+// Calls fn(j, key, user) for each member; fn must consume the value.
+static inline void BenchJson_Object(BenchJson* j, void (*fn)(BenchJson*, const char*, void*), void* user)
+{
+    if (!BenchJson_Eat(j, '{')) {
+        j->ok = false;
+        return;
+    }
+    if (BenchJson_Eat(j, '}')) return;
+    do {
+        char key[64];
+        if (!BenchJson_String(j, key, sizeof(key)) || !BenchJson_Eat(j, ':')) {
+            j->ok = false;
+            return;
+        }
+        if (fn) fn(j, key, user);
+        else BenchJson_Value(j);
+    } while (j->ok && BenchJson_Eat(j, ','));
+    if (!BenchJson_Eat(j, '}')) j->ok = false;
+}
+
+// Calls fn(j, index, user) for each element; fn must consume the value.
+static inline void BenchJson_Array(BenchJson* j, void (*fn)(BenchJson*, int, void*), void* user)
+{
+    if (!BenchJson_Eat(j, '[')) {
+        j->ok = false;
+        return;
+    }
+    if (BenchJson_Eat(j, ']')) return;
+    int i = 0;
+    do {
+        if (fn) fn(j, i++, user);
+        else BenchJson_Value(j);
+    } while (j->ok && BenchJson_Eat(j, ','));
+    if (!BenchJson_Eat(j, ']')) j->ok = false;
+}
+
+static inline void BenchJson_Value(BenchJson* j)
+{
+    BenchJson_Skip(j);
+    switch (*j->p) {
+    case '{': BenchJson_Object(j, NULL, NULL); break;
+    case '[': BenchJson_Array(j, NULL, NULL); break;
+    case '"': BenchJson_String(j, NULL, 0); break;
+    case 't': case 'f': case 'n':
+        while (isalpha((unsigned char)*j->p)) j->p++;
+        break;
+    default: BenchJson_Number(j); break;
+    }
+}
+
+typedef struct BenchBaselineSet {
+    BenchBaseline* items;
+    int count;
+    int cap;
+    char scenario[320];     // results[] entry being read
+    int first;              // its first item
+} BenchBaselineSet;
+
+static inline void bench_json_sample(BenchJson* j, int index, void* user)
+{
+    BenchBaseline* b = (BenchBaseline*)user;
+    double v = BenchJson_Number(j);
+    if (index < BENCH_MAX_SAMPLES) b->samples[b->count++] = v;
+}
+
+static inline void bench_json_metric_field(BenchJson* j, const char* key, void* user)
+{
+    BenchBaseline* b = (BenchBaseline*)user;
+    if (strcmp(key, "samples") == 0) BenchJson_Array(j, bench_json_sample, b);
+    else if (strcmp(key, "median") == 0) b->median = BenchJson_Number(j);
+    else BenchJson_Value(j);
+}
+
+static inline void bench_json_metric(BenchJson* j, const char* key, void* user)
+{
+    BenchBaselineSet* set = (BenchBaselineSet*)user;
+    if (set->count == set->cap) {
+        int cap = set->cap ? set->cap * 2 : 64;
+        BenchBaseline* grown = (BenchBaseline*)realloc(set->items, (size_t)cap * sizeof(BenchBaseline));
+        if (!grown) {
+            j->ok = false;
+            return;
+        }
+        set->items = grown;
+        set->cap = cap;
+    }
+
+    BenchBaseline* b = &set->items[set->count];
+    memset(b, 0, sizeof(*b));
+    snprintf(b->metric, sizeof(b->metric), "%s", key);
+    BenchJson_Object(j, bench_json_metric_field, b);
+    set->count++;
+}
+
+static inline void bench_json_result_field(BenchJson* j, const char* key, void* user)
+{
+    BenchBaselineSet* set = (BenchBaselineSet*)user;
+    if (strcmp(key, "name") == 0) BenchJson_String(j, set->scenario, sizeof(set->scenario));
+    else if (strcmp(key, "metrics") == 0) BenchJson_Object(j, bench_json_metric, set);
+    else BenchJson_Value(j);
+}
+
+static inline void bench_json_result(BenchJson* j, int index, void* user)
+{
+    BenchBaselineSet* set = (BenchBaselineSet*)user;
+    set->scenario[0] = '\0';
+    set->first = set->count;
+    BenchJson_Object(j, bench_json_result_field, set);
+    for (int i = set->first; i < set->count; i++) {
+        snprintf(set->items[i].scenario, sizeof(set->items[i].scenario), "%s", set->scenario);
+    }
+}
+
+static inline void bench_json_top(BenchJson* j, const char* key, void* user)
+{
+    if (strcmp(key, "results") == 0) BenchJson_Array(j, bench_json_result, user);
+    else BenchJson_Value(j);
+}
+
+// Loads every scenario/metric of a bench_suite JSON file. Free items with free().
+static inline bool Bench_LoadBaseline(const char* path, BenchBaseline** out_items, int* out_count)
+{
+    unsigned char* data = NULL;
+    size_t size = 0;
+    if (!File_ReadAllBytes(path, &data, &size)) return false;
+    char* text = (char*)realloc(data, size + 1u);
+    if (!text) {
+        free(data);
+        return false;
+    }
+    text[size] = '\0';
+
+    BenchBaselineSet set;
+    memset(&set, 0, sizeof(set));
+    BenchJson j = { text, true };
+    BenchJson_Object(&j, bench_json_top, &set);
+    free(text);
+
+    if (!j.ok) {
+        free(set.items);
+        return false;
+    }
+    *out_items = set.items;
+    *out_count = set.count;
+    return true;
+}
+
+static inline const BenchBaseline* Bench_FindBaseline(const BenchBaseline* items, int count,
+                                                      const char* scenario, const char* metric)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(items[i].scenario, scenario) == 0 && strcmp(items[i].metric, metric) == 0) {
+            return &items[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,113 @@
+// Lockstep SoA core vs. per-instance emulation on one core.
+//
+// Usage: bench_lockstep [rom.nes] [frames]
+// Without a ROM a synthetic NROM program with input-dependent branches is used.
+
+#include "bench_common.h"
+#include "nes/batch.h"
+#include "nes/cpu/cpu6502_lockstep.h"
+#include "nes/nes.h"
+#include "nes/util/file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static u8 lane_input(int lane, int frame)
+{
+    // Deterministic pseudo-random pads so lanes diverge now and then.
+    u32 h = (u32)lane * 2654435761u ^ (u32)frame * 40503u;
+    return (u8)((h >> 13) & 0x01u);
+}
+
+static double run_lockstep(const Cart* cart, int lanes, int frames, double* out_util)
+{
+    CPU6502Lockstep* ls = (CPU6502Lockstep*)malloc(sizeof(CPU6502Lockstep));
+    if (!ls || !CPU6502Lockstep_Init(ls, cart, lanes)) {
+        free(ls);
+        return 0.0;
+    }
+
+    double t0 = Bench_Now();
+    for (int f = 0; f < frames; f++) {
+        for (int l = 0; l < lanes; l++) {
+            NesInput in = { lane_input(l, f), 0 };
+            CPU6502Lockstep_SetInput(ls, l, in);
+        }
+        CPU6502Lockstep_RunFrame(ls);
+    }
+    double dt = Bench_Now() - t0;
+
+    *out_util = ls->steps ? (double)ls->lane_steps / ((double)ls->steps * (double)lanes) : 0.0;
+    free(ls);
+    return (double)frames * (double)lanes / dt;
+}
+
+static double run_batch(const u8* rom, size_t rom_size, int instances, int frames)
+{
+    NesBatchConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.instances = instances;
+    cfg.threads = 1;
+
+    NesBatch* b = NesBatch_CreateFromMemory(&cfg, rom, rom_size);
+    if (!b) return 0.0;
+
+    NesInput* in = (NesInput*)calloc((size_t)instances, sizeof(NesInput));
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < instances; i++) in[i].p1 = lane_input(i, f);
+        NesBatch_Step(b, in, 1, NULL, 0, NULL);
+    }
+
+    NesBatchStats st;
+    NesBatch_GetStats(b, &st);
+    free(in);
+    NesBatch_Destroy(b);
+    return st.fps_per_core;
+}
+
+int main(int argc, char** argv)
+{
+    const char* rom_path = (argc > 1) ? argv[1] : NULL;
+    int frames = (argc > 2) ? atoi(argv[2]) : 300;
+    if (frames <= 0) frames = 300;
+
+    u8* rom = NULL;
+    size_t rom_size = 0;
+    if (rom_path) {
+        unsigned char* data = NULL;
+        if (!File_ReadAllBytes(rom_path, &data, &rom_size)) {
+            fprintf(stderr, "failed to read %s\n", rom_path);
+            return 1;
+        }
+        rom = (u8*)data;
+    } else {
+        rom = Bench_MakeSyntheticROM(&rom_size);
+    }
+
+    Cart cart;
+    Cart_Init(&cart);
+    if (!rom || !Cart_LoadFromMemory(&cart, rom, rom_size)) {
+        fprintf(stderr, "failed to load ROM\n");
+        return 1;
+    }
+
+    printf("workload: %s, %d frames\n", rom_path ? rom_path : "synthetic", frames);
+    printf("lockstep build: %s, %d lanes max\n", CPU6502Lockstep_Backend(), NES_LOCKSTEP_LANES);
+
+    double util = 0.0;
+    double ls1 = run_lockstep(&cart, 1, frames, &util);
+    printf("lockstep  1 lane : %10.1f frames/s/core\n", ls1);
+
+    for (int lanes = 8; lanes <= NES_LOCKSTEP_LANES; lanes += 8) {
+        double fps = run_lockstep(&cart, lanes, frames, &util);
+        printf("lockstep %2d lanes: %10.1f frames/s/core (lane utilisation %.1f%%)\n",
+               lanes, fps, util * 100.0);
+    }
+
+    double batch = run_batch(rom, rom_size, NES_LOCKSTEP_LANES, frames);
+    printf("NesBatch %2d inst : %10.1f frames/s/core (full PPU/APU)\n", NES_LOCKSTEP_LANES, batch);
+
+    Cart_Destroy(&cart);
+    free(rom);
+    return 0;
+}
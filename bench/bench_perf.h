@@ -0,0 +1,162 @@
+#pragma once
+// Hardware counters around a benchmark, from Linux perf_event_open.
+//
+// Each counter is opened on its own, user space only, for the calling
+// thread, so a PMU without one of the events (VMs often lack the cache ones)
+// still gives the rest. Counters the kernel had to multiplex are scaled by
+// their enabled/running time and flagged, since ratios between them are then
+// estimates. Opening fails on non-Linux hosts, with perf_event_paranoid > 2,
+// and in most containers; BenchPerf_Open then returns false with the reason
+// and callers carry on without counters.
+//
+// Include after defining _GNU_SOURCE (syscall()).
+
+#include "bench_common.h"
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum {
+    BENCH_PERF_CYCLES,
+    BENCH_PERF_INSTRUCTIONS,
+    BENCH_PERF_BRANCHES,
+    BENCH_PERF_BRANCH_MISSES,
+    BENCH_PERF_L1D_MISSES,      // L1 data read misses
+    BENCH_PERF_LLC_MISSES,      // "cache misses": last level on most CPUs
+    BENCH_PERF_COUNT
+};
+
+static const char* const k_bench_perf_names[BENCH_PERF_COUNT] = {
+    "cycles", "instructions", "branches", "branch_misses", "l1d_misses", "llc_misses"
+};
+
+typedef struct BenchPerf {
+    int fd[BENCH_PERF_COUNT];   // -1 = not available
+    int open_count;
+} BenchPerf;
+
+typedef struct BenchPerfSample {
+    double value[BENCH_PERF_COUNT];
+    bool valid[BENCH_PERF_COUNT];
+    bool scaled;                // some counter was multiplexed
+} BenchPerfSample;
+
+#if defined(__linux__)
+
+static inline int bench_perf_open_event(u32 type, u64 config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0UL);
+}
+
+// False when no counter could be opened; *why is then a short reason.
+static inline bool BenchPerf_Open(BenchPerf* p, const char** why)
+{
+    static const struct { u32 type; u64 config; } events[BENCH_PERF_COUNT] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+    };
+
+    int first_errno = 0;
+    p->open_count = 0;
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        p->fd[i] = bench_perf_open_event(events[i].type, events[i].config);
+        if (p->fd[i] >= 0) p->open_count++;
+        else if (!first_errno) first_errno = errno;
+    }
+    if (p->open_count) return true;
+
+    if (why) {
+        switch (first_errno) {
+        case EACCES: case EPERM: *why = "not permitted (see /proc/sys/kernel/perf_event_paranoid)"; break;
+        case ENOENT: case EOPNOTSUPP: *why = "no hardware PMU events on this machine"; break;
+        case ENOSYS: *why = "perf_event_open not supported by the kernel"; break;
+        default: *why = strerror(first_errno); break;
+        }
+    }
+    return false;
+}
+
+static inline void BenchPerf_Close(BenchPerf* p)
+{
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        if (p->fd[i] >= 0) close(p->fd[i]);
+        p->fd[i] = -1;
+    }
+    p->open_count = 0;
+}
+
+// Zeroes and starts every open counter.
+static inline void BenchPerf_Start(BenchPerf* p)
+{
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        if (p->fd[i] < 0) continue;
+        ioctl(p->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// Stops the counters and reads them into *out.
+static inline void BenchPerf_Stop(BenchPerf* p, BenchPerfSample* out)
+{
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        if (p->fd[i] >= 0) ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        u64 v[3];   // value, time enabled, time running
+        if (p->fd[i] < 0 || read(p->fd[i], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) continue;
+        out->value[i] = (double)v[0];
+        if (v[2] < v[1]) {
+            out->value[i] *= (double)v[1] / (double)v[2];
+            out->scaled = true;
+        }
+        out->valid[i] = true;
+    }
+}
+
+#else
+
+static inline bool BenchPerf_Open(BenchPerf* p, const char** why)
+{
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) p->fd[i] = -1;
+    p->open_count = 0;
+    if (why) *why = "perf_event_open is Linux only";
+    return false;
+}
+
+static inline void BenchPerf_Close(BenchPerf* p) { (void)p; }
+static inline void BenchPerf_Start(BenchPerf* p) { (void)p; }
+
+static inline void BenchPerf_Stop(BenchPerf* p, BenchPerfSample* out)
+{
+    (void)p;
+    memset(out, 0, sizeof(*out));
+}
+
+#endif
+
+// a / b when both counters were read, else a negative value.
+static inline double BenchPerf_Ratio(const BenchPerfSample* s, int a, int b)
+{
+    if (!s->valid[a] || !s->valid[b] || s->value[b] <= 0.0) return -1.0;
+    return s->value[a] / s->value[b];
+}
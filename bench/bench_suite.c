@@ -0,0 +1,755 @@
+// Benchmark suite: whole-console throughput per ROM plus per-subsystem
+// microbenchmarks, summarised over repetitions and written as JSON.
+//
+// Usage: bench_suite [--rom-dir DIR] [--matrix tests/rom_matrix.csv]
+//                    [--frames N] [--warmup W] [--reps R] [--filter TEXT]
+//                    [--json out.json] [--pin CPU] [--perf]
+//                    [--baseline base.json [--threshold PCT] [--alpha P]]
+// ROMs are the supported rows of the matrix found under --rom-dir; the
+// synthetic game loop always runs. A table goes to stdout and the JSON to
+// --json (default build/bench/results.json, directories created as needed),
+// one object per scenario with median/mean/stddev/min/max of each rate over
+// the repetitions.
+//
+// With --baseline every metric is compared against the same scenario in an
+// earlier results file: a one-sided Mann-Whitney test over the repetitions
+// flags a regression when p < alpha (default 0.05) and the median dropped by
+// more than the threshold (default 5%). The exit status is 2 if any did.
+// --pin runs on one core; each scenario first spins for a moment so the
+// clock has settled (turbo/boost is reported, since it adds noise).
+//
+// --perf reads hardware counters (bench_perf.h) over each scenario's timed
+// repetitions and adds IPC, branch-miss rate and per-unit counts to the
+// table and a "perf" object to the JSON. The unit is the first metric's
+// ("frame" for whole-console runs, "dot" for the PPU, ...), so L1d/LLC
+// misses per frame or per dot tell a memory-bound loop from a branchy one.
+// Without counters (container, paranoid kernel, no PMU) it says why and runs
+// as usual.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <sys/stat.h>
+
+#include "bench_common.h"
+#include "bench_json.h"
+#include "bench_perf.h"
+#include "nes/apu/apu2a03.h"
+#include "nes/bus.h"
+#include "nes/cpu/cpu6502.h"
+#include "nes/nes.h"
+#include "nes/ppu/ppu2c02.h"
+
+enum {
+    MAX_METRICS     = 3,
+    MAX_REPS        = BENCH_MAX_SAMPLES,
+    DOTS_PER_FRAME  = 341 * 262,
+    CPU_STEPS       = 2000000,
+    BUS_READS       = 4000000,
+    APU_CYCLES      = 2000000,
+    PPU_FRAMES      = 60
+};
+
+#define SETTLE_SECONDS 0.1
+
+typedef struct SuiteConfig {
+    const char* rom_dir;
+    const char* matrix;
+    const char* filter;
+    const char* json_path;
+    const char* baseline_path;
+    int frames;
+    int warmup;
+    int reps;
+    int pin_cpu;            // -1 = not pinned
+    bool perf;
+    double threshold;       // regression threshold, fraction of the median
+    double alpha;
+} SuiteConfig;
+
+typedef struct Suite {
+    SuiteConfig cfg;
+    FILE* json;
+    int results;
+    BenchPerf perf;         // open_count 0 = no counters
+
+    BenchBaseline* baseline;
+    int baseline_count;
+    int compared;
+    int regressions;
+    int improvements;
+} Suite;
+
+// One repetition: does the work, returns elapsed seconds and the amount of
+// each metric's work unit done (rate = work / seconds).
+typedef double (*BenchFn)(void* ctx, double* work);
+
+static volatile u32 g_sink;
+
+// Busy work until the core has run flat out for this long, so frequency
+// ramp-up lands here and not in the first timed repetition.
+static void Bench_Settle(double seconds)
+{
+    u32 x = g_sink;
+    double end = Bench_Now() + seconds;
+    while (Bench_Now() < end) {
+        for (int i = 0; i < 10000; i++) x = x * 1664525u + 1013904223u;
+    }
+    g_sink = x;
+}
+
+static bool pin_to_cpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((size_t)cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// "on", "off" or "unknown", from intel_pstate or the generic cpufreq knob.
+static const char* turbo_state(void)
+{
+    FILE* f = fopen("/sys/devices/system/cpu/intel_pstate/no_turbo", "r");
+    if (f) {
+        int no_turbo = -1;
+        if (fscanf(f, "%d", &no_turbo) != 1) no_turbo = -1;
+        fclose(f);
+        if (no_turbo >= 0) return no_turbo ? "off" : "on";
+    }
+    f = fopen("/sys/devices/system/cpu/cpufreq/boost", "r");
+    if (f) {
+        int boost = -1;
+        if (fscanf(f, "%d", &boost) != 1) boost = -1;
+        fclose(f);
+        if (boost >= 0) return boost ? "on" : "off";
+    }
+    return "unknown";
+}
+
+// mkdir -p for the directory part of path. False with errno set on failure.
+static bool make_parent_dirs(const char* path)
+{
+    char dir[1024];
+    size_t len = strlen(path);
+    if (len >= sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    memcpy(dir, path, len + 1u);
+
+    for (size_t i = 1; i < len; i++) {
+        if (dir[i] != '/' || dir[i - 1u] == '/') continue;
+        dir[i] = '\0';
+        bool ok = mkdir(dir, 0777) == 0 || errno == EEXIST;
+        dir[i] = '/';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static void json_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') fprintf(f, "\\%c", ch);
+        else if (ch < 0x20u) fprintf(f, "\\u%04x", ch);
+        else fputc(ch, f);
+    }
+    fputc('"', f);
+}
+
+// Appends the baseline columns to the current table line.
+static void compare(Suite* s, const char* name, const char* metric, const double* samples,
+                    const BenchStats* st)
+{
+    const BenchBaseline* b = Bench_FindBaseline(s->baseline, s->baseline_count, name, metric);
+    if (!b || b->count == 0 || b->median <= 0.0) {
+        printf("  %14s  %8s  %7s  new", "-", "-", "-");
+        return;
+    }
+
+    double delta = st->median / b->median - 1.0;
+    double p_slower = Bench_MannWhitneyLess(samples, st->count, b->samples, b->count);
+    double p_faster = Bench_MannWhitneyLess(b->samples, b->count, samples, st->count);
+
+    const char* verdict = "ok";
+    double p = p_slower;
+    if (p_slower < s->cfg.alpha && delta < -s->cfg.threshold) {
+        verdict = "REGRESSED";
+        s->regressions++;
+    } else if (p_faster < s->cfg.alpha && delta > s->cfg.threshold) {
+        verdict = "improved";
+        p = p_faster;
+        s->improvements++;
+    }
+    s->compared++;
+    printf("  %14.6g  %+7.2f%%  %7.4f  %s", b->median, 100.0 * delta, p, verdict);
+}
+
+// "frames_per_sec" -> "frame": what the first metric counts.
+static void work_unit(const char* metric, char* out, size_t cap)
+{
+    const char* end = strstr(metric, "_per_sec");
+    size_t n = end ? (size_t)(end - metric) : strlen(metric);
+    if (n > 1 && metric[n - 1] == 's') n--;
+    if (n >= cap) n = cap - 1;
+    memcpy(out, metric, n);
+    out[n] = '\0';
+}
+
+// Counters over all timed repetitions, `units` of the first metric's work.
+static void report_perf(Suite* s, const char* metric, const BenchPerfSample* ps, double units)
+{
+    char unit[32];
+    work_unit(metric, unit, sizeof(unit));
+    double ipc = BenchPerf_Ratio(ps, BENCH_PERF_INSTRUCTIONS, BENCH_PERF_CYCLES);
+    double miss_rate = BenchPerf_Ratio(ps, BENCH_PERF_BRANCH_MISSES, BENCH_PERF_BRANCHES);
+
+    FILE* f = s->json;
+    fprintf(f, ",\n      \"perf\": {\"unit\": ");
+    json_string(f, unit);
+    fprintf(f, ", \"units\": %.9g, \"multiplexed\": %s", units, ps->scaled ? "true" : "false");
+    if (ipc >= 0.0) fprintf(f, ", \"ipc\": %.6g", ipc);
+    if (miss_rate >= 0.0) fprintf(f, ", \"branch_miss_rate\": %.6g", miss_rate);
+    for (int pass = 0; pass < 2; pass++) {
+        fprintf(f, pass ? ", \"per_unit\": {" : ", \"counters\": {");
+        int written = 0;
+        for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+            if (!ps->valid[i] || (pass && units <= 0.0)) continue;
+            fprintf(f, "%s\"%s\": %.9g", written++ ? ", " : "", k_bench_perf_names[i],
+                    pass ? ps->value[i] / units : ps->value[i]);
+        }
+        fputc('}', f);
+    }
+    fputc('}', f);
+
+    printf("%-40s %-24s", "", "perf");
+    if (ipc >= 0.0) printf(" ipc %.2f", ipc);
+    if (miss_rate >= 0.0) printf(", branch miss %.2f%%", 100.0 * miss_rate);
+    if (units > 0.0) {
+        printf(", per %s:", unit);
+        static const struct { int counter; const char* label; } shown[] = {
+            { BENCH_PERF_INSTRUCTIONS, "insns" },
+            { BENCH_PERF_BRANCH_MISSES, "br-miss" },
+            { BENCH_PERF_L1D_MISSES, "L1d-miss" },
+            { BENCH_PERF_LLC_MISSES, "LLC-miss" }
+        };
+        for (size_t i = 0; i < sizeof(shown) / sizeof(shown[0]); i++) {
+            if (ps->valid[shown[i].counter]) printf(" %.4g %s", ps->value[shown[i].counter] / units, shown[i].label);
+        }
+    }
+    printf("%s\n", ps->scaled ? " (multiplexed)" : "");
+}
+
+static void run_scenario(Suite* s, const char* name, const char* const* metrics, int metric_count,
+                         BenchFn fn, void* ctx)
+{
+    if (s->cfg.filter && !strstr(name, s->cfg.filter)) return;
+
+    Bench_Settle(SETTLE_SECONDS);
+
+    double work[MAX_METRICS];
+    for (int i = 0; i < s->cfg.warmup; i++) fn(ctx, work);
+
+    static double samples[MAX_METRICS][MAX_REPS];
+    double units = 0.0;
+    BenchPerfSample ps;
+    if (s->perf.open_count) BenchPerf_Start(&s->perf);
+    for (int r = 0; r < s->cfg.reps; r++) {
+        memset(work, 0, sizeof(work));
+        double dt = fn(ctx, work);
+        if (dt <= 0.0) dt = 1e-9;
+        for (int m = 0; m < metric_count; m++) samples[m][r] = work[m] / dt;
+        units += work[0];
+    }
+    if (s->perf.open_count) BenchPerf_Stop(&s->perf, &ps);
+
+    FILE* f = s->json;
+    fprintf(f, "%s\n    {\"name\": ", s->results ? "," : "");
+    json_string(f, name);
+    fprintf(f, ", \"warmup\": %d, \"repetitions\": %d, \"metrics\": {", s->cfg.warmup, s->cfg.reps);
+
+    for (int m = 0; m < metric_count; m++) {
+        BenchStats st = Bench_Summarize(samples[m], s->cfg.reps);
+        fprintf(f, "%s\n      ", m ? "," : "");
+        json_string(f, metrics[m]);
+        fprintf(f, ": {\"median\": %.6g, \"mean\": %.6g, \"stddev\": %.6g, \"min\": %.6g, \"max\": %.6g,",
+                st.median, st.mean, st.stddev, st.min, st.max);
+        fprintf(f, " \"samples\": [");
+        for (int r = 0; r < s->cfg.reps; r++) fprintf(f, "%s%.9g", r ? ", " : "", samples[m][r]);
+        fprintf(f, "]}");
+        printf("%-40s %-24s %14.6g  (sd %5.2f%%)", m ? "" : name, metrics[m],
+               st.median, st.median > 0.0 ? 100.0 * st.stddev / st.median : 0.0);
+        if (s->baseline) compare(s, name, metrics[m], samples[m], &st);
+        printf("\n");
+    }
+    fprintf(f, "\n    }");
+    if (s->perf.open_count) report_perf(s, metrics[0], &ps, units);
+    fprintf(f, "}");
+    s->results++;
+}
+
+static Nes* make_console(const u8* rom, size_t rom_size)
+{
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    if (!n) return NULL;
+    if (!NES_Init(n)) {
+        free(n);
+        return NULL;
+    }
+    n->quiet = true;
+    if (!NES_LoadROMFromMemory(n, rom, rom_size)) {
+        NES_Destroy(n);
+        free(n);
+        return NULL;
+    }
+    NES_Reset(n);
+    return n;
+}
+
+static void free_console(Nes* n)
+{
+    if (!n) return;
+    NES_Destroy(n);
+    free(n);
+}
+
+/* =========================
+   Whole console, unpaced
+   ========================= */
+
+typedef struct ConsoleCtx {
+    Nes* nes;
+    int frames;
+} ConsoleCtx;
+
+static const char* const k_console_metrics[] = { "frames_per_sec", "cpu_instructions_per_sec", "ppu_dots_per_sec" };
+
+static double bench_console(void* p, double* work)
+{
+    ConsoleCtx* c = (ConsoleCtx*)p;
+    u64 insn0 = c->nes->cpu.instructions;
+    u64 cyc0 = c->nes->cpu.cycles;
+
+    double t0 = Bench_Now();
+    for (int f = 0; f < c->frames; f++) NES_RunFrame(c->nes);
+    double dt = Bench_Now() - t0;
+
+    work[0] = (double)c->frames;
+    work[1] = (double)(c->nes->cpu.instructions - insn0);
+    work[2] = (double)(c->nes->cpu.cycles - cyc0) * 3.0;
+    return dt;
+}
+
+static void run_console(Suite* s, const char* label, const u8* rom, size_t rom_size)
+{
+    ConsoleCtx c = { make_console(rom, rom_size), s->cfg.frames };
+    if (!c.nes) {
+        fprintf(stderr, "%s: failed to load, skipped\n", label);
+        return;
+    }
+
+    char name[320];
+    snprintf(name, sizeof(name), "console/%s", label);
+    run_scenario(s, name, k_console_metrics, 3, bench_console, &c);
+    free_console(c.nes);
+}
+
+// Column 0 is the file name, column 2 "supported_now"; names may be quoted.
+static int csv_field(const char** line, char* out, size_t cap)
+{
+    const char* p = *line;
+    size_t n = 0;
+    bool quoted = (*p == '"');
+    if (quoted) p++;
+
+    while (*p && *p != '\n' && *p != '\r') {
+        if (quoted && *p == '"') {
+            if (p[1] == '"') {
+                p++;
+            } else {
+                quoted = false;
+                p++;
+                continue;
+            }
+        } else if (!quoted && *p == ',') {
+            break;
+        }
+        if (n + 1 < cap) out[n++] = *p;
+        p++;
+    }
+    out[n] = '\0';
+    if (*p == ',') p++;
+    *line = p;
+    return (int)n;
+}
+
+static void run_matrix(Suite* s)
+{
+    if (!s->cfg.rom_dir) return;
+
+    unsigned char* csv = NULL;
+    size_t csv_size = 0;
+    if (!File_ReadAllBytes(s->cfg.matrix, &csv, &csv_size)) {
+        fprintf(stderr, "failed to read %s\n", s->cfg.matrix);
+        return;
+    }
+    char* text = (char*)realloc(csv, csv_size + 1u);
+    if (!text) {
+        free(csv);
+        return;
+    }
+    text[csv_size] = '\0';
+
+    const char* line = strchr(text, '\n');     // skip the header
+    while (line && *++line) {
+        char rom_name[256], mapper[16], supported[16];
+        const char* p = line;
+        csv_field(&p, rom_name, sizeof(rom_name));
+        csv_field(&p, mapper, sizeof(mapper));
+        csv_field(&p, supported, sizeof(supported));
+        line = strchr(line, '\n');
+        if (!rom_name[0] || strcmp(supported, "yes") != 0) continue;
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", s->cfg.rom_dir, rom_name);
+        unsigned char* rom = NULL;
+        size_t rom_size = 0;
+        if (!File_ReadAllBytes(path, &rom, &rom_size)) {
+            fprintf(stderr, "%s: not found, skipped\n", rom_name);
+            continue;
+        }
+        run_console(s, rom_name, rom, rom_size);
+        free(rom);
+    }
+    free(text);
+}
+
+/* =========================
+   CPU6502_Step
+   ========================= */
+
+// Arithmetic and shifts in a register-only loop.
+static const u8 k_prog_alu[] = {
+    0x18,                   // $8000 CLC
+    0xA9, 0x00,             //       LDA #$00
+    0x69, 0x03,             // $8003 ADC #$03
+    0x49, 0x5A,             //       EOR #$5A
+    0x0A,                   //       ASL A
+    0x6A,                   //       ROR A
+    0xE8,                   //       INX
+    0x88,                   //       DEY
+    0x4C, 0x03, 0x80        //       JMP $8003
+};
+
+// Indexed loads and stores over two RAM pages.
+static const u8 k_prog_memory[] = {
+    0xA2, 0x00,             // $8000 LDX #$00
+    0xBD, 0x00, 0x02,       // $8002 LDA $0200,X
+    0x18,                   //       CLC
+    0x65, 0x00,             //       ADC $00
+    0x9D, 0x00, 0x03,       //       STA $0300,X
+    0x85, 0x00,             //       STA $00
+    0xE8,                   //       INX
+    0x4C, 0x02, 0x80        //       JMP $8002
+};
+
+// A data-dependent branch taken one time in four.
+static const u8 k_prog_branchy[] = {
+    0xA2, 0x00,             // $8000 LDX #$00
+    0x8A,                   // $8002 TXA
+    0x29, 0x03,             //       AND #$03
+    0xF0, 0x02,             //       BEQ skip
+    0xE6, 0x10,             //       INC $10
+    0xE8,                   // skip: INX
+    0xD0, 0xF6,             //       BNE $8002
+    0x4C, 0x00, 0x80        //       JMP $8000
+};
+
+static const char* const k_cpu_metrics[] = { "instructions_per_sec" };
+
+static double bench_cpu_step(void* p, double* work)
+{
+    Nes* n = (Nes*)p;
+    u64 insn0 = n->cpu.instructions;
+
+    double t0 = Bench_Now();
+    for (int i = 0; i < CPU_STEPS; i++) CPU6502_Step(&n->cpu);
+    double dt = Bench_Now() - t0;
+
+    work[0] = (double)(n->cpu.instructions - insn0);
+    return dt;
+}
+
+static void run_cpu(Suite* s, const char* label, const u8* prog, size_t prog_size)
+{
+    size_t rom_size = 0;
+    u8* rom = Bench_MakeProgramROM(prog, prog_size, 0, &rom_size);
+    Nes* n = rom ? make_console(rom, rom_size) : NULL;
+    free(rom);
+    if (!n) return;
+
+    char name[64];
+    snprintf(name, sizeof(name), "cpu_step/%s", label);
+    run_scenario(s, name, k_cpu_metrics, 1, bench_cpu_step, n);
+    free_console(n);
+}
+
+/* =========================
+   PPU2C02_Clock
+   ========================= */
+
+static const char* const k_ppu_metrics[] = { "dots_per_sec" };
+
+static double bench_ppu_clock(void* p, double* work)
+{
+    PPU2C02* ppu = (PPU2C02*)p;
+    long dots = (long)PPU_FRAMES * DOTS_PER_FRAME;
+
+    double t0 = Bench_Now();
+    for (long d = 0; d < dots; d++) PPU2C02_Clock(ppu);
+    double dt = Bench_Now() - t0;
+
+    work[0] = (double)dots;
+    return dt;
+}
+
+static void run_ppu(Suite* s, Nes* n)
+{
+    PPU2C02* ppu = &n->bus.ppu;
+    for (int i = 0; i < 0x3C0; i++) ppu->nametables[i] = (u8)i;
+    for (int i = 0; i < 256; i++) ppu->oam[i] = (u8)((u32)i * 37u);
+
+    ppu->mask = 0x1Eu;
+    run_scenario(s, "ppu_clock/render_on", k_ppu_metrics, 1, bench_ppu_clock, ppu);
+    ppu->mask = 0x00u;
+    run_scenario(s, "ppu_clock/render_off", k_ppu_metrics, 1, bench_ppu_clock, ppu);
+}
+
+/* =========================
+   Bus_CPURead
+   ========================= */
+
+typedef struct BusCtx {
+    Bus* bus;
+    u16 base;
+    u16 mask;
+} BusCtx;
+
+static const char* const k_bus_metrics[] = { "reads_per_sec" };
+
+static double bench_bus_read(void* p, double* work)
+{
+    BusCtx* c = (BusCtx*)p;
+    u32 sum = 0;
+
+    double t0 = Bench_Now();
+    for (u32 i = 0; i < BUS_READS; i++) {
+        sum += Bus_CPURead(c->bus, (u16)(c->base + ((i * 97u) & c->mask)));
+    }
+    double dt = Bench_Now() - t0;
+
+    g_sink += sum;
+    work[0] = (double)BUS_READS;
+    return dt;
+}
+
+static void run_bus(Suite* s, Nes* n)
+{
+    static const struct { const char* name; u16 base; u16 mask; } regions[] = {
+        { "bus_read/ram",      0x0000u, 0x1FFFu },
+        { "bus_read/ppu_regs", 0x2000u, 0x1FFFu },
+        { "bus_read/apu_io",   0x4000u, 0x001Fu },
+        { "bus_read/prg_rom",  0x8000u, 0x7FFFu }
+    };
+    for (size_t i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        BusCtx c = { &n->bus, regions[i].base, regions[i].mask };
+        run_scenario(s, regions[i].name, k_bus_metrics, 1, bench_bus_read, &c);
+    }
+}
+
+/* =========================
+   APU2A03 (catch-up advance)
+   ========================= */
+
+typedef struct ApuCtx {
+    APU2A03 apu;
+    u32 step;
+} ApuCtx;
+
+static const char* const k_apu_metrics[] = { "cycles_per_sec" };
+
+static u8 dmc_data(void* user, u16 addr)
+{
+    (void)user;
+    return (u8)(addr * 2654435761u >> 24);
+}
+
+static double bench_apu(void* p, double* work)
+{
+    ApuCtx* c = (ApuCtx*)p;
+
+    double t0 = Bench_Now();
+    for (u32 cyc = 0; cyc < APU_CYCLES; cyc += c->step) APU2A03_Advance(&c->apu, c->step);
+    APU2A03_EndFrame(&c->apu);
+    double dt = Bench_Now() - t0;
+
+    work[0] = (double)APU_CYCLES;
+    return dt;
+}
+
+static void run_apu(Suite* s)
+{
+    ApuCtx* c = (ApuCtx*)malloc(sizeof(ApuCtx));
+    if (!c) return;
+    APU2A03_Init(&c->apu);
+    APU2A03_SetDMCReader(&c->apu, dmc_data, NULL);
+
+    // Every channel playing, as in bench_apu.
+    APU2A03_Write(&c->apu, 0x4015, 0x1F);
+    APU2A03_Write(&c->apu, 0x4000, 0xBF);
+    APU2A03_Write(&c->apu, 0x4002, 0x80);
+    APU2A03_Write(&c->apu, 0x4003, 0x08);
+    APU2A03_Write(&c->apu, 0x4004, 0x7C);
+    APU2A03_Write(&c->apu, 0x4006, 0x40);
+    APU2A03_Write(&c->apu, 0x4007, 0x09);
+    APU2A03_Write(&c->apu, 0x4008, 0xFF);
+    APU2A03_Write(&c->apu, 0x400A, 0xC0);
+    APU2A03_Write(&c->apu, 0x400B, 0x08);
+    APU2A03_Write(&c->apu, 0x400C, 0x3F);
+    APU2A03_Write(&c->apu, 0x400E, 0x05);
+    APU2A03_Write(&c->apu, 0x400F, 0x08);
+    APU2A03_Write(&c->apu, 0x4010, 0x4E);
+    APU2A03_Write(&c->apu, 0x4013, 0x20);
+    APU2A03_Write(&c->apu, 0x4015, 0x1F);
+
+    c->step = 1;    // per CPU cycle
+    run_scenario(s, "apu/tick_1", k_apu_metrics, 1, bench_apu, c);
+    c->step = 3;    // per instruction, as the console loop advances it
+    run_scenario(s, "apu/tick_3", k_apu_metrics, 1, bench_apu, c);
+    free(c);
+}
+
+static void usage(const char* exe)
+{
+    fprintf(stderr,
+            "Usage: %s [--rom-dir DIR] [--matrix tests/rom_matrix.csv] [--frames N]\n"
+            "       [--warmup W] [--reps R] [--filter TEXT] [--json out.json] [--pin CPU] [--perf]\n"
+            "       [--baseline base.json [--threshold PCT] [--alpha P]]\n",
+            exe);
+}
+
+int main(int argc, char** argv)
+{
+    Suite s;
+    memset(&s, 0, sizeof(s));
+    s.cfg.matrix = "tests/rom_matrix.csv";
+    s.cfg.frames = 600;
+    s.cfg.warmup = 1;
+    s.cfg.reps = 5;
+    s.cfg.json_path = "build/bench/results.json";
+    s.cfg.pin_cpu = -1;
+    s.cfg.threshold = 0.05;
+    s.cfg.alpha = 0.05;
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) s.perf.fd[i] = -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--rom-dir") == 0 && has_value) s.cfg.rom_dir = argv[++i];
+        else if (strcmp(a, "--matrix") == 0 && has_value) s.cfg.matrix = argv[++i];
+        else if (strcmp(a, "--frames") == 0 && has_value) s.cfg.frames = atoi(argv[++i]);
+        else if (strcmp(a, "--warmup") == 0 && has_value) s.cfg.warmup = atoi(argv[++i]);
+        else if (strcmp(a, "--reps") == 0 && has_value) s.cfg.reps = atoi(argv[++i]);
+        else if (strcmp(a, "--filter") == 0 && has_value) s.cfg.filter = argv[++i];
+        else if (strcmp(a, "--json") == 0 && has_value) s.cfg.json_path = argv[++i];
+        else if (strcmp(a, "--pin") == 0 && has_value) s.cfg.pin_cpu = atoi(argv[++i]);
+        else if (strcmp(a, "--perf") == 0) s.cfg.perf = true;
+        else if (strcmp(a, "--baseline") == 0 && has_value) s.cfg.baseline_path = argv[++i];
+        else if (strcmp(a, "--threshold") == 0 && has_value) s.cfg.threshold = atof(argv[++i]) / 100.0;
+        else if (strcmp(a, "--alpha") == 0 && has_value) s.cfg.alpha = atof(argv[++i]);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (s.cfg.frames <= 0) s.cfg.frames = 600;
+    if (s.cfg.warmup < 0) s.cfg.warmup = 0;
+    if (s.cfg.reps <= 0 || s.cfg.reps > MAX_REPS) s.cfg.reps = 5;
+
+    if (s.cfg.baseline_path &&
+        !Bench_LoadBaseline(s.cfg.baseline_path, &s.baseline, &s.baseline_count)) {
+        fprintf(stderr, "cannot read baseline %s\n", s.cfg.baseline_path);
+        return 1;
+    }
+    if (s.cfg.pin_cpu >= 0 && !pin_to_cpu(s.cfg.pin_cpu)) {
+        fprintf(stderr, "cannot pin to cpu %d, running unpinned\n", s.cfg.pin_cpu);
+        s.cfg.pin_cpu = -1;
+    }
+    const char* turbo = turbo_state();
+    printf("cpu %d, turbo %s%s\n", s.cfg.pin_cpu, turbo,
+           strcmp(turbo, "on") == 0 ? " (expect extra noise)" : "");
+    if (s.cfg.perf) {
+        const char* why = NULL;
+        if (BenchPerf_Open(&s.perf, &why)) {
+            printf("perf counters:");
+            for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+                printf(" %s%s", k_bench_perf_names[i], s.perf.fd[i] >= 0 ? "" : " (unavailable)");
+            }
+            printf("\n");
+        } else {
+            printf("perf counters unavailable: %s\n", why);
+        }
+    }
+    if (s.baseline) {
+        printf("%-40s %-24s %14s  %10s  %14s  %8s  %7s\n", "scenario", "metric", "median", "",
+               "baseline", "delta", "p");
+    }
+
+    if (!make_parent_dirs(s.cfg.json_path)) {
+        fprintf(stderr, "cannot create the directory for %s: %s\n", s.cfg.json_path, strerror(errno));
+        return 1;
+    }
+    s.json = fopen(s.cfg.json_path, "w");
+    if (!s.json) {
+        fprintf(stderr, "cannot write %s: %s\n", s.cfg.json_path, strerror(errno));
+        return 1;
+    }
+    fprintf(s.json, "{\n  \"suite\": \"nes\",\n  \"frames\": %d,\n  \"pinned_cpu\": %d,\n"
+                    "  \"turbo\": \"%s\",\n  \"perf_counters\": %s,\n  \"results\": [",
+            s.cfg.frames, s.cfg.pin_cpu, turbo, s.perf.open_count ? "true" : "false");
+
+    size_t rom_size = 0;
+    u8* synthetic = Bench_MakeSyntheticROM(&rom_size);
+    if (!synthetic) return 1;
+
+    run_console(&s, "synthetic", synthetic, rom_size);
+    run_matrix(&s);
+
+    run_cpu(&s, "alu", k_prog_alu, sizeof(k_prog_alu));
+    run_cpu(&s, "memory", k_prog_memory, sizeof(k_prog_memory));
+    run_cpu(&s, "branchy", k_prog_branchy, sizeof(k_prog_branchy));
+
+    Nes* n = make_console(synthetic, rom_size);
+    if (n) {
+        run_ppu(&s, n);
+        run_bus(&s, n);
+        free_console(n);
+    }
+    run_apu(&s);
+    free(synthetic);
+
+    fprintf(s.json, "\n  ]\n}\n");
+    fclose(s.json);
+    BenchPerf_Close(&s.perf);
+    printf("wrote %s\n", s.cfg.json_path);
+
+    if (s.baseline) {
+        printf("%d metrics compared against %s: %d regressed, %d improved (threshold %.1f%%, alpha %g)\n",
+               s.compared, s.cfg.baseline_path, s.regressions, s.improvements,
+               100.0 * s.cfg.threshold, s.cfg.alpha);
+        free(s.baseline);
+    }
+    return s.regressions ? 2 : 0;
+}
@@ -2,14 +2,96 @@
 #include "nes/common.h"
 #include <stdbool.h>
 
+typedef struct Blip Blip;
+
 enum {
     APU_PULSE_CH1 = 0,
     APU_PULSE_CH2 = 1,
     APU_TRIANGLE  = 2,
     APU_NOISE     = 3,
-    APU_DMC       = 4
+    APU_DMC       = 4,
+    APU_CHANNELS  = 5
 };
 
+// NTSC CPU clock; APU timestamps are CPU cycles since reset.
+#define APU_CLOCK_RATE 1789773.0
+
+// The APU is a catch-up component. APU2A03_Advance only moves the cycle
+// counter; work happens when registers are accessed, at the end of a frame,
+// or when the cycle reaches `next_event` (a frame sequencer step or the
+// predicted DMC IRQ). Catching up processes the sequencer steps in order and
+// runs every channel, stepping only at timer expiries and reporting output
+// changes to the Blip buffer (when one is attached). Silent channels are
+// advanced arithmetically.
+
+typedef struct APUEnvelope {
+    bool start;
+    bool loop;          // also the length counter halt flag
+    bool constant;
+    u8 period;          // also the constant volume
+    u8 divider;
+    u8 decay;
+} APUEnvelope;
+
+typedef struct APUPulse {
+    APUEnvelope env;
+    u8 duty;
+    u8 seq;
+    u16 period;         // 11-bit timer reload
+    u64 next_step;      // cycle of the next sequencer step
+
+    bool sweep_enabled;
+    bool sweep_negate;
+    bool sweep_reload;
+    u8 sweep_period;
+    u8 sweep_shift;
+    u8 sweep_divider;
+
+    u8 length;
+} APUPulse;
+
+typedef struct APUTriangle {
+    bool control;       // length halt / linear counter control
+    bool linear_reload_flag;
+    u8 linear_reload;
+    u8 linear;
+    u8 seq;
+    u16 period;
+    u64 next_step;
+    u8 length;
+} APUTriangle;
+
+typedef struct APUNoise {
+    APUEnvelope env;
+    bool mode;
+    u8 period_index;
+    u16 lfsr;
+    u64 next_step;
+    u8 length;
+} APUNoise;
+
+typedef struct APUDMC {
+    bool irq_enabled;
+    bool loop;
+    u8 rate_index;
+    u8 level;           // 7-bit output level
+    u16 sample_addr;    // $4012 start address
+    u16 sample_length;  // $4013 length in bytes
+
+    u16 addr;           // current fetch address
+    u16 bytes_remaining;
+    u8 buffer;
+    bool buffer_full;
+    u8 shift;
+    u8 bits_remaining;
+    bool silence;
+    u64 next_step;
+    bool irq_flag;
+} APUDMC;
+
+// Reads a byte of DMC sample data ($8000-$FFFF) for the APU.
+typedef u8 (*APUDmcReadFn)(void* user, u16 addr);
+
 typedef struct APU2A03 {
     // Raw register mirror for $4000-$4013
     u8 regs[0x14];
@@ -20,32 +102,60 @@ typedef struct APU2A03 {
     bool frame_irq_pending;
     bool frame_irq_inhibit;
     bool five_step_mode;
-    u32 frame_cycle;
-
-    // Channel length counters: pulse1, pulse2, triangle, noise
-    u8 length_ctr[4];
+    u8 frame_step;          // next step of the sequence
+    u64 frame_seq_start;    // cycle the current sequence started
+    u64 frame_next;         // cycle of the next sequencer step
 
-    // Pulse channel state (minimal functional model)
-    u16 pulse_timer_period[2];
-    u16 pulse_timer_value[2];
-    u8 pulse_seq_step[2];
-    u8 pulse_duty[2];
+    APUPulse pulse[2];
+    APUTriangle triangle;
+    APUNoise noise;
+    APUDMC dmc;
 
-    bool pulse_const_vol[2];
-    bool pulse_env_loop[2];
-    u8 pulse_env_period[2];
-    u8 pulse_env_divider[2];
-    u8 pulse_env_decay[2];
-    bool pulse_env_start[2];
+    u64 cycle;              // current CPU cycle
+    u64 sync_cycle;         // channels have been run up to here
+    u64 dmc_irq_cycle;      // cycle the DMC IRQ will fire (UINT64_MAX if none)
+    u64 next_event;         // min(frame_next, dmc_irq_cycle)
 
-    u8 pulse_output[2];
+    // Host side (not part of the emulated state; must stay last). amp only
+    // tracks what was reported to `out`, so it differs with audio on or off.
+    int amp[APU_CHANNELS];  // last output reported per channel (mixer units)
+    u64 frame_start;        // cycle of the current audio frame's clock 0
+    APUDmcReadFn dmc_read;
+    void* dmc_user;
+    Blip* out;              // NULL = no audio synthesis
 } APU2A03;
 
 bool APU2A03_Init(APU2A03* a);
 void APU2A03_Reset(APU2A03* a);
 
+void APU2A03_SetDMCReader(APU2A03* a, APUDmcReadFn fn, void* user);
+
+// Attaches (or detaches, with NULL) the band-limited output buffer.
+void APU2A03_SetOutput(APU2A03* a, Blip* out);
+
 void APU2A03_Write(APU2A03* a, u16 addr, u8 data);
 u8 APU2A03_ReadStatus(APU2A03* a, u8 open_bus);
 
-// Tick one CPU cycle. Returns true when frame IRQ should be requested.
-bool APU2A03_Tick(APU2A03* a);
+// Catches up to the current cycle: sequencer steps, channels, IRQ flags.
+void APU2A03_Run(APU2A03* a);
+
+// IRQ line as of the last catch-up (frame or DMC interrupt flag).
+static inline bool APU2A03_IRQLine(const APU2A03* a)
+{
+    return (a->frame_irq_pending && !a->frame_irq_inhibit) || a->dmc.irq_flag;
+}
+
+// Advances `cycles` CPU cycles. Returns true while an IRQ should be requested.
+static inline bool APU2A03_Advance(APU2A03* a, u32 cycles)
+{
+    a->cycle += cycles;
+    if (a->cycle >= a->next_event) APU2A03_Run(a);
+    return APU2A03_IRQLine(a);
+}
+
+// Cycle at which the IRQ line will next be high (the current cycle if it
+// already is), assuming no register writes in between; UINT64_MAX if never.
+u64 APU2A03_NextIRQCycle(const APU2A03* a);
+
+// Runs the channels and closes the audio frame, making its samples readable.
+void APU2A03_EndFrame(APU2A03* a);
@@ -0,0 +1,44 @@
+#pragma once
+#include "nes/common.h"
+
+// Band-limited step buffer. Sound sources report amplitude changes (deltas) at
+// clock timestamps; each delta is spread over BLIP_TAPS output samples with a
+// windowed-sinc kernel chosen by its sub-sample phase, and reading integrates
+// the result. Sources therefore only do work when their output changes, and
+// square edges come out without aliasing.
+
+enum {
+    BLIP_PHASES     = 32,   // sub-sample kernel resolution
+    BLIP_TAPS       = 16,   // kernel width in output samples (even)
+    BLIP_KERNEL_ONE = 1 << 15,
+    BLIP_BASS_SHIFT = 9     // DC-blocking high-pass, ~14 Hz at 44.1 kHz
+};
+
+typedef struct Blip {
+    u64 factor;         // output samples per clock, 32.32 fixed point
+    u64 offset;         // time of clock 0 of the current frame, 32.32 samples
+    int avail;          // samples ready to read
+    int size;           // capacity in samples
+    s32 integrator;
+    u64 dropped;        // samples discarded because nobody read them
+    s32* buf;           // size + BLIP_TAPS accumulators
+    s16 kernel[BLIP_PHASES + 1][BLIP_TAPS];
+} Blip;
+
+// max_samples bounds what can be buffered between reads.
+bool Blip_Init(Blip* b, double clock_rate, double sample_rate, int max_samples);
+void Blip_Destroy(Blip* b);
+void Blip_Clear(Blip* b);
+
+// Adds an amplitude change at `clock` clocks into the current frame.
+void Blip_AddDelta(Blip* b, u32 clock, int delta);
+
+// Ends the frame after `clocks` clocks; the samples it covers become readable.
+// At most max_samples / 2 samples stay buffered; older unread samples are
+// dropped (see `dropped`), so size the buffer for twice the read interval.
+void Blip_EndFrame(Blip* b, u32 clocks);
+
+static inline int Blip_SamplesAvail(const Blip* b) { return b ? b->avail : 0; }
+
+// Reads up to `count` mono samples (out may be NULL to discard).
+int  Blip_ReadSamples(Blip* b, s16* out, int count);
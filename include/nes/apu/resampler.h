@@ -0,0 +1,60 @@
+#pragma once
+#include "nes/common.h"
+
+// Windowed-sinc resampler with an adjustable ratio, used for dynamic rate
+// control: the output rate is nudged by up to RESAMPLER_MAX_ADJUST so the
+// host audio queue stays at its target depth while video runs at the display
+// refresh rate. Each output sample is a RESAMPLER_TAPS dot product with the
+// kernel phase nearest to its fractional input position.
+
+enum {
+    RESAMPLER_PHASES = 256,
+    RESAMPLER_TAPS   = 16     // multiple of 4 (SSE lanes)
+};
+
+#define RESAMPLER_MAX_ADJUST 0.005
+
+typedef struct Resampler {
+    _Alignas(16) float kernel[RESAMPLER_PHASES][RESAMPLER_TAPS];
+
+    double base_step;   // input samples per output sample at ratio 1
+    double ratio;       // current output rate multiplier
+    u64 step;           // input samples per output sample, 32.32 fixed point
+    u64 pos;            // position of the next output in hist, 32.32
+
+    float* hist;        // pending input (TAPS - 1 samples of history first)
+    u32 hist_len;
+    u32 hist_cap;
+
+    bool use_simd;      // SSE inner loop when compiled in; clear to force scalar
+} Resampler;
+
+// max_input bounds the samples passed to one Resampler_Process call.
+bool Resampler_Init(Resampler* r, double in_rate, double out_rate, u32 max_input);
+void Resampler_Destroy(Resampler* r);
+void Resampler_Clear(Resampler* r);
+
+// Output rate multiplier, clamped to 1 +/- RESAMPLER_MAX_ADJUST.
+void Resampler_SetRatio(Resampler* r, double ratio);
+
+// Upper bound on the output of one Process call with in_count samples.
+u32 Resampler_MaxOutput(const Resampler* r, u32 in_count);
+
+// Consumes all of `in` and returns the samples written to out (out_cap must
+// be at least Resampler_MaxOutput(in_count)).
+u32 Resampler_Process(Resampler* r, const s16* in, u32 in_count, s16* out, u32 out_cap);
+
+// Dynamic rate control: maps queue fill against its target depth to a ratio.
+// An empty queue asks for RESAMPLER_MAX_ADJUST more output, a queue at twice
+// the target for that much less.
+static inline double Resampler_DRCRatio(u32 fill, u32 target)
+{
+    if (target == 0u) return 1.0;
+    double err = ((double)target - (double)fill) / (double)target;
+    if (err > 1.0) err = 1.0;
+    if (err < -1.0) err = -1.0;
+    return 1.0 + err * RESAMPLER_MAX_ADJUST;
+}
+
+// "sse" or "scalar": the inner loop this build uses by default.
+const char* Resampler_Backend(void);
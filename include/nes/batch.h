@@ -0,0 +1,71 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/input.h"
+#include "nes/nes.h"
+#include <stddef.h>
+
+// Batched environment: N emulator instances sharing one ROM image, stepped
+// K frames at a time across a work-stealing thread pool.
+
+typedef enum NesBatchObs {
+    NES_BATCH_OBS_NONE        = 0,
+    NES_BATCH_OBS_FRAMEBUFFER = 1u << 0, // ARGB8888, NES_FB_W * NES_FB_H words
+    NES_BATCH_OBS_RAM         = 1u << 1  // 2KB internal RAM
+} NesBatchObs;
+
+// Returns true when instance `index` has reached a terminal state. Called from
+// worker threads after each step; must only touch the given instance.
+typedef bool (*NesBatchDoneFn)(const Nes* n, int index, void* user);
+
+typedef struct NesBatchConfig {
+    int instances;
+    int threads;            // 0 = one per online CPU
+
+    // NesBatchObs bits. Instances only draw frames that are observed: the
+    // last frame of a step with NES_BATCH_OBS_FRAMEBUFFER, otherwise none.
+    u32 obs_flags;
+
+    // Pin worker i to CPU cpu_list[i % cpu_count] (or cpu i when cpu_list is NULL)
+    bool pin_threads;
+    const int* cpu_list;
+    int cpu_count;
+
+    // Optional terminal-state predicate; done instances are reset after their
+    // observation has been written.
+    NesBatchDoneFn done_fn;
+    void* done_user;
+} NesBatchConfig;
+
+typedef struct NesBatchStats {
+    u64 frames;             // emulated frames across all instances
+    double seconds;         // wall time spent inside NesBatch_Step
+    double fps;             // frames / seconds
+    double fps_per_core;    // fps / threads
+    int threads;
+} NesBatchStats;
+
+typedef struct NesBatch NesBatch;
+
+NesBatch* NesBatch_Create(const NesBatchConfig* cfg, const char* rom_path);
+NesBatch* NesBatch_CreateFromMemory(const NesBatchConfig* cfg, const u8* rom, size_t rom_size);
+void      NesBatch_Destroy(NesBatch* b);
+
+int    NesBatch_Count(const NesBatch* b);
+Nes*   NesBatch_Instance(NesBatch* b, int index);
+
+// Bytes per instance in the observation buffer; instance i starts at i * stride.
+// Layout inside a slot: framebuffer (if requested) followed by RAM (if requested).
+size_t NesBatch_ObsStride(const NesBatch* b);
+
+// Applies inputs[i] to instance i, runs `frames` frames on every instance and
+// writes observations into obs (Count * ObsStride bytes; may be NULL when no
+// observation is requested). out_done (optional, Count entries) receives 1 for
+// instances that were reset because done_fn returned true.
+bool NesBatch_Step(NesBatch* b, const NesInput* inputs, int frames,
+                   void* obs, size_t obs_size, u8* out_done);
+
+void NesBatch_Reset(NesBatch* b, int index);
+void NesBatch_ResetAll(NesBatch* b);
+
+void NesBatch_GetStats(const NesBatch* b, NesBatchStats* out);
+void NesBatch_ClearStats(NesBatch* b);
@@ -3,19 +3,30 @@
 #include "nes/input.h"
 #include "nes/ppu/ppu2c02.h"
 #include "nes/apu/apu2a03.h"
+#include "nes/debug/trace.h"
 #include <stdbool.h>
 
 typedef struct Cart Cart;
+typedef struct CPU6502 CPU6502;
+typedef struct NesProfiler NesProfiler;
+typedef struct Bus Bus;
+
+// Debug observers of the CPU (execution trace, profiler, timeline). The CPU
+// calls them only while Bus.debug is set, so it needs none of the debug
+// modules itself.
+typedef struct BusDebugHooks {
+    // Before the instruction at c->pc; the result is passed to retire.
+    u32  (*exec)(Bus* b, const CPU6502* c);
+    // After it ran: its opcode and cycles, and the CPU's pc and sp after it.
+    void (*retire)(Bus* b, u32 token, u8 opcode, u32 cycles, u16 pc, u8 sp);
+    // After an NMI ($FFFA) or IRQ ($FFFE) entry; sp_before is the SP before
+    // the pushes.
+    void (*interrupt)(Bus* b, const CPU6502* c, u16 vector, u8 sp_before);
+} BusDebugHooks;
 
 typedef struct Bus {
     Cart* cart;
 
-    // 2KB internal RAM ($0000-$07FF), mirrored to $1FFF
-    u8 ram[2048];
-
-    // PPU core + register interface
-    PPU2C02 ppu;
-
     // APU core
     APU2A03 apu;
 
@@ -39,6 +50,29 @@ typedef struct Bus {
 
     // Snapshot of current input (set each frame)
     NesInput input;
+
+    // 2KB internal RAM ($0000-$07FF), mirrored to $1FFF. Fields above are
+    // plain state copied by a fork; RAM pages borrowed from a fork parent are
+    // read through ram_borrow until the first write.
+    const u8* ram_borrow[2048 >> 8];
+    u64 ram_dirty;      // one bit per 256-byte page (see nes/util/dirty.h)
+    u8 ram[2048];
+
+    // PPU core + register interface
+    PPU2C02 ppu;
+
+    // Host side (not emulated state): when armed, the first $4016 write
+    // asks input_poll for the controller state before latching it.
+    NesInputPollFn input_poll;
+    void* input_user;
+    bool input_armed;
+    NesTraceLog* exec_log;  // per-instruction trace (NES_StartExecTrace), NULL when off
+    NesProfiler* profiler;  // guest-code profiler (NES_StartProfile), NULL when off
+    const BusDebugHooks* debug;  // CPU hooks, set while any of the above or the timeline is on
+
+#if NES_TRACE
+    NesTrace* trace;    // the owning console's counters
+#endif
 } Bus;
 
 bool Bus_Init(Bus* b, Cart* cart);
@@ -47,9 +81,24 @@ void Bus_Reset(Bus* b);
 void Bus_SetCart(Bus* b, Cart* cart);
 void Bus_SetInput(Bus* b, NesInput input);
 
+// Sets the just-in-time input provider (NULL removes it). Arming makes the
+// next $4016 write call it; arm once per frame.
+void Bus_SetInputProvider(Bus* b, NesInputPollFn fn, void* user);
+static inline void Bus_ArmInputPoll(Bus* b) { b->input_armed = b->input_poll != NULL; }
+
+// Points the APU's DMC sample reader at this bus (again after a copy/move).
+void Bus_BindAPU(Bus* b);
+
 bool Bus_DMATick(Bus* b);
-bool Bus_APUTick(Bus* b);
+// Advances the APU; true while its IRQ line is high.
+bool Bus_APUAdvance(Bus* b, u32 cpu_cycles);
 
 // CPU read/write (the 6502 will call these)
 u8   Bus_CPURead(Bus* b, u16 addr);
 void Bus_CPUWrite(Bus* b, u16 addr, u8 data);
+// Debugger read: RAM and cartridge as the CPU would see them, without
+// touching open bus or any register. I/O reads as open bus.
+u8   Bus_Peek(Bus* b, u16 addr);
+
+// Copies the current 2KB RAM contents (including fork-borrowed pages) to dst.
+void Bus_CopyRAM(const Bus* b, u8 dst[2048]);
@@ -1,6 +1,8 @@
 #pragma once
 #include "nes/common.h"
 #include "nes/ines.h"
+#include "nes/util/cow.h"
+#include "nes/util/dirty.h"
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -19,6 +21,18 @@ typedef struct Cart {
     u8* prg_ram;
     u32 prg_ram_size;
 
+    // PRG/CHR ROM buffers are owned by another cart (see Cart_Share)
+    bool rom_borrowed;
+
+    // Copy-on-write page tables for PRG RAM / CHR RAM; NULL unless the cart
+    // was built by Cart_Fork.
+    const u8** prg_ram_borrow;
+    const u8** chr_borrow;
+
+    // Dirty-page bitmaps for PRG RAM / CHR RAM (NULL when the region is absent)
+    u64* prg_ram_dirty;
+    u64* chr_dirty;
+
     Mapper* mapper;
 } Cart;
 
@@ -26,10 +40,49 @@ bool Cart_Init(Cart* c);
 void Cart_Destroy(Cart* c);
 
 bool Cart_LoadFromFile(Cart* c, const char* path);
+bool Cart_LoadFromMemory(Cart* c, const u8* rom, size_t rom_size);
+
+// Builds a cart that borrows src's PRG/CHR ROM and owns fresh PRG/CHR RAM and
+// mapper state. src must outlive c.
+bool Cart_Share(Cart* c, const Cart* src);
+
+// Builds a copy of src's current state: ROM is borrowed, PRG/CHR RAM pages are
+// borrowed copy-on-write and the mapper state is cloned. src must not be
+// written to (nor destroyed) while c is alive.
+bool Cart_Fork(Cart* c, const Cart* src);
+
+// Marks every PRG/CHR RAM page dirty (reset and state loads).
+void Cart_MarkAllDirty(Cart* c);
+
+// PRG/CHR RAM access for mappers (off already reduced modulo the buffer size)
+static inline u8 Cart_PRGRAMRead(const Cart* c, u32 off)
+{
+    return NesCow_Read(c->prg_ram, c->prg_ram_borrow, off);
+}
+
+static inline void Cart_PRGRAMWrite(Cart* c, u32 off, u8 data)
+{
+    *NesCow_WritePtr(c->prg_ram, c->prg_ram_borrow, off) = data;
+    if (c->prg_ram_dirty) NesDirty_Mark(c->prg_ram_dirty, off);
+}
+
+static inline u8 Cart_CHRRead(const Cart* c, u32 off)
+{
+    return NesCow_Read(c->chr, c->chr_borrow, off);
+}
+
+static inline void Cart_CHRWrite(Cart* c, u32 off, u8 data)
+{
+    *NesCow_WritePtr(c->chr, c->chr_borrow, off) = data;
+    if (c->chr_dirty) NesDirty_Mark(c->chr_dirty, off);
+}
 
 // Mapper-facing accessors (what the bus will call later)
 bool Cart_CPURead(Cart* c, u16 addr, u8* out);
 bool Cart_CPUWrite(Cart* c, u16 addr, u8 data);
+// PRG ROM offset behind a CPU address under the current banking (see
+// Mapper.prg_offset); false for RAM, I/O and unmapped space.
+bool Cart_PRGOffset(const Cart* c, u16 addr, u32* out);
 
 bool Cart_PPURead(Cart* c, u16 addr, u8* out);
 bool Cart_PPUWrite(Cart* c, u16 addr, u8 data);
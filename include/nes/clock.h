@@ -0,0 +1,46 @@
+#pragma once
+#include "nes/common.h"
+
+// Frame pacing. A clock is a fixed grid of frame boundaries from an epoch;
+// any thread can wait for a boundary (plus an offset) without shared state.
+// Waits sleep with clock_nanosleep until spin_ns before the target and spin
+// the rest, trading a little CPU for sub-100 us wake-up accuracy.
+
+// NTSC: 39375000 / 655171 = 60.0988 frames per second
+#define NES_NTSC_FRAME_HZ (39375000.0 / 655171.0)
+
+enum { NES_CLOCK_DEFAULT_SPIN_NS = 250000 };
+
+typedef struct NesClock {
+    u64 epoch_ns;
+    double period_ns;
+    u32 spin_ns;
+} NesClock;
+
+// Monotonic time in nanoseconds.
+u64 NesClock_Now(void);
+
+// Starts the grid at the current time.
+void NesClock_Init(NesClock* c, double hz, u32 spin_ns);
+
+// Boundary `frame` and the first boundary at or after t.
+u64 NesClock_Deadline(const NesClock* c, u64 frame);
+u64 NesClock_FrameAt(const NesClock* c, u64 t_ns);
+
+// Waits until t_ns. Returns how late it woke (0 when on time).
+u64 NesClock_SleepUntil(const NesClock* c, u64 t_ns);
+
+// Wake-up lateness, in the spirit of a jitter meter: moving average and the
+// worst case since the last reset.
+typedef struct NesJitter {
+    u64 samples;
+    u64 avg_ns;
+    u64 max_ns;
+} NesJitter;
+
+static inline void NesJitter_Add(NesJitter* j, u64 late_ns)
+{
+    j->avg_ns = j->samples ? j->avg_ns - j->avg_ns / 16u + late_ns / 16u : late_ns;
+    if (late_ns > j->max_ns) j->max_ns = late_ns;
+    j->samples++;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Compile-time feature switches; override with -DNAME=0 / -DNAME=1.
+
+// Per-page dirty bitmaps maintained on guest memory writes (see nes/state.h).
+#ifndef NES_DIRTY_TRACKING
+#define NES_DIRTY_TRACKING 1
+#endif
+
+// Hot-path counters and phase timers (see nes/debug/trace.h).
+#ifndef NES_TRACE
+#define NES_TRACE 0
+#endif
@@ -12,6 +12,7 @@ typedef struct CPU6502 {
     u8  sp;
     u8  p;        // status flags
     u64 cycles;
+    u64 instructions;   // executed (interrupt entries not counted)
 
     bool jammed;
 
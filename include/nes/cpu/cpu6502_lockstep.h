@@ -0,0 +1,81 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/input.h"
+#include <stdbool.h>
+
+// Experimental lockstep core: runs the 6502 of several consoles playing the
+// same NROM game in struct-of-arrays layout. All lanes whose PC matches the
+// lowest live PC execute the instruction together (one ROM fetch, vector ALU
+// and RAM row access); the rest are masked off and re-converge when the
+// leader catches up with them.
+//
+// Only the CPU, 2KB RAM and controllers are modelled. The PPU is reduced to a
+// dot counter that drives $2002 VBlank and NMI; other PPU/APU registers read
+// as zero and ignore writes. It is meant for game-logic search, not video.
+
+#ifndef NES_LOCKSTEP_LANES
+#define NES_LOCKSTEP_LANES 16
+#endif
+
+typedef struct Cart Cart;
+
+typedef struct CPU6502Lockstep {
+    const u8* prg;      // NROM PRG ROM
+    u32 prg_mask;       // 0x3FFF (NROM-128) or 0x7FFF (NROM-256)
+    int lanes;          // lanes in use (<= NES_LOCKSTEP_LANES)
+
+    // Registers, one entry per lane
+    u16 pc[NES_LOCKSTEP_LANES];
+    u8  a[NES_LOCKSTEP_LANES];
+    u8  x[NES_LOCKSTEP_LANES];
+    u8  y[NES_LOCKSTEP_LANES];
+    u8  sp[NES_LOCKSTEP_LANES];
+    u8  p[NES_LOCKSTEP_LANES];
+    u64 cycles[NES_LOCKSTEP_LANES];
+    bool jammed[NES_LOCKSTEP_LANES];
+
+    // PPU timing stub
+    u32 dot[NES_LOCKSTEP_LANES];        // PPU dot within the frame (0 = pre-render line)
+    u64 frame_count[NES_LOCKSTEP_LANES];
+    u8  ppu_ctrl[NES_LOCKSTEP_LANES];
+    u8  ppu_status[NES_LOCKSTEP_LANES];
+    bool nmi_pending[NES_LOCKSTEP_LANES];
+
+    // Controllers
+    NesInput input[NES_LOCKSTEP_LANES];
+    u8 pad_shift_p1[NES_LOCKSTEP_LANES];
+    u8 pad_shift_p2[NES_LOCKSTEP_LANES];
+    bool pad_strobe[NES_LOCKSTEP_LANES];
+
+    // Opcode -> handler kind, derived from g_op_table
+    u8 kind[256];
+
+    // 2KB internal RAM, lane-minor: ram[addr][lane]
+    _Alignas(32) u8 ram[2048][NES_LOCKSTEP_LANES];
+
+    // Stats
+    u64 steps;          // group instructions issued
+    u64 lane_steps;     // lane instructions retired (steps * utilisation)
+} CPU6502Lockstep;
+
+// Fails unless the cart uses mapper 0 and lanes is within 1..NES_LOCKSTEP_LANES.
+bool CPU6502Lockstep_Init(CPU6502Lockstep* c, const Cart* cart, int lanes);
+void CPU6502Lockstep_Reset(CPU6502Lockstep* c);
+
+void CPU6502Lockstep_SetInput(CPU6502Lockstep* c, int lane, NesInput input);
+
+// Issues one group instruction (or pending NMIs). Returns the number of lanes
+// that advanced, 0 when every lane is jammed.
+int  CPU6502Lockstep_Step(CPU6502Lockstep* c);
+
+// Runs until every live lane has completed one more frame.
+void CPU6502Lockstep_RunFrame(CPU6502Lockstep* c);
+
+// "avx2", "sse2" or "scalar", depending on the target the core was compiled
+// for.
+const char* CPU6502Lockstep_Backend(void);
+
+static inline u8 CPU6502Lockstep_ReadRAM(const CPU6502Lockstep* c, int lane, u16 addr)
+{
+    return c->ram[addr & 0x07FFu][lane];
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/cart.h"
+#include <stdio.h>
+
+// Guest-code profiler: CPU cycles and executions per code location, and
+// per JSR call stack.
+//
+// A location is the CPU address for code below $8000 (RAM, PRG-RAM) and
+// $8000 + the PRG ROM offset behind the address for cartridge code, taken
+// from the mapper's bank registers when the instruction runs. The same
+// $8000-$BFFF address in two UxROM/MMC1 banks is therefore two locations.
+// Counts live in flat arrays indexed by location (no hashing on the hot
+// path).
+//
+// Call stacks are a tree of JSR targets (interrupt handlers count as calls
+// too) with cycles charged to the innermost one. Frames are popped by the
+// stack pointer: RTS, RTI or TXS unwinds every frame whose entry SP is at or
+// below the new SP, which keeps the tree in step with code that returns
+// through pushed addresses or resets the stack.
+
+enum {
+    NES_PROF_MAX_DEPTH = 128,           // one frame per 2 bytes of stack at most
+    NES_PROF_MAX_NODES = 1u << 20,
+    NES_PROF_ROM_BASE  = 0x8000         // first location of PRG ROM code
+};
+
+typedef struct NesProfNode {
+    u32 loc;            // subroutine entry; node 0 is the top level
+    u32 parent;
+    u32 first_child;    // 0 = none (node 0 is never a child)
+    u32 next_sibling;
+    u64 cycles;         // self
+    u64 calls;
+} NesProfNode;
+
+typedef struct NesProfFrame {
+    u32 node;
+    u8 sp;              // SP before the call pushed its return address
+} NesProfFrame;
+
+typedef struct NesProfiler {
+    const Cart* cart;
+    u32 locs;           // NES_PROF_ROM_BASE + PRG ROM size
+    u64* cycles;        // per location
+    u32* execs;
+
+    NesProfNode* nodes;
+    u32 node_count;
+    u32 node_cap;
+    u32 current;        // node being charged
+
+    NesProfFrame stack[NES_PROF_MAX_DEPTH];
+    u32 depth;
+
+    u64 total_cycles;
+    u64 stall_cycles;   // OAM DMA, charged to the current node
+    u64 interrupts;
+    u64 dropped_calls;  // calls not tracked (stack depth or node limit)
+} NesProfiler;
+
+bool NesProfiler_Init(NesProfiler* p, const Cart* cart);
+void NesProfiler_Free(NesProfiler* p);
+void NesProfiler_Reset(NesProfiler* p);
+
+static inline u32 NesProfiler_Locate(const NesProfiler* p, u16 addr)
+{
+    u32 off;
+    if (addr >= NES_PROF_ROM_BASE && Cart_PRGOffset(p->cart, addr, &off)) return NES_PROF_ROM_BASE + off;
+    return addr;
+}
+
+// Call-stack edges: a JSR or interrupt entered `loc` with the SP before its
+// pushes; RTS/RTI/TXS left the SP at `sp`.
+void NesProfiler_Enter(NesProfiler* p, u32 loc, u8 sp);
+void NesProfiler_Unwind(NesProfiler* p, u8 sp);
+
+// Called by the CPU after each instruction at `loc` (located before it ran);
+// pc and sp are the CPU's after it.
+static inline void NesProfiler_Retire(NesProfiler* p, u32 loc, u8 opcode, u32 cycles, u16 pc, u8 sp)
+{
+    p->cycles[loc] += cycles;
+    p->execs[loc]++;
+    p->nodes[p->current].cycles += cycles;
+    p->total_cycles += cycles;
+
+    switch (opcode) {
+        case 0x20: NesProfiler_Enter(p, NesProfiler_Locate(p, pc), (u8)(sp + 2u)); break;    // JSR
+        case 0x40: case 0x60: case 0x9A: NesProfiler_Unwind(p, sp); break;                 // RTI, RTS, TXS
+        default: break;
+    }
+}
+
+// After an NMI/IRQ entry: pc is the handler, sp_before the SP before the pushes.
+void NesProfiler_Interrupt(NesProfiler* p, u16 pc, u8 sp_before, u32 cycles);
+void NesProfiler_Stall(NesProfiler* p, u32 cycles);
+
+// Symbols: names for locations, from FCEUX .nl files or a ca65/ld65 debug
+// file. Lookups return the nearest symbol at or below a location, in the
+// same 16KB bank (or below $8000).
+typedef struct NesSymbol {
+    u32 loc;
+    char name[48];
+} NesSymbol;
+
+typedef struct NesSymbols {
+    NesSymbol* items;
+    u32 count;
+    u32 cap;
+    bool sorted;
+} NesSymbols;
+
+// FCEUX naming: <rom>.ram.nl for $0000-$7FFF, <rom>.<bank>.nl per 16KB PRG
+// bank. Missing files are skipped; returns the number of symbols added.
+u32  NesSymbols_LoadNL(NesSymbols* s, const char* rom_path, u32 prg_size);
+// ld65 --dbgfile output: labels in segments written to the ROM image map to
+// PRG offsets through the segment's output offset (after the 16-byte iNES
+// header); labels in RAM segments map to their address.
+bool NesSymbols_LoadDbg(NesSymbols* s, const char* path, u32 prg_size);
+bool NesSymbols_Add(NesSymbols* s, u32 loc, const char* name);
+// NULL when there is no symbol in range; *offset is loc minus the symbol's.
+const char* NesSymbols_Find(NesSymbols* s, u32 loc, u32* offset);
+void NesSymbols_Free(NesSymbols* s);
+
+// Flat report: the hottest `top` locations (0 = all) and every subroutine
+// with self and inclusive cycles. syms may be NULL.
+void NesProfiler_WriteFlat(const NesProfiler* p, NesSymbols* syms, u32 top, FILE* out);
+// Collapsed stacks ("a;b;c cycles" per line) for flamegraph.pl / speedscope.
+void NesProfiler_WriteCollapsed(const NesProfiler* p, NesSymbols* syms, FILE* out);
@@ -0,0 +1,60 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/clock.h"
+
+// Host timeline: spans and instant events per thread, written as Chrome
+// trace-event JSON (chrome://tracing, ui.perfetto.dev) to find host-side
+// stalls by eye.
+//
+// Recording is switched on at run time with NesTimeline_Start. A thread
+// records once it has called NesTimeline_AttachThread, which gives it a ring
+// of its own (no locking; the oldest events are overwritten when it is
+// full). On any other thread the hooks below cost a thread-local load and a
+// branch, so they stay in release builds. NesTimeline_Write runs at exit,
+// after the recording threads have detached or finished.
+//
+// Each thread may also have one open segment: a span that instant events cut
+// in two, so the emulation loop shows as the CPU runs between NMI, IRQ, DMA
+// and bank switches without a hook per instruction.
+
+enum { NES_TIMELINE_DEFAULT_EVENTS = 1 << 18 };   // per thread, 6 MB
+
+#define NES_TIMELINE_IS_INSTANT 0xFFFFFFFFu     // dur_ns of an instant event
+#define NES_TIMELINE_NO_ARG     0xFFFFFFFFu
+
+typedef struct NesTimelineEvent {
+    u64 start_ns;       // NesClock_Now
+    u32 dur_ns;         // NES_TIMELINE_IS_INSTANT for instants
+    u32 arg;            // shown as args.value unless NES_TIMELINE_NO_ARG
+    const char* name;   // static string
+} NesTimelineEvent;
+
+typedef struct NesTimelineRing NesTimelineRing;
+
+// The calling thread's ring, NULL when it is not recording.
+extern _Thread_local NesTimelineRing* g_nes_timeline;
+
+#define NES_TIMELINE_BEGIN(var)              u64 var = g_nes_timeline ? NesClock_Now() : 0u
+#define NES_TIMELINE_END(var, name)          (g_nes_timeline ? NesTimeline_Span(name, var, NES_TIMELINE_NO_ARG) : (void)0)
+#define NES_TIMELINE_END_ARG(var, name, arg) (g_nes_timeline ? NesTimeline_Span(name, var, (u32)(arg)) : (void)0)
+#define NES_TIMELINE_INSTANT(name, arg)      (g_nes_timeline ? NesTimeline_Instant(name, (u32)(arg)) : (void)0)
+#define NES_TIMELINE_SEGMENT_BEGIN(name)     (g_nes_timeline ? NesTimeline_SegmentBegin(name) : (void)0)
+#define NES_TIMELINE_SEGMENT_END()           (g_nes_timeline ? NesTimeline_SegmentEnd() : (void)0)
+
+// Enables recording; 0 = NES_TIMELINE_DEFAULT_EVENTS per thread (rounded up
+// to a power of two). False if already started.
+bool NesTimeline_Start(u32 events_per_thread);
+// Starts recording on the calling thread, shown as `name`. False when the
+// timeline is not started or out of memory.
+bool NesTimeline_AttachThread(const char* name);
+// Stops recording on the calling thread; its events are kept for the file.
+void NesTimeline_DetachThread(void);
+// Writes every thread's events to path, then frees them and stops the
+// timeline. False if it was not started or the file could not be written.
+bool NesTimeline_Write(const char* path);
+
+// Recording thread only (see the macros).
+void NesTimeline_Span(const char* name, u64 start_ns, u32 arg);
+void NesTimeline_Instant(const char* name, u32 arg);
+void NesTimeline_SegmentBegin(const char* name);
+void NesTimeline_SegmentEnd(void);
@@ -0,0 +1,161 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/clock.h"
+#include "nes/config.h"
+#include "nes/util/file.h"
+#include <stdio.h>
+
+// Hot-path counters and phase timers, one NesTrace per console.
+//
+// The hooks below compile to nothing unless the core is built with
+// NES_TRACE=1 (make TRACE=1); their arguments are then not even evaluated,
+// so the fields they name only exist in tracing builds. The struct itself
+// and the functions in trace.c are always available. A NULL trace pointer
+// (a bus or PPU used without a console) is skipped.
+
+typedef enum NesTraceRegion {
+    NES_TRACE_RAM = 0,      // $0000-$1FFF
+    NES_TRACE_PPU,          // $2000-$3FFF
+    NES_TRACE_APU,          // $4000-$4017 (APU and controller I/O)
+    NES_TRACE_CART,         // $4018-$FFFF
+    NES_TRACE_REGION_COUNT
+} NesTraceRegion;
+
+typedef enum NesTraceLine {
+    NES_TRACE_LINE_VISIBLE = 0, // 0-239
+    NES_TRACE_LINE_POST,        // 240
+    NES_TRACE_LINE_VBLANK,      // 241-260
+    NES_TRACE_LINE_PRE,         // -1
+    NES_TRACE_LINE_COUNT
+} NesTraceLine;
+
+typedef enum NesTracePhase {
+    NES_TRACE_PHASE_CPU = 0,    // CPU6502_Step, including its bus accesses
+    NES_TRACE_PHASE_PPU,        // PPU dots and NMI polling
+    NES_TRACE_PHASE_APU,        // APU catch-up and end of frame
+    NES_TRACE_PHASE_PRESENT,    // framebuffer hand-off
+    NES_TRACE_PHASE_COUNT
+} NesTracePhase;
+
+typedef struct NesTrace {
+    u64 frames;
+    u64 bus_reads[NES_TRACE_REGION_COUNT];
+    u64 bus_writes[NES_TRACE_REGION_COUNT];
+    u64 mapper_calls;       // cart callbacks from the CPU, PPU and DMC
+    u64 ppu_dots[NES_TRACE_LINE_COUNT];
+    u64 sprite_evals;       // per-scanline OAM evaluations
+    u64 dma_stalls;         // CPU cycles lost to OAM DMA
+    u64 nmis;
+    u64 irqs;
+    u64 opcodes[256];
+    u64 phase_ticks[NES_TRACE_PHASE_COUNT];     // see NesTrace_Ticks
+} NesTrace;
+
+#if NES_TRACE
+#define NES_TRACE_INC(t, field)       ((t) ? (void)(t)->field++ : (void)0)
+#define NES_TRACE_ADD(t, field, n)    ((t) ? (void)((t)->field += (u64)(n)) : (void)0)
+#define NES_TRACE_BEGIN(var)          u64 var = NesTrace_Ticks()
+#define NES_TRACE_END(t, phase, var)  ((t) ? (void)((t)->phase_ticks[phase] += NesTrace_Ticks() - (var)) : (void)0)
+#else
+#define NES_TRACE_INC(t, field)       ((void)0)
+#define NES_TRACE_ADD(t, field, n)    ((void)0)
+#define NES_TRACE_BEGIN(var)          ((void)0)
+#define NES_TRACE_END(t, phase, var)  ((void)0)
+#endif
+
+// Cheap timestamp for the phase timers: the TSC on x86, nanoseconds
+// elsewhere. NesTrace_TicksPerSecond converts.
+static inline u64 NesTrace_Ticks(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return (u64)__builtin_ia32_rdtsc();
+#else
+    return NesClock_Now();
+#endif
+}
+
+double NesTrace_TicksPerSecond(void);
+
+void NesTrace_Reset(NesTrace* t);
+
+// Totals and per-frame averages since the last reset, ending at `frame`.
+void NesTrace_Dump(const NesTrace* t, FILE* out, u64 frame);
+
+// ---------------------------------------------------------------------------
+// Execution trace: one record per instruction, captured just before it
+// executes (the state nestest.log shows). Unlike the counters above it is
+// always compiled in and switched at run time (NES_StartExecTrace).
+//
+// The CPU pushes records into a NesTraceLog without blocking: they are
+// batched, handed to a background thread through a lock-free ring and
+// written delta-encoded (usually 4-6 bytes per instruction), with a sync
+// point every 64K records where decoding can start afresh. If the writer
+// falls behind, records are dropped and counted rather than waiting on I/O;
+// the CYC column shows where the gap is. NesTraceReader decodes a file and
+// NesTrace_FormatNestest prints a record the way nestest.log does.
+
+typedef struct NesTraceRecord {
+    u64 cycle;          // CPU cycle count before the instruction
+    u16 pc;
+    s16 scanline;       // PPU position: -1..260
+    u16 dot;            // 0..340
+    u8 opcode;
+    u8 operand[2];      // bytes after the opcode (unused ones are 0)
+    u8 a, x, y, p, sp;
+} NesTraceRecord;
+
+typedef struct NesTraceLog NesTraceLog;
+
+// Creates the file and starts its writer thread; the ring holds
+// `ring_records` (0 = default, about 6 MB). NULL on failure.
+NesTraceLog* NesTraceLog_Open(const char* path, u32 ring_records);
+// Emulation thread only. Never blocks.
+void NesTraceLog_Push(NesTraceLog* log, const NesTraceRecord* r);
+// Flushes everything pushed, stops the writer and closes the file. Returns
+// false if the file could not be written completely.
+bool NesTraceLog_Close(NesTraceLog* log);
+// Records pushed / dropped so far (emulation thread).
+u64 NesTraceLog_Records(const NesTraceLog* log);
+u64 NesTraceLog_Dropped(const NesTraceLog* log);
+
+// Reads a trace through a file mapping.
+typedef struct NesTraceReader {
+    FileMapping file;
+    const u8* cursor;
+    NesTraceRecord prev;
+    u64 index;          // of the record Next returns next
+    u64 records;        // from the file trailer, once Next has returned false
+    u64 dropped;
+    bool complete;      // the trailer was found (the writer closed cleanly)
+    const u8* syncs;    // sync point table from the trailer, NULL without one
+    u64 sync_count;
+} NesTraceReader;
+
+bool NesTraceReader_Open(NesTraceReader* r, const char* path);
+// Decodes the next record; false at the end of the file or on a bad one.
+bool NesTraceReader_Next(NesTraceReader* r, NesTraceRecord* out);
+// Moves to the last sync point at or before record `index` (the first
+// record for a trace without a sync table); r->index tells where that is.
+bool NesTraceReader_Seek(NesTraceReader* r, u64 index);
+void NesTraceReader_Close(NesTraceReader* r);
+
+// First divergence between two traces. The encoded streams are compared
+// byte-wise (see Mem_FirstDiff), decoding starts at the last sync point
+// before the first differing byte, so an equal prefix costs a memory
+// compare plus at most one sync interval of decoding.
+typedef struct NesTraceDiff {
+    bool diverged;
+    u64 index;          // first differing record; the record count when equal
+    bool has_a, has_b;  // false for a trace that ended before index
+    NesTraceRecord a, b;
+} NesTraceDiff;
+
+bool NesTrace_Diff(const char* path_a, const char* path_b, NesTraceDiff* out);
+
+// Instruction length in bytes (1-3) for an opcode.
+u32 NesTrace_OpLength(u8 opcode);
+
+// One nestest.log-style line without the newline, e.g.
+// "C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7"
+// Returns the length written (truncated to cap like snprintf).
+int NesTrace_FormatNestest(const NesTraceRecord* r, char* out, size_t cap);
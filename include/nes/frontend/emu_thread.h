@@ -0,0 +1,126 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/clock.h"
+#include "nes/nes.h"
+#include "nes/movie.h"
+#include "nes/apu/resampler.h"
+#include "nes/frontend/sdl_audio.h"
+#include "nes/util/triplebuf.h"
+#include <SDL3/SDL.h>
+#include <stdatomic.h>
+
+// Runs the console on its own thread so a slow present or vsync stall on the
+// render thread cannot steal emulation time. Frames are published through a
+// triple buffer; input goes the other way as one atomic word.
+
+// Frame k is emulated starting at clock boundary k plus the frame delay. Its
+// input is read just in time, when the game first strobes the pads. The
+// render thread shows it at boundary k + 1 (or the next vsync). A longer
+// delay samples input later, shortening the input-to-present latency, as long
+// as emulation still fits in the rest of the frame.
+
+typedef struct EmuFrame {
+    u64 frame;              // NES frame number
+    u64 input_ns;           // NesClock_Now when the game sampled its input
+    u64 done_ns;            // NesClock_Now when emulation finished it
+    u32 fb[NES_FB_W * NES_FB_H];
+} EmuFrame;
+
+// Beam racing (beam_slices > 0): the thread spreads each real-time frame
+// over its clock period, scanline by scanline, and copies every finished
+// slice of rows out as it goes, so the render thread can present the top of
+// a frame while the bottom is still being emulated. Slots alternate by frame
+// parity; a reader must be done with a frame's rows within a frame.
+enum { EMU_BEAM_MAX_SLICES = 16 };
+
+typedef struct EmuBeamSlice {
+    _Atomic u64 done_ns;    // rows copied out
+    _Atomic u64 input_ns;   // latest input sample at that point
+} EmuBeamSlice;
+
+typedef struct EmuBeam {
+    _Atomic u64 pos;        // see EmuThread_BeamPos
+    EmuBeamSlice slices[2][EMU_BEAM_MAX_SLICES];
+    u32 fb[2][NES_FB_W * NES_FB_H];
+} EmuBeam;
+
+typedef struct EmuThreadStats {
+    u64 frames_emulated;
+    u64 frames_dropped;     // published but superseded before being shown
+    u64 emulate_ns;         // NES_RunFrame (with beam pacing), moving average
+    u64 audio_ns;           // resample + ring push, moving average
+    u64 late_avg_ns;        // wake-up lateness vs. the frame clock
+    u64 late_max_ns;
+    u64 frames_skipped;     // clock boundaries missed because a frame overran
+} EmuThreadStats;
+
+typedef struct EmuThread {
+    Nes* nes;
+    SdlAudio* audio;        // optional
+    NesMovieRecorder* movie;    // optional; cleared if recording fails
+
+    // The thread paces itself at the NTSC rate, which drifts from the audio
+    // device clock; dynamic rate control holds the queue at its target depth.
+    Resampler drc;
+
+    NesClock clock;         // shared frame grid (copied; read-only)
+    u64 frame_delay_ns;
+
+    TripleBuf frames;       // EmuFrame slots
+    EmuBeam* beam;          // NULL unless beam racing
+    int beam_slices;
+    _Atomic u32 input;      // NesInput p1 | p2 << 8
+    _Atomic u32 speed;      // see EmuThread_SetSpeed
+    u64 input_ns;           // emulation thread: when the current frame read it
+    bool beam_on;           // emulation thread: racing the current frame
+    int beam_slice;         // next slice of it
+    u64 beam_start_ns;      // its clock boundary
+    atomic_bool quit;
+    SDL_Thread* thread;
+
+    // Written by the emulation thread
+    _Atomic u64 frames_emulated;
+    _Atomic u64 emulate_ns;
+    _Atomic u64 audio_ns;
+    _Atomic u64 late_avg_ns;
+    _Atomic u64 late_max_ns;
+    _Atomic u64 frames_skipped;
+} EmuThread;
+
+// With audio, the console must already have NES_EnableAudio at the device's
+// sample rate. frame_delay_ns is clamped to leave 2 ms of the frame; beam
+// racing (beam_slices 1..EMU_BEAM_MAX_SLICES, 0 = off) ignores it.
+bool EmuThread_Start(EmuThread* t, Nes* nes, SdlAudio* audio, NesMovieRecorder* movie,
+                     const NesClock* clock, u64 frame_delay_ns, int beam_slices);
+
+// Stops and joins the thread; the console can be used again afterwards.
+void EmuThread_Stop(EmuThread* t);
+
+void EmuThread_SetInput(EmuThread* t, NesInput input);
+
+// 1 = real time, N = fast-forward at N x, 0 = fast-forward uncapped. While
+// fast-forwarding audio is muted and only enough frames to keep up with the
+// display are drawn; the rest take the pixel-skip path.
+void EmuThread_SetSpeed(EmuThread* t, u32 speed);
+
+// Newest frame; *fresh is false when it was already returned last time.
+const EmuFrame* EmuThread_LatestFrame(EmuThread* t, bool* fresh);
+
+void EmuThread_GetStats(const EmuThread* t, EmuThreadStats* out);
+
+// Beam racing progress: frame << 16 | slices done << 8 | rows done. Frames
+// count like Nes.frame_count after they finish (the first one is 1).
+static inline u64 EmuThread_BeamPos(const EmuThread* t)
+{
+    return atomic_load_explicit(&t->beam->pos, memory_order_acquire);
+}
+
+static inline const u32* EmuThread_BeamRows(const EmuThread* t, u64 frame)
+{
+    return t->beam->fb[frame & 1u];
+}
+
+static inline const EmuBeamSlice* EmuThread_BeamSlice(const EmuThread* t, u64 frame, int slice)
+{
+    return &t->beam->slices[frame & 1u][slice];
+}
@@ -6,6 +6,8 @@
 
 typedef struct SdlApp {
     bool quit;
+    bool show_stats;    // F1 toggles the stats overlay
+    bool turbo;         // Tab toggles fast-forward
     SdlVideo video;
     NesInput input;
 } SdlApp;
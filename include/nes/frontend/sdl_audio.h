@@ -0,0 +1,35 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/util/ringbuf.h"
+#include <SDL3/SDL.h>
+
+// Mono s16 output. The emulation thread pushes samples into an SPSC ring; the
+// SDL audio callback pulls from it and pads with silence on underrun.
+
+enum {
+    SDLAUDIO_MIN_LATENCY_MS = 10,
+    SDLAUDIO_DEFAULT_LATENCY_MS = 40
+};
+
+typedef struct SdlAudio {
+    SDL_AudioStream* stream;
+    RingBuf ring;
+    int sample_rate;
+    int latency_ms;     // target queue depth
+    u32 target_depth;   // the same in samples (dynamic rate control setpoint)
+    s16 last;           // last sample played, held through underruns
+} SdlAudio;
+
+// latency_ms is clamped to SDLAUDIO_MIN_LATENCY_MS. On failure the struct is
+// left inert: pushes are dropped and the game runs silent.
+bool SdlAudio_Init(SdlAudio* a, int sample_rate, int latency_ms);
+void SdlAudio_Shutdown(SdlAudio* a);
+
+// Producer side; returns samples accepted (the rest count as an overrun).
+u32 SdlAudio_Push(SdlAudio* a, const s16* samples, u32 count);
+
+// Samples waiting to be played.
+u32 SdlAudio_Queued(const SdlAudio* a);
+
+static inline u64 SdlAudio_Underruns(const SdlAudio* a) { return RingBuf_Underruns(&a->ring); }
+static inline u64 SdlAudio_Overruns(const SdlAudio* a) { return RingBuf_Overruns(&a->ring); }
@@ -1,5 +1,6 @@
 #pragma once
 #include "nes/common.h"
+#include "nes/util/framediff.h"
 #include <SDL3/SDL.h>
 
 typedef struct SdlVideo {
@@ -8,9 +9,24 @@ typedef struct SdlVideo {
     SDL_Texture* texture;
     int tex_w;
     int tex_h;
+
+    // Text drawn over the picture, one line per '\n' (empty = none)
+    char overlay[512];
+
+    // Only rows that changed since the last present are written into the
+    // (locked) streaming texture; an unchanged frame is re-presented as is.
+    FrameDiff diff;
+    u64 upload_bytes;       // written into the texture since init
+    u64 uploads_skipped;    // presents of an unchanged frame
 } SdlVideo;
 
 bool SdlVideo_Init(SdlVideo* v, const char* title, int w, int h, int scale);
 void SdlVideo_Shutdown(SdlVideo* v);
 
+bool SdlVideo_SetVSync(SdlVideo* v, bool on);
+
 bool SdlVideo_PresentARGB(SdlVideo* v, const u32* argb_pixels, int w, int h);
+
+// Beam racing: uploads rows [first, last] of a texture-sized frame and
+// presents, keeping the other rows from earlier presents.
+bool SdlVideo_PresentRows(SdlVideo* v, const u32* argb_pixels, int first, int last);
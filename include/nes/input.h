@@ -17,6 +17,9 @@ typedef struct NesInput {
     u8 p2; // same bit layout as p1 for controller port 2
 } NesInput;
 
+// Supplies the controller state on demand (see NES_SetInputProvider).
+typedef NesInput (*NesInputPollFn)(void* user);
+
 static inline void NesInput_SetP1(NesInput* in, NesButton b, bool down)
 {
     if (!in) return;
@@ -0,0 +1,107 @@
+#pragma once
+// libnes: the emulator core behind a stable C API, for embedding in test
+// tooling and batch servers without SDL.
+//
+// Everything here is reached through an opaque handle and fixed-width types,
+// so the struct layouts of nes/*.h can change without breaking callers. The
+// API only grows: LIBNES_API_VERSION is bumped when functions are added, and
+// existing signatures and semantics do not change. A handle is not thread
+// safe, but separate handles can run on separate threads.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBNES_API_VERSION 1
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LIBNES_API __attribute__((visibility("default")))
+#else
+#define LIBNES_API
+#endif
+
+enum {
+    LIBNES_FB_W = 256,
+    LIBNES_FB_H = 240,
+    LIBNES_RAM_SIZE = 2048
+};
+
+// Controller bits: A, B, Select, Start, Up, Down, Left, Right from bit 0.
+enum {
+    LIBNES_BTN_A      = 1 << 0,
+    LIBNES_BTN_B      = 1 << 1,
+    LIBNES_BTN_SELECT = 1 << 2,
+    LIBNES_BTN_START  = 1 << 3,
+    LIBNES_BTN_UP     = 1 << 4,
+    LIBNES_BTN_DOWN   = 1 << 5,
+    LIBNES_BTN_LEFT   = 1 << 6,
+    LIBNES_BTN_RIGHT  = 1 << 7
+};
+
+typedef enum LibNesMovieState {
+    LIBNES_MOVIE_NONE = 0,      // no movie attached
+    LIBNES_MOVIE_PLAYING,
+    LIBNES_MOVIE_ENDED,         // every recorded frame has been played
+    LIBNES_MOVIE_DESYNC         // a state checksum did not match
+} LibNesMovieState;
+
+typedef struct LibNes LibNes;
+
+// Version of the header the library was built from (LIBNES_API_VERSION).
+LIBNES_API int LibNes_APIVersion(void);
+
+LIBNES_API LibNes* LibNes_Create(void);
+LIBNES_API void    LibNes_Destroy(LibNes* h);
+
+// Loading a ROM resets the console and detaches any movie.
+LIBNES_API bool LibNes_LoadROM(LibNes* h, const char* path);
+LIBNES_API bool LibNes_LoadROMFromMemory(LibNes* h, const void* rom, size_t size);
+LIBNES_API void LibNes_Reset(LibNes* h);
+
+// Controller state used by the following frames (LIBNES_BTN_* bits).
+LIBNES_API void LibNes_SetInput(LibNes* h, uint8_t p1, uint8_t p2);
+
+// Runs up to `frames` frames and returns how many ran: fewer when a movie
+// ends or desyncs, or the CPU jams.
+LIBNES_API uint64_t LibNes_RunFrames(LibNes* h, uint64_t frames);
+
+// Frames run since the last reset.
+LIBNES_API uint64_t LibNes_FrameCount(const LibNes* h);
+LIBNES_API bool     LibNes_CPUJammed(const LibNes* h);
+
+// When set, frames are emulated exactly but not drawn (faster); the
+// framebuffer keeps the last drawn picture.
+LIBNES_API void LibNes_SetSkipRender(LibNes* h, bool skip);
+
+// ARGB8888, LIBNES_FB_W x LIBNES_FB_H, valid until the next call on h.
+LIBNES_API const uint32_t* LibNes_Framebuffer(const LibNes* h);
+// 64-bit hash of the framebuffer's pixel values (taken little-endian, so it
+// is stable across builds and hosts).
+LIBNES_API uint64_t LibNes_FramebufferHash(const LibNes* h);
+// Copies the 2KB internal RAM to dst (LIBNES_RAM_SIZE bytes).
+LIBNES_API void LibNes_CopyRAM(const LibNes* h, uint8_t* dst);
+
+// Savestates are only valid for the same library build and ROM.
+LIBNES_API size_t LibNes_StateSize(const LibNes* h);
+LIBNES_API bool   LibNes_SaveState(const LibNes* h, void* buf, size_t size);
+LIBNES_API bool   LibNes_LoadState(LibNes* h, const void* buf, size_t size);
+
+// Mono 16-bit audio at sample_rate Hz (0 = off, the default).
+LIBNES_API bool LibNes_EnableAudio(LibNes* h, int sample_rate);
+LIBNES_API int  LibNes_ReadAudio(LibNes* h, int16_t* out, int count);
+
+// Plays a movie recorded by the frontend (--record): resets the console and
+// takes input from the movie, verifying its state checksums when present.
+// Fails when the movie was recorded against a different ROM.
+LIBNES_API bool LibNes_PlayMovie(LibNes* h, const char* path);
+// *out_desync_frame is the first mismatching frame in LIBNES_MOVIE_DESYNC
+// and UINT64_MAX in every other state.
+LIBNES_API LibNesMovieState LibNes_MovieState(const LibNes* h, uint64_t* out_desync_frame);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,6 +6,7 @@ typedef struct Cart Cart;
 typedef struct Mapper {
     u32 id;
     Cart* cart;
+    u32 size;   // sizeof the concrete mapper struct (for cloning/savestates)
 
     bool (*cpu_read)(struct Mapper* m, u16 addr, u8* out);
     bool (*cpu_write)(struct Mapper* m, u16 addr, u8 data);
@@ -13,8 +14,15 @@ typedef struct Mapper {
     bool (*ppu_read)(struct Mapper* m, u16 addr, u8* out);
     bool (*ppu_write)(struct Mapper* m, u16 addr, u8 data);
 
+    // Offset into PRG ROM that a CPU address currently maps to, from the
+    // bank registers; false outside PRG ROM. No side effects (profiler).
+    bool (*prg_offset)(const struct Mapper* m, u16 addr, u32* out);
+
     void (*destroy)(struct Mapper* m);
 } Mapper;
 
 Mapper* Mapper_Create(Cart* cart, u32 mapper_id);
 void    Mapper_Destroy(Mapper* m);
+
+// Byte-copies m (including its derived state) and rebinds the copy to cart.
+Mapper* Mapper_Clone(const Mapper* m, Cart* cart);
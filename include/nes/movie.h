@@ -0,0 +1,100 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/input.h"
+#include "nes/nes.h"
+#include "nes/util/file.h"
+#include <stdio.h>
+
+// Input movies: a fixed header followed by the per-frame NesInput stream,
+// run-length encoded as (p1, p2, LEB128 run length) triples, and optionally a
+// 32-bit state checksum per frame for desync detection. All integers are
+// little-endian.
+//
+//   off  size
+//     0     4  magic "NESM"
+//     4     2  version (2)
+//     6     2  flags (NesMovieFlags)
+//     8     4  start (NesMovieStart)
+//    12     4  header size (48)
+//    16     8  ROM hash (NesMovie_ROMHash)
+//    24     8  frame count
+//    32     8  input stream size in bytes (stream starts at the header size)
+//    40     8  checksum table offset (frame count * u32), 0 when absent
+
+enum {
+    NES_MOVIE_VERSION     = 2,
+    NES_MOVIE_HEADER_SIZE = 48
+};
+
+typedef enum NesMovieFlags {
+    NES_MOVIE_FLAG_CHECKSUMS = 1u << 0
+} NesMovieFlags;
+
+// How the console was brought up before frame 0.
+typedef enum NesMovieStart {
+    NES_MOVIE_START_POWER_ON = 0    // NES_Init + ROM load + NES_Reset
+} NesMovieStart;
+
+typedef struct NesMovieHeader {
+    u16 version;
+    u16 flags;
+    u32 start;
+    u64 rom_hash;
+    u64 frames;
+    u64 input_size;
+    u64 checksum_offset;
+} NesMovieHeader;
+
+typedef struct NesMovieRecorder {
+    FILE* f;
+    NesMovieHeader hdr;
+
+    // Open run
+    NesInput run_input;
+    u64 run_length;
+
+    // Per-frame checksums, appended on NesMovie_RecordEnd
+    u32* checksums;
+    u64 checksum_cap;
+} NesMovieRecorder;
+
+typedef struct NesMoviePlayer {
+    FileMapping file;
+    NesMovieHeader hdr;
+
+    const u8* cursor;       // next run in the input stream
+    const u8* stream_end;
+    NesInput run_input;
+    u64 run_left;
+
+    u64 frame;              // frames handed out so far
+    u64 desync_frame;       // first frame whose checksum mismatched (UINT64_MAX if none)
+} NesMoviePlayer;
+
+// Identifies the loaded ROM image (PRG + CHR ROM + mapper/mirroring).
+u64  NesMovie_ROMHash(const Cart* c);
+
+// 32-bit checksum of the console state, folded from NES_StateFingerprint so
+// it does not depend on struct layout or the build. Version 1 movies hashed
+// the raw savestate and are rejected.
+u32  NesMovie_StateChecksum(const Nes* n);
+
+// Recording: call RecordFrame after each NES_RunFrame with the input it used.
+bool NesMovie_RecordBegin(NesMovieRecorder* r, const char* path, const Nes* n, bool checksums);
+bool NesMovie_RecordFrame(NesMovieRecorder* r, const Nes* n, NesInput input);
+bool NesMovie_RecordEnd(NesMovieRecorder* r);
+
+// Playback streams the input runs straight out of the mapped file.
+bool NesMovie_Open(NesMoviePlayer* p, const char* path);
+void NesMovie_Close(NesMoviePlayer* p);
+
+// Fails when the movie was recorded against a different ROM.
+bool NesMovie_CheckROM(const NesMoviePlayer* p, const Nes* n);
+
+// Input for the next frame; false once the movie is exhausted or malformed.
+bool NesMovie_NextInput(NesMoviePlayer* p, NesInput* out);
+
+// Compares n against the checksum of the frame just played. Returns false on
+// the first mismatch and records it in desync_frame. Always true for movies
+// without checksums.
+bool NesMovie_Verify(NesMoviePlayer* p, const Nes* n);
@@ -4,6 +4,10 @@
 #include "nes/cart.h"
 #include "nes/bus.h"
 #include "nes/cpu/cpu6502.h"
+#include "nes/apu/blip.h"
+#include "nes/debug/trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
 
 enum {
     NES_FB_W = 256,
@@ -20,14 +24,91 @@ typedef struct Nes {
 
     u64 frame_count;
     NesInput input;
+
+    // Suppress per-instance info logs (batch/search instances)
+    bool quiet;
+
+    // Band-limited audio output (NULL until NES_EnableAudio)
+    Blip* audio;
+
+    // Fork bookkeeping (see nes/state.h). A console with live forks is frozen:
+    // its pages are shared with the children, so it must not run or reset.
+    struct Nes* fork_parent;
+    atomic_int fork_children;
+
+#if NES_TRACE
+    NesTrace trace;         // the bus and PPU count into this
+    FILE* trace_out;
+    u32 trace_every;
+#endif
 } Nes;
 
 bool NES_Init(Nes* n);
 void NES_Destroy(Nes* n);
 
 bool NES_LoadROM(Nes* n, const char* path);
+bool NES_LoadROMFromMemory(Nes* n, const u8* rom, size_t rom_size);
+
+// Loads a cart that borrows src's ROM image (see Cart_Share).
+bool NES_ShareROM(Nes* n, const Cart* src);
 void NES_Reset(Nes* n);
 
 void NES_RunFrame(Nes* n);
 
+// Frames run while set are emulated exactly but not drawn: n->fb keeps the
+// last drawn picture. For fast-forward and headless runs.
+static inline void NES_SetSkipRender(Nes* n, bool skip) { if (n) n->bus.ppu.skip_pixels = skip; }
+
+// Calls fn as each visible scanline is finished (see PPUScanlineFn), for
+// presenting a frame in slices while it is being emulated. NULL removes it.
+static inline void NES_SetScanlineCallback(Nes* n, PPUScanlineFn fn, void* user)
+{
+    if (!n) return;
+    n->bus.ppu.scanline_fn = fn;
+    n->bus.ppu.scanline_user = user;
+}
+
+// Rows of a frame in progress (valid up to the last finished scanline).
+static inline const u32* NES_ScanlineBuffer(const Nes* n) { return n ? n->bus.ppu.fb : NULL; }
+
+// Polls input just in time: instead of latching n->input at the start of
+// each frame, NES_RunFrame calls fn at the game's first $4016 write of the
+// frame and afterwards leaves the value it used in n->input (for movies).
+// Frames that never touch $4016 do not call fn. NULL restores the default.
+void NES_SetInputProvider(Nes* n, NesInputPollFn fn, void* user);
+
+// Starts synthesising mono audio at sample_rate Hz (0 turns it off). Each
+// NES_RunFrame then leaves about sample_rate / 60 samples to read; up to
+// 100 ms is buffered, older unread samples are dropped.
+bool NES_EnableAudio(Nes* n, int sample_rate);
+
+// Stops synthesis without dropping the buffer (fast-forward); resuming
+// starts from an empty buffer.
+void NES_PauseAudio(Nes* n, bool paused);
+
+static inline int NES_AudioAvail(const Nes* n) { return n ? Blip_SamplesAvail(n->audio) : 0; }
+int  NES_ReadAudio(Nes* n, s16* out, int count);
+
 static inline const u32* NES_Framebuffer(const Nes* n) { return n ? n->fb : NULL; }
+
+// Hot-path counters (NES_TRACE builds, see nes/debug/trace.h): prints them
+// to out every `every` frames and starts over (0 = only on NES_TraceDump).
+// Returns false when the counters are compiled out.
+bool NES_SetTraceDump(Nes* n, FILE* out, u32 every);
+// Prints and resets the counters; does nothing when compiled out.
+void NES_TraceDump(Nes* n, FILE* out);
+
+// Execution trace: writes every instruction to path in the background, see
+// NesTraceLog. Costs one branch per instruction while off. Stopping reports
+// the records written and dropped, and NES_Destroy stops it too; false if
+// the file could not be created or written.
+bool NES_StartExecTrace(Nes* n, const char* path);
+bool NES_StopExecTrace(Nes* n);
+
+// Guest-code profiler (see nes/debug/profiler.h), counting from the next
+// instruction; needs a loaded ROM. Restarting clears it; loading or sharing
+// a ROM and NES_Destroy stop it. Write reports from NES_Profiler before
+// stopping.
+bool NES_StartProfile(Nes* n);
+void NES_StopProfile(Nes* n);
+static inline NesProfiler* NES_Profiler(const Nes* n) { return n ? n->bus.profiler : NULL; }
@@ -1,10 +1,15 @@
 #pragma once
 #include "nes/common.h"
+#include "nes/debug/trace.h"
 #include "nes/ines.h"
 #include <stdbool.h>
 
 typedef struct Cart Cart;
 
+// Called when visible scanline `y` (0-239) is complete in fb, at the end of
+// its dot 340. Must not touch emulation state.
+typedef void (*PPUScanlineFn)(void* user, int y);
+
 enum {
     PPU_FB_W = 256,
     PPU_FB_H = 240
@@ -35,11 +40,6 @@ typedef struct PPU2C02 {
     // Interrupt line (latched edge)
     bool nmi_pending;
 
-    // Internal memory
-    u8 nametables[2048];
-    u8 palette[32];
-    u8 oam[256];
-
     // Per-scanline sprite evaluation cache (up to 8 visible sprites)
     u8 scanline_sprites[8];
     u8 scanline_sprite_count;
@@ -57,8 +57,34 @@ typedef struct PPU2C02 {
     u16 bg_shifter_attr_lo;
     u16 bg_shifter_attr_hi;
 
+    // Internal memory. Everything above this point is plain state that a fork
+    // copies; nametable/OAM pages borrowed from a fork parent are read through
+    // nt_borrow/oam_borrow until the first write (see nes/util/cow.h).
+    u8 palette[32];
+    const u8* nt_borrow[2048 >> 8];
+    const u8* oam_borrow;
+
+    // Dirty-page bitmaps (see nes/util/dirty.h); palette and OAM are one page.
+    u64 nt_dirty;
+    u64 palette_dirty;
+    u64 oam_dirty;
+
+    u8 nametables[2048];
+    u8 oam[256];
+
     // Framebuffer (ARGB8888)
     u32 fb[PPU_FB_W * PPU_FB_H];
+
+    // Host side (not emulated state): visible dots skip pixel composition
+    // except where sprite 0 can hit, leaving fb stale. Timing, registers
+    // and flags are unaffected.
+    bool skip_pixels;
+    PPUScanlineFn scanline_fn;
+    void* scanline_user;
+
+#if NES_TRACE
+    NesTrace* trace;
+#endif
 } PPU2C02;
 
 bool PPU2C02_Init(PPU2C02* p, Cart* cart);
@@ -68,6 +94,9 @@ void PPU2C02_SetCart(PPU2C02* p, Cart* cart);
 u8   PPU2C02_CPURead(PPU2C02* p, u16 addr, u8 open_bus);
 void PPU2C02_CPUWrite(PPU2C02* p, u16 addr, u8 data);
 
+// $2004-style OAM write at oam_addr (also the OAM DMA sink)
+void PPU2C02_WriteOAM(PPU2C02* p, u8 data);
+
 void PPU2C02_Clock(PPU2C02* p);
 bool PPU2C02_PollNMI(PPU2C02* p);
 bool PPU2C02_FrameComplete(const PPU2C02* p);
@@ -0,0 +1,58 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/nes.h"
+#include <stddef.h>
+
+// Savestates, copy-on-write forks and dirty-page tracking.
+//
+// A savestate is an in-process snapshot of the console (CPU, bus, PPU, APU,
+// cart RAM and mapper registers; not the framebuffers). The layout follows the
+// structs of this build and is not meant to be portable across builds.
+//
+// A fork is a child console that starts from the parent's current state and
+// shares every RAM/VRAM/OAM/PRG-RAM/CHR-RAM page with it until the child first
+// writes to that page. Forking is O(page count) and a child only pays for the
+// pages it dirties. The parent is frozen while it has live forks: NES_RunFrame
+// and NES_Reset refuse to run on it, and it must outlive all of its children.
+// Forks may themselves be forked. The child framebuffers are undefined until
+// its first NES_RunFrame.
+
+size_t NES_StateSize(const Nes* n);
+bool   NES_SaveState(const Nes* n, void* buf, size_t size);
+
+// n must have the same ROM loaded as the console that saved the state.
+bool   NES_LoadState(Nes* n, const void* buf, size_t size);
+
+// Hash of the guest-visible state: CPU registers and cycle count, frame
+// number, RAM, nametables, palette, OAM, PRG-RAM and CHR-RAM. Unlike a
+// savestate it does not depend on struct layouts, so two builds of the core
+// can compare their consoles with it.
+u64    NES_StateFingerprint(const Nes* n);
+
+Nes*   NES_Fork(Nes* parent);
+void   NES_FreeFork(Nes* child);
+
+// Pages a fork has not written to yet (0 for consoles that are not forks).
+u32    NES_ForkSharedPages(const Nes* n);
+
+// Guest memory regions with dirty-page tracking. A page is NES_PAGE_SIZE
+// (256) bytes; palette and OAM count as a single page each.
+typedef enum NesMemRegion {
+    NES_MEM_RAM = 0,        // 2KB internal RAM
+    NES_MEM_PRG_RAM,        // cartridge PRG RAM
+    NES_MEM_CHR_RAM,        // cartridge CHR RAM (absent with CHR ROM)
+    NES_MEM_NAMETABLE,      // 2KB PPU nametable RAM
+    NES_MEM_PALETTE,        // palette RAM
+    NES_MEM_OAM,            // sprite OAM
+    NES_MEM_REGION_COUNT
+} NesMemRegion;
+
+// Pages are marked when written and stay marked until cleared. NES_Reset and
+// NES_LoadState mark every region (cart RAM too, though reset keeps its
+// contents); a new fork starts with every bitmap clear.
+// Returns NULL when the region is absent or NES_DIRTY_TRACKING is 0.
+const u64* NES_DirtyBitmap(const Nes* n, NesMemRegion r, u32* out_pages);
+bool       NES_PageDirty(const Nes* n, NesMemRegion r, u32 page);
+u32        NES_DirtyPageCount(const Nes* n, NesMemRegion r);
+void       NES_ClearDirty(Nes* n, NesMemRegion r);
+void       NES_ClearAllDirty(Nes* n);
@@ -0,0 +1,13 @@
+#pragma once
+#include "nes/common.h"
+
+static inline u32 Bit_Popcount64(u64 v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (u32)__builtin_popcountll(v);
+#else
+    u32 n = 0;
+    while (v) { v &= v - 1u; n++; }
+    return n;
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "nes/common.h"
+#include <string.h>
+
+// Copy-on-write page helpers for guest memory regions.
+//
+// A region is an owned buffer plus an optional table of borrowed page
+// pointers. A NULL table (or NULL entry) means the page lives in the owned
+// buffer; a non-NULL entry points at a read-only page of a fork ancestor and is
+// copied into the owned buffer on first write.
+
+enum {
+    NES_PAGE_SHIFT = 8,
+    NES_PAGE_SIZE  = 1 << NES_PAGE_SHIFT,
+    NES_PAGE_MASK  = NES_PAGE_SIZE - 1
+};
+
+static inline u8 NesCow_Read(const u8* own, const u8* const* borrow, u32 off)
+{
+    const u8* pg = borrow ? borrow[off >> NES_PAGE_SHIFT] : NULL;
+    return pg ? pg[off & NES_PAGE_MASK] : own[off];
+}
+
+// Returns a writable pointer to own[off], pulling the page in first if borrowed.
+static inline u8* NesCow_WritePtr(u8* own, const u8** borrow, u32 off)
+{
+    if (borrow) {
+        u32 pg = off >> NES_PAGE_SHIFT;
+        if (borrow[pg]) {
+            memcpy(own + ((size_t)pg << NES_PAGE_SHIFT), borrow[pg], NES_PAGE_SIZE);
+            borrow[pg] = NULL;
+        }
+    }
+    return own + off;
+}
+
+// Points dst_borrow at every page of src (own or already borrowed), so chains
+// of forks always reference the page's original owner.
+void NesCow_BorrowAll(const u8** dst_borrow, const u8* src_own,
+                      const u8* const* src_borrow, u32 pages);
+
+// Copies every borrowed page into own and clears the table.
+void NesCow_Materialize(u8* own, const u8** borrow, u32 pages);
+
+// Copies the region's current contents (own or borrowed) to dst.
+void NesCow_CopyOut(u8* dst, const u8* own, const u8* const* borrow, u32 pages);
+
+// Number of pages currently borrowed.
+u32  NesCow_BorrowedCount(const u8* const* borrow, u32 pages);
@@ -0,0 +1,31 @@
+#pragma once
+#include "nes/common.h"
+#include "nes/config.h"
+#include "nes/util/cow.h"
+
+// Dirty-page bitmaps: bit (i & 63) of word i / 64 is set once page i
+// (NES_PAGE_SIZE bytes) of a region has been written since the last clear.
+
+static inline u32 NesDirty_Words(u32 pages)
+{
+    return (pages + 63u) >> 6;
+}
+
+static inline void NesDirty_Mark(u64* bits, u32 off)
+{
+#if NES_DIRTY_TRACKING
+    u32 pg = off >> NES_PAGE_SHIFT;
+    bits[pg >> 6] |= 1ull << (pg & 63u);
+#else
+    (void)bits; (void)off;
+#endif
+}
+
+// Marks pages [0, pages) dirty (whole-region writes such as reset or load).
+static inline void NesDirty_MarkAll(u64* bits, u32 pages)
+{
+    for (u32 w = 0; w < NesDirty_Words(pages); w++) {
+        u32 n = pages - w * 64u;
+        bits[w] = (n >= 64u) ? ~0ull : ((1ull << n) - 1ull);
+    }
+}
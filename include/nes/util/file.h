@@ -4,3 +4,14 @@
 
 bool File_ReadAllBytes(const char* path, unsigned char** out_data, size_t* out_size);
 void File_Free(void* p);
+
+// Read-only view of a whole file: mmap'd where available, read into memory
+// otherwise. Release with File_Unmap.
+typedef struct FileMapping {
+    const unsigned char* data;
+    size_t size;
+    bool mapped;
+} FileMapping;
+
+bool File_Map(const char* path, FileMapping* out);
+void File_Unmap(FileMapping* m);
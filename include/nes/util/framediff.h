@@ -0,0 +1,24 @@
+#pragma once
+#include "nes/common.h"
+
+// Change detection for a presented picture: one 64-bit hash per row, kept
+// from the previous frame. Lets a frontend skip the texture upload for an
+// unchanged frame (menus, pauses) and upload only the rows that changed
+// otherwise. A hash collision would leave a stale row until it changes
+// again.
+
+enum { FRAMEDIFF_MAX_ROWS = 256 };
+
+typedef struct FrameDiff {
+    int rows;               // rows with a known hash (0 = nothing yet)
+    int width;
+    u64 hashes[FRAMEDIFF_MAX_ROWS];
+} FrameDiff;
+
+// Forgets the previous frame; the next update reports every row.
+static inline void FrameDiff_Reset(FrameDiff* d) { d->rows = 0; }
+
+// Compares w x h ARGB pixels (tightly packed) against the previous update
+// and remembers them. Returns the number of changed rows; when there are
+// any, [*first, *last] is the span that covers them.
+int FrameDiff_Update(FrameDiff* d, const u32* pixels, int w, int h, int* first, int* last);
@@ -0,0 +1,16 @@
+#pragma once
+#include "nes/common.h"
+
+// 64-bit multiplicative hash in the style of FNV (its offset basis and prime)
+// that mixes 8 bytes per step, plus a shift; it is not FNV-1a. Words are read
+// little-endian, so a byte string hashes the same on every host. Hash_Bytes64
+// can be chained by passing the previous result as `seed` (start with
+// HASH_FNV64_SEED); chained pieces hash like one string only when every piece
+// but the last is a multiple of 8 bytes.
+#define HASH_FNV64_SEED 0xCBF29CE484222325ull
+
+u64 Hash_Bytes64(u64 seed, const void* data, size_t size);
+
+// Hash_Bytes64 of the values serialised little-endian (pixels, samples), so
+// it does not depend on the host's byte order either.
+u64 Hash_U32s64(u64 seed, const u32* data, size_t count);
@@ -0,0 +1,6 @@
+#pragma once
+#include "nes/common.h"
+
+// Offset of the first byte where a and b differ, or n when the first n bytes
+// are equal. Compares 64 bytes per step with SSE2 where available.
+size_t Mem_FirstDiff(const void* a, const void* b, size_t n);
@@ -0,0 +1,52 @@
+#pragma once
+#include "nes/common.h"
+#include <stdatomic.h>
+
+// Wait-free single-producer / single-consumer ring of fixed-size elements
+// (s16 or float audio samples). head is only written by the producer and tail
+// only by the consumer; each sits on its own cache line so the two threads do
+// not false-share. Indices run freely and are masked on access, so capacity
+// is a power of two and all of it is usable.
+
+#define RINGBUF_CACHE_LINE 64
+
+typedef struct RingBuf {
+    u8* data;
+    u32 capacity;       // elements, power of two
+    u32 mask;
+    u32 elem_size;
+
+    _Alignas(RINGBUF_CACHE_LINE) _Atomic u32 head;     // producer
+    _Atomic u64 overruns;                              // writes cut short
+
+    _Alignas(RINGBUF_CACHE_LINE) _Atomic u32 tail;     // consumer
+    _Atomic u64 underruns;                             // reads cut short
+} RingBuf;
+
+// Capacity is rounded up to a power of two.
+bool RingBuf_Init(RingBuf* rb, u32 min_capacity, u32 elem_size);
+void RingBuf_Destroy(RingBuf* rb);
+
+// Producer: copies up to `count` elements in, returns how many fit. A short
+// write counts one overrun; the rest are dropped by the caller.
+u32 RingBuf_Write(RingBuf* rb, const void* src, u32 count);
+
+// Consumer: copies up to `count` elements out (dst may be NULL to discard),
+// returns how many were available. A short read counts one underrun.
+u32 RingBuf_Read(RingBuf* rb, void* dst, u32 count);
+
+// Elements currently queued. Exact on either end's thread, a snapshot elsewhere.
+u32 RingBuf_Count(const RingBuf* rb);
+
+// Consumer: discards everything queued.
+void RingBuf_Clear(RingBuf* rb);
+
+static inline u64 RingBuf_Overruns(const RingBuf* rb)
+{
+    return atomic_load_explicit(&rb->overruns, memory_order_relaxed);
+}
+
+static inline u64 RingBuf_Underruns(const RingBuf* rb)
+{
+    return atomic_load_explicit(&rb->underruns, memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "nes/common.h"
+#include <stdatomic.h>
+
+// Lock-free triple buffer for one producer and one consumer. The producer
+// fills the back slot and publishes it by swapping it with the middle slot;
+// the consumer swaps its front slot with the middle one when a fresh frame is
+// waiting. Neither side ever blocks, and the consumer always gets the newest
+// complete frame.
+
+#define TRIPLEBUF_FRESH 0x4u
+
+typedef struct TripleBuf {
+    u8* slots[3];
+    size_t size;
+
+    u32 back;                   // producer-owned slot
+    _Atomic u64 published;
+    _Atomic u64 dropped;        // published over a frame nobody acquired
+
+    _Alignas(64) _Atomic u32 middle;    // slot index | TRIPLEBUF_FRESH
+
+    _Alignas(64) u32 front;     // consumer-owned slot
+} TripleBuf;
+
+// Allocates three zeroed, cache-line aligned slots of `size` bytes.
+bool TripleBuf_Init(TripleBuf* tb, size_t size);
+void TripleBuf_Destroy(TripleBuf* tb);
+
+// Producer: slot to fill next, then publish it. Returns false when the frame
+// it replaces in the middle slot was never acquired (counted as dropped).
+static inline void* TripleBuf_Back(TripleBuf* tb) { return tb->slots[tb->back]; }
+bool TripleBuf_Publish(TripleBuf* tb);
+
+// Consumer: the newest published slot. *fresh tells whether it changed since
+// the previous call; the slot stays valid until the next call.
+const void* TripleBuf_Acquire(TripleBuf* tb, bool* fresh);
@@ -0,0 +1,34 @@
+#pragma once
+#include "nes/common.h"
+#include <stdio.h>
+
+// Streaming 16-bit PCM WAV writer. Samples are serialised little-endian into
+// a fixed buffer and flushed in WAV_BUFFER_BYTES blocks; the RIFF and data
+// sizes are patched in on close. `hash` chains Hash_Bytes64 over the flushed
+// blocks, so equal sample streams give equal hashes without rereading.
+
+enum {
+    WAV_HEADER_BYTES = 44,
+    WAV_BUFFER_BYTES = 64 * 1024
+};
+
+typedef struct WavWriter {
+    FILE* f;
+    u32 sample_rate;
+    u16 channels;
+    bool failed;        // a write failed; Close reports it
+
+    u64 samples;        // per channel
+    u64 hash;           // of the PCM bytes written so far
+
+    u32 used;
+    u8 buf[WAV_BUFFER_BYTES];
+} WavWriter;
+
+bool Wav_Open(WavWriter* w, const char* path, u32 sample_rate, u16 channels);
+
+// `count` interleaved samples (a multiple of channels).
+bool Wav_Write(WavWriter* w, const s16* samples, u32 count);
+
+// Flushes, finalises the header and closes. False if anything failed.
+bool Wav_Close(WavWriter* w);
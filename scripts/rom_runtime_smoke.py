@@ -1,8 +1,9 @@
 #!/usr/bin/env python3
 """Run headless runtime smoke checks for NES ROMs and emit an auto-filled CSV.
 
-This script compiles a tiny core-only NES runner (no SDL), runs each ROM for a
-fixed number of frames, and records simple runtime health signals:
+This script runs each ROM through the headless libnes runner (build/nes_headless,
+brought up to date with `make headless` first) for a fixed number of frames, and
+records simple runtime health signals:
 - load/reset success
 - CPU jammed flag
 - framebuffer hash progression
@@ -15,9 +16,7 @@ from __future__ import annotations
 
 import argparse
 import csv
-import os
 import subprocess
-import tempfile
 from dataclasses import dataclass
 from pathlib import Path
 from typing import Dict, Iterable, List
@@ -91,124 +90,12 @@ def read_existing_manual_columns(path: Path) -> Dict[str, Dict[str, str]]:
     return out
 
 
-def build_runner(binary: Path, cc: str) -> None:
-    src = binary.with_suffix(".c")
-    src.write_text(
-        r'''
-#include "nes/nes.h"
-#include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
-
-static uint64_t fnv1a64(const uint32_t* data, size_t n_words)
-{
-    uint64_t h = 1469598103934665603ull;
-    for (size_t i = 0; i < n_words; i++) {
-        uint32_t v = data[i];
-        for (int b = 0; b < 4; b++) {
-            uint8_t x = (uint8_t)(v & 0xFFu);
-            h ^= x;
-            h *= 1099511628211ull;
-            v >>= 8;
-        }
-    }
-    return h;
-}
-
-int main(int argc, char** argv)
-{
-    if (argc < 3) {
-        fprintf(stderr, "usage: %s ROM FRAMES\n", argv[0]);
-        return 2;
-    }
-
-    const char* rom = argv[1];
-    int frames = atoi(argv[2]);
-    if (frames <= 0) frames = 120;
-
-    Nes n;
-    if (!NES_Init(&n)) {
-        printf("status=init_fail\n");
-        return 1;
-    }
-
-    if (!NES_LoadROM(&n, rom)) {
-        printf("status=load_fail\n");
-        NES_Destroy(&n);
-        return 1;
-    }
-
-    NES_Reset(&n);
-
-    uint64_t first_hash = 0;
-    uint64_t last_hash = 0;
-    int changed_frames = 0;
-    int jammed = 0;
-
-    uint64_t* uniq = (uint64_t*)calloc((size_t)frames, sizeof(uint64_t));
-    int uniq_count = 0;
-
-    for (int i = 0; i < frames; i++) {
-        NES_RunFrame(&n);
-
-        if (n.cpu.jammed) jammed = 1;
-
-        uint64_t h = fnv1a64(NES_Framebuffer(&n), (size_t)(NES_FB_W * NES_FB_H));
-        if (i == 0) first_hash = h;
-        if (h != first_hash) changed_frames++;
-        last_hash = h;
-
-        int seen = 0;
-        for (int j = 0; j < uniq_count; j++) {
-            if (uniq[j] == h) { seen = 1; break; }
-        }
-        if (!seen && uniq_count < frames) {
-            uniq[uniq_count++] = h;
-        }
-    }
-
-    printf("status=ok\n");
-    printf("jammed=%d\n", jammed);
-    printf("frames=%d\n", frames);
-    printf("changed_frames=%d\n", changed_frames);
-    printf("unique_hashes=%d\n", uniq_count);
-    printf("first_hash=%llu\n", (unsigned long long)first_hash);
-    printf("last_hash=%llu\n", (unsigned long long)last_hash);
-
-    free(uniq);
-    NES_Destroy(&n);
-    return 0;
-}
-''',
-        encoding="utf-8",
-    )
-
-    cmd = [
-        cc,
-        "-std=c11",
-        "-O2",
-        "-Wall",
-        "-Wextra",
-        "-Wpedantic",
-        "-Iinclude",
-        str(src),
-        "src/nes/nes.c",
-        "src/nes/bus.c",
-        "src/nes/cart.c",
-        "src/nes/mapper.c",
-        "src/nes/mapper_nrom.c",
-        "src/nes/mapper_mmc1.c",
-        "src/nes/mapper_uxrom.c",
-        "src/nes/ines.c",
-        "src/nes/util/file.c",
-        "src/nes/ppu/ppu2c02.c",
-        "src/nes/apu/apu2a03.c",
-        "src/nes/cpu/cpu6502.c",
-        "src/nes/cpu/cpu_tables.c",
-        "-o",
-        str(binary),
-    ]
-    subprocess.run(cmd, check=True)
+def ensure_headless(binary: Path) -> None:
+    # Always go through make: it is a no-op when the runner is current, and a
+    # stale binary would smoke-test code that was never built.
+    subprocess.run(["make", "headless"], check=True)
+    if not binary.exists():
+        raise SystemExit(f"headless runner not found after build: {binary}")
 
 
 def parse_kv(stdout: str) -> Dict[str, str]:
@@ -223,7 +110,7 @@ def parse_kv(stdout: str) -> Dict[str, str]:
 
 def run_one(binary: Path, rom: Path, frames: int, timeout_s: int) -> Dict[str, str]:
     p = subprocess.run(
-        [str(binary), str(rom), str(frames)],
+        [str(binary), str(rom), "--frames", str(frames)],
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE,
         text=True,
@@ -331,7 +218,12 @@ def main() -> int:
     ap.add_argument("rom_dir", type=Path, help="Directory containing .nes files")
     ap.add_argument("--frames", type=int, default=120, help="Frames per ROM (default: 120)")
     ap.add_argument("--timeout", type=int, default=20, help="Per-ROM timeout seconds (default: 20)")
-    ap.add_argument("--cc", default=os.environ.get("CC", "cc"), help="C compiler (default: $CC or cc)")
+    ap.add_argument(
+        "--headless",
+        type=Path,
+        default=Path("build/nes_headless"),
+        help="Headless runner binary, rebuilt with make headless first (default: build/nes_headless)",
+    )
     ap.add_argument(
         "--out-csv",
         type=Path,
@@ -356,36 +248,34 @@ def main() -> int:
     existing = read_existing_manual_columns(args.existing_csv)
 
     runtime: Dict[str, Dict[str, str]] = {}
-    with tempfile.TemporaryDirectory(prefix="nes_smoke_") as td:
-        binary = Path(td) / "rom_smoke_runner"
-        build_runner(binary, args.cc)
-
-        for r in rows:
-            key = str(r.path.relative_to(args.rom_dir))
-            if r.mapper not in SUPPORTED_MAPPERS:
-                runtime[key] = {
-                    "auto_boot": "no",
-                    "auto_title_stable": "no",
-                    "auto_input_ok": "unknown",
-                    "auto_jammed": "unknown",
-                    "auto_changed_frames": "0",
-                    "auto_unique_hashes": "0",
-                    "auto_notes": "unsupported_mapper",
-                }
-                continue
+    ensure_headless(args.headless)
+
+    for r in rows:
+        key = str(r.path.relative_to(args.rom_dir))
+        if r.mapper not in SUPPORTED_MAPPERS:
+            runtime[key] = {
+                "auto_boot": "no",
+                "auto_title_stable": "no",
+                "auto_input_ok": "unknown",
+                "auto_jammed": "unknown",
+                "auto_changed_frames": "0",
+                "auto_unique_hashes": "0",
+                "auto_notes": "unsupported_mapper",
+            }
+            continue
 
-            try:
-                runtime[key] = run_one(binary, r.path, args.frames, args.timeout)
-            except subprocess.TimeoutExpired:
-                runtime[key] = {
-                    "auto_boot": "no",
-                    "auto_title_stable": "no",
-                    "auto_input_ok": "unknown",
-                    "auto_jammed": "unknown",
-                    "auto_changed_frames": "0",
-                    "auto_unique_hashes": "0",
-                    "auto_notes": "timeout",
-                }
+        try:
+            runtime[key] = run_one(args.headless, r.path, args.frames, args.timeout)
+        except subprocess.TimeoutExpired:
+            runtime[key] = {
+                "auto_boot": "no",
+                "auto_title_stable": "no",
+                "auto_input_ok": "unknown",
+                "auto_jammed": "unknown",
+                "auto_changed_frames": "0",
+                "auto_unique_hashes": "0",
+                "auto_notes": "timeout",
+            }
 
     write_csv(rows, runtime, args.out_csv, args.rom_dir, existing)
     print(f"Wrote runtime matrix for {len(rows)} ROMs -> {args.out_csv}")
@@ -1,13 +1,254 @@
+#include "nes/clock.h"
+#include "nes/debug/profiler.h"
+#include "nes/debug/timeline.h"
 #include "nes/log.h"
+#include "nes/movie.h"
 #include "nes/nes.h"
 #include "nes/frontend/sdl_app.h"
+#include "nes/frontend/emu_thread.h"
+#include "nes/frontend/sdl_audio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    AUDIO_SAMPLE_RATE   = 48000,
+    POLL_SLICE_NS       = 1000000,  // vsync off: input polled at least every 1 ms
+    OVERLAY_REFRESH_NS  = 500000000,// overlay text and emulated FPS window
+    BEAM_POLL_NS        = 200000    // beam racing: wait between slice checks
+};
+
+// Render-thread side of the frame metrics.
+typedef struct PresentStats {
+    u64 presented;
+    u64 duplicated;     // presents that showed an already shown frame
+    u64 present_ns;     // SdlVideo_PresentARGB, moving average
+    u64 latency_ns;     // emulation done -> present returned, moving average
+    u64 input_ns;       // input sampled -> present returned, moving average
+    NesJitter jitter;   // vsync off: present wake-up lateness
+
+    // Beam racing, measured from when the top slice of a frame was emulated
+    // to when it was on screen: as sliced, and as a full-frame present of
+    // the same frame would have had it (after the last slice).
+    u64 slice_ns;       // newest slice emulated -> present returned
+    u64 top_ns;
+    u64 top_full_ns;
+
+    // Rates over the last OVERLAY_REFRESH_NS window
+    double emu_fps;
+    double upload_bps;  // texture upload bytes per second
+    u64 window_start;
+    u64 window_frames;
+    u64 window_upload;
+} PresentStats;
+
+static u64 ema(u64 avg, u64 sample)
+{
+    return avg ? avg - avg / 16u + sample / 16u : sample;
+}
+
+static void present_stats_note(PresentStats* ps, const EmuFrame* frame, bool fresh, u64 t0, u64 t1)
+{
+    if (frame->frame == 0) return;  // nothing emulated yet
+
+    ps->presented++;
+    if (!fresh) ps->duplicated++;
+    ps->present_ns = ema(ps->present_ns, t1 - t0);
+    if (fresh) {
+        ps->latency_ns = ema(ps->latency_ns, t1 - frame->done_ns);
+        ps->input_ns = ema(ps->input_ns, t1 - frame->input_ns);
+    }
+}
+
+// Beam racing: the render thread's position in the frame being emulated.
+typedef struct BeamCursor {
+    u64 frame;
+    int slices;
+    int rows;
+} BeamCursor;
+
+// Presents the slices finished since the last call; false if there were none.
+static bool present_beam(SdlApp* app, const EmuThread* emu, BeamCursor* bc, PresentStats* ps)
+{
+    u64 pos = EmuThread_BeamPos(emu);
+    u64 frame = pos >> 16;
+    int slices = (int)((pos >> 8) & 0xFFu);
+    int rows = (int)(pos & 0xFFu);
+    if (frame != bc->frame) {
+        bc->frame = frame;
+        bc->slices = 0;
+        bc->rows = 0;
+    }
+    if (slices == bc->slices) return false;
+
+    u64 t0 = NesClock_Now();
+    SdlVideo_PresentRows(&app->video, EmuThread_BeamRows(emu, frame), bc->rows, rows - 1);
+    u64 t1 = NesClock_Now();
+
+    const EmuBeamSlice* top = EmuThread_BeamSlice(emu, frame, 0);
+    const EmuBeamSlice* newest = EmuThread_BeamSlice(emu, frame, slices - 1);
+    u64 top_done = atomic_load_explicit(&top->done_ns, memory_order_relaxed);
+    ps->presented++;
+    ps->present_ns = ema(ps->present_ns, t1 - t0);
+    ps->slice_ns = ema(ps->slice_ns, t1 - atomic_load_explicit(&newest->done_ns, memory_order_relaxed));
+    ps->input_ns = ema(ps->input_ns, t1 - atomic_load_explicit(&newest->input_ns, memory_order_relaxed));
+    if (bc->slices == 0) ps->top_ns = ema(ps->top_ns, t1 - top_done);
+    if (slices == emu->beam_slices) ps->top_full_ns = ema(ps->top_full_ns, t1 - top_done);
+
+    bc->slices = slices;
+    bc->rows = rows;
+    return true;
+}
+
+// Closes the rate window when it is due; returns true if it did.
+static bool update_rates(PresentStats* ps, const EmuThread* emu, const SdlVideo* video, u64 now)
+{
+    if (now - ps->window_start < OVERLAY_REFRESH_NS) return false;
+
+    EmuThreadStats es;
+    EmuThread_GetStats(emu, &es);
+    if (ps->window_start) {
+        double dt = (double)(now - ps->window_start) * 1e-9;
+        ps->emu_fps = (double)(es.frames_emulated - ps->window_frames) / dt;
+        ps->upload_bps = (double)(video->upload_bytes - ps->window_upload) / dt;
+    }
+    ps->window_start = now;
+    ps->window_frames = es.frames_emulated;
+    ps->window_upload = video->upload_bytes;
+    return true;
+}
+
+// speed as given to EmuThread_SetSpeed.
+static void update_overlay(SdlApp* app, const EmuThread* emu, const PresentStats* ps, bool vsync, u32 speed)
+{
+    char* out = app->video.overlay;
+    size_t size = sizeof(app->video.overlay);
+
+    if (!app->show_stats) {
+        if (speed == 1u) {
+            out[0] = '\0';
+        } else if (speed == 0u) {
+            snprintf(out, size, ">> max  %.0f fps", ps->emu_fps);
+        } else {
+            snprintf(out, size, ">> %ux  %.0f fps", speed, ps->emu_fps);
+        }
+        return;
+    }
+
+    EmuThreadStats es;
+    EmuThread_GetStats(emu, &es);
+    int n = 0;
+    if (speed == 0u) {
+        n = snprintf(out, size, "emu %.1f fps (fast-forward max)\n", ps->emu_fps);
+    } else if (speed > 1u) {
+        n = snprintf(out, size, "emu %.1f fps (fast-forward %ux)\n", ps->emu_fps, speed);
+    } else {
+        n = snprintf(out, size, "emu %.1f fps\n", ps->emu_fps);
+    }
+    if (n < 0 || (size_t)n >= size) return;
+
+    snprintf(out + n, size - (size_t)n,
+             "%s  delay %.1f ms\n"
+             "emu %.2f ms  audio %.2f ms  present %.2f ms\n"
+             "dropped %llu  dup %llu  skipped %llu\n"
+             "emu jitter %.0f/%.0f us\n"
+             "present jitter %.0f/%.0f us\n"
+             "input->present %.1f ms\n"
+             "upload %.2f MB/s  unchanged %llu",
+             vsync ? "vsync" : "vsync off", (double)emu->frame_delay_ns * 1e-6,
+             (double)es.emulate_ns * 1e-6, (double)es.audio_ns * 1e-6, (double)ps->present_ns * 1e-6,
+             (unsigned long long)es.frames_dropped, (unsigned long long)ps->duplicated,
+             (unsigned long long)es.frames_skipped,
+             (double)es.late_avg_ns * 1e-3, (double)es.late_max_ns * 1e-3,
+             (double)ps->jitter.avg_ns * 1e-3, (double)ps->jitter.max_ns * 1e-3,
+             (double)ps->input_ns * 1e-6,
+             ps->upload_bps * 1e-6, (unsigned long long)app->video.uploads_skipped);
+    if (!emu->beam) return;
+
+    size_t used = strlen(out);
+    snprintf(out + used, size - used,
+             "\nbeam %d slices: slice %.1f ms\n"
+             "top rows %.1f ms (full frame %.1f ms)",
+             emu->beam_slices, (double)ps->slice_ns * 1e-6,
+             (double)ps->top_ns * 1e-6, (double)ps->top_full_ns * 1e-6);
+}
+
+static void log_frame_stats(const EmuThread* emu, const PresentStats* ps, const SdlVideo* video, u64 elapsed_ns)
+{
+    EmuThreadStats es;
+    EmuThread_GetStats(emu, &es);
+
+    NES_LOGI("Frames: %llu emulated, %llu presented, %llu dropped, %llu duplicated",
+             (unsigned long long)es.frames_emulated, (unsigned long long)ps->presented,
+             (unsigned long long)es.frames_dropped, (unsigned long long)ps->duplicated);
+    NES_LOGI("Timing (avg): emulate %.2f ms, audio %.2f ms, present %.2f ms, emu->present %.2f ms",
+             (double)es.emulate_ns * 1e-6, (double)es.audio_ns * 1e-6,
+             (double)ps->present_ns * 1e-6, (double)ps->latency_ns * 1e-6);
+    NES_LOGI("Pacing: input->present %.2f ms, %llu skipped, emu jitter %.1f/%.1f us avg/max",
+             (double)ps->input_ns * 1e-6, (unsigned long long)es.frames_skipped,
+             (double)es.late_avg_ns * 1e-3, (double)es.late_max_ns * 1e-3);
+    if (ps->jitter.samples) {
+        NES_LOGI("Present jitter: %.1f/%.1f us avg/max",
+                 (double)ps->jitter.avg_ns * 1e-3, (double)ps->jitter.max_ns * 1e-3);
+    }
+    if (emu->beam_slices) {
+        NES_LOGI("Beam racing (%d slices): slice->present %.2f ms; top rows on screen %.2f ms "
+                 "after emulation vs %.2f ms with full-frame presentation",
+                 emu->beam_slices, (double)ps->slice_ns * 1e-6,
+                 (double)ps->top_ns * 1e-6, (double)ps->top_full_ns * 1e-6);
+    }
+    NES_LOGI("Texture upload: %.1f MB, %.2f MB/s avg, %llu unchanged frames not uploaded",
+             (double)video->upload_bytes * 1e-6,
+             elapsed_ns ? (double)video->upload_bytes * 1e3 / (double)elapsed_ns : 0.0,
+             (unsigned long long)video->uploads_skipped);
+}
+
+// prefix.txt (flat report) and prefix.folded (collapsed stacks), named with
+// the ROM's .nl files and the optional ld65 debug file.
+static void write_profile(Nes* nes, const char* rom_path, const char* prefix, const char* dbg_path)
+{
+    const NesProfiler* p = NES_Profiler(nes);
+    if (!p) return;
+
+    NesSymbols syms = { 0 };
+    NesSymbols_LoadNL(&syms, rom_path, nes->cart.prg_rom_size);
+    if (dbg_path && !NesSymbols_LoadDbg(&syms, dbg_path, nes->cart.prg_rom_size)) {
+        NES_LOGW("--dbg: cannot read %s", dbg_path);
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.txt", prefix);
+    FILE* f = fopen(path, "w");
+    if (f) {
+        NesProfiler_WriteFlat(p, &syms, 100, f);
+        fclose(f);
+        NES_LOGI("Profile: %s", path);
+    } else {
+        NES_LOGW("--profile: cannot write %s", path);
+    }
+    snprintf(path, sizeof(path), "%s.folded", prefix);
+    f = fopen(path, "w");
+    if (f) {
+        NesProfiler_WriteCollapsed(p, &syms, f);
+        fclose(f);
+        NES_LOGI("Profile stacks: %s", path);
+    } else {
+        NES_LOGW("--profile: cannot write %s", path);
+    }
+    NesSymbols_Free(&syms);
+}
 
 static void usage(const char* exe)
 {
-    NES_LOGI("Usage: %s path/to/rom.nes", exe);
+    NES_LOGI("Usage: %s path/to/rom.nes [--record movie.nesm] [--audio-latency ms]", exe);
+    NES_LOGI("       [--no-vsync] [--frame-delay ms] [--beam-slices N] [--stats] [--turbo] [--turbo-speed N]");
+    NES_LOGI("       [--trace-counters N] (NES_TRACE builds: hot-path counters every N frames, 0 = on exit)");
+    NES_LOGI("       [--exec-trace out.nestrace] (every instruction, convert with tools/tracefmt)");
+    NES_LOGI("       [--profile prefix] [--dbg file.dbg] (guest-code profile: prefix.txt, prefix.folded)");
+    NES_LOGI("       [--timeline out.json] (frame phases for chrome://tracing / Perfetto, written on exit)");
     NES_LOGI("P1: Arrows=Dpad, Z=B, X=A, RShift=Select, Enter=Start");
     NES_LOGI("P2: WASD=Dpad, G=B, H=A, R=Select, T=Start");
-    NES_LOGI("Esc=Quit");
+    NES_LOGI("Tab=Fast-forward (--turbo-speed N x, default 0 = uncapped), F1=Stats overlay, Esc=Quit");
 }
 
 int main(int argc, char** argv)
@@ -18,11 +259,72 @@ int main(int argc, char** argv)
     }
 
     const char* rom_path = argv[1];
+    const char* record_path = NULL;
+    int audio_latency_ms = SDLAUDIO_DEFAULT_LATENCY_MS;
+    bool vsync = true;
+    double frame_delay_ms = 0.0;
+    bool show_stats = false;
+    bool turbo = false;
+    u32 turbo_speed = 0;
+    int beam_slices = 0;
+    bool trace_counters = false;
+    u32 trace_every = 0;
+    const char* exec_trace_path = NULL;
+    const char* profile_prefix = NULL;
+    const char* dbg_path = NULL;
+    const char* timeline_path = NULL;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--audio-latency") == 0 && i + 1 < argc) {
+            audio_latency_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-vsync") == 0) {
+            vsync = false;
+        } else if (strcmp(argv[i], "--frame-delay") == 0 && i + 1 < argc) {
+            frame_delay_ms = atof(argv[++i]);
+            if (frame_delay_ms < 0.0) frame_delay_ms = 0.0;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = true;
+        } else if (strcmp(argv[i], "--turbo") == 0) {
+            turbo = true;
+        } else if (strcmp(argv[i], "--turbo-speed") == 0 && i + 1 < argc) {
+            turbo_speed = (u32)strtoul(argv[++i], NULL, 10);
+            if (turbo_speed == 1u) turbo_speed = 2u;    // 1x is not fast-forward
+        } else if (strcmp(argv[i], "--beam-slices") == 0 && i + 1 < argc) {
+            beam_slices = atoi(argv[++i]);
+            if (beam_slices < 0) beam_slices = 0;
+            if (beam_slices > EMU_BEAM_MAX_SLICES) beam_slices = EMU_BEAM_MAX_SLICES;
+        } else if (strcmp(argv[i], "--trace-counters") == 0 && i + 1 < argc) {
+            trace_counters = true;
+            trace_every = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--exec-trace") == 0 && i + 1 < argc) {
+            exec_trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--dbg") == 0 && i + 1 < argc) {
+            dbg_path = argv[++i];
+        } else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+            timeline_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
     SdlApp app;
     if (!SdlApp_Init(&app, "NES Emulator (SDL3)", NES_FB_W, NES_FB_H, 3)) {
         return 1;
     }
+    app.show_stats = show_stats;
+    app.turbo = turbo;
+    // Slices only reach the screen early when presents do not wait for vsync.
+    if (beam_slices) vsync = false;
+    if (!vsync && !SdlVideo_SetVSync(&app.video, false)) {
+        vsync = true;
+        if (beam_slices) NES_LOGW("Beam racing needs vsync off; presenting full frames");
+        beam_slices = 0;
+    }
 
     Nes nes;
     if (!NES_Init(&nes)) {
@@ -37,19 +339,116 @@ int main(int argc, char** argv)
     }
 
     NES_Reset(&nes);
+    if (trace_counters && !NES_SetTraceDump(&nes, stderr, trace_every)) {
+        NES_LOGW("--trace-counters: this build has no counters (make TRACE=1)");
+        trace_counters = false;
+    }
+    if (exec_trace_path && !NES_StartExecTrace(&nes, exec_trace_path)) {
+        NES_LOGW("--exec-trace: cannot write %s", exec_trace_path);
+    }
+    if (profile_prefix && !NES_StartProfile(&nes)) profile_prefix = NULL;
+
+    // Audio is optional: without a device the game runs silent.
+    SdlAudio audio;
+    if (SdlAudio_Init(&audio, AUDIO_SAMPLE_RATE, audio_latency_ms)) {
+        NES_EnableAudio(&nes, AUDIO_SAMPLE_RATE);
+    }
+
+    // Movies start from power-on, so recording begins right after reset.
+    NesMovieRecorder movie;
+    bool recording = false;
+    if (record_path) {
+        recording = NesMovie_RecordBegin(&movie, record_path, &nes, true);
+        if (recording) NES_LOGI("Recording movie to %s", record_path);
+    }
+
+    // Both threads pace off one grid. With vsync the display paces the
+    // render loop; without it, presents land on the frame boundaries, one
+    // frame behind emulation, and input is polled while waiting.
+    NesClock clock;
+    NesClock_Init(&clock, NES_NTSC_FRAME_HZ, NES_CLOCK_DEFAULT_SPIN_NS);
+
+    // Before the emulation thread starts, so it attaches itself.
+    if (timeline_path && NesTimeline_Start(0)) NesTimeline_AttachThread("render");
+
+    EmuThread emu;
+    bool running = EmuThread_Start(&emu, &nes, nes.audio ? &audio : NULL,
+                                   recording ? &movie : NULL,
+                                   &clock, (u64)(frame_delay_ms * 1e6), beam_slices);
+    if (running && emu.frame_delay_ns) {
+        NES_LOGI("Frame delay: %.1f ms", (double)emu.frame_delay_ns * 1e-6);
+    }
 
-    while (!app.quit) {
+    PresentStats ps = { 0 };
+    u64 k = NesClock_FrameAt(&clock, NesClock_Now()) + 1u;
+    u32 speed = 1u;
+    bool overlay_stats = false;
+    u32 overlay_speed = 1u;
+    u64 t_start = NesClock_Now();
+    BeamCursor bc = { 0 };
+    while (running && !app.quit) {
         SdlApp_Poll(&app);
+        EmuThread_SetInput(&emu, app.input);
 
-        // snapshot input into NES
-        nes.input = app.input;
+        u32 want = app.turbo ? turbo_speed : 1u;
+        if (want != speed) {
+            speed = want;
+            EmuThread_SetSpeed(&emu, speed);
+        }
 
-        // run one frame of emulation (placeholder now)
-        NES_RunFrame(&nes);
+        if (emu.beam && speed == 1u) {
+            if (!present_beam(&app, &emu, &bc, &ps)) {
+                NesClock_SleepUntil(&clock, NesClock_Now() + BEAM_POLL_NS);
+            }
+        } else {
+            if (!vsync) {
+                u64 deadline = NesClock_Deadline(&clock, k);
+                for (u64 now = NesClock_Now(); now + POLL_SLICE_NS < deadline && !app.quit;
+                     now = NesClock_Now()) {
+                    NesClock_SleepUntil(&clock, now + POLL_SLICE_NS);
+                    SdlApp_Poll(&app);
+                    EmuThread_SetInput(&emu, app.input);
+                }
+                NesJitter_Add(&ps.jitter, NesClock_SleepUntil(&clock, deadline));
+                k = NesClock_FrameAt(&clock, NesClock_Now() + 1u);
+            }
+
+            bool fresh = false;
+            const EmuFrame* frame = EmuThread_LatestFrame(&emu, &fresh);
+
+            u64 t0 = NesClock_Now();
+            SdlVideo_PresentARGB(&app.video, frame->fb, NES_FB_W, NES_FB_H);
+            u64 t1 = NesClock_Now();
+            present_stats_note(&ps, frame, fresh, t0, t1);
+        }
+
+        bool due = update_rates(&ps, &emu, &app.video, NesClock_Now());
+        if (due || app.show_stats != overlay_stats || speed != overlay_speed) {
+            update_overlay(&app, &emu, &ps, vsync, speed);
+            overlay_stats = app.show_stats;
+            overlay_speed = speed;
+        }
+    }
+
+    if (running) {
+        EmuThread_Stop(&emu);
+        log_frame_stats(&emu, &ps, &app.video, NesClock_Now() - t_start);
+        recording = emu.movie != NULL;
+    }
+    if (trace_counters) NES_TraceDump(&nes, stderr);
+    if (profile_prefix) write_profile(&nes, rom_path, profile_prefix, dbg_path);
+    if (timeline_path && NesTimeline_Write(timeline_path)) NES_LOGI("Timeline: %s", timeline_path);
+
+    if (recording && NesMovie_RecordEnd(&movie)) {
+        NES_LOGI("Movie saved: %s", record_path);
+    }
 
-        // present framebuffer
-        SdlVideo_PresentARGB(&app.video, NES_Framebuffer(&nes), NES_FB_W, NES_FB_H);
+    if (audio.stream) {
+        NES_LOGI("Audio: %llu underruns, %llu overruns",
+                 (unsigned long long)SdlAudio_Underruns(&audio),
+                 (unsigned long long)SdlAudio_Overruns(&audio));
     }
+    SdlAudio_Shutdown(&audio);
 
     NES_Destroy(&nes);
     SdlApp_Shutdown(&app);
@@ -1,4 +1,6 @@
 #include "nes/apu/apu2a03.h"
+#include "nes/apu/blip.h"
+#include <stddef.h>
 #include <string.h>
 
 static const u8 k_apu_len_table[32] = {
@@ -15,174 +17,621 @@ static const u8 k_duty_table[4][8] = {
     {1, 0, 0, 1, 1, 1, 1, 1}
 };
 
-static void pulse_reload_from_reg3(APU2A03* a, int ch, u8 data)
+static const u8 k_triangle_table[32] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+// NTSC timer periods in CPU cycles
+static const u16 k_noise_period[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+
+static const u16 k_dmc_period[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+// Linear approximation of the 2A03 mixer, scaled so a full mix peaks near
+// 28000: pulse 0.00752, triangle 0.00851, noise 0.00494, DMC 0.00335 per step.
+enum {
+    MIX_PULSE    = 246,
+    MIX_TRIANGLE = 279,
+    MIX_NOISE    = 162,
+    MIX_DMC      = 110
+};
+
+// ---------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------
+
+static void emit(APU2A03* a, int ch, u64 time, int amp)
 {
-    if ((a->status_enable & (u8)(1u << ch)) == 0u) return;
+    int delta = amp - a->amp[ch];
+    if (delta == 0) return;
 
-    a->length_ctr[ch] = k_apu_len_table[(data >> 3) & 0x1Fu];
-    a->pulse_seq_step[ch] = 0;
-    a->pulse_env_start[ch] = true;
+    a->amp[ch] = amp;
+    if (a->out) Blip_AddDelta(a->out, (u32)(time - a->frame_start), delta);
 }
 
-static void pulse_clock_envelope(APU2A03* a, int ch)
+static u8 envelope_volume(const APUEnvelope* e)
 {
-    if (a->pulse_env_start[ch]) {
-        a->pulse_env_start[ch] = false;
-        a->pulse_env_decay[ch] = 15u;
-        a->pulse_env_divider[ch] = a->pulse_env_period[ch];
+    return e->constant ? (u8)(e->period & 0x0Fu) : e->decay;
+}
+
+static void envelope_clock(APUEnvelope* e)
+{
+    if (e->start) {
+        e->start = false;
+        e->decay = 15u;
+        e->divider = e->period;
         return;
     }
 
-    if (a->pulse_env_divider[ch] > 0u) {
-        a->pulse_env_divider[ch]--;
+    if (e->divider > 0u) {
+        e->divider--;
         return;
     }
 
-    a->pulse_env_divider[ch] = a->pulse_env_period[ch];
-    if (a->pulse_env_decay[ch] > 0u) {
-        a->pulse_env_decay[ch]--;
-    } else if (a->pulse_env_loop[ch]) {
-        a->pulse_env_decay[ch] = 15u;
+    e->divider = e->period;
+    if (e->decay > 0u) {
+        e->decay--;
+    } else if (e->loop) {
+        e->decay = 15u;
     }
 }
 
-static void clock_quarter_frame(APU2A03* a)
+// Number of timer expiries at or before `end` for a timer next due at `next`.
+static u64 steps_until(u64 next, u64 end, u64 period)
 {
-    pulse_clock_envelope(a, APU_PULSE_CH1);
-    pulse_clock_envelope(a, APU_PULSE_CH2);
+    return (next > end) ? 0u : (end - next) / period + 1u;
 }
 
-static void clock_half_frame(APU2A03* a)
+// ---------------------------------------------------------------------------
+// Pulse
+// ---------------------------------------------------------------------------
+
+static u32 pulse_timer_cycles(const APUPulse* p)
 {
-    for (int ch = 0; ch < 4; ch++) {
-        bool halt = false;
-        if (ch == APU_PULSE_CH1) halt = a->pulse_env_loop[APU_PULSE_CH1];
-        if (ch == APU_PULSE_CH2) halt = a->pulse_env_loop[APU_PULSE_CH2];
+    return ((u32)p->period + 1u) * 2u;
+}
 
-        if ((a->status_enable & (u8)(1u << ch)) && a->length_ctr[ch] > 0u && !halt) {
-            a->length_ctr[ch]--;
-        }
+static u16 pulse_sweep_target(const APUPulse* p, int ch)
+{
+    u16 change = (u16)(p->period >> p->sweep_shift);
+    if (!p->sweep_negate) return (u16)(p->period + change);
+
+    // Pulse 1 negates with one's complement, pulse 2 with two's complement.
+    u16 sub = (u16)(change + (ch == APU_PULSE_CH1 ? 1u : 0u));
+    return (sub > p->period) ? 0u : (u16)(p->period - sub);
+}
+
+static bool pulse_muted(const APUPulse* p, int ch)
+{
+    return p->period < 8u || pulse_sweep_target(p, ch) > 0x07FFu;
+}
+
+static bool pulse_silent(const APUPulse* p, int ch)
+{
+    return p->length == 0u || pulse_muted(p, ch) || envelope_volume(&p->env) == 0u;
+}
+
+static int pulse_amp(const APUPulse* p, int ch)
+{
+    if (pulse_silent(p, ch)) return 0;
+    if (!k_duty_table[p->duty & 3u][p->seq & 7u]) return 0;
+    return (int)envelope_volume(&p->env) * MIX_PULSE;
+}
+
+static void pulse_run(APU2A03* a, int ch, u64 end)
+{
+    APUPulse* p = &a->pulse[ch];
+    u64 period = pulse_timer_cycles(p);
+
+    if (!a->out || pulse_silent(p, ch)) {
+        u64 n = steps_until(p->next_step, end, period);
+        p->seq = (u8)((p->seq + (n & 7u)) & 7u);
+        p->next_step += n * period;
+        return;
+    }
+
+    while (p->next_step <= end) {
+        p->seq = (u8)((p->seq + 1u) & 7u);
+        emit(a, ch, p->next_step, pulse_amp(p, ch));
+        p->next_step += period;
     }
 }
 
-static void pulse_tick_timer(APU2A03* a, int ch)
+static void pulse_clock_sweep(APUPulse* p, int ch)
 {
-    if (a->pulse_timer_value[ch] == 0u) {
-        a->pulse_timer_value[ch] = a->pulse_timer_period[ch];
-        a->pulse_seq_step[ch] = (u8)((a->pulse_seq_step[ch] + 1u) & 7u);
+    if (p->sweep_divider == 0u && p->sweep_enabled && p->sweep_shift > 0u && !pulse_muted(p, ch)) {
+        p->period = pulse_sweep_target(p, ch);
+    }
+
+    if (p->sweep_divider == 0u || p->sweep_reload) {
+        p->sweep_divider = p->sweep_period;
+        p->sweep_reload = false;
     } else {
-        a->pulse_timer_value[ch]--;
+        p->sweep_divider--;
     }
+}
 
-    if ((a->status_enable & (u8)(1u << ch)) == 0u || a->length_ctr[ch] == 0u) {
-        a->pulse_output[ch] = 0u;
+// ---------------------------------------------------------------------------
+// Triangle
+// ---------------------------------------------------------------------------
+
+static bool triangle_running(const APUTriangle* t)
+{
+    // Ultrasonic periods hold the current level instead of aliasing.
+    return t->length > 0u && t->linear > 0u && t->period >= 2u;
+}
+
+static int triangle_amp(const APUTriangle* t)
+{
+    return (int)k_triangle_table[t->seq & 31u] * MIX_TRIANGLE;
+}
+
+static void triangle_run(APU2A03* a, u64 end)
+{
+    APUTriangle* t = &a->triangle;
+    u64 period = (u64)t->period + 1u;
+
+    if (!triangle_running(t)) {
+        t->next_step += steps_until(t->next_step, end, period) * period;
         return;
     }
 
-    if (a->pulse_timer_period[ch] < 8u) {
-        a->pulse_output[ch] = 0u;
+    if (!a->out) {
+        u64 n = steps_until(t->next_step, end, period);
+        t->seq = (u8)((t->seq + (n & 31u)) & 31u);
+        t->next_step += n * period;
         return;
     }
 
-    u8 duty_bit = k_duty_table[a->pulse_duty[ch] & 3u][a->pulse_seq_step[ch] & 7u];
-    if (!duty_bit) {
-        a->pulse_output[ch] = 0u;
-        return;
+    while (t->next_step <= end) {
+        t->seq = (u8)((t->seq + 1u) & 31u);
+        emit(a, APU_TRIANGLE, t->next_step, triangle_amp(t));
+        t->next_step += period;
+    }
+}
+
+static void triangle_clock_linear(APUTriangle* t)
+{
+    if (t->linear_reload_flag) {
+        t->linear = t->linear_reload;
+    } else if (t->linear > 0u) {
+        t->linear--;
     }
 
-    u8 vol = a->pulse_const_vol[ch] ? (a->pulse_env_period[ch] & 0x0Fu)
-                                    : (a->pulse_env_decay[ch] & 0x0Fu);
-    a->pulse_output[ch] = vol;
+    if (!t->control) t->linear_reload_flag = false;
 }
 
-bool APU2A03_Init(APU2A03* a)
+// ---------------------------------------------------------------------------
+// Noise
+// ---------------------------------------------------------------------------
+
+static bool noise_silent(const APUNoise* n)
 {
-    if (!a) return false;
-    memset(a, 0, sizeof(*a));
-    return true;
+    return n->length == 0u || envelope_volume(&n->env) == 0u;
 }
 
-void APU2A03_Reset(APU2A03* a)
+static int noise_amp(const APUNoise* n)
 {
-    if (!a) return;
-    memset(a, 0, sizeof(*a));
+    if (noise_silent(n) || (n->lfsr & 1u)) return 0;
+    return (int)envelope_volume(&n->env) * MIX_NOISE;
 }
 
-void APU2A03_Write(APU2A03* a, u16 addr, u8 data)
+static void noise_clock_lfsr(APUNoise* n)
 {
-    if (!a) return;
+    u16 tap = n->mode ? 6u : 1u;
+    u16 feedback = (u16)((n->lfsr ^ (n->lfsr >> tap)) & 1u);
+    n->lfsr = (u16)((n->lfsr >> 1) | (feedback << 14));
+}
 
-    if (addr >= 0x4000u && addr <= 0x4013u) {
-        a->regs[(u8)(addr - 0x4000u)] = data;
+static void noise_run(APU2A03* a, u64 end)
+{
+    APUNoise* n = &a->noise;
+    u64 period = k_noise_period[n->period_index & 0x0Fu];
 
-        if (addr == 0x4000u) {
-            a->pulse_duty[APU_PULSE_CH1] = (u8)((data >> 6) & 0x03u);
-            a->pulse_env_loop[APU_PULSE_CH1] = (data & 0x20u) != 0;
-            a->pulse_const_vol[APU_PULSE_CH1] = (data & 0x10u) != 0;
-            a->pulse_env_period[APU_PULSE_CH1] = (u8)(data & 0x0Fu);
-            return;
-        }
+    // A silent channel freezes its shift register.
+    if (noise_silent(n)) {
+        n->next_step += steps_until(n->next_step, end, period) * period;
+        return;
+    }
 
-        if (addr == 0x4002u) {
-            a->pulse_timer_period[APU_PULSE_CH1] =
-                (u16)((a->pulse_timer_period[APU_PULSE_CH1] & 0x0700u) | data);
-            return;
+    if (!a->out) {
+        for (u64 k = steps_until(n->next_step, end, period); k > 0u; k--) {
+            noise_clock_lfsr(n);
         }
+        n->next_step += steps_until(n->next_step, end, period) * period;
+        return;
+    }
 
-        if (addr == 0x4003u) {
-            a->pulse_timer_period[APU_PULSE_CH1] =
-                (u16)((a->pulse_timer_period[APU_PULSE_CH1] & 0x00FFu) |
-                      (((u16)(data & 0x07u)) << 8));
-            pulse_reload_from_reg3(a, APU_PULSE_CH1, data);
-            return;
+    while (n->next_step <= end) {
+        noise_clock_lfsr(n);
+        emit(a, APU_NOISE, n->next_step, noise_amp(n));
+        n->next_step += period;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DMC
+// ---------------------------------------------------------------------------
+
+static void dmc_restart(APUDMC* d)
+{
+    d->addr = d->sample_addr;
+    d->bytes_remaining = d->sample_length;
+}
+
+static void dmc_fetch(APU2A03* a)
+{
+    APUDMC* d = &a->dmc;
+    if (d->buffer_full || d->bytes_remaining == 0u) return;
+
+    d->buffer = a->dmc_read ? a->dmc_read(a->dmc_user, d->addr) : 0u;
+    d->buffer_full = true;
+    d->addr = (d->addr == 0xFFFFu) ? 0x8000u : (u16)(d->addr + 1u);
+
+    if (--d->bytes_remaining == 0u) {
+        if (d->loop) {
+            dmc_restart(d);
+        } else if (d->irq_enabled) {
+            d->irq_flag = true;
         }
+    }
+}
 
-        if (addr == 0x4004u) {
-            a->pulse_duty[APU_PULSE_CH2] = (u8)((data >> 6) & 0x03u);
-            a->pulse_env_loop[APU_PULSE_CH2] = (data & 0x20u) != 0;
-            a->pulse_const_vol[APU_PULSE_CH2] = (data & 0x10u) != 0;
-            a->pulse_env_period[APU_PULSE_CH2] = (u8)(data & 0x0Fu);
-            return;
+static bool dmc_idle(const APUDMC* d)
+{
+    return d->silence && !d->buffer_full && d->bytes_remaining == 0u;
+}
+
+static void dmc_step(APU2A03* a, u64 time)
+{
+    APUDMC* d = &a->dmc;
+
+    if (!d->silence) {
+        if (d->shift & 1u) {
+            if (d->level <= 125u) d->level = (u8)(d->level + 2u);
+        } else if (d->level >= 2u) {
+            d->level = (u8)(d->level - 2u);
         }
+        d->shift >>= 1;
+        emit(a, APU_DMC, time, (int)d->level * MIX_DMC);
+    }
 
-        if (addr == 0x4006u) {
-            a->pulse_timer_period[APU_PULSE_CH2] =
-                (u16)((a->pulse_timer_period[APU_PULSE_CH2] & 0x0700u) | data);
-            return;
+    if (--d->bits_remaining == 0u) {
+        d->bits_remaining = 8u;
+        if (d->buffer_full) {
+            d->shift = d->buffer;
+            d->buffer_full = false;
+            d->silence = false;
+            dmc_fetch(a);
+        } else {
+            d->silence = true;
         }
+    }
+}
 
-        if (addr == 0x4007u) {
-            a->pulse_timer_period[APU_PULSE_CH2] =
-                (u16)((a->pulse_timer_period[APU_PULSE_CH2] & 0x00FFu) |
-                      (((u16)(data & 0x07u)) << 8));
-            pulse_reload_from_reg3(a, APU_PULSE_CH2, data);
+static void dmc_run(APU2A03* a, u64 end)
+{
+    APUDMC* d = &a->dmc;
+    u64 period = k_dmc_period[d->rate_index & 0x0Fu];
+
+    if (dmc_idle(d)) {
+        // Only the output-cycle counter moves; bits_remaining cycles 8..1.
+        u64 n = steps_until(d->next_step, end, period);
+        d->bits_remaining = (u8)(((u64)d->bits_remaining + 7u - (n & 7u)) % 8u + 1u);
+        d->next_step += n * period;
+        return;
+    }
+
+    while (d->next_step <= end) {
+        dmc_step(a, d->next_step);
+        d->next_step += period;
+        if (dmc_idle(d)) {
+            dmc_run(a, end);
             return;
         }
+    }
+}
 
-        if (addr == 0x400Bu) {
-            if (a->status_enable & 0x04u) {
-                a->length_ctr[APU_TRIANGLE] = k_apu_len_table[(data >> 3) & 0x1Fu];
-            }
-            return;
+// Cycle of the fetch that empties a non-looping sample, when it raises an IRQ.
+static void dmc_predict_irq(APU2A03* a)
+{
+    const APUDMC* d = &a->dmc;
+    a->dmc_irq_cycle = UINT64_MAX;
+    if (!d->irq_enabled || d->loop || d->bytes_remaining == 0u || d->irq_flag) return;
+
+    // The buffer is full whenever bytes remain, so the next fetch happens at
+    // the next output-cycle boundary and every 8 timer clocks after that.
+    u64 period = k_dmc_period[d->rate_index & 0x0Fu];
+    u64 boundary = d->next_step + (u64)(d->bits_remaining - 1u) * period;
+    a->dmc_irq_cycle = boundary + (u64)(d->bytes_remaining - 1u) * 8u * period;
+}
+
+// ---------------------------------------------------------------------------
+// Catch-up
+// ---------------------------------------------------------------------------
+
+static void apu_run_to(APU2A03* a, u64 end)
+{
+    if (end < a->sync_cycle) return;
+
+    pulse_run(a, APU_PULSE_CH1, end);
+    pulse_run(a, APU_PULSE_CH2, end);
+    triangle_run(a, end);
+    noise_run(a, end);
+    dmc_run(a, end);
+
+    a->sync_cycle = end;
+}
+
+static void schedule(APU2A03* a)
+{
+    dmc_predict_irq(a);
+    a->next_event = (a->frame_next < a->dmc_irq_cycle) ? a->frame_next : a->dmc_irq_cycle;
+}
+
+// Re-derives every channel's output at `t` after a register write or
+// sequencer clock.
+static void apu_refresh(APU2A03* a, u64 t)
+{
+    emit(a, APU_PULSE_CH1, t, pulse_amp(&a->pulse[0], APU_PULSE_CH1));
+    emit(a, APU_PULSE_CH2, t, pulse_amp(&a->pulse[1], APU_PULSE_CH2));
+    emit(a, APU_TRIANGLE, t, triangle_amp(&a->triangle));
+    emit(a, APU_NOISE, t, noise_amp(&a->noise));
+    emit(a, APU_DMC, t, (int)a->dmc.level * MIX_DMC);
+    schedule(a);
+}
+
+static void clock_quarter_frame(APU2A03* a)
+{
+    envelope_clock(&a->pulse[0].env);
+    envelope_clock(&a->pulse[1].env);
+    envelope_clock(&a->noise.env);
+    triangle_clock_linear(&a->triangle);
+}
+
+static void clock_length(u8* length, bool halt)
+{
+    if (*length > 0u && !halt) (*length)--;
+}
+
+static void clock_half_frame(APU2A03* a)
+{
+    clock_length(&a->pulse[0].length, a->pulse[0].env.loop);
+    clock_length(&a->pulse[1].length, a->pulse[1].env.loop);
+    clock_length(&a->triangle.length, a->triangle.control);
+    clock_length(&a->noise.length, a->noise.env.loop);
+
+    pulse_clock_sweep(&a->pulse[0], APU_PULSE_CH1);
+    pulse_clock_sweep(&a->pulse[1], APU_PULSE_CH2);
+}
+
+// Frame sequencer steps, in cycles after the sequence start.
+enum {
+    SEQ_QUARTER = 1u << 0,
+    SEQ_HALF    = 1u << 1,
+    SEQ_IRQ     = 1u << 2,
+    SEQ_WRAP    = 1u << 3
+};
+
+typedef struct APUSeqStep {
+    u16 cycle;
+    u8 action;
+} APUSeqStep;
+
+static const APUSeqStep k_seq_steps[2][5] = {
+    {   // 4-step
+        { 3729u, SEQ_QUARTER },
+        { 7457u, SEQ_QUARTER | SEQ_HALF },
+        { 11186u, SEQ_QUARTER },
+        { 14915u, SEQ_QUARTER | SEQ_HALF | SEQ_IRQ | SEQ_WRAP },
+        { 0u, 0u }
+    },
+    {   // 5-step
+        { 3729u, SEQ_QUARTER },
+        { 7457u, SEQ_QUARTER | SEQ_HALF },
+        { 11186u, SEQ_QUARTER },
+        { 14915u, SEQ_QUARTER | SEQ_HALF },
+        { 18641u, SEQ_QUARTER | SEQ_WRAP }
+    }
+};
+
+static void seq_restart(APU2A03* a, u64 start)
+{
+    a->frame_seq_start = start;
+    a->frame_step = 0u;
+    a->frame_next = start + k_seq_steps[a->five_step_mode][0].cycle;
+}
+
+// Processes sequencer steps due at or before `target` (each after running the
+// channels up to its cycle), then runs the channels to `target`.
+static void apu_sync(APU2A03* a, u64 target)
+{
+    while (a->frame_next <= target) {
+        u64 t = a->frame_next;
+        u8 action = k_seq_steps[a->five_step_mode][a->frame_step].action;
+
+        apu_run_to(a, t);
+        clock_quarter_frame(a);
+        if (action & SEQ_HALF) clock_half_frame(a);
+        if ((action & SEQ_IRQ) && !a->frame_irq_inhibit) a->frame_irq_pending = true;
+
+        if (action & SEQ_WRAP) {
+            seq_restart(a, t);
+        } else {
+            a->frame_step++;
+            a->frame_next = a->frame_seq_start + k_seq_steps[a->five_step_mode][a->frame_step].cycle;
         }
+        apu_refresh(a, t);
+    }
 
-        if (addr == 0x400Fu) {
-            if (a->status_enable & 0x08u) {
-                a->length_ctr[APU_NOISE] = k_apu_len_table[(data >> 3) & 0x1Fu];
-            }
-            return;
+    apu_run_to(a, target);
+    schedule(a);
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+static void reset_state(APU2A03* a)
+{
+    // Host bindings live at the end of the struct and survive resets.
+    memset(a, 0, offsetof(APU2A03, amp));
+    memset(a->amp, 0, sizeof(a->amp));
+    a->frame_start = 0;
+
+    a->noise.lfsr = 1u;
+    a->dmc.bits_remaining = 8u;
+    a->dmc.silence = true;
+    seq_restart(a, 0u);
+    schedule(a);
+}
+
+bool APU2A03_Init(APU2A03* a)
+{
+    if (!a) return false;
+    memset(a, 0, sizeof(*a));
+    reset_state(a);
+    return true;
+}
+
+void APU2A03_Reset(APU2A03* a)
+{
+    if (!a) return;
+    if (a->out) Blip_Clear(a->out);
+    reset_state(a);
+}
+
+void APU2A03_SetDMCReader(APU2A03* a, APUDmcReadFn fn, void* user)
+{
+    if (!a) return;
+    a->dmc_read = fn;
+    a->dmc_user = user;
+}
+
+void APU2A03_SetOutput(APU2A03* a, Blip* out)
+{
+    if (!a) return;
+    APU2A03_Run(a);
+    a->out = out;
+    a->frame_start = a->cycle;
+    memset(a->amp, 0, sizeof(a->amp));
+    if (out) {
+        Blip_Clear(out);
+        apu_refresh(a, a->cycle);
+    }
+}
+
+static void write_length(APU2A03* a, u8* length, int ch, u8 data)
+{
+    if (a->status_enable & (u8)(1u << ch)) {
+        *length = k_apu_len_table[(data >> 3) & 0x1Fu];
+    }
+}
+
+static void write_envelope(APUEnvelope* e, u8 data)
+{
+    e->loop = (data & 0x20u) != 0;
+    e->constant = (data & 0x10u) != 0;
+    e->period = (u8)(data & 0x0Fu);
+}
+
+static void write_pulse(APU2A03* a, int ch, u16 reg, u8 data)
+{
+    APUPulse* p = &a->pulse[ch];
+
+    switch (reg & 3u) {
+        case 0:
+            p->duty = (u8)((data >> 6) & 0x03u);
+            write_envelope(&p->env, data);
+            break;
+
+        case 1:
+            p->sweep_enabled = (data & 0x80u) != 0;
+            p->sweep_period = (u8)((data >> 4) & 0x07u);
+            p->sweep_negate = (data & 0x08u) != 0;
+            p->sweep_shift = (u8)(data & 0x07u);
+            p->sweep_reload = true;
+            break;
+
+        case 2:
+            p->period = (u16)((p->period & 0x0700u) | data);
+            break;
+
+        default:
+            p->period = (u16)((p->period & 0x00FFu) | (((u16)(data & 0x07u)) << 8));
+            write_length(a, &p->length, ch, data);
+            p->seq = 0;
+            p->env.start = true;
+            break;
+    }
+}
+
+void APU2A03_Write(APU2A03* a, u16 addr, u8 data)
+{
+    if (!a) return;
+
+    APU2A03_Run(a);
+
+    if (addr >= 0x4000u && addr <= 0x4013u) {
+        a->regs[(u8)(addr - 0x4000u)] = data;
+
+        if (addr <= 0x4007u) {
+            write_pulse(a, (addr < 0x4004u) ? APU_PULSE_CH1 : APU_PULSE_CH2, addr, data);
+        } else if (addr == 0x4008u) {
+            a->triangle.control = (data & 0x80u) != 0;
+            a->triangle.linear_reload = (u8)(data & 0x7Fu);
+        } else if (addr == 0x400Au) {
+            a->triangle.period = (u16)((a->triangle.period & 0x0700u) | data);
+        } else if (addr == 0x400Bu) {
+            a->triangle.period = (u16)((a->triangle.period & 0x00FFu) | (((u16)(data & 0x07u)) << 8));
+            write_length(a, &a->triangle.length, APU_TRIANGLE, data);
+            a->triangle.linear_reload_flag = true;
+        } else if (addr == 0x400Cu) {
+            write_envelope(&a->noise.env, data);
+        } else if (addr == 0x400Eu) {
+            a->noise.mode = (data & 0x80u) != 0;
+            a->noise.period_index = (u8)(data & 0x0Fu);
+        } else if (addr == 0x400Fu) {
+            write_length(a, &a->noise.length, APU_NOISE, data);
+            a->noise.env.start = true;
+        } else if (addr == 0x4010u) {
+            a->dmc.irq_enabled = (data & 0x80u) != 0;
+            a->dmc.loop = (data & 0x40u) != 0;
+            a->dmc.rate_index = (u8)(data & 0x0Fu);
+            if (!a->dmc.irq_enabled) a->dmc.irq_flag = false;
+        } else if (addr == 0x4011u) {
+            a->dmc.level = (u8)(data & 0x7Fu);
+        } else if (addr == 0x4012u) {
+            a->dmc.sample_addr = (u16)(0xC000u + (u16)data * 64u);
+        } else if (addr == 0x4013u) {
+            a->dmc.sample_length = (u16)((u16)data * 16u + 1u);
         }
 
+        apu_refresh(a, a->cycle);
         return;
     }
 
     if (addr == 0x4015u) {
         a->status_enable = (u8)(data & 0x1Fu);
 
-        if ((a->status_enable & 0x01u) == 0u) a->length_ctr[APU_PULSE_CH1] = 0u;
-        if ((a->status_enable & 0x02u) == 0u) a->length_ctr[APU_PULSE_CH2] = 0u;
-        if ((a->status_enable & 0x04u) == 0u) a->length_ctr[APU_TRIANGLE] = 0u;
-        if ((a->status_enable & 0x08u) == 0u) a->length_ctr[APU_NOISE] = 0u;
+        if ((a->status_enable & 0x01u) == 0u) a->pulse[0].length = 0u;
+        if ((a->status_enable & 0x02u) == 0u) a->pulse[1].length = 0u;
+        if ((a->status_enable & 0x04u) == 0u) a->triangle.length = 0u;
+        if ((a->status_enable & 0x08u) == 0u) a->noise.length = 0u;
+
+        a->dmc.irq_flag = false;
+        if ((a->status_enable & 0x10u) == 0u) {
+            a->dmc.bytes_remaining = 0u;
+        } else if (a->dmc.bytes_remaining == 0u) {
+            dmc_restart(&a->dmc);
+            dmc_fetch(a);
+        }
+
+        apu_refresh(a, a->cycle);
         return;
     }
 
@@ -193,7 +642,14 @@ void APU2A03_Write(APU2A03* a, u16 addr, u8 data)
         if (a->frame_irq_inhibit) {
             a->frame_irq_pending = false;
         }
-        a->frame_cycle = 0u;
+
+        // Selecting the 5-step sequence clocks every unit immediately.
+        if (a->five_step_mode) {
+            clock_quarter_frame(a);
+            clock_half_frame(a);
+        }
+        seq_restart(a, a->cycle);
+        apu_refresh(a, a->cycle);
         return;
     }
 }
@@ -202,57 +658,46 @@ u8 APU2A03_ReadStatus(APU2A03* a, u8 open_bus)
 {
     if (!a) return open_bus;
 
+    APU2A03_Run(a);
+
     u8 status = 0u;
-    if (a->length_ctr[APU_PULSE_CH1] > 0u) status |= 0x01u;
-    if (a->length_ctr[APU_PULSE_CH2] > 0u) status |= 0x02u;
-    if (a->length_ctr[APU_TRIANGLE] > 0u) status |= 0x04u;
-    if (a->length_ctr[APU_NOISE] > 0u) status |= 0x08u;
-    if (a->status_enable & 0x10u) status |= 0x10u; // DMC active approximation
+    if (a->pulse[0].length > 0u) status |= 0x01u;
+    if (a->pulse[1].length > 0u) status |= 0x02u;
+    if (a->triangle.length > 0u) status |= 0x04u;
+    if (a->noise.length > 0u) status |= 0x08u;
+    if (a->dmc.bytes_remaining > 0u) status |= 0x10u;
 
-    u8 irq_bit = a->frame_irq_pending ? 0x40u : 0x00u;
-    u8 out = (u8)((open_bus & 0x20u) | irq_bit | status);
+    u8 irq_bits = (u8)((a->frame_irq_pending ? 0x40u : 0x00u) | (a->dmc.irq_flag ? 0x80u : 0x00u));
+    u8 out = (u8)((open_bus & 0x20u) | irq_bits | status);
 
     a->frame_irq_pending = false;
     return out;
 }
 
-bool APU2A03_Tick(APU2A03* a)
+u64 APU2A03_NextIRQCycle(const APU2A03* a)
 {
-    if (!a) return false;
-
-    a->frame_cycle++;
-
-    if (!a->five_step_mode) {
-        if (a->frame_cycle == 3729u || a->frame_cycle == 11186u) {
-            clock_quarter_frame(a);
-        }
-        if (a->frame_cycle == 7457u || a->frame_cycle == 14915u) {
-            clock_quarter_frame(a);
-            clock_half_frame(a);
-        }
+    if (!a) return UINT64_MAX;
+    if (APU2A03_IRQLine(a)) return a->cycle;
 
-        if (a->frame_cycle >= 14915u) {
-            if (!a->frame_irq_inhibit) {
-                a->frame_irq_pending = true;
-            }
-            a->frame_cycle = 0u;
-        }
-    } else {
-        if (a->frame_cycle == 3729u || a->frame_cycle == 11186u || a->frame_cycle == 18641u) {
-            clock_quarter_frame(a);
-        }
-        if (a->frame_cycle == 7457u || a->frame_cycle == 14915u) {
-            clock_quarter_frame(a);
-            clock_half_frame(a);
-        }
-
-        if (a->frame_cycle >= 18641u) {
-            a->frame_cycle = 0u;
-        }
+    u64 next = a->dmc_irq_cycle;
+    if (!a->five_step_mode && !a->frame_irq_inhibit) {
+        u64 frame_irq = a->frame_seq_start + k_seq_steps[0][3].cycle;
+        if (frame_irq < next) next = frame_irq;
     }
+    return next;
+}
 
-    pulse_tick_timer(a, APU_PULSE_CH1);
-    pulse_tick_timer(a, APU_PULSE_CH2);
+void APU2A03_Run(APU2A03* a)
+{
+    if (!a) return;
+    apu_sync(a, a->cycle);
+}
+
+void APU2A03_EndFrame(APU2A03* a)
+{
+    if (!a) return;
 
-    return a->frame_irq_pending && !a->frame_irq_inhibit;
+    APU2A03_Run(a);
+    if (a->out) Blip_EndFrame(a->out, (u32)(a->cycle - a->frame_start));
+    a->frame_start = a->cycle;
 }
@@ -0,0 +1,140 @@
+#include "nes/apu/blip.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLIP_PI 3.14159265358979323846
+
+// Lowpass cutoff as a fraction of the output Nyquist frequency.
+#define BLIP_CUTOFF 0.90
+
+static void build_kernel(Blip* b)
+{
+    const int half = BLIP_TAPS / 2;
+
+    for (int ph = 0; ph <= BLIP_PHASES; ph++) {
+        double frac = (double)ph / (double)BLIP_PHASES;
+        double taps[BLIP_TAPS];
+        double sum = 0.0;
+
+        for (int i = 0; i < BLIP_TAPS; i++) {
+            // Distance from the step to output sample i (step sits between
+            // samples half-1 and half, shifted right by frac).
+            double d = (double)(i - half + 1) - frac;
+            double x = BLIP_CUTOFF * d;
+            double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(BLIP_PI * x) / (BLIP_PI * x);
+            double w = 0.5 + 0.5 * cos(BLIP_PI * d / (double)half); // Hann
+            if (fabs(d) >= (double)half) w = 0.0;
+            taps[i] = sinc * w;
+            sum += taps[i];
+        }
+
+        // Normalise so every phase integrates to exactly BLIP_KERNEL_ONE;
+        // rounding error goes to the largest tap so steps never drift.
+        int total = 0;
+        int peak = 0;
+        for (int i = 0; i < BLIP_TAPS; i++) {
+            int v = (int)lround(taps[i] / sum * (double)BLIP_KERNEL_ONE);
+            b->kernel[ph][i] = (s16)v;
+            total += v;
+            if (abs(v) > abs(b->kernel[ph][peak])) peak = i;
+        }
+        b->kernel[ph][peak] = (s16)(b->kernel[ph][peak] + (BLIP_KERNEL_ONE - total));
+    }
+}
+
+bool Blip_Init(Blip* b, double clock_rate, double sample_rate, int max_samples)
+{
+    if (!b || clock_rate <= 0.0 || sample_rate <= 0.0 || max_samples <= 0) return false;
+    memset(b, 0, sizeof(*b));
+
+    b->buf = (s32*)calloc((size_t)max_samples + BLIP_TAPS, sizeof(s32));
+    if (!b->buf) return false;
+
+    b->size = max_samples;
+    b->factor = (u64)(sample_rate / clock_rate * 4294967296.0 + 0.5);
+    build_kernel(b);
+    return true;
+}
+
+void Blip_Destroy(Blip* b)
+{
+    if (!b) return;
+    free(b->buf);
+    b->buf = NULL;
+    b->size = 0;
+}
+
+void Blip_Clear(Blip* b)
+{
+    if (!b || !b->buf) return;
+    b->offset = 0;
+    b->avail = 0;
+    b->integrator = 0;
+    memset(b->buf, 0, ((size_t)b->size + BLIP_TAPS) * sizeof(s32));
+}
+
+void Blip_AddDelta(Blip* b, u32 clock, int delta)
+{
+    if (!b || !b->buf || delta == 0) return;
+
+    u64 pos = b->offset + (u64)clock * b->factor;
+    u64 index = pos >> 32;
+    u32 phase = (u32)((((pos & 0xFFFFFFFFull) * BLIP_PHASES) + 0x80000000ull) >> 32);
+
+    // Frames longer than the buffer are clamped in Blip_EndFrame.
+    if (index > (u64)b->size) return;
+
+    s32* out = b->buf + index;
+    const s16* k = b->kernel[phase];
+    for (int i = 0; i < BLIP_TAPS; i++) out[i] += (s32)k[i] * delta;
+}
+
+void Blip_EndFrame(Blip* b, u32 clocks)
+{
+    if (!b || !b->buf) return;
+
+    // offset is relative to the first unread sample, so its integer part is
+    // the number of finished samples. Kernels are written at or after the
+    // delta's sample index, so later deltas never touch finished samples.
+    b->offset += (u64)clocks * b->factor;
+    u64 total = b->offset >> 32;
+    if (total > (u64)b->size) {
+        b->offset = ((u64)b->size << 32) | (b->offset & 0xFFFFFFFFull);
+        total = (u64)b->size;
+    }
+    b->avail = (int)total;
+
+    // Keep half the buffer free for the next frame; unread samples beyond
+    // that are dropped oldest first.
+    int keep = b->size / 2;
+    if (b->avail > keep) {
+        int excess = b->avail - keep;
+        Blip_ReadSamples(b, NULL, excess);
+        b->dropped += (u64)excess;
+    }
+}
+
+int Blip_ReadSamples(Blip* b, s16* out, int count)
+{
+    if (!b || !b->buf || count <= 0) return 0;
+    if (count > b->avail) count = b->avail;
+
+    s32 sum = b->integrator;
+    for (int i = 0; i < count; i++) {
+        sum += b->buf[i];
+        s32 s = sum >> 15;
+        if (s < -32768) s = -32768;
+        if (s > 32767) s = 32767;
+        if (out) out[i] = (s16)s;
+        sum -= s << (15 - BLIP_BASS_SHIFT);
+    }
+    b->integrator = sum;
+
+    int remain = b->avail - count + BLIP_TAPS;
+    memmove(b->buf, b->buf + count, (size_t)remain * sizeof(s32));
+    memset(b->buf + remain, 0, (size_t)count * sizeof(s32));
+    b->avail -= count;
+    b->offset -= (u64)count << 32;
+    return count;
+}
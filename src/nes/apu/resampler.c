@@ -0,0 +1,191 @@
+#include "nes/apu/resampler.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define RESAMPLER_HAVE_SSE 1
+#else
+#define RESAMPLER_HAVE_SSE 0
+#endif
+
+#define RESAMPLER_PI 3.14159265358979323846
+
+// Lowpass cutoff as a fraction of the lower Nyquist frequency; the input is
+// already band-limited, so this mostly removes imaging of the ratio wobble.
+#define RESAMPLER_CUTOFF 0.92
+
+// Half a kernel phase in 32.32, so pos >> 24 picks the nearest phase rather
+// than the one below. A fraction that rounds up to 1.0 moves to phase 0 of
+// the next input sample.
+#define RESAMPLER_PHASE_ROUND (1ull << 23)
+
+enum { HISTORY = RESAMPLER_TAPS - 1 };
+
+static void build_kernel(Resampler* r, double cutoff)
+{
+    const int half = RESAMPLER_TAPS / 2;
+
+    for (int ph = 0; ph < RESAMPLER_PHASES; ph++) {
+        double frac = (double)ph / (double)RESAMPLER_PHASES;
+        double sum = 0.0;
+        double taps[RESAMPLER_TAPS];
+
+        for (int i = 0; i < RESAMPLER_TAPS; i++) {
+            // Output sits between taps half-1 and half, frac past half-1.
+            double d = (double)(i - half + 1) - frac;
+            double x = cutoff * d;
+            double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(RESAMPLER_PI * x) / (RESAMPLER_PI * x);
+            double w = 0.5 + 0.5 * cos(RESAMPLER_PI * d / (double)half); // Hann
+            if (fabs(d) >= (double)half) w = 0.0;
+            taps[i] = sinc * w;
+            sum += taps[i];
+        }
+
+        for (int i = 0; i < RESAMPLER_TAPS; i++) {
+            r->kernel[ph][i] = (float)(taps[i] / sum);
+        }
+    }
+}
+
+bool Resampler_Init(Resampler* r, double in_rate, double out_rate, u32 max_input)
+{
+    if (!r || in_rate <= 0.0 || out_rate <= 0.0 || max_input == 0u) return false;
+    memset(r, 0, sizeof(*r));
+
+    r->hist_cap = max_input + RESAMPLER_TAPS;
+    r->hist = (float*)calloc(r->hist_cap, sizeof(float));
+    if (!r->hist) return false;
+
+    double cutoff = RESAMPLER_CUTOFF * (out_rate < in_rate ? out_rate / in_rate : 1.0);
+    build_kernel(r, cutoff);
+
+    r->base_step = in_rate / out_rate;
+    r->use_simd = RESAMPLER_HAVE_SSE != 0;
+    Resampler_SetRatio(r, 1.0);
+    Resampler_Clear(r);
+    return true;
+}
+
+void Resampler_Destroy(Resampler* r)
+{
+    if (!r) return;
+    free(r->hist);
+    r->hist = NULL;
+    r->hist_cap = 0;
+}
+
+void Resampler_Clear(Resampler* r)
+{
+    if (!r || !r->hist) return;
+    memset(r->hist, 0, (size_t)HISTORY * sizeof(float));
+    r->hist_len = HISTORY;
+    r->pos = 0;
+}
+
+void Resampler_SetRatio(Resampler* r, double ratio)
+{
+    if (!r) return;
+    if (ratio > 1.0 + RESAMPLER_MAX_ADJUST) ratio = 1.0 + RESAMPLER_MAX_ADJUST;
+    if (ratio < 1.0 - RESAMPLER_MAX_ADJUST) ratio = 1.0 - RESAMPLER_MAX_ADJUST;
+
+    r->ratio = ratio;
+    r->step = (u64)(r->base_step / ratio * 4294967296.0 + 0.5);
+}
+
+u32 Resampler_MaxOutput(const Resampler* r, u32 in_count)
+{
+    if (!r || r->step == 0u) return 0;
+    u64 span = ((u64)in_count + RESAMPLER_TAPS) << 32;
+    return (u32)(span / r->step + 1u);
+}
+
+static float dot_scalar(const float* x, const float* k)
+{
+    float acc = 0.0f;
+    for (int i = 0; i < RESAMPLER_TAPS; i++) acc += x[i] * k[i];
+    return acc;
+}
+
+#if RESAMPLER_HAVE_SSE
+static float dot_sse(const float* x, const float* k)
+{
+    __m128 acc = _mm_mul_ps(_mm_loadu_ps(x), _mm_load_ps(k));
+    for (int i = 4; i < RESAMPLER_TAPS; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_load_ps(k + i)));
+    }
+
+    __m128 hi = _mm_movehl_ps(acc, acc);
+    acc = _mm_add_ps(acc, hi);
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return _mm_cvtss_f32(acc);
+}
+#endif
+
+static s16 to_s16(float v)
+{
+    if (v >= 32767.0f) return 32767;
+    if (v <= -32768.0f) return -32768;
+    return (s16)lrintf(v);
+}
+
+// Emits every output whose kernel window lies inside hist.
+static u32 run(Resampler* r, s16* out, u32 out_cap)
+{
+    u32 n = 0;
+    u64 limit = (u64)(r->hist_len - RESAMPLER_TAPS + 1u) << 32;
+
+#if RESAMPLER_HAVE_SSE
+    if (r->use_simd) {
+        while (r->pos + RESAMPLER_PHASE_ROUND < limit && n < out_cap) {
+            u64 pos = r->pos + RESAMPLER_PHASE_ROUND;
+            const float* x = r->hist + (pos >> 32);
+            const float* k = r->kernel[(pos >> 24) & (RESAMPLER_PHASES - 1u)];
+            out[n++] = to_s16(dot_sse(x, k));
+            r->pos += r->step;
+        }
+        return n;
+    }
+#endif
+
+    while (r->pos + RESAMPLER_PHASE_ROUND < limit && n < out_cap) {
+        u64 pos = r->pos + RESAMPLER_PHASE_ROUND;
+        const float* x = r->hist + (pos >> 32);
+        const float* k = r->kernel[(pos >> 24) & (RESAMPLER_PHASES - 1u)];
+        out[n++] = to_s16(dot_scalar(x, k));
+        r->pos += r->step;
+    }
+    return n;
+}
+
+u32 Resampler_Process(Resampler* r, const s16* in, u32 in_count, s16* out, u32 out_cap)
+{
+    if (!r || !r->hist || !in || !out) return 0;
+
+    u32 written = 0;
+    while (in_count > 0u) {
+        u32 room = r->hist_cap - r->hist_len;
+        if (room == 0u) break;  // out_cap too small; the rest is dropped
+        u32 take = (in_count < room) ? in_count : room;
+        for (u32 i = 0; i < take; i++) r->hist[r->hist_len + i] = (float)in[i];
+        r->hist_len += take;
+        in += take;
+        in_count -= take;
+
+        written += run(r, out + written, out_cap - written);
+
+        // Keep the inputs the next output still needs.
+        u32 used = (u32)(r->pos >> 32);
+        if (used > r->hist_len) used = r->hist_len;
+        memmove(r->hist, r->hist + used, (size_t)(r->hist_len - used) * sizeof(float));
+        r->hist_len -= used;
+        r->pos -= (u64)used << 32;
+    }
+    return written;
+}
+
+const char* Resampler_Backend(void)
+{
+    return RESAMPLER_HAVE_SSE ? "sse" : "scalar";
+}
@@ -0,0 +1,398 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "nes/batch.h"
+#include "nes/cart.h"
+#include "nes/log.h"
+#include "nes/util/file.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+enum { BATCH_CACHE_LINE = 64 };
+
+// Per-worker queue of instance indices. Owners and thieves both claim work by
+// bumping `next`, so a worker that finishes early drains its neighbours.
+typedef struct BatchRange {
+    _Alignas(BATCH_CACHE_LINE) atomic_int next;
+    int end;
+} BatchRange;
+
+typedef struct BatchWorker {
+    pthread_t thread;
+    struct NesBatch* owner;
+    int id;
+    bool started;
+} BatchWorker;
+
+struct NesBatch {
+    Cart rom;           // shared ROM image; instances borrow its PRG/CHR ROM
+    Nes* nes;
+    int count;
+
+    NesBatchConfig cfg;
+    size_t obs_stride;
+
+    // Thread pool
+    BatchWorker* workers;
+    BatchRange* ranges;
+    int threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start_cv;
+    pthread_cond_t done_cv;
+    u64 epoch;
+    int pending;
+    bool stop;
+
+    // Current job (valid while pending > 0)
+    const NesInput* job_inputs;
+    int job_frames;
+    u8* job_obs;
+    u8* job_done;
+
+    // Throughput
+    u64 stat_frames;
+    double stat_seconds;
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int online_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
+
+static void pin_current_thread(const NesBatch* b, int worker_id)
+{
+#if defined(__linux__)
+    int cpu;
+    if (b->cfg.cpu_list && b->cfg.cpu_count > 0) {
+        cpu = b->cfg.cpu_list[worker_id % b->cfg.cpu_count];
+    } else {
+        cpu = worker_id % online_cpus();
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((size_t)cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        NES_LOGW("NesBatch: failed to pin worker %d to CPU %d", worker_id, cpu);
+    }
+#else
+    (void)b; (void)worker_id;
+#endif
+}
+
+static void write_observation(const NesBatch* b, int index)
+{
+    if (!b->job_obs || b->obs_stride == 0) return;
+
+    const Nes* n = &b->nes[index];
+    u8* dst = b->job_obs + (size_t)index * b->obs_stride;
+
+    if (b->cfg.obs_flags & NES_BATCH_OBS_FRAMEBUFFER) {
+        memcpy(dst, n->fb, sizeof(n->fb));
+        dst += sizeof(n->fb);
+    }
+
+    if (b->cfg.obs_flags & NES_BATCH_OBS_RAM) {
+        Bus_CopyRAM(&n->bus, dst);
+    }
+}
+
+static void step_instance(NesBatch* b, int index)
+{
+    Nes* n = &b->nes[index];
+
+    if (b->job_inputs) n->input = b->job_inputs[index];
+
+    bool draw = (b->cfg.obs_flags & NES_BATCH_OBS_FRAMEBUFFER) != 0;
+    for (int f = 0; f < b->job_frames; f++) {
+        NES_SetSkipRender(n, !draw || f + 1 < b->job_frames);
+        NES_RunFrame(n);
+    }
+
+    write_observation(b, index);
+
+    bool done = b->cfg.done_fn && b->cfg.done_fn(n, index, b->cfg.done_user);
+    if (done) NES_Reset(n);
+    if (b->job_done) b->job_done[index] = done ? 1u : 0u;
+}
+
+static void run_worker_job(NesBatch* b, int id)
+{
+    // Own queue first, then steal from the others in ring order.
+    for (int k = 0; k < b->threads; k++) {
+        BatchRange* r = &b->ranges[(id + k) % b->threads];
+        for (;;) {
+            int i = atomic_fetch_add_explicit(&r->next, 1, memory_order_relaxed);
+            if (i >= r->end) break;
+            step_instance(b, i);
+        }
+    }
+}
+
+static void* worker_main(void* arg)
+{
+    BatchWorker* w = (BatchWorker*)arg;
+    NesBatch* b = w->owner;
+
+    if (b->cfg.pin_threads) pin_current_thread(b, w->id);
+
+    u64 seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        while (b->epoch == seen && !b->stop) {
+            pthread_cond_wait(&b->start_cv, &b->lock);
+        }
+        if (b->stop) {
+            pthread_mutex_unlock(&b->lock);
+            break;
+        }
+        seen = b->epoch;
+        pthread_mutex_unlock(&b->lock);
+
+        run_worker_job(b, w->id);
+
+        pthread_mutex_lock(&b->lock);
+        if (--b->pending == 0) pthread_cond_signal(&b->done_cv);
+        pthread_mutex_unlock(&b->lock);
+    }
+
+    return NULL;
+}
+
+static void stop_workers(NesBatch* b)
+{
+    if (!b->workers) return;
+
+    pthread_mutex_lock(&b->lock);
+    b->stop = true;
+    pthread_cond_broadcast(&b->start_cv);
+    pthread_mutex_unlock(&b->lock);
+
+    for (int i = 0; i < b->threads; i++) {
+        if (b->workers[i].started) pthread_join(b->workers[i].thread, NULL);
+    }
+}
+
+static bool start_workers(NesBatch* b)
+{
+    b->workers = (BatchWorker*)calloc((size_t)b->threads, sizeof(BatchWorker));
+    size_t ranges_bytes = sizeof(BatchRange) * (size_t)b->threads;
+    b->ranges = (BatchRange*)aligned_alloc(BATCH_CACHE_LINE, ranges_bytes);
+    if (!b->workers || !b->ranges) return false;
+    memset(b->ranges, 0, ranges_bytes);
+
+    for (int i = 0; i < b->threads; i++) {
+        BatchWorker* w = &b->workers[i];
+        w->owner = b;
+        w->id = i;
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            NES_LOGE("NesBatch: failed to start worker %d", i);
+            return false;
+        }
+        w->started = true;
+    }
+    return true;
+}
+
+static NesBatch* batch_create(const NesBatchConfig* cfg, const u8* rom, size_t rom_size)
+{
+    if (!cfg || cfg->instances <= 0 || !rom) return NULL;
+
+    NesBatch* b = (NesBatch*)calloc(1, sizeof(NesBatch));
+    if (!b) return NULL;
+
+    b->cfg = *cfg;
+    b->count = cfg->instances;
+
+    b->threads = (cfg->threads > 0) ? cfg->threads : online_cpus();
+    if (b->threads > b->count) b->threads = b->count;
+
+    if (cfg->obs_flags & NES_BATCH_OBS_FRAMEBUFFER) b->obs_stride += sizeof(((Nes*)0)->fb);
+    if (cfg->obs_flags & NES_BATCH_OBS_RAM)         b->obs_stride += sizeof(((Nes*)0)->bus.ram);
+
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->start_cv, NULL);
+    pthread_cond_init(&b->done_cv, NULL);
+
+    if (!Cart_Init(&b->rom) || !Cart_LoadFromMemory(&b->rom, rom, rom_size)) {
+        NesBatch_Destroy(b);
+        return NULL;
+    }
+
+    b->nes = (Nes*)malloc(sizeof(Nes) * (size_t)b->count);
+    if (!b->nes) {
+        NesBatch_Destroy(b);
+        return NULL;
+    }
+
+    for (int i = 0; i < b->count; i++) {
+        Nes* n = &b->nes[i];
+        if (!NES_Init(n)) {
+            b->count = i;
+            NesBatch_Destroy(b);
+            return NULL;
+        }
+        n->quiet = true;
+        if (!NES_ShareROM(n, &b->rom)) {
+            b->count = i + 1;
+            NesBatch_Destroy(b);
+            return NULL;
+        }
+        NES_Reset(n);
+    }
+
+    if (!start_workers(b)) {
+        NesBatch_Destroy(b);
+        return NULL;
+    }
+
+    NES_LOGI("NesBatch: %d instances, %d threads, obs stride %zu bytes",
+             b->count, b->threads, b->obs_stride);
+    return b;
+}
+
+NesBatch* NesBatch_Create(const NesBatchConfig* cfg, const char* rom_path)
+{
+    if (!rom_path) return NULL;
+
+    unsigned char* rom = NULL;
+    size_t rom_size = 0;
+    if (!File_ReadAllBytes(rom_path, &rom, &rom_size)) {
+        NES_LOGE("NesBatch: failed to read ROM: %s", rom_path);
+        return NULL;
+    }
+
+    NesBatch* b = batch_create(cfg, (const u8*)rom, rom_size);
+    File_Free(rom);
+    return b;
+}
+
+NesBatch* NesBatch_CreateFromMemory(const NesBatchConfig* cfg, const u8* rom, size_t rom_size)
+{
+    return batch_create(cfg, rom, rom_size);
+}
+
+void NesBatch_Destroy(NesBatch* b)
+{
+    if (!b) return;
+
+    stop_workers(b);
+    free(b->workers);
+    free(b->ranges);
+
+    if (b->nes) {
+        // Instances borrow from b->rom, so they go first.
+        for (int i = 0; i < b->count; i++) NES_Destroy(&b->nes[i]);
+        free(b->nes);
+    }
+    Cart_Destroy(&b->rom);
+
+    pthread_cond_destroy(&b->done_cv);
+    pthread_cond_destroy(&b->start_cv);
+    pthread_mutex_destroy(&b->lock);
+    free(b);
+}
+
+int NesBatch_Count(const NesBatch* b)
+{
+    return b ? b->count : 0;
+}
+
+Nes* NesBatch_Instance(NesBatch* b, int index)
+{
+    if (!b || index < 0 || index >= b->count) return NULL;
+    return &b->nes[index];
+}
+
+size_t NesBatch_ObsStride(const NesBatch* b)
+{
+    return b ? b->obs_stride : 0;
+}
+
+bool NesBatch_Step(NesBatch* b, const NesInput* inputs, int frames,
+                   void* obs, size_t obs_size, u8* out_done)
+{
+    if (!b || frames < 0) return false;
+
+    size_t need = b->obs_stride * (size_t)b->count;
+    if (need > 0 && obs && obs_size < need) {
+        NES_LOGE("NesBatch_Step: observation buffer too small (%zu < %zu)", obs_size, need);
+        return false;
+    }
+
+    double t0 = now_seconds();
+
+    b->job_inputs = inputs;
+    b->job_frames = frames;
+    b->job_obs = (u8*)obs;
+    b->job_done = out_done;
+
+    // Contiguous initial split; imbalance is absorbed by stealing.
+    for (int t = 0; t < b->threads; t++) {
+        int begin = (int)(((s64)b->count * t) / b->threads);
+        int end   = (int)(((s64)b->count * (t + 1)) / b->threads);
+        atomic_store_explicit(&b->ranges[t].next, begin, memory_order_relaxed);
+        b->ranges[t].end = end;
+    }
+
+    pthread_mutex_lock(&b->lock);
+    b->pending = b->threads;
+    b->epoch++;
+    pthread_cond_broadcast(&b->start_cv);
+    while (b->pending > 0) {
+        pthread_cond_wait(&b->done_cv, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    b->stat_frames += (u64)frames * (u64)b->count;
+    b->stat_seconds += now_seconds() - t0;
+    return true;
+}
+
+void NesBatch_Reset(NesBatch* b, int index)
+{
+    Nes* n = NesBatch_Instance(b, index);
+    if (n) NES_Reset(n);
+}
+
+void NesBatch_ResetAll(NesBatch* b)
+{
+    if (!b) return;
+    for (int i = 0; i < b->count; i++) NES_Reset(&b->nes[i]);
+}
+
+void NesBatch_GetStats(const NesBatch* b, NesBatchStats* out)
+{
+    if (!b || !out) return;
+
+    memset(out, 0, sizeof(*out));
+    out->frames = b->stat_frames;
+    out->seconds = b->stat_seconds;
+    out->threads = b->threads;
+    if (b->stat_seconds > 0.0) {
+        out->fps = (double)b->stat_frames / b->stat_seconds;
+        out->fps_per_core = out->fps / (double)b->threads;
+    }
+}
+
+void NesBatch_ClearStats(NesBatch* b)
+{
+    if (!b) return;
+    b->stat_frames = 0;
+    b->stat_seconds = 0.0;
+}
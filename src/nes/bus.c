@@ -1,5 +1,8 @@
 #include "nes/bus.h"
 #include "nes/cart.h"
+#include "nes/debug/timeline.h"
+#include "nes/util/cow.h"
+#include "nes/util/dirty.h"
 #include <string.h>
 
 static void latch_controllers(Bus* b)
@@ -40,8 +43,7 @@ static void perform_oam_dma_copy(Bus* b, u8 page)
     u16 base = (u16)((u16)page << 8);
     for (u16 i = 0; i < 256u; i++) {
         u8 v = Bus_CPURead(b, (u16)(base + i));
-        b->ppu.oam[b->ppu.oam_addr] = v;
-        b->ppu.oam_addr++;
+        PPU2C02_WriteOAM(&b->ppu, v);
     }
 }
 
@@ -50,6 +52,7 @@ static void begin_oam_dma(Bus* b, u8 page)
     if (!b) return;
 
     b->dma_page = page;
+    NES_TIMELINE_INSTANT("OAM DMA", page);
     perform_oam_dma_copy(b, page);
 
     // CPU is stalled for 513 or 514 cycles, depending on current parity.
@@ -57,6 +60,22 @@ static void begin_oam_dma(Bus* b, u8 page)
     b->dma_active = true;
 }
 
+// DMC sample fetches go straight to the cartridge ($8000-$FFFF).
+static u8 dmc_read(void* user, u16 addr)
+{
+    Bus* b = (Bus*)user;
+    u8 v = b->open_bus;
+    NES_TRACE_INC(b->trace, mapper_calls);
+    if (b->cart) Cart_CPURead(b->cart, addr, &v);
+    return v;
+}
+
+void Bus_BindAPU(Bus* b)
+{
+    if (!b) return;
+    APU2A03_SetDMCReader(&b->apu, dmc_read, b);
+}
+
 bool Bus_Init(Bus* b, Cart* cart)
 {
     if (!b) return false;
@@ -65,6 +84,7 @@ bool Bus_Init(Bus* b, Cart* cart)
 
     if (!PPU2C02_Init(&b->ppu, cart)) return false;
     if (!APU2A03_Init(&b->apu)) return false;
+    Bus_BindAPU(b);
 
     Bus_Reset(b);
     return true;
@@ -74,7 +94,9 @@ void Bus_Reset(Bus* b)
 {
     if (!b) return;
 
+    memset(b->ram_borrow, 0, sizeof(b->ram_borrow));
     memset(b->ram, 0, sizeof(b->ram));
+    NesDirty_MarkAll(&b->ram_dirty, sizeof(b->ram) >> NES_PAGE_SHIFT);
     b->open_bus = 0;
 
     b->controller_latch_p1 = 0;
@@ -113,6 +135,14 @@ void Bus_SetInput(Bus* b, NesInput input)
     }
 }
 
+void Bus_SetInputProvider(Bus* b, NesInputPollFn fn, void* user)
+{
+    if (!b) return;
+    b->input_poll = fn;
+    b->input_user = user;
+    b->input_armed = false;
+}
+
 bool Bus_DMATick(Bus* b)
 {
     if (!b || !b->dma_active) return false;
@@ -128,10 +158,10 @@ bool Bus_DMATick(Bus* b)
     return true;
 }
 
-bool Bus_APUTick(Bus* b)
+bool Bus_APUAdvance(Bus* b, u32 cpu_cycles)
 {
     if (!b) return false;
-    return APU2A03_Tick(&b->apu);
+    return APU2A03_Advance(&b->apu, cpu_cycles);
 }
 
 u8 Bus_CPURead(Bus* b, u16 addr)
@@ -140,13 +170,15 @@ u8 Bus_CPURead(Bus* b, u16 addr)
 
     // $0000-$1FFF: internal RAM (mirrored every 2KB)
     if (addr <= 0x1FFF) {
-        u8 v = b->ram[addr & 0x07FFu];
+        NES_TRACE_INC(b->trace, bus_reads[NES_TRACE_RAM]);
+        u8 v = NesCow_Read(b->ram, b->ram_borrow, addr & 0x07FFu);
         b->open_bus = v;
         return v;
     }
 
     // $2000-$3FFF: PPU regs (mirrored every 8 bytes)
     if (addr >= 0x2000 && addr <= 0x3FFF) {
+        NES_TRACE_INC(b->trace, bus_reads[NES_TRACE_PPU]);
         u8 v = PPU2C02_CPURead(&b->ppu, addr, b->open_bus);
         b->open_bus = v;
         return v;
@@ -154,6 +186,8 @@ u8 Bus_CPURead(Bus* b, u16 addr)
 
     // $4000-$4017: APU/IO
     if (addr >= 0x4000 && addr <= 0x4017) {
+        NES_TRACE_INC(b->trace, bus_reads[NES_TRACE_APU]);
+
         // $4015: APU status
         if (addr == 0x4015) {
             u8 v = APU2A03_ReadStatus(&b->apu, b->open_bus);
@@ -183,8 +217,10 @@ u8 Bus_CPURead(Bus* b, u16 addr)
     }
 
     // $4020-$FFFF: cartridge space (mapper)
+    NES_TRACE_INC(b->trace, bus_reads[NES_TRACE_CART]);
     if (b->cart) {
         u8 v;
+        NES_TRACE_INC(b->trace, mapper_calls);
         if (Cart_CPURead(b->cart, addr, &v)) {
             b->open_bus = v;
             return v;
@@ -194,6 +230,16 @@ u8 Bus_CPURead(Bus* b, u16 addr)
     return b->open_bus;
 }
 
+u8 Bus_Peek(Bus* b, u16 addr)
+{
+    if (!b) return 0;
+    if (addr <= 0x1FFF) return NesCow_Read(b->ram, b->ram_borrow, addr & 0x07FFu);
+
+    u8 v = b->open_bus;
+    if (addr >= 0x4020 && b->cart) Cart_CPURead(b->cart, addr, &v);
+    return v;
+}
+
 void Bus_CPUWrite(Bus* b, u16 addr, u8 data)
 {
     if (!b) return;
@@ -202,18 +248,24 @@ void Bus_CPUWrite(Bus* b, u16 addr, u8 data)
 
     // $0000-$1FFF: internal RAM (mirrored)
     if (addr <= 0x1FFF) {
-        b->ram[addr & 0x07FFu] = data;
+        NES_TRACE_INC(b->trace, bus_writes[NES_TRACE_RAM]);
+        u32 off = addr & 0x07FFu;
+        *NesCow_WritePtr(b->ram, b->ram_borrow, off) = data;
+        NesDirty_Mark(&b->ram_dirty, off);
         return;
     }
 
     // $2000-$3FFF: PPU regs (mirrored)
     if (addr >= 0x2000 && addr <= 0x3FFF) {
+        NES_TRACE_INC(b->trace, bus_writes[NES_TRACE_PPU]);
         PPU2C02_CPUWrite(&b->ppu, addr, data);
         return;
     }
 
     // $4000-$4017: APU/IO
     if (addr >= 0x4000 && addr <= 0x4017) {
+        NES_TRACE_INC(b->trace, bus_writes[NES_TRACE_APU]);
+
         // $4014: OAMDMA
         if (addr == 0x4014) {
             begin_oam_dma(b, data);
@@ -222,6 +274,11 @@ void Bus_CPUWrite(Bus* b, u16 addr, u8 data)
 
         // $4016: controller strobe
         if (addr == 0x4016) {
+            if (b->input_armed) {
+                b->input_armed = false;
+                b->input = b->input_poll(b->input_user);
+            }
+
             bool old_strobe = b->controller_strobe;
             bool new_strobe = (data & 0x01u) != 0;
             b->controller_strobe = new_strobe;
@@ -246,7 +303,15 @@ void Bus_CPUWrite(Bus* b, u16 addr, u8 data)
     }
 
     // $4020-$FFFF: cartridge space (mapper)
+    NES_TRACE_INC(b->trace, bus_writes[NES_TRACE_CART]);
     if (b->cart) {
+        NES_TRACE_INC(b->trace, mapper_calls);
         (void)Cart_CPUWrite(b->cart, addr, data);
     }
 }
+
+void Bus_CopyRAM(const Bus* b, u8 dst[2048])
+{
+    if (!b || !dst) return;
+    NesCow_CopyOut(dst, b->ram, b->ram_borrow, 2048u >> NES_PAGE_SHIFT);
+}
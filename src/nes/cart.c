@@ -12,17 +12,59 @@ static void cart_free_all(Cart* c)
 
     if (c->mapper) { Mapper_Destroy(c->mapper); c->mapper = NULL; }
 
-    if (c->prg_rom) { File_Free(c->prg_rom); c->prg_rom = NULL; }
-    if (c->chr)     { File_Free(c->chr);     c->chr = NULL; }
+    // Borrowed ROM buffers belong to the cart they were shared from.
+    if (c->prg_rom && !c->rom_borrowed) File_Free(c->prg_rom);
+    if (c->chr && !(c->rom_borrowed && !c->chr_is_ram)) File_Free(c->chr);
+    c->prg_rom = NULL;
+    c->chr = NULL;
     if (c->prg_ram) { File_Free(c->prg_ram); c->prg_ram = NULL; }
+    free(c->prg_ram_borrow);
+    free(c->chr_borrow);
+    c->prg_ram_borrow = NULL;
+    c->chr_borrow = NULL;
+    free(c->prg_ram_dirty);
+    free(c->chr_dirty);
+    c->prg_ram_dirty = NULL;
+    c->chr_dirty = NULL;
 
     c->prg_rom_size = 0;
     c->chr_size = 0;
     c->prg_ram_size = 0;
     c->chr_is_ram = false;
+    c->rom_borrowed = false;
     memset(&c->info, 0, sizeof(c->info));
 }
 
+// Bitmap covering `size` bytes; starts all-dirty unless `clean`.
+static u64* alloc_dirty_bitmap(u32 size, bool clean)
+{
+    u32 pages = (size + NES_PAGE_MASK) >> NES_PAGE_SHIFT;
+    u64* bits = (u64*)calloc(NesDirty_Words(pages), sizeof(u64));
+    if (bits && !clean) NesDirty_MarkAll(bits, pages);
+    return bits;
+}
+
+void Cart_MarkAllDirty(Cart* c)
+{
+    if (!c) return;
+    if (c->prg_ram_dirty) NesDirty_MarkAll(c->prg_ram_dirty, (c->prg_ram_size + NES_PAGE_MASK) >> NES_PAGE_SHIFT);
+    if (c->chr_dirty) NesDirty_MarkAll(c->chr_dirty, (c->chr_size + NES_PAGE_MASK) >> NES_PAGE_SHIFT);
+}
+
+// Allocates the PRG/CHR RAM dirty bitmaps for the buffers c already has.
+static bool alloc_dirty_bitmaps(Cart* c, bool clean)
+{
+    if (c->prg_ram) {
+        c->prg_ram_dirty = alloc_dirty_bitmap(c->prg_ram_size, clean);
+        if (!c->prg_ram_dirty) return false;
+    }
+    if (c->chr_is_ram && c->chr) {
+        c->chr_dirty = alloc_dirty_bitmap(c->chr_size, clean);
+        if (!c->chr_dirty) return false;
+    }
+    return true;
+}
+
 bool Cart_Init(Cart* c)
 {
     if (!c) return false;
@@ -49,33 +91,45 @@ bool Cart_LoadFromFile(Cart* c, const char* path)
         return false;
     }
 
+    bool ok = Cart_LoadFromMemory(c, (const u8*)rom, rom_size);
+    if (!ok) NES_LOGE("Cart: failed to load ROM: %s", path);
+
+    File_Free(rom);
+    return ok;
+}
+
+bool Cart_LoadFromMemory(Cart* c, const u8* rom, size_t rom_size)
+{
+    if (!c || !rom) return false;
+
+    cart_free_all(c);
+
     INesInfo info;
     size_t prg_off = 0;
     size_t chr_off = 0;
 
-    if (!INes_Parse((const u8*)rom, rom_size, &info, &prg_off, &chr_off)) {
-        NES_LOGE("Cart: invalid or unsupported NES ROM header: %s", path);
-        File_Free(rom);
+    if (!INes_Parse(rom, rom_size, &info, &prg_off, &chr_off)) {
+        NES_LOGE("Cart: invalid or unsupported NES ROM header");
         return false;
     }
 
     // PRG ROM
     c->prg_rom_size = info.prg_rom_size;
     c->prg_rom = (u8*)malloc((size_t)c->prg_rom_size);
-    if (!c->prg_rom) { File_Free(rom); return false; }
+    if (!c->prg_rom) return false;
     memcpy(c->prg_rom, rom + prg_off, (size_t)c->prg_rom_size);
 
     // CHR ROM or CHR RAM
     if (info.chr_rom_size > 0) {
         c->chr_size = info.chr_rom_size;
         c->chr = (u8*)malloc((size_t)c->chr_size);
-        if (!c->chr) { File_Free(rom); cart_free_all(c); return false; }
+        if (!c->chr) { cart_free_all(c); return false; }
         memcpy(c->chr, rom + chr_off, (size_t)c->chr_size);
         c->chr_is_ram = false;
     } else {
         c->chr_size = 8u * 1024u;
         c->chr = (u8*)malloc((size_t)c->chr_size);
-        if (!c->chr) { File_Free(rom); cart_free_all(c); return false; }
+        if (!c->chr) { cart_free_all(c); return false; }
         memset(c->chr, 0, (size_t)c->chr_size);
         c->chr_is_ram = true;
     }
@@ -84,12 +138,12 @@ bool Cart_LoadFromFile(Cart* c, const char* path)
     c->prg_ram_size = info.prg_ram_size;
     if (c->prg_ram_size == 0) c->prg_ram_size = 8u * 1024u; // safe default
     c->prg_ram = (u8*)malloc((size_t)c->prg_ram_size);
-    if (!c->prg_ram) { File_Free(rom); cart_free_all(c); return false; }
+    if (!c->prg_ram) { cart_free_all(c); return false; }
     memset(c->prg_ram, 0, (size_t)c->prg_ram_size);
 
     c->info = info;
 
-    File_Free(rom);
+    if (!alloc_dirty_bitmaps(c, false)) { cart_free_all(c); return false; }
 
     // Create mapper
     c->mapper = Mapper_Create(c, c->info.mapper);
@@ -109,6 +163,122 @@ bool Cart_LoadFromFile(Cart* c, const char* path)
     return true;
 }
 
+bool Cart_Share(Cart* c, const Cart* src)
+{
+    if (!c || !src || !src->prg_rom || !src->chr) return false;
+
+    cart_free_all(c);
+
+    c->info = src->info;
+    c->rom_borrowed = true;
+
+    // PRG ROM and CHR ROM are read-only, so every sharer points at src's copy.
+    c->prg_rom = src->prg_rom;
+    c->prg_rom_size = src->prg_rom_size;
+
+    c->chr_size = src->chr_size;
+    c->chr_is_ram = src->chr_is_ram;
+    if (src->chr_is_ram) {
+        c->chr = (u8*)malloc((size_t)c->chr_size);
+        if (!c->chr) { cart_free_all(c); return false; }
+        memset(c->chr, 0, (size_t)c->chr_size);
+    } else {
+        c->chr = src->chr;
+    }
+
+    c->prg_ram_size = src->prg_ram_size;
+    if (c->prg_ram_size > 0) {
+        c->prg_ram = (u8*)malloc((size_t)c->prg_ram_size);
+        if (!c->prg_ram) { cart_free_all(c); return false; }
+        memset(c->prg_ram, 0, (size_t)c->prg_ram_size);
+    }
+
+    if (!alloc_dirty_bitmaps(c, false)) { cart_free_all(c); return false; }
+
+    c->mapper = Mapper_Create(c, c->info.mapper);
+    if (!c->mapper) {
+        NES_LOGE("Cart: failed to create mapper %u", c->info.mapper);
+        cart_free_all(c);
+        return false;
+    }
+
+    return true;
+}
+
+// Allocates an uninitialised buffer of `size` bytes whose pages borrow src's.
+// Regions that are not a whole number of pages are copied eagerly instead.
+static bool fork_region(u8** out_own, const u8*** out_borrow,
+                        const u8* src_own, const u8* const* src_borrow, u32 size)
+{
+    *out_own = NULL;
+    *out_borrow = NULL;
+    if (size == 0) return true;
+
+    u8* own = (u8*)malloc((size_t)size);
+    if (!own) return false;
+    *out_own = own;
+
+    u32 pages = size >> NES_PAGE_SHIFT;
+    if ((size & NES_PAGE_MASK) != 0) {
+        NesCow_CopyOut(own, src_own, src_borrow, pages);
+        size_t tail = (size_t)pages << NES_PAGE_SHIFT;
+        memcpy(own + tail, src_own + tail, (size_t)size - tail);
+        return true;
+    }
+
+    const u8** borrow = (const u8**)malloc(sizeof(*borrow) * (size_t)pages);
+    if (!borrow) return false;
+    NesCow_BorrowAll(borrow, src_own, src_borrow, pages);
+    *out_borrow = borrow;
+    return true;
+}
+
+bool Cart_Fork(Cart* c, const Cart* src)
+{
+    if (!c || !src || !src->prg_rom || !src->chr || !src->mapper) return false;
+
+    cart_free_all(c);
+
+    c->info = src->info;
+    c->rom_borrowed = true;
+
+    c->prg_rom = src->prg_rom;
+    c->prg_rom_size = src->prg_rom_size;
+
+    c->chr_size = src->chr_size;
+    c->chr_is_ram = src->chr_is_ram;
+    if (src->chr_is_ram) {
+        if (!fork_region(&c->chr, &c->chr_borrow, src->chr, src->chr_borrow, src->chr_size)) {
+            cart_free_all(c);
+            return false;
+        }
+    } else {
+        c->chr = src->chr;
+    }
+
+    c->prg_ram_size = src->prg_ram_size;
+    if (!fork_region(&c->prg_ram, &c->prg_ram_borrow, src->prg_ram, src->prg_ram_borrow,
+                     src->prg_ram ? src->prg_ram_size : 0u)) {
+        cart_free_all(c);
+        return false;
+    }
+
+    // A fork starts clean: its bitmaps record writes relative to src.
+    if (!alloc_dirty_bitmaps(c, true)) {
+        cart_free_all(c);
+        return false;
+    }
+
+    c->mapper = Mapper_Clone(src->mapper, c);
+    if (!c->mapper) {
+        NES_LOGE("Cart: failed to clone mapper %u", c->info.mapper);
+        cart_free_all(c);
+        return false;
+    }
+
+    return true;
+}
+
 bool Cart_CPURead(Cart* c, u16 addr, u8* out)
 {
     if (!c || !c->mapper || !c->mapper->cpu_read) return false;
@@ -121,6 +291,12 @@ bool Cart_CPUWrite(Cart* c, u16 addr, u8 data)
     return c->mapper->cpu_write(c->mapper, addr, data);
 }
 
+bool Cart_PRGOffset(const Cart* c, u16 addr, u32* out)
+{
+    if (!c || !c->mapper || !c->mapper->prg_offset) return false;
+    return c->mapper->prg_offset(c->mapper, addr, out);
+}
+
 bool Cart_PPURead(Cart* c, u16 addr, u8* out)
 {
     if (!c || !c->mapper || !c->mapper->ppu_read) return false;
@@ -0,0 +1,56 @@
+#define _POSIX_C_SOURCE 200112L
+#include "nes/clock.h"
+#include "nes/debug/timeline.h"
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+u64 NesClock_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000u + (u64)ts.tv_nsec;
+}
+
+void NesClock_Init(NesClock* c, double hz, u32 spin_ns)
+{
+    if (!c) return;
+    c->epoch_ns = NesClock_Now();
+    c->period_ns = 1e9 / (hz > 0.0 ? hz : NES_NTSC_FRAME_HZ);
+    c->spin_ns = spin_ns;
+}
+
+u64 NesClock_Deadline(const NesClock* c, u64 frame)
+{
+    return c->epoch_ns + (u64)llround((double)frame * c->period_ns);
+}
+
+u64 NesClock_FrameAt(const NesClock* c, u64 t_ns)
+{
+    if (t_ns <= c->epoch_ns) return 0;
+    // Deadlines are rounded to whole ns, so settle the estimate against them.
+    u64 frame = (u64)((double)(t_ns - c->epoch_ns) / c->period_ns);
+    while (NesClock_Deadline(c, frame) < t_ns) frame++;
+    while (frame > 0u && NesClock_Deadline(c, frame - 1u) >= t_ns) frame--;
+    return frame;
+}
+
+u64 NesClock_SleepUntil(const NesClock* c, u64 t_ns)
+{
+    u64 now = NesClock_Now();
+    u64 t0 = now;
+
+    if (now + c->spin_ns < t_ns) {
+        u64 wake = t_ns - c->spin_ns;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wake / 1000000000u);
+        ts.tv_nsec = (long)(wake % 1000000000u);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        now = NesClock_Now();
+    }
+
+    while (now < t_ns) now = NesClock_Now();
+    if (g_nes_timeline && t0 < t_ns) NesTimeline_Span("sleep", t0, NES_TIMELINE_NO_ARG);
+    return now - t_ns;
+}
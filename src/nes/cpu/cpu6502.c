@@ -85,6 +85,7 @@ bool CPU6502_Init(CPU6502* c, Bus* bus)
     c->sp = 0xFD;
     c->p = (u8)(F_I | F_U);
     c->cycles = 0;
+    c->instructions = 0;
     c->jammed = false;
     c->nmi_pending = false;
     c->irq_pending = false;
@@ -199,23 +200,32 @@ int CPU6502_Step(CPU6502* c)
     if (!c || !c->bus) return 0;
     if (c->jammed) return 0;
 
+    const BusDebugHooks* dbg = c->bus->debug;
+    u8 sp0 = c->sp;
+
     if (c->nmi_pending) {
+        NES_TRACE_INC(c->bus->trace, nmis);
         c->nmi_pending = false;
         service_interrupt(c, 0xFFFA, false);
         c->cycles += 7;
+        if (dbg) dbg->interrupt(c->bus, c, 0xFFFA, sp0);
         return 7;
     }
 
     if (c->irq_pending && (c->p & F_I) == 0) {
+        NES_TRACE_INC(c->bus->trace, irqs);
         c->irq_pending = false;
         service_interrupt(c, 0xFFFE, false);
         c->cycles += 7;
+        if (dbg) dbg->interrupt(c->bus, c, 0xFFFE, sp0);
         return 7;
     }
 
+    u32 dbg_token = dbg ? dbg->exec(c->bus, c) : 0u;
 
     u16 pc0 = c->pc;
     u8 op = fetch8(c);
+    NES_TRACE_INC(c->bus->trace, opcodes[op]);
 
     const OpInfo info = g_op_table[op];
 
@@ -251,6 +261,8 @@ int CPU6502_Step(CPU6502* c)
     info.fn(c, addr, has_addr, page_cross);
 
     c->cycles += (u64)cyc;
+    c->instructions++;
+    if (dbg) dbg->retire(c->bus, dbg_token, op, (u32)cyc, c->pc, c->sp);
     return cyc;
 }
 
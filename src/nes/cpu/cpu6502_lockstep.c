@@ -0,0 +1,744 @@
+#include "nes/cpu/cpu6502_lockstep.h"
+#include "nes/cpu/cpu6502.h"
+#include "nes/cpu/cpu_tables.h"
+#include "nes/cart.h"
+#include "nes/log.h"
+#include <string.h>
+
+// Lane masks use SSE2, which every x86-64 target has, so the core needs no
+// ISA flags beyond the compiler's default.
+#if (defined(__SSE2__) || defined(_M_X64)) && (NES_LOCKSTEP_LANES == 16)
+#include <emmintrin.h>
+#define LOCKSTEP_HAVE_SSE2 1
+#else
+#define LOCKSTEP_HAVE_SSE2 0
+#endif
+
+#define L NES_LOCKSTEP_LANES
+
+enum {
+    // NTSC frame: 262 lines of 341 dots; VBlank starts at line 241 dot 1.
+    LS_DOTS_PER_FRAME = 341 * 262,
+    LS_VBLANK_DOT     = (241 + 1) * 341 + 1,
+    LS_RESET_DOT      = 341
+};
+
+typedef enum LsKind {
+    K_ILL = 0, K_NOP,
+    K_LDA, K_LDX, K_LDY, K_STA, K_STX, K_STY,
+    K_TAX, K_TAY, K_TXA, K_TYA, K_TSX, K_TXS,
+    K_PHA, K_PHP, K_PLA, K_PLP,
+    K_AND, K_ORA, K_EOR, K_BIT,
+    K_CMP, K_CPX, K_CPY, K_ADC, K_SBC,
+    K_INC, K_DEC, K_INX, K_INY, K_DEX, K_DEY,
+    K_ASL, K_LSR, K_ROL, K_ROR,
+    K_BCC, K_BCS, K_BEQ, K_BNE, K_BMI, K_BPL, K_BVC, K_BVS,
+    K_JMP, K_JSR, K_RTS, K_RTI, K_BRK,
+    K_CLC, K_SEC, K_CLI, K_SEI, K_CLV, K_CLD, K_SED
+} LsKind;
+
+// Decoded operands for the lanes of one group instruction.
+typedef struct LsOp {
+    u8 lm[L];           // 0xFF for lanes in the group
+    u16 ea[L];          // effective address per lane
+    bool uniform;       // ea[] identical for every lane (ea0)
+    u16 ea0;
+    bool has_addr;
+    u8 extra[L];        // page-cross cycle per lane
+} LsOp;
+
+static u8 kind_of(OpFunc fn)
+{
+#define K(name) if (fn == op_##name) return (u8)K_##name
+    K(NOP);
+    K(LDA); K(LDX); K(LDY); K(STA); K(STX); K(STY);
+    K(TAX); K(TAY); K(TXA); K(TYA); K(TSX); K(TXS);
+    K(PHA); K(PHP); K(PLA); K(PLP);
+    K(AND); K(ORA); K(EOR); K(BIT);
+    K(CMP); K(CPX); K(CPY); K(ADC); K(SBC);
+    K(INC); K(DEC); K(INX); K(INY); K(DEX); K(DEY);
+    K(ASL); K(LSR); K(ROL); K(ROR);
+    K(BCC); K(BCS); K(BEQ); K(BNE); K(BMI); K(BPL); K(BVC); K(BVS);
+    K(JMP); K(JSR); K(RTS); K(RTI); K(BRK);
+    K(CLC); K(SEC); K(CLI); K(SEI); K(CLV); K(CLD); K(SED);
+#undef K
+    return (u8)K_ILL;
+}
+
+static inline u8 rom_read(const CPU6502Lockstep* c, u16 addr)
+{
+    return c->prg[(u32)(addr - 0x8000u) & c->prg_mask];
+}
+
+/* =========================
+   Per-lane bus
+   ========================= */
+
+static void advance_lane(CPU6502Lockstep* c, int l, int cpu_cycles)
+{
+    c->cycles[l] += (u64)cpu_cycles;
+
+    u32 before = c->dot[l];
+    u32 after = before + (u32)cpu_cycles * 3u;
+
+    if (before <= LS_VBLANK_DOT && after > LS_VBLANK_DOT) {
+        c->ppu_status[l] |= 0x80u;
+        if (c->ppu_ctrl[l] & 0x80u) c->nmi_pending[l] = true;
+    }
+
+    if (after >= LS_DOTS_PER_FRAME) {
+        after -= LS_DOTS_PER_FRAME;
+        c->frame_count[l]++;
+        c->ppu_status[l] = (u8)(c->ppu_status[l] & 0x1Fu);
+    }
+
+    c->dot[l] = after;
+}
+
+static u8 lane_read(CPU6502Lockstep* c, int l, u16 addr)
+{
+    if (addr <= 0x1FFFu) return c->ram[addr & 0x07FFu][l];
+    if (addr >= 0x8000u) return rom_read(c, addr);
+
+    if (addr <= 0x3FFFu) {
+        if ((addr & 7u) != 2u) return 0;
+        u8 v = c->ppu_status[l];
+        c->ppu_status[l] = (u8)(v & 0x7Fu);
+        return v;
+    }
+
+    if (addr == 0x4016u || addr == 0x4017u) {
+        bool port2 = (addr == 0x4017u);
+        u8* shift = port2 ? &c->pad_shift_p2[l] : &c->pad_shift_p1[l];
+        if (c->pad_strobe[l]) {
+            u8 src = port2 ? c->input[l].p2 : c->input[l].p1;
+            return (u8)(src & 1u);
+        }
+        u8 bit = (u8)(*shift & 1u);
+        *shift = (u8)((*shift >> 1) | 0x80u);
+        return bit;
+    }
+
+    return 0;
+}
+
+static void lane_write(CPU6502Lockstep* c, int l, u16 addr, u8 v)
+{
+    if (addr <= 0x1FFFu) {
+        c->ram[addr & 0x07FFu][l] = v;
+        return;
+    }
+
+    if (addr <= 0x3FFFu) {
+        if ((addr & 7u) == 0u) {
+            bool was_on = (c->ppu_ctrl[l] & 0x80u) != 0;
+            c->ppu_ctrl[l] = v;
+            if (!was_on && (v & 0x80u) && (c->ppu_status[l] & 0x80u)) c->nmi_pending[l] = true;
+        }
+        return;
+    }
+
+    if (addr == 0x4014u) {
+        // OAM is not modelled; only the CPU stall is.
+        advance_lane(c, l, 513 + (int)((c->cycles[l] - 7u) & 1u));
+        return;
+    }
+
+    if (addr == 0x4016u) {
+        bool old = c->pad_strobe[l];
+        c->pad_strobe[l] = (v & 1u) != 0;
+        if (c->pad_strobe[l] || old) {
+            c->pad_shift_p1[l] = c->input[l].p1;
+            c->pad_shift_p2[l] = c->input[l].p2;
+        }
+    }
+}
+
+/* =========================
+   Group memory access
+   ========================= */
+
+static void read_operand(CPU6502Lockstep* c, const LsOp* op, u8 out[L])
+{
+    if (op->uniform && op->ea0 <= 0x1FFFu) {
+        // Same RAM address in every lane: one row load.
+        memcpy(out, c->ram[op->ea0 & 0x07FFu], L);
+        return;
+    }
+    if (op->uniform && op->ea0 >= 0x8000u) {
+        memset(out, rom_read(c, op->ea0), L);
+        return;
+    }
+
+    memset(out, 0, L);
+    for (int l = 0; l < L; l++) {
+        if (op->lm[l]) out[l] = lane_read(c, l, op->ea[l]);
+    }
+}
+
+static void write_operand(CPU6502Lockstep* c, const LsOp* op, const u8 v[L])
+{
+    if (op->uniform && op->ea0 <= 0x1FFFu) {
+        u8* row = c->ram[op->ea0 & 0x07FFu];
+        for (int l = 0; l < L; l++) row[l] = (u8)((v[l] & op->lm[l]) | (row[l] & (u8)~op->lm[l]));
+        return;
+    }
+
+    for (int l = 0; l < L; l++) {
+        if (op->lm[l]) lane_write(c, l, op->ea[l], v[l]);
+    }
+}
+
+static void push_lanes(CPU6502Lockstep* c, const u8 lm[L], const u8 v[L])
+{
+    for (int l = 0; l < L; l++) {
+        if (!lm[l]) continue;
+        c->ram[0x0100u | c->sp[l]][l] = v[l];
+        c->sp[l]--;
+    }
+}
+
+static void pull_lanes(CPU6502Lockstep* c, const u8 lm[L], u8 out[L])
+{
+    for (int l = 0; l < L; l++) {
+        if (!lm[l]) { out[l] = 0; continue; }
+        c->sp[l]++;
+        out[l] = c->ram[0x0100u | c->sp[l]][l];
+    }
+}
+
+/* =========================
+   Lane-parallel ALU helpers
+   ========================= */
+
+static inline void blend8(u8 dst[L], const u8 src[L], const u8 lm[L])
+{
+#if LOCKSTEP_HAVE_SSE2
+    __m128i d = _mm_loadu_si128((const __m128i*)dst);
+    __m128i s = _mm_loadu_si128((const __m128i*)src);
+    __m128i m = _mm_loadu_si128((const __m128i*)lm);
+    _mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+#else
+    for (int l = 0; l < L; l++) dst[l] = (u8)((src[l] & lm[l]) | (dst[l] & (u8)~lm[l]));
+#endif
+}
+
+static inline void set_zn(CPU6502Lockstep* c, const u8 v[L], const u8 lm[L])
+{
+    u8 np[L];
+    for (int l = 0; l < L; l++) {
+        u8 z = (v[l] == 0u) ? (u8)F_Z : 0u;
+        np[l] = (u8)((c->p[l] & (u8)~(F_Z | F_N)) | z | (v[l] & 0x80u));
+    }
+    blend8(c->p, np, lm);
+}
+
+static inline void set_flag_lanes(CPU6502Lockstep* c, u8 flag, const u8 on[L], const u8 lm[L])
+{
+    u8 np[L];
+    for (int l = 0; l < L; l++) {
+        np[l] = (u8)((c->p[l] & (u8)~flag) | (on[l] ? flag : 0u));
+    }
+    blend8(c->p, np, lm);
+}
+
+static void compare_lanes(CPU6502Lockstep* c, const u8 r[L], const u8 v[L], const u8 lm[L])
+{
+    u8 carry[L];
+    u8 diff[L];
+    for (int l = 0; l < L; l++) {
+        carry[l] = (r[l] >= v[l]) ? 1u : 0u;
+        diff[l] = (u8)(r[l] - v[l]);
+    }
+    set_flag_lanes(c, F_C, carry, lm);
+    set_zn(c, diff, lm);
+}
+
+static void add_lanes(CPU6502Lockstep* c, const u8 v[L], const u8 lm[L])
+{
+    u8 res[L];
+    u8 carry[L];
+    u8 ovf[L];
+    for (int l = 0; l < L; l++) {
+        unsigned int sum = (unsigned int)c->a[l] + (unsigned int)v[l] + ((c->p[l] & F_C) ? 1u : 0u);
+        res[l] = (u8)sum;
+        carry[l] = (sum > 0xFFu) ? 1u : 0u;
+        ovf[l] = (u8)((~(c->a[l] ^ v[l])) & (c->a[l] ^ res[l]) & 0x80u);
+    }
+    set_flag_lanes(c, F_C, carry, lm);
+    set_flag_lanes(c, F_V, ovf, lm);
+    blend8(c->a, res, lm);
+    set_zn(c, res, lm);
+}
+
+static void shift_lanes(CPU6502Lockstep* c, LsKind k, u8 v[L], const u8 lm[L])
+{
+    u8 carry[L];
+    for (int l = 0; l < L; l++) {
+        u8 cin = (c->p[l] & F_C) ? 1u : 0u;
+        switch (k) {
+            case K_ASL: carry[l] = (u8)(v[l] >> 7); v[l] = (u8)(v[l] << 1); break;
+            case K_LSR: carry[l] = (u8)(v[l] & 1u); v[l] = (u8)(v[l] >> 1); break;
+            case K_ROL: carry[l] = (u8)(v[l] >> 7); v[l] = (u8)((v[l] << 1) | cin); break;
+            default:    carry[l] = (u8)(v[l] & 1u); v[l] = (u8)((v[l] >> 1) | (u8)(cin << 7)); break;
+        }
+    }
+    set_flag_lanes(c, F_C, carry, lm);
+    set_zn(c, v, lm);
+}
+
+static void service_interrupt_lane(CPU6502Lockstep* c, int l, u16 vec, bool brk)
+{
+    u16 ret = c->pc[l];
+    c->ram[0x0100u | c->sp[l]][l] = (u8)(ret >> 8); c->sp[l]--;
+    c->ram[0x0100u | c->sp[l]][l] = (u8)(ret & 0xFFu); c->sp[l]--;
+
+    u8 pp = (u8)(c->p[l] | F_U);
+    pp = brk ? (u8)(pp | F_B) : (u8)(pp & (u8)~F_B);
+    c->ram[0x0100u | c->sp[l]][l] = pp; c->sp[l]--;
+
+    c->p[l] = (u8)(c->p[l] | F_I);
+    c->pc[l] = (u16)(rom_read(c, vec) | ((u16)rom_read(c, (u16)(vec + 1u)) << 8));
+}
+
+/* =========================
+   Group selection
+   ========================= */
+
+// Bitmask of lanes in `live` whose PC equals pc.
+static u32 lanes_at_pc(const CPU6502Lockstep* c, u32 live, u16 pc)
+{
+#if LOCKSTEP_HAVE_SSE2
+    __m128i want = _mm_set1_epi16((short)pc);
+    __m128i lo = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)c->pc), want);
+    __m128i hi = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(c->pc + 8)), want);
+    // Saturating pack keeps 0 / -1, one byte per lane.
+    return (u32)_mm_movemask_epi8(_mm_packs_epi16(lo, hi)) & live;
+#else
+    u32 m = 0;
+    for (int l = 0; l < L; l++) {
+        if (c->pc[l] == pc) m |= 1u << l;
+    }
+    return m & live;
+#endif
+}
+
+static int resolve(CPU6502Lockstep* c, AddrMode mode, u16 pc, LsOp* op, bool store)
+{
+    u8 b1 = rom_read(c, (u16)(pc + 1u));
+    u8 b2 = rom_read(c, (u16)(pc + 2u));
+    u16 abs = (u16)(b1 | ((u16)b2 << 8));
+
+    op->uniform = true;
+    op->has_addr = true;
+    op->ea0 = 0;
+    memset(op->extra, 0, sizeof(op->extra));
+
+    switch (mode) {
+        case AM_IMP:
+        case AM_ACC:
+            op->has_addr = false;
+            return 1;
+
+        case AM_IMM: op->ea0 = (u16)(pc + 1u); break;
+        case AM_ZP:  op->ea0 = b1; break;
+        case AM_REL: op->ea0 = b1; break;
+        case AM_ABS: op->ea0 = abs; break;
+
+        case AM_IND: {
+            // JMP ($xxxx) with the page-wrap bug; the pointer may live in RAM.
+            u16 hi_addr = (u16)((abs & 0xFF00u) | ((abs + 1u) & 0x00FFu));
+            op->uniform = false;
+            for (int l = 0; l < L; l++) {
+                if (!op->lm[l]) continue;
+                op->ea[l] = (u16)(lane_read(c, l, abs) | ((u16)lane_read(c, l, hi_addr) << 8));
+            }
+        } return 3;
+
+        case AM_ZPX:
+        case AM_ZPY:
+            op->uniform = false;
+            for (int l = 0; l < L; l++) {
+                u8 idx = (mode == AM_ZPX) ? c->x[l] : c->y[l];
+                op->ea[l] = (u8)(b1 + idx);
+            }
+            return 2;
+
+        case AM_ABX:
+        case AM_ABY:
+            op->uniform = false;
+            for (int l = 0; l < L; l++) {
+                u8 idx = (mode == AM_ABX) ? c->x[l] : c->y[l];
+                op->ea[l] = (u16)(abs + idx);
+                op->extra[l] = (u8)(!store && ((op->ea[l] ^ abs) & 0xFF00u) != 0);
+            }
+            return 3;
+
+        case AM_IZX:
+            op->uniform = false;
+            for (int l = 0; l < L; l++) {
+                u8 zp = (u8)(b1 + c->x[l]);
+                op->ea[l] = (u16)(c->ram[zp][l] | ((u16)c->ram[(u8)(zp + 1u)][l] << 8));
+            }
+            return 2;
+
+        case AM_IZY:
+            op->uniform = false;
+            for (int l = 0; l < L; l++) {
+                u16 base = (u16)(c->ram[b1][l] | ((u16)c->ram[(u8)(b1 + 1u)][l] << 8));
+                op->ea[l] = (u16)(base + c->y[l]);
+                op->extra[l] = (u8)(!store && ((op->ea[l] ^ base) & 0xFF00u) != 0);
+            }
+            return 2;
+    }
+
+    if (mode == AM_ABS) {
+        for (int l = 0; l < L; l++) op->ea[l] = op->ea0;
+        return 3;
+    }
+    for (int l = 0; l < L; l++) op->ea[l] = op->ea0;
+    return 2;
+}
+
+static void branch_lanes(CPU6502Lockstep* c, u16 next_pc, u8 rel, u8 flag, bool want_set, const u8 lm[L])
+{
+    u16 target = (u16)(next_pc + (s16)(s8)rel);
+    for (int l = 0; l < L; l++) {
+        if (!lm[l]) continue;
+        bool set = (c->p[l] & flag) != 0;
+        c->pc[l] = (set == want_set) ? target : next_pc;
+    }
+}
+
+/* =========================
+   Execution
+   ========================= */
+
+static void execute_group(CPU6502Lockstep* c, u16 pc, u32 mask)
+{
+    u8 opcode = rom_read(c, pc);
+    const OpInfo info = g_op_table[opcode];
+    LsKind k = (LsKind)c->kind[opcode];
+
+    LsOp op;
+    for (int l = 0; l < L; l++) op.lm[l] = ((mask >> l) & 1u) ? 0xFFu : 0x00u;
+
+    bool store = (k == K_STA || k == K_STX || k == K_STY);
+    int len = resolve(c, info.mode, pc, &op, store);
+    u16 next_pc = (u16)(pc + (u16)len);
+
+    // Default PC update; control flow overrides below.
+    for (int l = 0; l < L; l++) {
+        if (op.lm[l]) c->pc[l] = next_pc;
+    }
+
+    u8 v[L];
+    u8 t[L];
+
+    switch (k) {
+        case K_NOP: break;
+
+        case K_ILL:
+            NES_LOGE("CPU lockstep: illegal opcode %02X at PC=%04X", opcode, pc);
+            for (int l = 0; l < L; l++) if (op.lm[l]) c->jammed[l] = true;
+            break;
+
+        case K_LDA: read_operand(c, &op, v); blend8(c->a, v, op.lm); set_zn(c, v, op.lm); break;
+        case K_LDX: read_operand(c, &op, v); blend8(c->x, v, op.lm); set_zn(c, v, op.lm); break;
+        case K_LDY: read_operand(c, &op, v); blend8(c->y, v, op.lm); set_zn(c, v, op.lm); break;
+
+        case K_STA: write_operand(c, &op, c->a); break;
+        case K_STX: write_operand(c, &op, c->x); break;
+        case K_STY: write_operand(c, &op, c->y); break;
+
+        case K_TAX: blend8(c->x, c->a, op.lm); set_zn(c, c->x, op.lm); break;
+        case K_TAY: blend8(c->y, c->a, op.lm); set_zn(c, c->y, op.lm); break;
+        case K_TXA: blend8(c->a, c->x, op.lm); set_zn(c, c->a, op.lm); break;
+        case K_TYA: blend8(c->a, c->y, op.lm); set_zn(c, c->a, op.lm); break;
+        case K_TSX: blend8(c->x, c->sp, op.lm); set_zn(c, c->x, op.lm); break;
+        case K_TXS: blend8(c->sp, c->x, op.lm); break;
+
+        case K_PHA: push_lanes(c, op.lm, c->a); break;
+        case K_PHP:
+            for (int l = 0; l < L; l++) t[l] = (u8)(c->p[l] | F_B | F_U);
+            push_lanes(c, op.lm, t);
+            break;
+        case K_PLA: pull_lanes(c, op.lm, v); blend8(c->a, v, op.lm); set_zn(c, v, op.lm); break;
+        case K_PLP:
+            pull_lanes(c, op.lm, v);
+            for (int l = 0; l < L; l++) v[l] = (u8)((v[l] | F_U) & (u8)~F_B);
+            blend8(c->p, v, op.lm);
+            break;
+
+        case K_AND:
+            read_operand(c, &op, v);
+            for (int l = 0; l < L; l++) t[l] = (u8)(c->a[l] & v[l]);
+            blend8(c->a, t, op.lm); set_zn(c, t, op.lm);
+            break;
+        case K_ORA:
+            read_operand(c, &op, v);
+            for (int l = 0; l < L; l++) t[l] = (u8)(c->a[l] | v[l]);
+            blend8(c->a, t, op.lm); set_zn(c, t, op.lm);
+            break;
+        case K_EOR:
+            read_operand(c, &op, v);
+            for (int l = 0; l < L; l++) t[l] = (u8)(c->a[l] ^ v[l]);
+            blend8(c->a, t, op.lm); set_zn(c, t, op.lm);
+            break;
+        case K_BIT: {
+            read_operand(c, &op, v);
+            u8 np[L];
+            for (int l = 0; l < L; l++) {
+                u8 z = ((c->a[l] & v[l]) == 0u) ? (u8)F_Z : 0u;
+                np[l] = (u8)((c->p[l] & (u8)~(F_Z | F_N | F_V)) | z | (v[l] & (F_N | F_V)));
+            }
+            blend8(c->p, np, op.lm);
+        } break;
+
+        case K_CMP: read_operand(c, &op, v); compare_lanes(c, c->a, v, op.lm); break;
+        case K_CPX: read_operand(c, &op, v); compare_lanes(c, c->x, v, op.lm); break;
+        case K_CPY: read_operand(c, &op, v); compare_lanes(c, c->y, v, op.lm); break;
+
+        case K_ADC: read_operand(c, &op, v); add_lanes(c, v, op.lm); break;
+        case K_SBC:
+            read_operand(c, &op, v);
+            for (int l = 0; l < L; l++) v[l] = (u8)(v[l] ^ 0xFFu);
+            add_lanes(c, v, op.lm);
+            break;
+
+        case K_INC:
+        case K_DEC:
+            read_operand(c, &op, v);
+            for (int l = 0; l < L; l++) v[l] = (u8)(v[l] + ((k == K_INC) ? 1u : 0xFFu));
+            write_operand(c, &op, v);
+            set_zn(c, v, op.lm);
+            break;
+
+        case K_INX: for (int l = 0; l < L; l++) t[l] = (u8)(c->x[l] + 1u); blend8(c->x, t, op.lm); set_zn(c, t, op.lm); break;
+        case K_INY: for (int l = 0; l < L; l++) t[l] = (u8)(c->y[l] + 1u); blend8(c->y, t, op.lm); set_zn(c, t, op.lm); break;
+        case K_DEX: for (int l = 0; l < L; l++) t[l] = (u8)(c->x[l] - 1u); blend8(c->x, t, op.lm); set_zn(c, t, op.lm); break;
+        case K_DEY: for (int l = 0; l < L; l++) t[l] = (u8)(c->y[l] - 1u); blend8(c->y, t, op.lm); set_zn(c, t, op.lm); break;
+
+        case K_ASL:
+        case K_LSR:
+        case K_ROL:
+        case K_ROR:
+            if (!op.has_addr) {
+                memcpy(v, c->a, L);
+                shift_lanes(c, k, v, op.lm);
+                blend8(c->a, v, op.lm);
+            } else {
+                read_operand(c, &op, v);
+                shift_lanes(c, k, v, op.lm);
+                write_operand(c, &op, v);
+            }
+            break;
+
+        case K_BCC: branch_lanes(c, next_pc, (u8)op.ea0, F_C, false, op.lm); break;
+        case K_BCS: branch_lanes(c, next_pc, (u8)op.ea0, F_C, true,  op.lm); break;
+        case K_BNE: branch_lanes(c, next_pc, (u8)op.ea0, F_Z, false, op.lm); break;
+        case K_BEQ: branch_lanes(c, next_pc, (u8)op.ea0, F_Z, true,  op.lm); break;
+        case K_BPL: branch_lanes(c, next_pc, (u8)op.ea0, F_N, false, op.lm); break;
+        case K_BMI: branch_lanes(c, next_pc, (u8)op.ea0, F_N, true,  op.lm); break;
+        case K_BVC: branch_lanes(c, next_pc, (u8)op.ea0, F_V, false, op.lm); break;
+        case K_BVS: branch_lanes(c, next_pc, (u8)op.ea0, F_V, true,  op.lm); break;
+
+        case K_JMP:
+            for (int l = 0; l < L; l++) if (op.lm[l]) c->pc[l] = op.uniform ? op.ea0 : op.ea[l];
+            break;
+
+        case K_JSR: {
+            u16 ret = (u16)(next_pc - 1u);
+            memset(t, (u8)(ret >> 8), L);
+            push_lanes(c, op.lm, t);
+            memset(t, (u8)(ret & 0xFFu), L);
+            push_lanes(c, op.lm, t);
+            for (int l = 0; l < L; l++) if (op.lm[l]) c->pc[l] = op.ea0;
+        } break;
+
+        case K_RTS:
+            pull_lanes(c, op.lm, v);
+            pull_lanes(c, op.lm, t);
+            for (int l = 0; l < L; l++) {
+                if (op.lm[l]) c->pc[l] = (u16)((v[l] | ((u16)t[l] << 8)) + 1u);
+            }
+            break;
+
+        case K_RTI: {
+            u8 pl[L];
+            pull_lanes(c, op.lm, pl);
+            for (int l = 0; l < L; l++) pl[l] = (u8)((pl[l] | F_U) & (u8)~F_B);
+            blend8(c->p, pl, op.lm);
+            pull_lanes(c, op.lm, v);
+            pull_lanes(c, op.lm, t);
+            for (int l = 0; l < L; l++) {
+                if (op.lm[l]) c->pc[l] = (u16)(v[l] | ((u16)t[l] << 8));
+            }
+        } break;
+
+        case K_BRK:
+            for (int l = 0; l < L; l++) {
+                if (!op.lm[l]) continue;
+                c->pc[l] = (u16)(pc + 2u);
+                service_interrupt_lane(c, l, 0xFFFE, true);
+            }
+            break;
+
+        case K_CLC: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] &= (u8)~F_C; break;
+        case K_SEC: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] |= F_C; break;
+        case K_CLI: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] &= (u8)~F_I; break;
+        case K_SEI: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] |= F_I; break;
+        case K_CLV: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] &= (u8)~F_V; break;
+        case K_CLD: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] &= (u8)~F_D; break;
+        case K_SED: for (int l = 0; l < L; l++) if (op.lm[l]) c->p[l] |= F_D; break;
+    }
+
+    for (int l = 0; l < L; l++) {
+        if (op.lm[l]) advance_lane(c, l, (int)info.cycles + op.extra[l]);
+    }
+}
+
+static int step_masked(CPU6502Lockstep* c, u32 live)
+{
+    for (int l = 0; l < c->lanes; l++) {
+        if (c->jammed[l]) live &= ~(1u << l);
+    }
+    if (live == 0) return 0;
+
+    // Pending NMIs are taken per lane before any group instruction.
+    int serviced = 0;
+    for (int l = 0; l < c->lanes; l++) {
+        if (!((live >> l) & 1u) || !c->nmi_pending[l]) continue;
+        c->nmi_pending[l] = false;
+        service_interrupt_lane(c, l, 0xFFFA, false);
+        advance_lane(c, l, 7);
+        serviced++;
+    }
+    if (serviced > 0) return serviced;
+
+    // Lowest PC leads: lanes that took a forward branch wait at the join point.
+    u16 leader = 0xFFFFu;
+    for (int l = 0; l < c->lanes; l++) {
+        if (((live >> l) & 1u) && c->pc[l] < leader) leader = c->pc[l];
+    }
+
+    u32 mask = lanes_at_pc(c, live, leader);
+
+    if (leader < 0x8000u) {
+        // Code running from RAM may differ per lane: issue it one lane at a time.
+        u32 first = mask & (~mask + 1u);
+        for (int l = 0; l < c->lanes; l++) {
+            if (first == (1u << l)) {
+                u8 opcode = lane_read(c, l, leader);
+                NES_LOGE("CPU lockstep: code outside PRG ROM at PC=%04X (op %02X) is not supported", leader, opcode);
+                c->jammed[l] = true;
+            }
+        }
+        return 1;
+    }
+
+    execute_group(c, leader, mask);
+
+    int n = 0;
+    for (u32 m = mask; m; m &= m - 1u) n++;
+    c->steps++;
+    c->lane_steps += (u64)n;
+    return n;
+}
+
+bool CPU6502Lockstep_Init(CPU6502Lockstep* c, const Cart* cart, int lanes)
+{
+    if (!c || !cart || !cart->prg_rom) return false;
+    if (lanes < 1 || lanes > L) return false;
+
+    if (cart->info.mapper != 0u) {
+        NES_LOGE("CPU lockstep: only mapper 0 is supported (got %u)", cart->info.mapper);
+        return false;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->prg = cart->prg_rom;
+    c->prg_mask = (cart->prg_rom_size > 16u * 1024u) ? 0x7FFFu : 0x3FFFu;
+    c->lanes = lanes;
+
+    for (int op = 0; op < 256; op++) c->kind[op] = kind_of(g_op_table[op].fn);
+
+    CPU6502Lockstep_Reset(c);
+    return true;
+}
+
+void CPU6502Lockstep_Reset(CPU6502Lockstep* c)
+{
+    if (!c || !c->prg) return;
+
+    u16 vec = (u16)(rom_read(c, 0xFFFC) | ((u16)rom_read(c, 0xFFFD) << 8));
+
+    for (int l = 0; l < L; l++) {
+        c->pc[l] = vec;
+        c->a[l] = c->x[l] = c->y[l] = 0;
+        c->sp[l] = 0xFD;
+        c->p[l] = (u8)(F_I | F_U);
+        c->cycles[l] = 7;
+        c->jammed[l] = (l >= c->lanes);
+
+        c->dot[l] = LS_RESET_DOT;
+        c->frame_count[l] = 0;
+        c->ppu_ctrl[l] = 0;
+        c->ppu_status[l] = 0;
+        c->nmi_pending[l] = false;
+
+        c->pad_shift_p1[l] = 0;
+        c->pad_shift_p2[l] = 0;
+        c->pad_strobe[l] = false;
+    }
+
+    memset(c->ram, 0, sizeof(c->ram));
+    c->steps = 0;
+    c->lane_steps = 0;
+}
+
+void CPU6502Lockstep_SetInput(CPU6502Lockstep* c, int lane, NesInput input)
+{
+    if (!c || lane < 0 || lane >= c->lanes) return;
+    c->input[lane] = input;
+    if (c->pad_strobe[lane]) {
+        c->pad_shift_p1[lane] = input.p1;
+        c->pad_shift_p2[lane] = input.p2;
+    }
+}
+
+int CPU6502Lockstep_Step(CPU6502Lockstep* c)
+{
+    if (!c) return 0;
+    u32 all = (c->lanes >= 32) ? 0xFFFFFFFFu : ((1u << c->lanes) - 1u);
+    return step_masked(c, all);
+}
+
+void CPU6502Lockstep_RunFrame(CPU6502Lockstep* c)
+{
+    if (!c) return;
+
+    u64 target[L];
+    for (int l = 0; l < L; l++) target[l] = c->frame_count[l] + 1u;
+
+    for (;;) {
+        // Lanes that reached the frame boundary sit out until the rest catch up.
+        u32 live = 0;
+        for (int l = 0; l < c->lanes; l++) {
+            if (!c->jammed[l] && c->frame_count[l] < target[l]) live |= 1u << l;
+        }
+        if (live == 0) break;
+        if (step_masked(c, live) == 0) break;
+    }
+}
+
+const char* CPU6502Lockstep_Backend(void)
+{
+#if defined(__AVX2__) && LOCKSTEP_HAVE_SSE2
+    return "avx2";
+#elif LOCKSTEP_HAVE_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,506 @@
+#include "nes/debug/profiler.h"
+#include "nes/util/file.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    BANK_SHIFT = 14,            // 16KB banks, as in .nl file names
+    BANK_MASK = (1 << BANK_SHIFT) - 1,
+    NAME_CHARS = 48,            // NesSymbol.name
+    DBG_MAX_SEGS = 256
+};
+
+bool NesProfiler_Init(NesProfiler* p, const Cart* cart)
+{
+    if (!p || !cart) return false;
+    memset(p, 0, sizeof(*p));
+    p->cart = cart;
+
+    // Raw addresses stay in range even when no PRG ROM is mapped.
+    u32 rom = cart->prg_rom_size > 0x8000u ? cart->prg_rom_size : 0x8000u;
+    p->locs = NES_PROF_ROM_BASE + rom;
+    p->cycles = (u64*)calloc(p->locs, sizeof(u64));
+    p->execs = (u32*)calloc(p->locs, sizeof(u32));
+    p->node_cap = 1024;
+    p->nodes = (NesProfNode*)calloc(p->node_cap, sizeof(NesProfNode));
+    if (!p->cycles || !p->execs || !p->nodes) {
+        NesProfiler_Free(p);
+        return false;
+    }
+    p->node_count = 1;
+    return true;
+}
+
+void NesProfiler_Free(NesProfiler* p)
+{
+    if (!p) return;
+    free(p->cycles);
+    free(p->execs);
+    free(p->nodes);
+    memset(p, 0, sizeof(*p));
+}
+
+void NesProfiler_Reset(NesProfiler* p)
+{
+    if (!p || !p->nodes) return;
+    memset(p->cycles, 0, (size_t)p->locs * sizeof(u64));
+    memset(p->execs, 0, (size_t)p->locs * sizeof(u32));
+    memset(&p->nodes[0], 0, sizeof(p->nodes[0]));
+    p->node_count = 1;
+    p->current = 0;
+    p->depth = 0;
+    p->total_cycles = p->stall_cycles = p->interrupts = p->dropped_calls = 0;
+}
+
+// Child of `parent` entered at `loc`, created on first use; 0 when full.
+static u32 child_node(NesProfiler* p, u32 parent, u32 loc)
+{
+    for (u32 i = p->nodes[parent].first_child; i; i = p->nodes[i].next_sibling) {
+        if (p->nodes[i].loc == loc) return i;
+    }
+
+    if (p->node_count == p->node_cap) {
+        if (p->node_cap >= NES_PROF_MAX_NODES) return 0;
+        u32 cap = p->node_cap * 2u;
+        NesProfNode* grown = (NesProfNode*)realloc(p->nodes, (size_t)cap * sizeof(NesProfNode));
+        if (!grown) return 0;
+        p->nodes = grown;
+        p->node_cap = cap;
+    }
+
+    u32 i = p->node_count++;
+    NesProfNode* n = &p->nodes[i];
+    memset(n, 0, sizeof(*n));
+    n->loc = loc;
+    n->parent = parent;
+    n->next_sibling = p->nodes[parent].first_child;
+    p->nodes[parent].first_child = i;
+    return i;
+}
+
+void NesProfiler_Enter(NesProfiler* p, u32 loc, u8 sp)
+{
+    u32 node = p->depth < NES_PROF_MAX_DEPTH ? child_node(p, p->current, loc) : 0;
+    if (!node) {
+        // Untracked: cycles stay with the caller, and its frame is unwound
+        // by the SP as usual.
+        p->dropped_calls++;
+        return;
+    }
+    p->stack[p->depth].node = node;
+    p->stack[p->depth].sp = sp;
+    p->depth++;
+    p->current = node;
+    p->nodes[node].calls++;
+}
+
+void NesProfiler_Unwind(NesProfiler* p, u8 sp)
+{
+    while (p->depth && p->stack[p->depth - 1u].sp <= sp) p->depth--;
+    p->current = p->depth ? p->stack[p->depth - 1u].node : 0u;
+}
+
+void NesProfiler_Interrupt(NesProfiler* p, u16 pc, u8 sp_before, u32 cycles)
+{
+    NesProfiler_Enter(p, NesProfiler_Locate(p, pc), sp_before);
+    p->nodes[p->current].cycles += cycles;
+    p->total_cycles += cycles;
+    p->interrupts++;
+}
+
+void NesProfiler_Stall(NesProfiler* p, u32 cycles)
+{
+    p->nodes[p->current].cycles += cycles;
+    p->total_cycles += cycles;
+    p->stall_cycles += cycles;
+}
+
+// ---------------------------------------------------------------------------
+// Symbols
+// ---------------------------------------------------------------------------
+
+bool NesSymbols_Add(NesSymbols* s, u32 loc, const char* name)
+{
+    if (!s || !name || !name[0]) return false;
+    if (s->count == s->cap) {
+        u32 cap = s->cap ? s->cap * 2u : 256u;
+        NesSymbol* grown = (NesSymbol*)realloc(s->items, (size_t)cap * sizeof(NesSymbol));
+        if (!grown) return false;
+        s->items = grown;
+        s->cap = cap;
+    }
+    NesSymbol* sym = &s->items[s->count++];
+    sym->loc = loc;
+    snprintf(sym->name, sizeof(sym->name), "%s", name);
+    s->sorted = false;
+    return true;
+}
+
+void NesSymbols_Free(NesSymbols* s)
+{
+    if (!s) return;
+    free(s->items);
+    memset(s, 0, sizeof(*s));
+}
+
+static int cmp_symbol(const void* a, const void* b)
+{
+    u32 x = ((const NesSymbol*)a)->loc;
+    u32 y = ((const NesSymbol*)b)->loc;
+    return (x > y) - (x < y);
+}
+
+static bool same_region(u32 a, u32 b)
+{
+    if (a < NES_PROF_ROM_BASE || b < NES_PROF_ROM_BASE) return a < NES_PROF_ROM_BASE && b < NES_PROF_ROM_BASE;
+    return ((a - NES_PROF_ROM_BASE) >> BANK_SHIFT) == ((b - NES_PROF_ROM_BASE) >> BANK_SHIFT);
+}
+
+const char* NesSymbols_Find(NesSymbols* s, u32 loc, u32* offset)
+{
+    if (!s || s->count == 0) return NULL;
+    if (!s->sorted) {
+        qsort(s->items, s->count, sizeof(NesSymbol), cmp_symbol);
+        s->sorted = true;
+    }
+
+    // Last symbol at or below loc.
+    u32 lo = 0, hi = s->count;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2u;
+        if (s->items[mid].loc <= loc) lo = mid + 1u;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+
+    const NesSymbol* sym = &s->items[lo - 1u];
+    if (!same_region(sym->loc, loc)) return NULL;
+    if (offset) *offset = loc - sym->loc;
+    return sym->name;
+}
+
+// One .nl line: "$C000#Name#comment" (or "$0200/10#Name#" for arrays).
+static void parse_nl_line(NesSymbols* s, const char* line, int bank, u32 prg_size)
+{
+    if (line[0] != '$') return;
+    char* end = NULL;
+    unsigned long addr = strtoul(line + 1, &end, 16);
+    const char* name = strchr(end, '#');
+    if (!name || addr > 0xFFFFul) return;
+    name++;
+
+    char buf[NAME_CHARS];
+    size_t n = 0;
+    while (name[n] && name[n] != '#' && name[n] != '\r' && name[n] != '\n' && n + 1 < sizeof(buf)) {
+        buf[n] = name[n];
+        n++;
+    }
+    buf[n] = '\0';
+
+    if (bank < 0) {
+        if (addr < NES_PROF_ROM_BASE) NesSymbols_Add(s, (u32)addr, buf);
+    } else {
+        u32 off = ((u32)bank << BANK_SHIFT) + ((u32)addr & BANK_MASK);
+        if (addr >= NES_PROF_ROM_BASE && off < prg_size) NesSymbols_Add(s, NES_PROF_ROM_BASE + off, buf);
+    }
+}
+
+static u32 load_nl_file(NesSymbols* s, const char* path, int bank, u32 prg_size)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    u32 before = s->count;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) parse_nl_line(s, line, bank, prg_size);
+    fclose(f);
+    return s->count - before;
+}
+
+u32 NesSymbols_LoadNL(NesSymbols* s, const char* rom_path, u32 prg_size)
+{
+    if (!s || !rom_path) return 0;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.ram.nl", rom_path);
+    u32 added = load_nl_file(s, path, -1, prg_size);
+    for (u32 bank = 0; bank < (prg_size >> BANK_SHIFT); bank++) {
+        snprintf(path, sizeof(path), "%s.%u.nl", rom_path, bank);
+        added += load_nl_file(s, path, (int)bank, prg_size);
+    }
+    return added;
+}
+
+// Value of key=... in an ld65 debug line ("sym\tid=3,name=\"x\",val=0x8000,...").
+static bool dbg_field(const char* line, const char* key, char* out, size_t cap)
+{
+    size_t klen = strlen(key);
+    const char* p = strchr(line, '\t');
+    while (p) {
+        p++;
+        if (strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            p += klen + 1u;
+            bool quoted = *p == '"';
+            if (quoted) p++;
+            size_t n = 0;
+            while (*p && *p != '\n' && *p != '\r' && (quoted ? *p != '"' : *p != ',')) {
+                if (n + 1 < cap) out[n++] = *p;
+                p++;
+            }
+            out[n] = '\0';
+            return true;
+        }
+        // Next field; commas inside quoted names are skipped over.
+        bool in_quote = false;
+        while (*p && *p != '\n' && (in_quote || *p != ',')) {
+            if (*p == '"') in_quote = !in_quote;
+            p++;
+        }
+        p = *p == ',' ? p : NULL;
+    }
+    return false;
+}
+
+typedef struct DbgSeg {
+    u32 id;
+    u32 start;
+    long ooffs;         // -1 when the segment is not in the ROM image
+} DbgSeg;
+
+bool NesSymbols_LoadDbg(NesSymbols* s, const char* path, u32 prg_size)
+{
+    if (!s || !path) return false;
+
+    unsigned char* data = NULL;
+    size_t size = 0;
+    if (!File_ReadAllBytes(path, &data, &size)) return false;
+    char* text = (char*)realloc(data, size + 1u);
+    if (!text) {
+        free(data);
+        return false;
+    }
+    text[size] = '\0';
+
+    DbgSeg segs[DBG_MAX_SEGS];
+    u32 nsegs = 0;
+    char v[NAME_CHARS];
+
+    // Two passes: segments may be listed after the symbols that use them.
+    for (int pass = 0; pass < 2; pass++) {
+        for (char* line = text; line && *line; ) {
+            char* next = strchr(line, '\n');
+            if (pass == 0 && strncmp(line, "seg\t", 4) == 0 && nsegs < DBG_MAX_SEGS) {
+                DbgSeg* seg = &segs[nsegs];
+                if (dbg_field(line, "id", v, sizeof(v))) {
+                    seg->id = (u32)strtoul(v, NULL, 0);
+                    seg->start = dbg_field(line, "start", v, sizeof(v)) ? (u32)strtoul(v, NULL, 0) : 0u;
+                    seg->ooffs = dbg_field(line, "ooffs", v, sizeof(v)) ? strtol(v, NULL, 0) : -1;
+                    nsegs++;
+                }
+            } else if (pass == 1 && strncmp(line, "sym\t", 4) == 0) {
+                char name[NAME_CHARS];
+                bool label = dbg_field(line, "type", v, sizeof(v)) && strcmp(v, "lab") == 0;
+                if (label && dbg_field(line, "name", name, sizeof(name)) && dbg_field(line, "val", v, sizeof(v))) {
+                    u32 val = (u32)strtoul(v, NULL, 0);
+                    const DbgSeg* seg = NULL;
+                    if (dbg_field(line, "seg", v, sizeof(v))) {
+                        u32 id = (u32)strtoul(v, NULL, 0);
+                        for (u32 i = 0; i < nsegs; i++) {
+                            if (segs[i].id == id) seg = &segs[i];
+                        }
+                    }
+
+                    // ROM image offsets include the 16-byte iNES header.
+                    if (seg && seg->ooffs >= 16 && val >= seg->start) {
+                        u32 off = (u32)(seg->ooffs - 16) + (val - seg->start);
+                        if (off < prg_size) NesSymbols_Add(s, NES_PROF_ROM_BASE + off, name);
+                    } else if (val < NES_PROF_ROM_BASE) {
+                        NesSymbols_Add(s, val, name);
+                    }
+                }
+            }
+            line = next ? next + 1 : NULL;
+        }
+    }
+
+    free(text);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Reports
+// ---------------------------------------------------------------------------
+
+// "Name", "Name+12", "03:1A40" (PRG bank:offset) or "$0300".
+static void loc_name(NesSymbols* syms, u32 loc, char* out, size_t cap)
+{
+    u32 off = 0;
+    const char* sym = NesSymbols_Find(syms, loc, &off);
+    if (sym && off == 0) {
+        snprintf(out, cap, "%s", sym);
+    } else if (sym) {
+        snprintf(out, cap, "%s+%u", sym, off);
+    } else if (loc >= NES_PROF_ROM_BASE) {
+        u32 prg = loc - NES_PROF_ROM_BASE;
+        snprintf(out, cap, "%02X:%04X", prg >> BANK_SHIFT, prg & BANK_MASK);
+    } else {
+        snprintf(out, cap, "$%04X", loc);
+    }
+}
+
+static double pct(u64 part, u64 total)
+{
+    return total ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+typedef struct ProfRow {
+    u32 loc;
+    u64 self;
+    u64 incl;
+    u64 calls;
+} ProfRow;
+
+static int cmp_row_self(const void* a, const void* b)
+{
+    u64 x = ((const ProfRow*)a)->self;
+    u64 y = ((const ProfRow*)b)->self;
+    return (x < y) - (x > y);
+}
+
+static int cmp_row_incl(const void* a, const void* b)
+{
+    u64 x = ((const ProfRow*)a)->incl;
+    u64 y = ((const ProfRow*)b)->incl;
+    return (x < y) - (x > y);
+}
+
+static int cmp_row_loc(const void* a, const void* b)
+{
+    u32 x = ((const ProfRow*)a)->loc;
+    u32 y = ((const ProfRow*)b)->loc;
+    return (x > y) - (x < y);
+}
+
+// Per-subroutine rows: self cycles summed over every node of a location,
+// inclusive cycles over the outermost ones (so recursion is not counted
+// twice).
+static ProfRow* subroutine_rows(const NesProfiler* p, u32* out_count)
+{
+    u32 n = p->node_count;
+    u64* incl = (u64*)malloc((size_t)n * sizeof(u64));
+    ProfRow* rows = (ProfRow*)malloc((size_t)n * sizeof(ProfRow));
+    if (!incl || !rows) {
+        free(incl);
+        free(rows);
+        return NULL;
+    }
+
+    // Children are always created after their parent.
+    for (u32 i = 0; i < n; i++) incl[i] = p->nodes[i].cycles;
+    for (u32 i = n; i-- > 1u;) incl[p->nodes[i].parent] += incl[i];
+
+    for (u32 i = 0; i < n; i++) {
+        bool outermost = true;
+        for (u32 a = p->nodes[i].parent; i && a; a = p->nodes[a].parent) {
+            if (p->nodes[a].loc == p->nodes[i].loc) outermost = false;
+        }
+        rows[i].loc = i ? p->nodes[i].loc : UINT32_MAX;
+        rows[i].self = p->nodes[i].cycles;
+        rows[i].incl = outermost ? incl[i] : 0;
+        rows[i].calls = p->nodes[i].calls;
+    }
+    free(incl);
+
+    qsort(rows, n, sizeof(ProfRow), cmp_row_loc);
+    u32 out = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (out && rows[out - 1u].loc == rows[i].loc) {
+            rows[out - 1u].self += rows[i].self;
+            rows[out - 1u].incl += rows[i].incl;
+            rows[out - 1u].calls += rows[i].calls;
+        } else {
+            rows[out++] = rows[i];
+        }
+    }
+
+    *out_count = out;
+    return rows;
+}
+
+void NesProfiler_WriteFlat(const NesProfiler* p, NesSymbols* syms, u32 top, FILE* out)
+{
+    if (!p || !out || !p->nodes) return;
+
+    u64 total = p->total_cycles;
+    fprintf(out, "profile: %llu cycles (%llu in DMA stalls), %llu interrupts, %llu untracked calls\n",
+            (unsigned long long)total, (unsigned long long)p->stall_cycles,
+            (unsigned long long)p->interrupts, (unsigned long long)p->dropped_calls);
+
+    u32 used = 0;
+    for (u32 loc = 0; loc < p->locs; loc++) used += p->execs[loc] ? 1u : 0u;
+    ProfRow* rows = (ProfRow*)malloc((size_t)(used ? used : 1u) * sizeof(ProfRow));
+    if (!rows) return;
+    u32 k = 0;
+    for (u32 loc = 0; loc < p->locs; loc++) {
+        if (!p->execs[loc]) continue;
+        rows[k].loc = loc;
+        rows[k].self = p->cycles[loc];
+        rows[k].incl = 0;
+        rows[k].calls = p->execs[loc];
+        k++;
+    }
+    qsort(rows, used, sizeof(ProfRow), cmp_row_self);
+
+    char name[NAME_CHARS + 16];
+    fprintf(out, "\nlocations (bank:offset in PRG ROM, $addr below $8000):\n");
+    fprintf(out, "%14s %7s %12s %7s  %s\n", "cycles", "%", "execs", "cyc/ex", "location");
+    u32 shown = top && top < used ? top : used;
+    for (u32 i = 0; i < shown; i++) {
+        loc_name(syms, rows[i].loc, name, sizeof(name));
+        fprintf(out, "%14llu %6.2f%% %12llu %7.2f  %s\n",
+                (unsigned long long)rows[i].self, pct(rows[i].self, total),
+                (unsigned long long)rows[i].calls, (double)rows[i].self / (double)rows[i].calls, name);
+    }
+    free(rows);
+
+    u32 nsubs = 0;
+    ProfRow* subs = subroutine_rows(p, &nsubs);
+    if (!subs) return;
+    qsort(subs, nsubs, sizeof(ProfRow), cmp_row_incl);
+
+    fprintf(out, "\nsubroutines:\n");
+    fprintf(out, "%14s %7s %14s %7s %10s  %s\n", "inclusive", "%", "self", "%", "calls", "subroutine");
+    for (u32 i = 0; i < nsubs; i++) {
+        if (subs[i].loc == UINT32_MAX) snprintf(name, sizeof(name), "(top level)");
+        else loc_name(syms, subs[i].loc, name, sizeof(name));
+        fprintf(out, "%14llu %6.2f%% %14llu %6.2f%% %10llu  %s\n",
+                (unsigned long long)subs[i].incl, pct(subs[i].incl, total),
+                (unsigned long long)subs[i].self, pct(subs[i].self, total),
+                (unsigned long long)subs[i].calls, name);
+    }
+    free(subs);
+}
+
+void NesProfiler_WriteCollapsed(const NesProfiler* p, NesSymbols* syms, FILE* out)
+{
+    if (!p || !out || !p->nodes) return;
+
+    u32 path[NES_PROF_MAX_DEPTH + 1];
+    char name[NAME_CHARS + 16];
+    for (u32 i = 0; i < p->node_count; i++) {
+        if (!p->nodes[i].cycles) continue;
+
+        u32 depth = 0;
+        for (u32 n = i; n && depth < NES_PROF_MAX_DEPTH; n = p->nodes[n].parent) path[depth++] = n;
+
+        fputs("(top)", out);
+        while (depth--) {
+            loc_name(syms, p->nodes[path[depth]].loc, name, sizeof(name));
+            // Frame names must not contain the separators.
+            for (char* c = name; *c; c++) {
+                if (*c == ';' || *c == ' ') *c = '_';
+            }
+            fprintf(out, ";%s", name);
+        }
+        fprintf(out, " %llu\n", (unsigned long long)p->nodes[i].cycles);
+    }
+}
@@ -0,0 +1,217 @@
+#include "nes/debug/timeline.h"
+#include "nes/log.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct NesTimelineRing {
+    NesTimelineEvent* events;
+    u32 mask;
+    u64 count;              // recorded; the ring keeps the last mask + 1
+    const char* segment;    // open segment, NULL when none
+    u64 segment_start;
+    u32 tid;
+    char name[32];
+    NesTimelineRing* next;
+};
+
+_Thread_local NesTimelineRing* g_nes_timeline;
+
+// Registration only; recording never takes the lock.
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static NesTimelineRing* s_rings;
+static u32 s_ring_events;
+static u32 s_next_tid;
+static u64 s_epoch_ns;
+static bool s_active;
+
+static inline void push(NesTimelineRing* r, const char* name, u64 start_ns, u32 dur_ns, u32 arg)
+{
+    NesTimelineEvent* e = &r->events[r->count & r->mask];
+    e->start_ns = start_ns;
+    e->dur_ns = dur_ns;
+    e->arg = arg;
+    e->name = name;
+    r->count++;
+}
+
+static u32 span_ns(u64 start_ns, u64 end_ns)
+{
+    u64 d = end_ns > start_ns ? end_ns - start_ns : 0u;
+    return d < NES_TIMELINE_IS_INSTANT ? (u32)d : NES_TIMELINE_IS_INSTANT - 1u;
+}
+
+bool NesTimeline_Start(u32 events_per_thread)
+{
+    pthread_mutex_lock(&s_lock);
+    bool ok = !s_active;
+    if (ok) {
+        u32 n = events_per_thread ? events_per_thread : (u32)NES_TIMELINE_DEFAULT_EVENTS;
+        u32 cap = 16u;
+        while (cap < n && cap < (1u << 30)) cap <<= 1;
+        s_ring_events = cap;
+        s_next_tid = 1;
+        s_epoch_ns = NesClock_Now();
+        s_active = true;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ok;
+}
+
+bool NesTimeline_AttachThread(const char* name)
+{
+    if (g_nes_timeline) return true;
+
+    pthread_mutex_lock(&s_lock);
+    NesTimelineRing* r = NULL;
+    if (s_active) {
+        r = (NesTimelineRing*)calloc(1, sizeof(NesTimelineRing));
+        if (r) r->events = (NesTimelineEvent*)malloc((size_t)s_ring_events * sizeof(NesTimelineEvent));
+        if (r && r->events) {
+            r->mask = s_ring_events - 1u;
+            r->tid = s_next_tid++;
+            snprintf(r->name, sizeof(r->name), "%s", name ? name : "thread");
+            r->next = s_rings;
+            s_rings = r;
+        } else if (r) {
+            free(r);
+            r = NULL;
+            NES_LOGE("Timeline: out of memory for thread %s", name ? name : "");
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    g_nes_timeline = r;
+    return r != NULL;
+}
+
+void NesTimeline_DetachThread(void)
+{
+    if (!g_nes_timeline) return;
+    NesTimeline_SegmentEnd();
+    g_nes_timeline = NULL;
+}
+
+void NesTimeline_Span(const char* name, u64 start_ns, u32 arg)
+{
+    NesTimelineRing* r = g_nes_timeline;
+    if (!r) return;
+    push(r, name, start_ns, span_ns(start_ns, NesClock_Now()), arg);
+}
+
+void NesTimeline_Instant(const char* name, u32 arg)
+{
+    NesTimelineRing* r = g_nes_timeline;
+    if (!r) return;
+    u64 now = NesClock_Now();
+    if (r->segment) {
+        push(r, r->segment, r->segment_start, span_ns(r->segment_start, now), NES_TIMELINE_NO_ARG);
+        r->segment_start = now;
+    }
+    push(r, name, now, NES_TIMELINE_IS_INSTANT, arg);
+}
+
+void NesTimeline_SegmentBegin(const char* name)
+{
+    NesTimelineRing* r = g_nes_timeline;
+    if (!r) return;
+    NesTimeline_SegmentEnd();
+    r->segment = name;
+    r->segment_start = NesClock_Now();
+}
+
+void NesTimeline_SegmentEnd(void)
+{
+    NesTimelineRing* r = g_nes_timeline;
+    if (!r || !r->segment) return;
+    push(r, r->segment, r->segment_start, span_ns(r->segment_start, NesClock_Now()), NES_TIMELINE_NO_ARG);
+    r->segment = NULL;
+}
+
+// Names are caller text; write them as a JSON string body.
+static void write_json_string(FILE* f, const char* s)
+{
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+}
+
+// Timestamps are microseconds from NesTimeline_Start, as the format expects.
+static void write_event(FILE* f, const NesTimelineRing* r, const NesTimelineEvent* e)
+{
+    double ts = e->start_ns > s_epoch_ns ? (double)(e->start_ns - s_epoch_ns) * 1e-3 : 0.0;
+    fputs(",\n{\"name\":\"", f);
+    write_json_string(f, e->name);
+    if (e->dur_ns == NES_TIMELINE_IS_INSTANT) {
+        fprintf(f, "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", r->tid, ts);
+    } else {
+        fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                r->tid, ts, (double)e->dur_ns * 1e-3);
+    }
+    if (e->arg != NES_TIMELINE_NO_ARG) fprintf(f, ",\"args\":{\"value\":%u}", e->arg);
+    fputc('}', f);
+}
+
+static void write_ring(FILE* f, const NesTimelineRing* r)
+{
+    fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", r->tid);
+    write_json_string(f, r->name);
+    fputs("\"}}", f);
+
+    u64 cap = (u64)r->mask + 1u;
+    u64 first = r->count > cap ? r->count - cap : 0u;
+    for (u64 i = first; i < r->count; i++) write_event(f, r, &r->events[i & r->mask]);
+}
+
+static void free_rings(void)
+{
+    while (s_rings) {
+        NesTimelineRing* r = s_rings;
+        s_rings = r->next;
+        free(r->events);
+        free(r);
+    }
+}
+
+bool NesTimeline_Write(const char* path)
+{
+    NesTimeline_DetachThread();
+
+    pthread_mutex_lock(&s_lock);
+    if (!s_active) {
+        pthread_mutex_unlock(&s_lock);
+        return false;
+    }
+
+    FILE* f = path ? fopen(path, "w") : NULL;
+    bool ok = f != NULL;
+    if (f) {
+        u64 lost = 0;
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+              "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"nes\"}}", f);
+        for (const NesTimelineRing* r = s_rings; r; r = r->next) {
+            write_ring(f, r);
+            u64 cap = (u64)r->mask + 1u;
+            lost += r->count > cap ? r->count - cap : 0u;
+        }
+        fputs("\n]}\n", f);
+        ok = !ferror(f);
+        ok = fclose(f) == 0 && ok;
+        if (lost) NES_LOGW("Timeline: %llu older events were overwritten (ring full)", (unsigned long long)lost);
+    }
+    if (!ok) NES_LOGE("Timeline: cannot write %s", path ? path : "(null)");
+
+    free_rings();
+    s_active = false;
+    pthread_mutex_unlock(&s_lock);
+    return ok;
+}
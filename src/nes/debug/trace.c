@@ -0,0 +1,661 @@
+#define _POSIX_C_SOURCE 200112L
+#include "nes/debug/trace.h"
+#include "nes/cpu/cpu_tables.h"
+#include "nes/util/memdiff.h"
+#include "nes/util/ringbuf.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { TOP_OPCODES = 8 };
+
+static const char* const k_regions[NES_TRACE_REGION_COUNT] = { "ram", "ppu", "apu", "cart" };
+static const char* const k_lines[NES_TRACE_LINE_COUNT] = { "visible", "post", "vblank", "pre" };
+static const char* const k_phases[NES_TRACE_PHASE_COUNT] = { "cpu", "ppu", "apu", "present" };
+
+double NesTrace_TicksPerSecond(void)
+{
+    static double rate;
+    if (rate > 0.0) return rate;
+
+    // Measured once against the monotonic clock over ~10 ms.
+    u64 t0 = NesClock_Now();
+    u64 k0 = NesTrace_Ticks();
+    u64 t1 = t0;
+    while (t1 - t0 < 10000000u) t1 = NesClock_Now();
+    u64 k1 = NesTrace_Ticks();
+
+    rate = (double)(k1 - k0) * 1e9 / (double)(t1 - t0);
+    return rate;
+}
+
+void NesTrace_Reset(NesTrace* t)
+{
+    if (!t) return;
+    memset(t, 0, sizeof(*t));
+}
+
+static double per_frame(const NesTrace* t, u64 v)
+{
+    return t->frames ? (double)v / (double)t->frames : (double)v;
+}
+
+void NesTrace_Dump(const NesTrace* t, FILE* out, u64 frame)
+{
+    if (!t || !out) return;
+
+    fprintf(out, "trace: frames %llu-%llu, per frame:\n",
+            (unsigned long long)(frame - t->frames), (unsigned long long)frame);
+
+    for (int rw = 0; rw < 2; rw++) {
+        const u64* v = rw ? t->bus_writes : t->bus_reads;
+        fprintf(out, "  bus %-6s", rw ? "writes" : "reads");
+        for (int r = 0; r < NES_TRACE_REGION_COUNT; r++) {
+            fprintf(out, " %s %.0f", k_regions[r], per_frame(t, v[r]));
+        }
+        fputc('\n', out);
+    }
+
+    fprintf(out, "  ppu dots  ");
+    for (int l = 0; l < NES_TRACE_LINE_COUNT; l++) {
+        fprintf(out, " %s %.0f", k_lines[l], per_frame(t, t->ppu_dots[l]));
+    }
+    fputc('\n', out);
+
+    fprintf(out, "  mapper calls %.0f, sprite evals %.0f, dma stalls %.0f, nmi %.1f, irq %.1f\n",
+            per_frame(t, t->mapper_calls), per_frame(t, t->sprite_evals),
+            per_frame(t, t->dma_stalls), per_frame(t, t->nmis), per_frame(t, t->irqs));
+
+    // Most frequent opcodes (a partial selection sort over a copy).
+    u64 total = 0;
+    u8 order[256];
+    for (int i = 0; i < 256; i++) {
+        total += t->opcodes[i];
+        order[i] = (u8)i;
+    }
+    fprintf(out, "  insns %.0f, top:", per_frame(t, total));
+    for (int k = 0; k < TOP_OPCODES && total; k++) {
+        int best = k;
+        for (int i = k + 1; i < 256; i++) {
+            if (t->opcodes[order[i]] > t->opcodes[order[best]]) best = i;
+        }
+        u8 tmp = order[k]; order[k] = order[best]; order[best] = tmp;
+        u8 op = order[k];
+        if (!t->opcodes[op]) break;
+        const char* name = g_op_table[op].name ? g_op_table[op].name : "???";
+        fprintf(out, " %02X %s %.1f%%", op, name, 100.0 * (double)t->opcodes[op] / (double)total);
+    }
+    fputc('\n', out);
+
+    u64 ticks = 0;
+    for (int ph = 0; ph < NES_TRACE_PHASE_COUNT; ph++) ticks += t->phase_ticks[ph];
+    double us_per_tick = 1e6 / NesTrace_TicksPerSecond();
+    fprintf(out, "  time us   ");
+    for (int ph = 0; ph < NES_TRACE_PHASE_COUNT; ph++) {
+        fprintf(out, " %s %.1f (%.0f%%)", k_phases[ph],
+                per_frame(t, t->phase_ticks[ph]) * us_per_tick,
+                ticks ? 100.0 * (double)t->phase_ticks[ph] / (double)ticks : 0.0);
+    }
+    fputc('\n', out);
+}
+
+// ---------------------------------------------------------------------------
+// Execution trace file: "NESTRACE", u32 version, then one entry per record:
+//   u8 mask, opcode, operand bytes (NesTrace_OpLength - 1),
+//   zigzag varint cycle delta, then the fields named by mask.
+// PC is stored only when it is not the previous PC plus its instruction
+// length, registers only when they changed, and the PPU position only when
+// it is not the previous one advanced by 3 dots per CPU cycle.
+//
+// Every TRACE_SYNC_RECORDS records a TR_SYNC marker and the varint index of
+// the next record reset the previous record to all zeroes, so decoding can
+// start there. A mask of TR_END is the trailer: varint records, varint
+// dropped, the sync table (u64 offset, u64 index per marker) and a footer of
+// u64 sync count and u64 offset of the TR_END byte, all little-endian.
+
+enum {
+    TR_PC   = 0x01,
+    TR_A    = 0x02,
+    TR_X    = 0x04,
+    TR_Y    = 0x08,
+    TR_P    = 0x10,
+    TR_SP   = 0x20,
+    TR_PPU  = 0x40,
+    TR_END  = 0x80,
+    TR_SYNC = 0x81
+};
+
+enum {
+    TRACE_VERSION = 2,
+    TRACE_HEADER_BYTES = 12,    // magic, u32 version
+    TRACE_FOOTER_BYTES = 16,    // sync count, trailer offset
+    TRACE_SYNC_BYTES = 16,      // per sync table entry
+    TRACE_SYNC_RECORDS = 1u << 16,
+    TRACE_DEFAULT_RING = 1u << 18,
+    TRACE_BATCH = 256,          // records the CPU collects before touching the ring
+    TRACE_CHUNK = 4096,         // records the writer takes per read
+    TRACE_OUT_BYTES = 64 * 1024,
+    TRACE_OUT_SLACK = 64,       // worst case sync marker plus record is 11 + 25 bytes
+    TRACE_IDLE_NS = 1000000
+};
+
+static const char k_trace_magic[8] = { 'N', 'E', 'S', 'T', 'R', 'A', 'C', 'E' };
+
+struct NesTraceLog {
+    RingBuf ring;
+    FILE* f;
+    pthread_t thread;
+    atomic_bool stop;
+
+    // Emulation thread.
+    NesTraceRecord batch[TRACE_BATCH];
+    u32 batch_count;
+    u64 records;
+    u64 dropped;
+
+    // Writer thread.
+    NesTraceRecord chunk[TRACE_CHUNK];
+    NesTraceRecord prev;
+    u8 out[TRACE_OUT_BYTES];
+    u32 out_len;
+    u64 flushed;            // file bytes written before out
+    u64 encoded;            // records written to the file
+    u64* syncs;             // offset, index pairs for the trailer
+    u32 sync_count;
+    u32 sync_cap;
+    bool io_ok;
+};
+
+u32 NesTrace_OpLength(u8 opcode)
+{
+    switch (g_op_table[opcode].mode) {
+        case AM_IMP: case AM_ACC:
+            return 1;
+        case AM_ABS: case AM_ABX: case AM_ABY: case AM_IND:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+static void predict_ppu(const NesTraceRecord* prev, u64 cycle, s16* line, u16* dot)
+{
+    *line = prev->scanline;
+    *dot = prev->dot;
+    if (cycle < prev->cycle) return;    // a state load went back in time
+
+    u64 dots = (u64)prev->dot + (cycle - prev->cycle) * 3u;
+    u64 row = (u64)(prev->scanline + 1) + dots / 341u;
+    *line = (s16)((s64)(row % 262u) - 1);
+    *dot = (u16)(dots % 341u);
+}
+
+static u32 put_varint(u8* p, u64 v)
+{
+    u32 n = 0;
+    while (v >= 0x80u) {
+        p[n++] = (u8)(v | 0x80u);
+        v >>= 7;
+    }
+    p[n++] = (u8)v;
+    return n;
+}
+
+static u32 encode_record(u8* p, const NesTraceRecord* prev, const NesTraceRecord* r)
+{
+    u32 len = NesTrace_OpLength(r->opcode);
+    s16 line;
+    u16 dot;
+    predict_ppu(prev, r->cycle, &line, &dot);
+
+    u8 mask = 0;
+    if (r->pc != (u16)(prev->pc + NesTrace_OpLength(prev->opcode))) mask |= TR_PC;
+    if (r->a != prev->a) mask |= TR_A;
+    if (r->x != prev->x) mask |= TR_X;
+    if (r->y != prev->y) mask |= TR_Y;
+    if (r->p != prev->p) mask |= TR_P;
+    if (r->sp != prev->sp) mask |= TR_SP;
+    if (r->scanline != line || r->dot != dot) mask |= TR_PPU;
+
+    u32 n = 0;
+    p[n++] = mask;
+    p[n++] = r->opcode;
+    for (u32 i = 1; i < len; i++) p[n++] = r->operand[i - 1u];
+
+    s64 delta = (s64)(r->cycle - prev->cycle);
+    n += put_varint(p + n, ((u64)delta << 1) ^ (u64)(delta >> 63));
+
+    if (mask & TR_PC) {
+        p[n++] = (u8)r->pc;
+        p[n++] = (u8)(r->pc >> 8);
+    }
+    if (mask & TR_A) p[n++] = r->a;
+    if (mask & TR_X) p[n++] = r->x;
+    if (mask & TR_Y) p[n++] = r->y;
+    if (mask & TR_P) p[n++] = r->p;
+    if (mask & TR_SP) p[n++] = r->sp;
+    if (mask & TR_PPU) {
+        p[n++] = (u8)(u16)r->scanline;
+        p[n++] = (u8)((u16)r->scanline >> 8);
+        p[n++] = (u8)r->dot;
+        p[n++] = (u8)(r->dot >> 8);
+    }
+    return n;
+}
+
+static void put_u64(u8* p, u64 v)
+{
+    for (u32 i = 0; i < 8u; i++) p[i] = (u8)(v >> (i * 8u));
+}
+
+static u64 get_u64(const u8* p)
+{
+    u64 v = 0;
+    for (u32 i = 0; i < 8u; i++) v |= (u64)p[i] << (i * 8u);
+    return v;
+}
+
+static void flush_out(NesTraceLog* log)
+{
+    if (log->out_len && log->io_ok && fwrite(log->out, 1, log->out_len, log->f) != log->out_len) {
+        log->io_ok = false;
+    }
+    log->flushed += log->out_len;
+    log->out_len = 0;
+}
+
+// A marker the reader can restart from. Without room in the table it is
+// still written, just not indexed.
+static void write_sync(NesTraceLog* log)
+{
+    if (log->sync_count == log->sync_cap) {
+        u32 cap = log->sync_cap ? log->sync_cap * 2u : 256u;
+        u64* grown = (u64*)realloc(log->syncs, (size_t)cap * 2u * sizeof(u64));
+        if (grown) {
+            log->syncs = grown;
+            log->sync_cap = cap;
+        }
+    }
+    if (log->sync_count < log->sync_cap) {
+        log->syncs[log->sync_count * 2u] = log->flushed + log->out_len;
+        log->syncs[log->sync_count * 2u + 1u] = log->encoded;
+        log->sync_count++;
+    }
+    log->out[log->out_len++] = TR_SYNC;
+    log->out_len += put_varint(log->out + log->out_len, log->encoded);
+    memset(&log->prev, 0, sizeof(log->prev));
+}
+
+static void write_trailer(NesTraceLog* log)
+{
+    if (log->out_len > TRACE_OUT_BYTES - TRACE_OUT_SLACK) flush_out(log);
+    u64 end = log->flushed + log->out_len;
+    log->out[log->out_len++] = TR_END;
+    log->out_len += put_varint(log->out + log->out_len, log->records);
+    log->out_len += put_varint(log->out + log->out_len, log->dropped);
+
+    for (u32 i = 0; i < log->sync_count; i++) {
+        if (log->out_len > TRACE_OUT_BYTES - TRACE_OUT_SLACK) flush_out(log);
+        put_u64(log->out + log->out_len, log->syncs[i * 2u]);
+        put_u64(log->out + log->out_len + 8u, log->syncs[i * 2u + 1u]);
+        log->out_len += TRACE_SYNC_BYTES;
+    }
+    put_u64(log->out + log->out_len, log->sync_count);
+    put_u64(log->out + log->out_len + 8u, end);
+    log->out_len += TRACE_FOOTER_BYTES;
+    flush_out(log);
+}
+
+static void* writer_main(void* arg)
+{
+    NesTraceLog* log = (NesTraceLog*)arg;
+
+    for (;;) {
+        bool stopping = atomic_load_explicit(&log->stop, memory_order_acquire);
+        u32 n = RingBuf_Read(&log->ring, log->chunk, TRACE_CHUNK);
+        if (n == 0) {
+            if (stopping) break;
+            struct timespec ts = { 0, TRACE_IDLE_NS };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        for (u32 i = 0; i < n; i++) {
+            if (log->out_len > TRACE_OUT_BYTES - TRACE_OUT_SLACK) flush_out(log);
+            if (log->encoded && log->encoded % TRACE_SYNC_RECORDS == 0) write_sync(log);
+            log->out_len += encode_record(log->out + log->out_len, &log->prev, &log->chunk[i]);
+            log->prev = log->chunk[i];
+            log->encoded++;
+        }
+    }
+
+    // records/dropped were published before stop.
+    write_trailer(log);
+    return NULL;
+}
+
+NesTraceLog* NesTraceLog_Open(const char* path, u32 ring_records)
+{
+    if (!path) return NULL;
+
+    NesTraceLog* log = (NesTraceLog*)calloc(1, sizeof(NesTraceLog));
+    if (!log) return NULL;
+    if (!RingBuf_Init(&log->ring, ring_records ? ring_records : TRACE_DEFAULT_RING,
+                      (u32)sizeof(NesTraceRecord))) {
+        free(log);
+        return NULL;
+    }
+
+    log->f = fopen(path, "wb");
+    if (!log->f) {
+        RingBuf_Destroy(&log->ring);
+        free(log);
+        return NULL;
+    }
+
+    u8 version[4] = { TRACE_VERSION, 0, 0, 0 };
+    log->io_ok = fwrite(k_trace_magic, 1, sizeof(k_trace_magic), log->f) == sizeof(k_trace_magic) &&
+                 fwrite(version, 1, sizeof(version), log->f) == sizeof(version);
+    log->flushed = TRACE_HEADER_BYTES;
+    atomic_init(&log->stop, false);
+
+    if (!log->io_ok || pthread_create(&log->thread, NULL, writer_main, log) != 0) {
+        fclose(log->f);
+        RingBuf_Destroy(&log->ring);
+        free(log);
+        return NULL;
+    }
+    return log;
+}
+
+static void flush_batch(NesTraceLog* log)
+{
+    u32 n = RingBuf_Write(&log->ring, log->batch, log->batch_count);
+    log->dropped += log->batch_count - n;
+    log->batch_count = 0;
+}
+
+void NesTraceLog_Push(NesTraceLog* log, const NesTraceRecord* r)
+{
+    log->batch[log->batch_count++] = *r;
+    log->records++;
+    if (log->batch_count == TRACE_BATCH) flush_batch(log);
+}
+
+bool NesTraceLog_Close(NesTraceLog* log)
+{
+    if (!log) return false;
+
+    flush_batch(log);
+    atomic_store_explicit(&log->stop, true, memory_order_release);
+    pthread_join(log->thread, NULL);
+
+    bool ok = log->io_ok;
+    if (fclose(log->f) != 0) ok = false;
+    RingBuf_Destroy(&log->ring);
+    free(log->syncs);
+    free(log);
+    return ok;
+}
+
+u64 NesTraceLog_Records(const NesTraceLog* log)
+{
+    return log ? log->records : 0;
+}
+
+u64 NesTraceLog_Dropped(const NesTraceLog* log)
+{
+    return log ? log->dropped : 0;
+}
+
+static bool same_record(const NesTraceRecord* a, const NesTraceRecord* b)
+{
+    return a->cycle == b->cycle && a->pc == b->pc && a->scanline == b->scanline && a->dot == b->dot &&
+           a->opcode == b->opcode && a->operand[0] == b->operand[0] && a->operand[1] == b->operand[1] &&
+           a->a == b->a && a->x == b->x && a->y == b->y && a->p == b->p && a->sp == b->sp;
+}
+
+bool NesTraceReader_Open(NesTraceReader* r, const char* path)
+{
+    if (!r || !path) return false;
+    memset(r, 0, sizeof(*r));
+    if (!File_Map(path, &r->file)) return false;
+
+    const u8* d = r->file.data;
+    if (r->file.size < TRACE_HEADER_BYTES || memcmp(d, k_trace_magic, sizeof(k_trace_magic)) != 0 ||
+        d[8] != TRACE_VERSION) {
+        NesTraceReader_Close(r);
+        return false;
+    }
+    r->cursor = d + TRACE_HEADER_BYTES;
+
+    // The sync table, when the writer closed cleanly.
+    size_t size = r->file.size;
+    if (size >= TRACE_HEADER_BYTES + 1u + TRACE_FOOTER_BYTES) {
+        u64 count = get_u64(d + size - TRACE_FOOTER_BYTES);
+        u64 end = get_u64(d + size - 8u);
+        u64 room = size - TRACE_FOOTER_BYTES;
+        if (end >= TRACE_HEADER_BYTES && end < room && d[end] == TR_END &&
+            count <= (room - end - 1u) / TRACE_SYNC_BYTES) {
+            r->syncs = d + room - count * TRACE_SYNC_BYTES;
+            r->sync_count = count;
+        }
+    }
+    return true;
+}
+
+static bool get_byte(NesTraceReader* r, u8* out)
+{
+    if (r->cursor == r->file.data + r->file.size) return false;
+    *out = *r->cursor++;
+    return true;
+}
+
+static bool get_u16(NesTraceReader* r, u16* out)
+{
+    u8 lo, hi;
+    if (!get_byte(r, &lo) || !get_byte(r, &hi)) return false;
+    *out = (u16)(lo | (hi << 8));
+    return true;
+}
+
+static bool get_varint(NesTraceReader* r, u64* out)
+{
+    u64 v = 0;
+    for (u32 shift = 0; shift < 64u; shift += 7u) {
+        u8 b;
+        if (!get_byte(r, &b)) return false;
+        v |= (u64)(b & 0x7Fu) << shift;
+        if (!(b & 0x80u)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NesTraceReader_Next(NesTraceReader* r, NesTraceRecord* out)
+{
+    if (!r || !r->cursor || !out) return false;
+
+    u8 mask;
+    if (!get_byte(r, &mask)) return false;
+    while (mask == TR_SYNC) {
+        if (!get_varint(r, &r->index) || !get_byte(r, &mask)) return false;
+        memset(&r->prev, 0, sizeof(r->prev));
+    }
+    if (mask == TR_END) {
+        r->complete = get_varint(r, &r->records) && get_varint(r, &r->dropped);
+        r->cursor--;    // stay on the trailer
+        return false;
+    }
+
+    const NesTraceRecord* prev = &r->prev;
+    NesTraceRecord rec = *prev;
+    rec.operand[0] = rec.operand[1] = 0;
+    if (!get_byte(r, &rec.opcode)) return false;
+    u32 len = NesTrace_OpLength(rec.opcode);
+    for (u32 i = 1; i < len; i++) {
+        if (!get_byte(r, &rec.operand[i - 1u])) return false;
+    }
+
+    u64 zz;
+    if (!get_varint(r, &zz)) return false;
+    s64 delta = (s64)(zz >> 1) ^ -(s64)(zz & 1u);
+    rec.cycle = prev->cycle + (u64)delta;
+
+    rec.pc = (u16)(prev->pc + NesTrace_OpLength(prev->opcode));
+    predict_ppu(prev, rec.cycle, &rec.scanline, &rec.dot);
+
+    bool ok = true;
+    if (mask & TR_PC) ok = ok && get_u16(r, &rec.pc);
+    if (mask & TR_A) ok = ok && get_byte(r, &rec.a);
+    if (mask & TR_X) ok = ok && get_byte(r, &rec.x);
+    if (mask & TR_Y) ok = ok && get_byte(r, &rec.y);
+    if (mask & TR_P) ok = ok && get_byte(r, &rec.p);
+    if (mask & TR_SP) ok = ok && get_byte(r, &rec.sp);
+    if (mask & TR_PPU) {
+        u16 line;
+        ok = ok && get_u16(r, &line) && get_u16(r, &rec.dot);
+        rec.scanline = (s16)line;
+    }
+    if (!ok) return false;
+
+    r->prev = rec;
+    r->index++;
+    *out = rec;
+    return true;
+}
+
+static u64 sync_offset(const NesTraceReader* r, u64 k)
+{
+    return get_u64(r->syncs + k * TRACE_SYNC_BYTES);
+}
+
+static u64 sync_index(const NesTraceReader* r, u64 k)
+{
+    return get_u64(r->syncs + k * TRACE_SYNC_BYTES + 8u);
+}
+
+// Decoding restarts at sync entry k, or at the first record when k is the
+// table size (no sync point qualified).
+static void restart(NesTraceReader* r, u64 k)
+{
+    memset(&r->prev, 0, sizeof(r->prev));
+    r->index = 0;
+    r->cursor = r->file.data + TRACE_HEADER_BYTES;
+    if (k < r->sync_count && r->file.data[sync_offset(r, k)] == TR_SYNC) {
+        r->cursor = r->file.data + sync_offset(r, k);
+        r->index = sync_index(r, k);
+    }
+}
+
+bool NesTraceReader_Seek(NesTraceReader* r, u64 index)
+{
+    if (!r || !r->cursor) return false;
+
+    // Last entry at or before index; the table is in file order.
+    u64 lo = 0, hi = r->sync_count;
+    while (lo < hi) {
+        u64 mid = lo + (hi - lo) / 2u;
+        if (sync_index(r, mid) <= index) lo = mid + 1u;
+        else hi = mid;
+    }
+    restart(r, lo ? lo - 1u : r->sync_count);
+    return true;
+}
+
+void NesTraceReader_Close(NesTraceReader* r)
+{
+    if (!r) return;
+    File_Unmap(&r->file);
+    r->cursor = NULL;
+}
+
+bool NesTrace_Diff(const char* path_a, const char* path_b, NesTraceDiff* out)
+{
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+
+    NesTraceReader ra, rb;
+    if (!NesTraceReader_Open(&ra, path_a)) return false;
+    if (!NesTraceReader_Open(&rb, path_b)) {
+        NesTraceReader_Close(&ra);
+        return false;
+    }
+
+    size_t na = ra.file.size, nb = rb.file.size;
+    size_t at = Mem_FirstDiff(ra.file.data, rb.file.data, na < nb ? na : nb);
+
+    // Both streams decode identically up to byte `at`, so a sync marker
+    // before it sits at the same offset in both and decoding starts there.
+    u64 lo = 0, hi = ra.sync_count;
+    while (lo < hi) {
+        u64 mid = lo + (hi - lo) / 2u;
+        if (sync_offset(&ra, mid) < at) lo = mid + 1u;
+        else hi = mid;
+    }
+    if (lo) {
+        restart(&ra, lo - 1u);
+        rb.cursor = rb.file.data + (ra.cursor - ra.file.data);
+    }
+
+    // Records that end before `at` are only decoded to stay in step.
+    NesTraceRecord a, b;
+    for (;;) {
+        out->index = ra.index;
+        out->has_a = NesTraceReader_Next(&ra, &a);
+        out->has_b = NesTraceReader_Next(&rb, &b);
+        if (out->has_a) out->index = ra.index - 1u;
+        if (!out->has_a || !out->has_b) break;
+        if ((size_t)(ra.cursor - ra.file.data) > at && !same_record(&a, &b)) break;
+    }
+
+    out->diverged = out->has_a || out->has_b;
+    if (out->has_a) out->a = a;
+    if (out->has_b) out->b = b;
+
+    NesTraceReader_Close(&ra);
+    NesTraceReader_Close(&rb);
+    return true;
+}
+
+int NesTrace_FormatNestest(const NesTraceRecord* r, char* out, size_t cap)
+{
+    if (!r || !out || cap == 0) return 0;
+
+    const OpInfo* op = &g_op_table[r->opcode];
+    const char* name = op->name ? op->name : "???";
+    u8 lo = r->operand[0];
+    u16 abs = (u16)(lo | (r->operand[1] << 8));
+
+    char bytes[12];
+    switch (NesTrace_OpLength(r->opcode)) {
+        case 1: snprintf(bytes, sizeof(bytes), "%02X", r->opcode); break;
+        case 2: snprintf(bytes, sizeof(bytes), "%02X %02X", r->opcode, lo); break;
+        default: snprintf(bytes, sizeof(bytes), "%02X %02X %02X", r->opcode, lo, r->operand[1]); break;
+    }
+
+    char dis[40];
+    switch (op->mode) {
+        case AM_IMP: snprintf(dis, sizeof(dis), "%s", name); break;
+        case AM_ACC: snprintf(dis, sizeof(dis), "%s A", name); break;
+        case AM_IMM: snprintf(dis, sizeof(dis), "%s #$%02X", name, lo); break;
+        case AM_ZP:  snprintf(dis, sizeof(dis), "%s $%02X", name, lo); break;
+        case AM_ZPX: snprintf(dis, sizeof(dis), "%s $%02X,X", name, lo); break;
+        case AM_ZPY: snprintf(dis, sizeof(dis), "%s $%02X,Y", name, lo); break;
+        case AM_REL: snprintf(dis, sizeof(dis), "%s $%04X", name, (u16)(r->pc + 2 + (s8)lo)); break;
+        case AM_ABS: snprintf(dis, sizeof(dis), "%s $%04X", name, abs); break;
+        case AM_ABX: snprintf(dis, sizeof(dis), "%s $%04X,X", name, abs); break;
+        case AM_ABY: snprintf(dis, sizeof(dis), "%s $%04X,Y", name, abs); break;
+        case AM_IND: snprintf(dis, sizeof(dis), "%s ($%04X)", name, abs); break;
+        case AM_IZX: snprintf(dis, sizeof(dis), "%s ($%02X,X)", name, lo); break;
+        case AM_IZY: snprintf(dis, sizeof(dis), "%s ($%02X),Y", name, lo); break;
+    }
+
+    return snprintf(out, cap, "%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d CYC:%llu",
+                    r->pc, bytes, dis, r->a, r->x, r->y, r->p, r->sp,
+                    r->scanline, r->dot, (unsigned long long)r->cycle);
+}
@@ -0,0 +1,291 @@
+#include "nes/frontend/emu_thread.h"
+#include "nes/log.h"
+#include "nes/debug/timeline.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    AUDIO_CHUNK     = 2048,
+    MIN_WORK_NS     = 2000000,  // frame delay never eats into the last 2 ms
+    MAX_PRESENT_GAP_NS = 250000000,
+    NES_SCANLINES   = 262
+};
+
+// Moving average with a 1/16 weight for the newest sample.
+static void ema_update(_Atomic u64* avg, u64 sample)
+{
+    u64 prev = atomic_load_explicit(avg, memory_order_relaxed);
+    u64 next = prev ? prev - prev / 16u + sample / 16u : sample;
+    atomic_store_explicit(avg, next, memory_order_relaxed);
+}
+
+static void push_audio(EmuThread* t)
+{
+    s16 samples[AUDIO_CHUNK];
+    s16 resampled[AUDIO_CHUNK + AUDIO_CHUNK / 32];
+    int got;
+
+    while ((got = NES_ReadAudio(t->nes, samples, AUDIO_CHUNK)) > 0) {
+        if (!t->audio) continue;
+        Resampler_SetRatio(&t->drc, Resampler_DRCRatio(SdlAudio_Queued(t->audio), t->audio->target_depth));
+        u32 n = Resampler_Process(&t->drc, samples, (u32)got, resampled, (u32)(sizeof(resampled) / sizeof(resampled[0])));
+        SdlAudio_Push(t->audio, resampled, n);
+    }
+}
+
+static NesInput load_input(const EmuThread* t)
+{
+    u32 in = atomic_load_explicit(&t->input, memory_order_relaxed);
+    NesInput r = { (u8)in, (u8)(in >> 8) };
+    return r;
+}
+
+// Input provider: runs on this thread when the game first strobes the pads,
+// so it sees the newest state the render thread has published.
+static NesInput poll_input(void* user)
+{
+    EmuThread* t = (EmuThread*)user;
+    t->input_ns = NesClock_Now();
+    return load_input(t);
+}
+
+// Scanline callback: copies out finished slices, then holds emulation back
+// to the raster position of the row (the pre-render line comes first).
+static void on_scanline(void* user, int y)
+{
+    EmuThread* t = (EmuThread*)user;
+    if (!t->beam_on) return;
+
+    int start = t->beam_slice * NES_FB_H / t->beam_slices;
+    int end = (t->beam_slice + 1) * NES_FB_H / t->beam_slices;
+    if (y + 1 < end) return;
+
+    EmuBeam* beam = t->beam;
+    u64 frame = t->nes->frame_count + 1u;
+    size_t off = (size_t)start * NES_FB_W;
+    memcpy(beam->fb[frame & 1u] + off, NES_ScanlineBuffer(t->nes) + off,
+           (size_t)(end - start) * NES_FB_W * sizeof(u32));
+
+    EmuBeamSlice* s = &beam->slices[frame & 1u][t->beam_slice];
+    atomic_store_explicit(&s->done_ns, NesClock_Now(), memory_order_relaxed);
+    atomic_store_explicit(&s->input_ns, t->input_ns, memory_order_relaxed);
+    t->beam_slice++;
+    atomic_store_explicit(&beam->pos, frame << 16 | (u64)t->beam_slice << 8 | (u64)end, memory_order_release);
+
+    double raster = (double)(y + 2) * t->clock.period_ns / (double)NES_SCANLINES;
+    NesClock_SleepUntil(&t->clock, t->beam_start_ns + (u64)raster);
+}
+
+// Switches between real time and fast-forward. Fast-forward mutes audio (the
+// device holds its last level) rather than stretching it.
+static void apply_speed(EmuThread* t, u32 speed, NesClock* fast)
+{
+    NES_PauseAudio(t->nes, speed != 1u);
+    if (speed == 1u) {
+        Resampler_Clear(&t->drc);
+    } else if (speed > 1u) {
+        NesClock_Init(fast, 1e9 * (double)speed / t->clock.period_ns, t->clock.spin_ns);
+    }
+}
+
+static int SDLCALL emu_main(void* user)
+{
+    EmuThread* t = (EmuThread*)user;
+    Nes* nes = t->nes;
+    NesTimeline_AttachThread("emulation");     // no-op unless the timeline is on
+    const NesClock* clock = &t->clock;
+    NesJitter jitter = { 0 };
+
+    u32 speed = 1u;
+    NesClock fast = *clock;     // fast-forward grid at N x
+    u64 fast_k = 0;
+    u64 min_gap = (u64)clock->period_ns;  // fast-forward: between published frames
+    u64 last_publish = 0;
+
+    u64 k = NesClock_FrameAt(clock, NesClock_Now());
+    while (!atomic_load_explicit(&t->quit, memory_order_acquire)) {
+        u32 want = atomic_load_explicit(&t->speed, memory_order_relaxed);
+        if (want != speed) {
+            speed = want;
+            apply_speed(t, speed, &fast);
+            fast_k = 0;
+            k = NesClock_FrameAt(clock, NesClock_Now());
+        }
+
+        // Fast-forward only draws a frame when the last one is min_gap old,
+        // so presenting never limits the emulation rate.
+        bool draw = true;
+        if (speed == 1u) {
+            u64 late = NesClock_SleepUntil(clock, NesClock_Deadline(clock, k) + t->frame_delay_ns);
+            NesJitter_Add(&jitter, late);
+        } else {
+            if (speed > 1u) {
+                u64 late = NesClock_SleepUntil(&fast, NesClock_Deadline(&fast, fast_k));
+                fast_k = late > (u64)fast.period_ns ? NesClock_FrameAt(&fast, NesClock_Now()) : fast_k + 1u;
+            }
+            u64 est = atomic_load_explicit(&t->emulate_ns, memory_order_relaxed);
+            draw = NesClock_Now() + est >= last_publish + min_gap;
+        }
+        NES_SetSkipRender(nes, !draw);
+        t->beam_on = t->beam && speed == 1u;
+        t->beam_slice = 0;
+        t->beam_start_ns = NesClock_Deadline(clock, k);
+
+        u64 t_in = NesClock_Now();
+        t->input_ns = t_in;     // frames that never read the pads
+        NES_RunFrame(nes);
+        u64 t_run = NesClock_Now();
+        NES_TIMELINE_BEGIN(tl_audio);
+        push_audio(t);
+        NES_TIMELINE_END(tl_audio, "audio push");
+        u64 t_audio = NesClock_Now();
+
+        if (t->movie && !NesMovie_RecordFrame(t->movie, nes, nes->input)) {
+            NES_LOGE("Movie recording stopped (write error)");
+            NesMovie_RecordEnd(t->movie);
+            t->movie = NULL;
+        }
+
+        if (draw) {
+            NES_TIMELINE_BEGIN(tl_publish);
+            EmuFrame* f = (EmuFrame*)TripleBuf_Back(&t->frames);
+            f->frame = nes->frame_count;
+            f->input_ns = t->input_ns;
+            memcpy(f->fb, NES_Framebuffer(nes), sizeof(f->fb));
+            f->done_ns = NesClock_Now();
+            last_publish = f->done_ns;
+
+            // A frame superseded before it was shown means the render side
+            // is the bottleneck: back off, then ease back to the frame rate.
+            if (!TripleBuf_Publish(&t->frames)) {
+                min_gap = min_gap * 2u < MAX_PRESENT_GAP_NS ? min_gap * 2u : MAX_PRESENT_GAP_NS;
+            } else if (min_gap > (u64)clock->period_ns) {
+                min_gap -= min_gap / 8u;
+                if (min_gap < (u64)clock->period_ns) min_gap = (u64)clock->period_ns;
+            }
+            NES_TIMELINE_END(tl_publish, "publish");
+        }
+
+        atomic_fetch_add_explicit(&t->frames_emulated, 1u, memory_order_relaxed);
+        ema_update(&t->emulate_ns, t_run - t_in);
+        ema_update(&t->audio_ns, t_audio - t_run);
+        atomic_store_explicit(&t->late_avg_ns, jitter.avg_ns, memory_order_relaxed);
+        atomic_store_explicit(&t->late_max_ns, jitter.max_ns, memory_order_relaxed);
+
+        // A frame that overran its slot is not made up; resume on the grid.
+        if (speed == 1u) {
+            u64 next = NesClock_FrameAt(clock, NesClock_Now());
+            if (next > k + 1u) {
+                atomic_fetch_add_explicit(&t->frames_skipped, next - k - 1u, memory_order_relaxed);
+                k = next;
+            } else {
+                k++;
+            }
+        }
+    }
+
+    NES_SetSkipRender(nes, false);
+    NES_PauseAudio(nes, false);
+    NesTimeline_DetachThread();
+    return 0;
+}
+
+bool EmuThread_Start(EmuThread* t, Nes* nes, SdlAudio* audio, NesMovieRecorder* movie,
+                     const NesClock* clock, u64 frame_delay_ns, int beam_slices)
+{
+    if (!t || !nes || !clock) return false;
+    if (beam_slices < 0 || beam_slices > EMU_BEAM_MAX_SLICES) return false;
+    memset(t, 0, sizeof(*t));
+
+    t->nes = nes;
+    t->audio = audio;
+    t->movie = movie;
+    t->clock = *clock;
+
+    u64 max_delay = (u64)clock->period_ns > MIN_WORK_NS ? (u64)clock->period_ns - MIN_WORK_NS : 0u;
+    t->frame_delay_ns = frame_delay_ns < max_delay ? frame_delay_ns : max_delay;
+    if (beam_slices > 0) t->frame_delay_ns = 0;
+
+    if (audio) {
+        double rate = (double)audio->sample_rate;
+        if (!Resampler_Init(&t->drc, rate, rate, AUDIO_CHUNK)) return false;
+    }
+    t->input_ns = 0;
+    atomic_init(&t->input, (u32)nes->input.p1 | ((u32)nes->input.p2 << 8));
+    atomic_init(&t->speed, 1u);
+    atomic_init(&t->quit, false);
+    atomic_init(&t->frames_emulated, 0u);
+    atomic_init(&t->emulate_ns, 0u);
+    atomic_init(&t->audio_ns, 0u);
+    atomic_init(&t->late_avg_ns, 0u);
+    atomic_init(&t->late_max_ns, 0u);
+    atomic_init(&t->frames_skipped, 0u);
+
+    if (beam_slices > 0) {
+        t->beam = (EmuBeam*)calloc(1, sizeof(EmuBeam));
+        if (t->beam) atomic_init(&t->beam->pos, 0u);
+        t->beam_slices = beam_slices;
+    }
+    if (!TripleBuf_Init(&t->frames, sizeof(EmuFrame)) || (beam_slices > 0 && !t->beam)) {
+        NES_LOGE("EmuThread: out of memory");
+        TripleBuf_Destroy(&t->frames);
+        free(t->beam);
+        Resampler_Destroy(&t->drc);
+        return false;
+    }
+
+    NES_SetInputProvider(nes, poll_input, t);
+    if (t->beam) NES_SetScanlineCallback(nes, on_scanline, t);
+    t->thread = SDL_CreateThread(emu_main, "emulation", t);
+    if (!t->thread) {
+        NES_LOGE("SDL_CreateThread failed: %s", SDL_GetError());
+        NES_SetInputProvider(nes, NULL, NULL);
+        NES_SetScanlineCallback(nes, NULL, NULL);
+        TripleBuf_Destroy(&t->frames);
+        free(t->beam);
+        Resampler_Destroy(&t->drc);
+        return false;
+    }
+    return true;
+}
+
+void EmuThread_Stop(EmuThread* t)
+{
+    if (!t || !t->thread) return;
+
+    atomic_store_explicit(&t->quit, true, memory_order_release);
+    SDL_WaitThread(t->thread, NULL);
+    t->thread = NULL;
+    NES_SetInputProvider(t->nes, NULL, NULL);
+    NES_SetScanlineCallback(t->nes, NULL, NULL);
+    TripleBuf_Destroy(&t->frames);
+    free(t->beam);
+    t->beam = NULL;
+    Resampler_Destroy(&t->drc);
+}
+
+void EmuThread_SetInput(EmuThread* t, NesInput input)
+{
+    atomic_store_explicit(&t->input, (u32)input.p1 | ((u32)input.p2 << 8), memory_order_relaxed);
+}
+
+void EmuThread_SetSpeed(EmuThread* t, u32 speed)
+{
+    atomic_store_explicit(&t->speed, speed, memory_order_relaxed);
+}
+
+const EmuFrame* EmuThread_LatestFrame(EmuThread* t, bool* fresh)
+{
+    return (const EmuFrame*)TripleBuf_Acquire(&t->frames, fresh);
+}
+
+void EmuThread_GetStats(const EmuThread* t, EmuThreadStats* out)
+{
+    out->frames_emulated = atomic_load_explicit(&t->frames_emulated, memory_order_relaxed);
+    out->frames_dropped = atomic_load_explicit(&t->frames.dropped, memory_order_relaxed);
+    out->emulate_ns = atomic_load_explicit(&t->emulate_ns, memory_order_relaxed);
+    out->audio_ns = atomic_load_explicit(&t->audio_ns, memory_order_relaxed);
+    out->late_avg_ns = atomic_load_explicit(&t->late_avg_ns, memory_order_relaxed);
+    out->late_max_ns = atomic_load_explicit(&t->late_max_ns, memory_order_relaxed);
+    out->frames_skipped = atomic_load_explicit(&t->frames_skipped, memory_order_relaxed);
+}
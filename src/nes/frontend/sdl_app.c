@@ -1,5 +1,6 @@
 #include "nes/frontend/sdl_app.h"
 #include "nes/log.h"
+#include "nes/debug/timeline.h"
 
 static void set_key_p1(NesInput* in, SDL_Keycode key, bool down)
 {
@@ -35,6 +36,8 @@ bool SdlApp_Init(SdlApp* app, const char* title, int fb_w, int fb_h, int scale)
 {
     if (!app) return false;
     app->quit = false;
+    app->show_stats = false;
+    app->turbo = false;
     app->input.p1 = 0;
     app->input.p2 = 0;
 
@@ -62,6 +65,7 @@ void SdlApp_Poll(SdlApp* app)
 {
     if (!app) return;
 
+    NES_TIMELINE_BEGIN(tl_poll);
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         switch (e.type) {
@@ -71,6 +75,8 @@ void SdlApp_Poll(SdlApp* app)
 
             case SDL_EVENT_KEY_DOWN:
                 if (e.key.key == SDLK_ESCAPE) app->quit = true;
+                if (e.key.key == SDLK_F1 && !e.key.repeat) app->show_stats = !app->show_stats;
+                if (e.key.key == SDLK_TAB && !e.key.repeat) app->turbo = !app->turbo;
                 set_key_p1(&app->input, e.key.key, true);
                 set_key_p2(&app->input, e.key.key, true);
                 break;
@@ -84,4 +90,5 @@ void SdlApp_Poll(SdlApp* app)
                 break;
         }
     }
+    NES_TIMELINE_END(tl_poll, "poll");
 }
@@ -0,0 +1,83 @@
+#include "nes/frontend/sdl_audio.h"
+#include "nes/log.h"
+#include <string.h>
+
+// SDL asks for `additional` bytes; hand over what the ring holds and hold the
+// last level for the rest so an underrun is a gap, not a click.
+static void SDLCALL audio_callback(void* user, SDL_AudioStream* stream, int additional, int total)
+{
+    SdlAudio* a = (SdlAudio*)user;
+    s16 buf[512];
+    u32 want = (u32)(additional > 0 ? additional : 0) / (u32)sizeof(s16);
+
+    while (want > 0u) {
+        u32 chunk = (want < 512u) ? want : 512u;
+        u32 got = RingBuf_Read(&a->ring, buf, chunk);
+        if (got > 0u) a->last = buf[got - 1u];
+        for (u32 i = got; i < chunk; i++) buf[i] = a->last;
+
+        SDL_PutAudioStreamData(stream, buf, (int)(chunk * sizeof(s16)));
+        want -= chunk;
+    }
+}
+
+bool SdlAudio_Init(SdlAudio* a, int sample_rate, int latency_ms)
+{
+    if (!a) return false;
+    memset(a, 0, sizeof(*a));
+    if (sample_rate <= 0) return false;
+
+    if (latency_ms < SDLAUDIO_MIN_LATENCY_MS) latency_ms = SDLAUDIO_MIN_LATENCY_MS;
+    a->sample_rate = sample_rate;
+    a->latency_ms = latency_ms;
+
+    // The ring holds the target depth plus a video frame's burst of samples.
+    u32 depth = (u32)((s64)sample_rate * latency_ms / 1000);
+    u32 burst = (u32)(sample_rate / 50);
+    a->target_depth = depth;
+    if (!RingBuf_Init(&a->ring, depth + burst, sizeof(s16))) {
+        NES_LOGE("SdlAudio: out of memory");
+        return false;
+    }
+
+    // Keep the device period well under the target depth.
+    char frames[16];
+    SDL_snprintf(frames, sizeof(frames), "%u", depth / 2u > 64u ? depth / 2u : 64u);
+    SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, frames);
+
+    SDL_AudioSpec spec;
+    spec.format = SDL_AUDIO_S16;
+    spec.channels = 1;
+    spec.freq = sample_rate;
+
+    a->stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, audio_callback, a);
+    if (!a->stream) {
+        NES_LOGE("SDL_OpenAudioDeviceStream failed: %s", SDL_GetError());
+        RingBuf_Destroy(&a->ring);
+        return false;
+    }
+
+    SDL_ResumeAudioStreamDevice(a->stream);
+    return true;
+}
+
+void SdlAudio_Shutdown(SdlAudio* a)
+{
+    if (!a) return;
+
+    // Destroying the stream closes the device and stops the callback first.
+    if (a->stream) SDL_DestroyAudioStream(a->stream);
+    a->stream = NULL;
+    RingBuf_Destroy(&a->ring);
+}
+
+u32 SdlAudio_Push(SdlAudio* a, const s16* samples, u32 count)
+{
+    if (!a || !a->stream) return 0;
+    return RingBuf_Write(&a->ring, samples, count);
+}
+
+u32 SdlAudio_Queued(const SdlAudio* a)
+{
+    return (a && a->stream) ? RingBuf_Count(&a->ring) : 0u;
+}
@@ -1,5 +1,7 @@
 #include "nes/frontend/sdl_video.h"
 #include "nes/log.h"
+#include "nes/debug/timeline.h"
+#include <string.h>
 
 bool SdlVideo_Init(SdlVideo* v, const char* title, int w, int h, int scale)
 {
@@ -10,6 +12,10 @@ bool SdlVideo_Init(SdlVideo* v, const char* title, int w, int h, int scale)
     v->texture = NULL;
     v->tex_w = w;
     v->tex_h = h;
+    v->overlay[0] = '\0';
+    FrameDiff_Reset(&v->diff);
+    v->upload_bytes = 0;
+    v->uploads_skipped = 0;
 
     int win_w = w * (scale > 0 ? scale : 3);
     int win_h = h * (scale > 0 ? scale : 3);
@@ -67,22 +73,126 @@ void SdlVideo_Shutdown(SdlVideo* v)
     v->window = NULL;
 }
 
-bool SdlVideo_PresentARGB(SdlVideo* v, const u32* argb_pixels, int w, int h)
+bool SdlVideo_SetVSync(SdlVideo* v, bool on)
 {
-    if (!v || !v->renderer || !v->texture) return false;
-    if (!argb_pixels) return false;
-    if (w != v->tex_w || h != v->tex_h) return false;
+    if (!v || !v->renderer) return false;
+    if (!SDL_SetRenderVSync(v->renderer, on ? 1 : 0)) {
+        NES_LOGE("SDL_SetRenderVSync failed: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+static void draw_overlay(SdlVideo* v)
+{
+    if (v->overlay[0] == '\0') return;
+
+    // SDL's built-in 8x8 debug font, on a translucent backing.
+    enum { LINE_H = 10, CHAR_W = 8, MARGIN = 4 };
+    int lines = 1;
+    int width = 0;
+    int col = 0;
+    for (const char* c = v->overlay; *c; c++) {
+        if (*c == '\n') {
+            lines++;
+            col = 0;
+        } else if (++col > width) {
+            width = col;
+        }
+    }
 
-    const int pitch = w * (int)sizeof(u32);
+    SDL_FRect bg = { 0.0f, 0.0f, (float)(width * CHAR_W + 2 * MARGIN), (float)(lines * LINE_H + 2 * MARGIN) };
+    SDL_SetRenderDrawBlendMode(v->renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(v->renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(v->renderer, &bg);
+
+    SDL_SetRenderDrawColor(v->renderer, 255, 255, 255, 255);
+    char line[128];
+    const char* c = v->overlay;
+    for (int i = 0; i < lines; i++) {
+        size_t n = 0;
+        while (c[n] && c[n] != '\n' && n + 1 < sizeof(line)) {
+            line[n] = c[n];
+            n++;
+        }
+        line[n] = '\0';
+        SDL_RenderDebugText(v->renderer, (float)MARGIN, (float)(MARGIN + i * LINE_H), line);
+
+        c += n;
+        while (*c && *c != '\n') c++;
+        if (*c == '\n') c++;
+    }
+}
 
-    if (!SDL_UpdateTexture(v->texture, NULL, argb_pixels, pitch)) {
+// Copies rows [first, last] straight into the locked texture (one copy,
+// where SDL_UpdateTexture would stage it first). Locked pixels are
+// write-only, so the whole rect is written.
+static bool upload_rows(SdlVideo* v, const u32* src, int first, int last)
+{
+    SDL_Rect rect = { 0, first, v->tex_w, last - first + 1 };
+    size_t row_bytes = (size_t)v->tex_w * sizeof(u32);
+    const u8* from = (const u8*)(src + (size_t)first * (size_t)v->tex_w);
+
+    void* dst = NULL;
+    int pitch = 0;
+    NES_TIMELINE_BEGIN(tl_upload);
+    if (SDL_LockTexture(v->texture, &rect, &dst, &pitch)) {
+        if ((size_t)pitch == row_bytes) {
+            memcpy(dst, from, row_bytes * (size_t)rect.h);
+        } else {
+            for (int y = 0; y < rect.h; y++) {
+                memcpy((u8*)dst + (size_t)y * (size_t)pitch, from + (size_t)y * row_bytes, row_bytes);
+            }
+        }
+        SDL_UnlockTexture(v->texture);
+    } else if (!SDL_UpdateTexture(v->texture, &rect, from, (int)row_bytes)) {
         NES_LOGE("SDL_UpdateTexture failed: %s", SDL_GetError());
         return false;
     }
+    NES_TIMELINE_END_ARG(tl_upload, "upload", rect.h);
 
+    v->upload_bytes += row_bytes * (size_t)rect.h;
+    return true;
+}
+
+static void render_present(SdlVideo* v)
+{
+    NES_TIMELINE_BEGIN(tl_present);
     SDL_RenderClear(v->renderer);
     SDL_RenderTexture(v->renderer, v->texture, NULL, NULL);
+    draw_overlay(v);
     SDL_RenderPresent(v->renderer);
+    NES_TIMELINE_END(tl_present, "present");
+}
+
+bool SdlVideo_PresentARGB(SdlVideo* v, const u32* argb_pixels, int w, int h)
+{
+    if (!v || !v->renderer || !v->texture) return false;
+    if (!argb_pixels) return false;
+    if (w != v->tex_w || h != v->tex_h) return false;
+
+    int first = 0;
+    int last = 0;
+    if (FrameDiff_Update(&v->diff, argb_pixels, w, h, &first, &last) == 0) {
+        v->uploads_skipped++;
+    } else if (!upload_rows(v, argb_pixels, first, last)) {
+        FrameDiff_Reset(&v->diff);
+        return false;
+    }
+
+    render_present(v);
+    return true;
+}
+
+bool SdlVideo_PresentRows(SdlVideo* v, const u32* argb_pixels, int first, int last)
+{
+    if (!v || !v->renderer || !v->texture) return false;
+    if (!argb_pixels || first < 0 || last < first || last >= v->tex_h) return false;
+
+    // The texture now mixes frames; the next full present uploads everything.
+    FrameDiff_Reset(&v->diff);
+    if (!upload_rows(v, argb_pixels, first, last)) return false;
 
+    render_present(v);
     return true;
 }
@@ -0,0 +1,185 @@
+#include "nes/libnes.h"
+#include "nes/movie.h"
+#include "nes/nes.h"
+#include "nes/state.h"
+#include "nes/util/hash.h"
+#include <stdlib.h>
+
+_Static_assert((int)LIBNES_FB_W == (int)NES_FB_W && (int)LIBNES_FB_H == (int)NES_FB_H, "framebuffer size");
+_Static_assert(LIBNES_RAM_SIZE == sizeof(((Bus*)0)->ram), "RAM size");
+
+struct LibNes {
+    Nes nes;
+    NesMoviePlayer movie;
+    LibNesMovieState movie_state;
+};
+
+static void close_movie(LibNes* h)
+{
+    if (h->movie_state != LIBNES_MOVIE_NONE) NesMovie_Close(&h->movie);
+    h->movie_state = LIBNES_MOVIE_NONE;
+}
+
+int LibNes_APIVersion(void)
+{
+    return LIBNES_API_VERSION;
+}
+
+LibNes* LibNes_Create(void)
+{
+    LibNes* h = (LibNes*)calloc(1, sizeof(LibNes));
+    if (!h) return NULL;
+
+    if (!NES_Init(&h->nes)) {
+        free(h);
+        return NULL;
+    }
+    h->nes.quiet = true;
+    return h;
+}
+
+void LibNes_Destroy(LibNes* h)
+{
+    if (!h) return;
+    close_movie(h);
+    NES_Destroy(&h->nes);
+    free(h);
+}
+
+bool LibNes_LoadROM(LibNes* h, const char* path)
+{
+    if (!h || !path) return false;
+    close_movie(h);
+    if (!NES_LoadROM(&h->nes, path)) return false;
+    NES_Reset(&h->nes);
+    return true;
+}
+
+bool LibNes_LoadROMFromMemory(LibNes* h, const void* rom, size_t size)
+{
+    if (!h || !rom) return false;
+    close_movie(h);
+    if (!NES_LoadROMFromMemory(&h->nes, (const u8*)rom, size)) return false;
+    NES_Reset(&h->nes);
+    return true;
+}
+
+void LibNes_Reset(LibNes* h)
+{
+    if (!h) return;
+    NES_Reset(&h->nes);
+}
+
+void LibNes_SetInput(LibNes* h, uint8_t p1, uint8_t p2)
+{
+    if (!h) return;
+    h->nes.input.p1 = p1;
+    h->nes.input.p2 = p2;
+}
+
+uint64_t LibNes_RunFrames(LibNes* h, uint64_t frames)
+{
+    if (!h || !h->nes.cart.mapper) return 0;
+
+    uint64_t done = 0;
+    while (done < frames && !h->nes.cpu.jammed) {
+        if (h->movie_state == LIBNES_MOVIE_PLAYING) {
+            if (!NesMovie_NextInput(&h->movie, &h->nes.input)) {
+                h->movie_state = LIBNES_MOVIE_ENDED;
+                break;
+            }
+        } else if (h->movie_state != LIBNES_MOVIE_NONE) {
+            break;
+        }
+
+        NES_RunFrame(&h->nes);
+        done++;
+
+        if (h->movie_state == LIBNES_MOVIE_PLAYING && !NesMovie_Verify(&h->movie, &h->nes)) {
+            h->movie_state = LIBNES_MOVIE_DESYNC;
+            break;
+        }
+    }
+    return done;
+}
+
+uint64_t LibNes_FrameCount(const LibNes* h)
+{
+    return h ? h->nes.frame_count : 0u;
+}
+
+bool LibNes_CPUJammed(const LibNes* h)
+{
+    return h && h->nes.cpu.jammed;
+}
+
+void LibNes_SetSkipRender(LibNes* h, bool skip)
+{
+    if (!h) return;
+    NES_SetSkipRender(&h->nes, skip);
+}
+
+const uint32_t* LibNes_Framebuffer(const LibNes* h)
+{
+    return h ? NES_Framebuffer(&h->nes) : NULL;
+}
+
+uint64_t LibNes_FramebufferHash(const LibNes* h)
+{
+    if (!h) return 0;
+    return Hash_U32s64(HASH_FNV64_SEED, h->nes.fb, sizeof(h->nes.fb) / sizeof(h->nes.fb[0]));
+}
+
+void LibNes_CopyRAM(const LibNes* h, uint8_t* dst)
+{
+    if (!h || !dst) return;
+    Bus_CopyRAM(&h->nes.bus, dst);
+}
+
+size_t LibNes_StateSize(const LibNes* h)
+{
+    return h ? NES_StateSize(&h->nes) : 0u;
+}
+
+bool LibNes_SaveState(const LibNes* h, void* buf, size_t size)
+{
+    return h && NES_SaveState(&h->nes, buf, size);
+}
+
+bool LibNes_LoadState(LibNes* h, const void* buf, size_t size)
+{
+    return h && NES_LoadState(&h->nes, buf, size);
+}
+
+bool LibNes_EnableAudio(LibNes* h, int sample_rate)
+{
+    return h && NES_EnableAudio(&h->nes, sample_rate);
+}
+
+int LibNes_ReadAudio(LibNes* h, int16_t* out, int count)
+{
+    return h ? NES_ReadAudio(&h->nes, out, count) : 0;
+}
+
+bool LibNes_PlayMovie(LibNes* h, const char* path)
+{
+    if (!h || !path || !h->nes.cart.mapper) return false;
+    close_movie(h);
+
+    if (!NesMovie_Open(&h->movie, path)) return false;
+    if (!NesMovie_CheckROM(&h->movie, &h->nes)) {
+        NesMovie_Close(&h->movie);
+        return false;
+    }
+
+    NES_Reset(&h->nes);
+    h->movie_state = LIBNES_MOVIE_PLAYING;
+    return true;
+}
+
+LibNesMovieState LibNes_MovieState(const LibNes* h, uint64_t* out_desync_frame)
+{
+    LibNesMovieState state = h ? h->movie_state : LIBNES_MOVIE_NONE;
+    if (out_desync_frame) *out_desync_frame = (state == LIBNES_MOVIE_DESYNC) ? h->movie.desync_frame : UINT64_MAX;
+    return state;
+}
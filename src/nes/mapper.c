@@ -2,6 +2,7 @@
 #include "nes/cart.h"
 #include "nes/log.h"
 #include <stdlib.h>
+#include <string.h>
 
 Mapper* MapperNROM_Create(Cart* cart);  // implemented in mapper_nrom.c
 Mapper* MapperMMC1_Create(Cart* cart);  // implemented in mapper_mmc1.c
@@ -27,3 +28,15 @@ void Mapper_Destroy(Mapper* m)
     if (m->destroy) m->destroy(m);
     free(m);
 }
+
+Mapper* Mapper_Clone(const Mapper* m, Cart* cart)
+{
+    if (!m || !cart || m->size < sizeof(Mapper)) return NULL;
+
+    Mapper* c = (Mapper*)malloc(m->size);
+    if (!c) return NULL;
+
+    memcpy(c, m, m->size);
+    c->cart = cart;
+    return c;
+}
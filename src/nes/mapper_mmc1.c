@@ -1,5 +1,6 @@
 #include "nes/mapper.h"
 #include "nes/cart.h"
+#include "nes/debug/timeline.h"
 #include <stdlib.h>
 
 typedef struct MapperMMC1 {
@@ -30,12 +31,14 @@ static inline bool prg_ram_disabled(const MapperMMC1* m)
     return (m->prg_bank & 0x10u) != 0;
 }
 
-static u8 mmc1_read_prg(MapperMMC1* m, u16 addr)
+static bool mmc1_prg_offset(const Mapper* base, u16 addr, u32* out)
 {
-    Cart* c = m->base.cart;
+    const MapperMMC1* m = (const MapperMMC1*)base;
+    const Cart* c = base->cart;
+    if (addr < 0x8000) return false;
 
     u32 banks16 = prg_bank_count_16k(c);
-    if (banks16 == 0) return 0;
+    if (banks16 == 0) return false;
 
     u8 prg_mode = (u8)((m->control >> 2) & 0x03u);
     u32 bank16;
@@ -60,7 +63,8 @@ static u8 mmc1_read_prg(MapperMMC1* m, u16 addr)
 
     u32 off = bank16 * (16u * 1024u) + off16;
     if (off >= c->prg_rom_size) off %= c->prg_rom_size;
-    return c->prg_rom[off];
+    *out = off;
+    return true;
 }
 
 static u8 mmc1_read_chr(MapperMMC1* m, u16 addr)
@@ -88,7 +92,7 @@ static u8 mmc1_read_chr(MapperMMC1* m, u16 addr)
 
     u32 off = bank4 * (4u * 1024u) + off4;
     if (off >= c->chr_size) off %= c->chr_size;
-    return c->chr[off];
+    return Cart_CHRRead(c, off);
 }
 
 static void mmc1_write_reg(MapperMMC1* m, u16 addr, u8 val)
@@ -119,12 +123,13 @@ static bool mmc1_cpu_read(Mapper* base, u16 addr, u8* out)
         if (prg_ram_disabled(m) || !c->prg_ram || c->prg_ram_size == 0) return false;
         u32 off = (u32)(addr - 0x6000);
         if (off >= c->prg_ram_size) off %= c->prg_ram_size;
-        *out = c->prg_ram[off];
+        *out = Cart_PRGRAMRead(c, off);
         return true;
     }
 
     if (addr >= 0x8000) {
-        *out = mmc1_read_prg(m, addr);
+        u32 off;
+        *out = mmc1_prg_offset(base, addr, &off) ? c->prg_rom[off] : 0;
         return true;
     }
 
@@ -141,7 +146,7 @@ static bool mmc1_cpu_write(Mapper* base, u16 addr, u8 data)
         if (prg_ram_disabled(m) || !c->prg_ram || c->prg_ram_size == 0) return false;
         u32 off = (u32)(addr - 0x6000);
         if (off >= c->prg_ram_size) off %= c->prg_ram_size;
-        c->prg_ram[off] = data;
+        Cart_PRGRAMWrite(c, off, data);
         return true;
     }
 
@@ -158,6 +163,8 @@ static bool mmc1_cpu_write(Mapper* base, u16 addr, u8 data)
     m->shift = (u8)((m->shift >> 1) | ((data & 1u) ? 0x10u : 0x00u));
 
     if (complete) {
+        // Timeline arg: register (0 control, 1 CHR0, 2 CHR1, 3 PRG) << 8 | value.
+        NES_TIMELINE_INSTANT("bank switch", (u32)((addr >> 13) & 3u) << 8 | m->shift);
         mmc1_write_reg(m, addr, m->shift);
         m->shift = 0x10u;
     }
@@ -204,7 +211,7 @@ static bool mmc1_ppu_write(Mapper* base, u16 addr, u8 data)
 
     u32 off = bank4 * (4u * 1024u) + off4;
     if (off >= c->chr_size) off %= c->chr_size;
-    c->chr[off] = data;
+    Cart_CHRWrite(c, off, data);
     return true;
 }
 
@@ -220,11 +227,13 @@ Mapper* MapperMMC1_Create(Cart* cart)
 
     m->base.id = 1;
     m->base.cart = cart;
+    m->base.size = (u32)sizeof(*m);
 
     m->base.cpu_read  = mmc1_cpu_read;
     m->base.cpu_write = mmc1_cpu_write;
     m->base.ppu_read  = mmc1_ppu_read;
     m->base.ppu_write = mmc1_ppu_write;
+    m->base.prg_offset = mmc1_prg_offset;
     m->base.destroy   = mmc1_destroy;
 
     m->shift = 0x10u;
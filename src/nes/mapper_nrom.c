@@ -6,6 +6,22 @@ typedef struct MapperNROM {
     Mapper base;
 } MapperNROM;
 
+static bool nrom_prg_offset(const Mapper* m, u16 addr, u32* out)
+{
+    const Cart* c = m->cart;
+    if (addr < 0x8000 || !c->prg_rom || c->prg_rom_size == 0) return false;
+
+    u32 off = (u32)(addr - 0x8000);
+    if (c->prg_rom_size == 16u * 1024u) {
+        off &= 0x3FFFu; // mirror 16KB
+    } else {
+        off &= 0x7FFFu; // 32KB
+        if (off >= c->prg_rom_size) off %= c->prg_rom_size;
+    }
+    *out = off;
+    return true;
+}
+
 static bool nrom_cpu_read(Mapper* m, u16 addr, u8* out)
 {
     Cart* c = m->cart;
@@ -16,27 +32,15 @@ static bool nrom_cpu_read(Mapper* m, u16 addr, u8* out)
         if (!c->prg_ram || c->prg_ram_size == 0) return false;
         u32 off = (u32)(addr - 0x6000);
         if (off >= c->prg_ram_size) off %= c->prg_ram_size;
-        *out = c->prg_ram[off];
+        *out = Cart_PRGRAMRead(c, off);
         return true;
     }
 
     // $8000-$FFFF : PRG ROM (NROM-128 16KB mirrored, NROM-256 32KB)
-    if (addr >= 0x8000) {
-        if (!c->prg_rom || c->prg_rom_size == 0) return false;
-        u32 off = (u32)(addr - 0x8000);
-
-        if (c->prg_rom_size == 16u * 1024u) {
-            off &= 0x3FFFu; // mirror 16KB
-        } else {
-            off &= 0x7FFFu; // 32KB
-            if (off >= c->prg_rom_size) off %= c->prg_rom_size;
-        }
-
-        *out = c->prg_rom[off];
-        return true;
-    }
-
-    return false;
+    u32 off;
+    if (!nrom_prg_offset(m, addr, &off)) return false;
+    *out = c->prg_rom[off];
+    return true;
 }
 
 static bool nrom_cpu_write(Mapper* m, u16 addr, u8 data)
@@ -49,7 +53,7 @@ static bool nrom_cpu_write(Mapper* m, u16 addr, u8 data)
         if (!c->prg_ram || c->prg_ram_size == 0) return false;
         u32 off = (u32)(addr - 0x6000);
         if (off >= c->prg_ram_size) off %= c->prg_ram_size;
-        c->prg_ram[off] = data;
+        Cart_PRGRAMWrite(c, off, data);
         return true;
     }
 
@@ -71,7 +75,7 @@ static bool nrom_ppu_read(Mapper* m, u16 addr, u8* out)
         if (!c->chr || c->chr_size == 0) return false;
         u32 off = (u32)addr;
         if (off >= c->chr_size) off %= c->chr_size;
-        *out = c->chr[off];
+        *out = Cart_CHRRead(c, off);
         return true;
     }
 
@@ -90,7 +94,7 @@ static bool nrom_ppu_write(Mapper* m, u16 addr, u8 data)
 
         u32 off = (u32)addr;
         if (off >= c->chr_size) off %= c->chr_size;
-        c->chr[off] = data;
+        Cart_CHRWrite(c, off, data);
         return true;
     }
 
@@ -109,11 +113,13 @@ Mapper* MapperNROM_Create(Cart* cart)
 
     n->base.id = 0;
     n->base.cart = cart;
+    n->base.size = (u32)sizeof(*n);
 
     n->base.cpu_read  = nrom_cpu_read;
     n->base.cpu_write = nrom_cpu_write;
     n->base.ppu_read  = nrom_ppu_read;
     n->base.ppu_write = nrom_ppu_write;
+    n->base.prg_offset = nrom_prg_offset;
     n->base.destroy   = nrom_destroy;
 
     return &n->base;
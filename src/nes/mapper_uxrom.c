@@ -1,5 +1,6 @@
 #include "nes/mapper.h"
 #include "nes/cart.h"
+#include "nes/debug/timeline.h"
 #include <stdlib.h>
 
 typedef struct MapperUxROM {
@@ -13,21 +14,10 @@ static inline u32 prg_bank_count_16k(const Cart* c)
     return c->prg_rom_size / (16u * 1024u);
 }
 
-static bool uxrom_cpu_read(Mapper* m, u16 addr, u8* out)
+static bool uxrom_prg_offset(const Mapper* m, u16 addr, u32* out)
 {
-    MapperUxROM* u = (MapperUxROM*)m;
-    Cart* c = m->cart;
-    if (!u || !c || !out) return false;
-
-    // $6000-$7FFF: PRG RAM (common compatibility behavior)
-    if (addr >= 0x6000 && addr <= 0x7FFF) {
-        if (!c->prg_ram || c->prg_ram_size == 0) return false;
-        u32 off = (u32)(addr - 0x6000);
-        if (off >= c->prg_ram_size) off %= c->prg_ram_size;
-        *out = c->prg_ram[off];
-        return true;
-    }
-
+    const MapperUxROM* u = (const MapperUxROM*)m;
+    const Cart* c = m->cart;
     if (addr < 0x8000 || !c->prg_rom || c->prg_rom_size == 0) return false;
 
     u32 banks = prg_bank_count_16k(c);
@@ -46,7 +36,27 @@ static bool uxrom_cpu_read(Mapper* m, u16 addr, u8* out)
 
     u32 off = bank * (16u * 1024u) + bank_off;
     if (off >= c->prg_rom_size) off %= c->prg_rom_size;
+    *out = off;
+    return true;
+}
+
+static bool uxrom_cpu_read(Mapper* m, u16 addr, u8* out)
+{
+    MapperUxROM* u = (MapperUxROM*)m;
+    Cart* c = m->cart;
+    if (!u || !c || !out) return false;
+
+    // $6000-$7FFF: PRG RAM (common compatibility behavior)
+    if (addr >= 0x6000 && addr <= 0x7FFF) {
+        if (!c->prg_ram || c->prg_ram_size == 0) return false;
+        u32 off = (u32)(addr - 0x6000);
+        if (off >= c->prg_ram_size) off %= c->prg_ram_size;
+        *out = Cart_PRGRAMRead(c, off);
+        return true;
+    }
 
+    u32 off;
+    if (!uxrom_prg_offset(m, addr, &off)) return false;
     *out = c->prg_rom[off];
     return true;
 }
@@ -62,12 +72,13 @@ static bool uxrom_cpu_write(Mapper* m, u16 addr, u8 data)
         if (!c->prg_ram || c->prg_ram_size == 0) return false;
         u32 off = (u32)(addr - 0x6000);
         if (off >= c->prg_ram_size) off %= c->prg_ram_size;
-        c->prg_ram[off] = data;
+        Cart_PRGRAMWrite(c, off, data);
         return true;
     }
 
     if (addr >= 0x8000) {
         // UxROM: bank select from low bits.
+        if (u->bank_select != data) NES_TIMELINE_INSTANT("bank switch", data);
         u->bank_select = data;
         return true;
     }
@@ -85,7 +96,7 @@ static bool uxrom_ppu_read(Mapper* m, u16 addr, u8* out)
         if (!c->chr || c->chr_size == 0) return false;
         u32 off = (u32)addr;
         if (off >= c->chr_size) off %= c->chr_size;
-        *out = c->chr[off];
+        *out = Cart_CHRRead(c, off);
         return true;
     }
 
@@ -103,7 +114,7 @@ static bool uxrom_ppu_write(Mapper* m, u16 addr, u8 data)
 
         u32 off = (u32)addr;
         if (off >= c->chr_size) off %= c->chr_size;
-        c->chr[off] = data;
+        Cart_CHRWrite(c, off, data);
         return true;
     }
 
@@ -122,11 +133,13 @@ Mapper* MapperUxROM_Create(Cart* cart)
 
     u->base.id = 2;
     u->base.cart = cart;
+    u->base.size = (u32)sizeof(*u);
 
     u->base.cpu_read  = uxrom_cpu_read;
     u->base.cpu_write = uxrom_cpu_write;
     u->base.ppu_read  = uxrom_ppu_read;
     u->base.ppu_write = uxrom_ppu_write;
+    u->base.prg_offset = uxrom_prg_offset;
     u->base.destroy   = uxrom_destroy;
 
     u->bank_select = 0;
@@ -0,0 +1,271 @@
+#include "nes/movie.h"
+#include "nes/log.h"
+#include "nes/state.h"
+#include "nes/util/hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char k_magic[4] = { 'N', 'E', 'S', 'M' };
+
+static void put_le(u8* p, u64 v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) p[i] = (u8)(v >> (8 * i));
+}
+
+static u64 get_le(const u8* p, int bytes)
+{
+    u64 v = 0;
+    for (int i = 0; i < bytes; i++) v |= (u64)p[i] << (8 * i);
+    return v;
+}
+
+static void encode_header(const NesMovieHeader* h, u8 out[NES_MOVIE_HEADER_SIZE])
+{
+    memset(out, 0, NES_MOVIE_HEADER_SIZE);
+    memcpy(out, k_magic, sizeof(k_magic));
+    put_le(out + 4, h->version, 2);
+    put_le(out + 6, h->flags, 2);
+    put_le(out + 8, h->start, 4);
+    put_le(out + 12, NES_MOVIE_HEADER_SIZE, 4);
+    put_le(out + 16, h->rom_hash, 8);
+    put_le(out + 24, h->frames, 8);
+    put_le(out + 32, h->input_size, 8);
+    put_le(out + 40, h->checksum_offset, 8);
+}
+
+u64 NesMovie_ROMHash(const Cart* c)
+{
+    if (!c || !c->prg_rom) return 0;
+
+    u64 h = HASH_FNV64_SEED;
+    u8 info[4] = { (u8)c->info.mapper, (u8)(c->info.mapper >> 8),
+                   (u8)c->info.mirroring, (u8)(c->chr_is_ram ? 1u : 0u) };
+    h = Hash_Bytes64(h, info, sizeof(info));
+    h = Hash_Bytes64(h, c->prg_rom, c->prg_rom_size);
+    if (!c->chr_is_ram && c->chr) h = Hash_Bytes64(h, c->chr, c->chr_size);
+    return h;
+}
+
+u32 NesMovie_StateChecksum(const Nes* n)
+{
+    u64 h = NES_StateFingerprint(n);
+    return (u32)(h ^ (h >> 32));
+}
+
+// ---------------------------------------------------------------------------
+// Recording
+// ---------------------------------------------------------------------------
+
+static bool write_run(NesMovieRecorder* r)
+{
+    if (r->run_length == 0) return true;
+
+    u8 buf[2 + 10];
+    size_t len = 0;
+    buf[len++] = r->run_input.p1;
+    buf[len++] = r->run_input.p2;
+
+    u64 v = r->run_length;
+    do {
+        u8 b = (u8)(v & 0x7Fu);
+        v >>= 7;
+        buf[len++] = (u8)(b | (v ? 0x80u : 0u));
+    } while (v);
+
+    r->hdr.input_size += len;
+    r->run_length = 0;
+    return fwrite(buf, 1, len, r->f) == len;
+}
+
+bool NesMovie_RecordBegin(NesMovieRecorder* r, const char* path, const Nes* n, bool checksums)
+{
+    if (!r || !path || !n) return false;
+    memset(r, 0, sizeof(*r));
+
+    r->hdr.version = NES_MOVIE_VERSION;
+    r->hdr.flags = checksums ? NES_MOVIE_FLAG_CHECKSUMS : 0u;
+    r->hdr.start = NES_MOVIE_START_POWER_ON;
+    r->hdr.rom_hash = NesMovie_ROMHash(&n->cart);
+
+    r->f = fopen(path, "wb");
+    if (!r->f) {
+        NES_LOGE("Movie: cannot create %s", path);
+        return false;
+    }
+
+    // Placeholder; the final header is written by NesMovie_RecordEnd.
+    u8 hdr[NES_MOVIE_HEADER_SIZE];
+    encode_header(&r->hdr, hdr);
+    return fwrite(hdr, 1, sizeof(hdr), r->f) == sizeof(hdr);
+}
+
+bool NesMovie_RecordFrame(NesMovieRecorder* r, const Nes* n, NesInput input)
+{
+    if (!r || !r->f) return false;
+
+    if (r->run_length > 0 &&
+        (input.p1 != r->run_input.p1 || input.p2 != r->run_input.p2)) {
+        if (!write_run(r)) return false;
+    }
+    r->run_input = input;
+    r->run_length++;
+
+    if (r->hdr.flags & NES_MOVIE_FLAG_CHECKSUMS) {
+        if (r->hdr.frames == r->checksum_cap) {
+            u64 cap = r->checksum_cap ? r->checksum_cap * 2u : 4096u;
+            u32* grown = (u32*)realloc(r->checksums, (size_t)cap * sizeof(u32));
+            if (!grown) return false;
+            r->checksums = grown;
+            r->checksum_cap = cap;
+        }
+        r->checksums[r->hdr.frames] = NesMovie_StateChecksum(n);
+    }
+
+    r->hdr.frames++;
+    return true;
+}
+
+bool NesMovie_RecordEnd(NesMovieRecorder* r)
+{
+    if (!r || !r->f) return false;
+
+    bool ok = write_run(r);
+
+    if (ok && (r->hdr.flags & NES_MOVIE_FLAG_CHECKSUMS)) {
+        r->hdr.checksum_offset = NES_MOVIE_HEADER_SIZE + r->hdr.input_size;
+        u8 word[4];
+        for (u64 i = 0; ok && i < r->hdr.frames; i++) {
+            put_le(word, r->checksums[i], 4);
+            ok = fwrite(word, 1, sizeof(word), r->f) == sizeof(word);
+        }
+    }
+
+    if (ok) {
+        u8 hdr[NES_MOVIE_HEADER_SIZE];
+        encode_header(&r->hdr, hdr);
+        ok = fseek(r->f, 0, SEEK_SET) == 0 && fwrite(hdr, 1, sizeof(hdr), r->f) == sizeof(hdr);
+    }
+
+    if (fclose(r->f) != 0) ok = false;
+    r->f = NULL;
+
+    free(r->checksums);
+    r->checksums = NULL;
+
+    if (!ok) NES_LOGE("Movie: failed to write movie");
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Playback
+// ---------------------------------------------------------------------------
+
+bool NesMovie_Open(NesMoviePlayer* p, const char* path)
+{
+    if (!p || !path) return false;
+    memset(p, 0, sizeof(*p));
+    p->desync_frame = UINT64_MAX;
+
+    if (!File_Map(path, &p->file)) {
+        NES_LOGE("Movie: cannot open %s", path);
+        return false;
+    }
+
+    const u8* d = p->file.data;
+    size_t size = p->file.size;
+    if (size < NES_MOVIE_HEADER_SIZE || memcmp(d, k_magic, sizeof(k_magic)) != 0) {
+        NES_LOGE("Movie: %s is not a movie file", path);
+        NesMovie_Close(p);
+        return false;
+    }
+
+    NesMovieHeader* h = &p->hdr;
+    h->version = (u16)get_le(d + 4, 2);
+    h->flags = (u16)get_le(d + 6, 2);
+    h->start = (u32)get_le(d + 8, 4);
+    u64 header_size = get_le(d + 12, 4);
+    h->rom_hash = get_le(d + 16, 8);
+    h->frames = get_le(d + 24, 8);
+    h->input_size = get_le(d + 32, 8);
+    h->checksum_offset = get_le(d + 40, 8);
+
+    bool ok = h->version == NES_MOVIE_VERSION &&
+              h->start == NES_MOVIE_START_POWER_ON &&
+              header_size >= NES_MOVIE_HEADER_SIZE && header_size <= size &&
+              h->input_size <= size - header_size;
+    if (ok && (h->flags & NES_MOVIE_FLAG_CHECKSUMS)) {
+        ok = h->checksum_offset <= size && h->frames <= (size - h->checksum_offset) / 4u;
+    }
+    if (!ok) {
+        NES_LOGE("Movie: %s has an unsupported or truncated header", path);
+        NesMovie_Close(p);
+        return false;
+    }
+
+    p->cursor = d + header_size;
+    p->stream_end = p->cursor + h->input_size;
+    return true;
+}
+
+void NesMovie_Close(NesMoviePlayer* p)
+{
+    if (!p) return;
+    File_Unmap(&p->file);
+    p->cursor = NULL;
+    p->stream_end = NULL;
+}
+
+bool NesMovie_CheckROM(const NesMoviePlayer* p, const Nes* n)
+{
+    if (!p || !n) return false;
+    return p->hdr.rom_hash == NesMovie_ROMHash(&n->cart);
+}
+
+static bool read_run(NesMoviePlayer* p)
+{
+    if (p->stream_end - p->cursor < 3) return false;
+
+    p->run_input.p1 = *p->cursor++;
+    p->run_input.p2 = *p->cursor++;
+
+    u64 v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p->cursor >= p->stream_end) return false;
+        u8 b = *p->cursor++;
+        v |= (u64)(b & 0x7Fu) << shift;
+        if (!(b & 0x80u)) {
+            p->run_left = v;
+            return v > 0;
+        }
+    }
+    return false;
+}
+
+bool NesMovie_NextInput(NesMoviePlayer* p, NesInput* out)
+{
+    if (!p || !out || p->frame >= p->hdr.frames) return false;
+
+    if (p->run_left == 0 && !read_run(p)) {
+        NES_LOGE("Movie: input stream ends early at frame %llu", (unsigned long long)p->frame);
+        return false;
+    }
+
+    *out = p->run_input;
+    p->run_left--;
+    p->frame++;
+    return true;
+}
+
+bool NesMovie_Verify(NesMoviePlayer* p, const Nes* n)
+{
+    if (!p || !n) return false;
+    if (!(p->hdr.flags & NES_MOVIE_FLAG_CHECKSUMS) || p->frame == 0) return true;
+
+    u64 index = p->frame - 1u;
+    u32 want = (u32)get_le(p->file.data + p->hdr.checksum_offset + index * 4u, 4);
+    u32 got = NesMovie_StateChecksum(n);
+    if (got == want) return true;
+
+    if (p->desync_frame == UINT64_MAX) p->desync_frame = index;
+    return false;
+}
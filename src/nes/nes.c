@@ -1,27 +1,81 @@
 #include "nes/nes.h"
 #include "nes/log.h"
 #include "nes/ppu/ppu2c02.h"
+#include "nes/debug/profiler.h"
+#include "nes/debug/timeline.h"
+#include <stdlib.h>
 #include <string.h>
 
+// CPU hooks for the execution trace, profiler and timeline (Bus.debug).
+static u32 debug_exec(Bus* b, const CPU6502* c)
+{
+    if (b->exec_log) {
+        NesTraceRecord r;
+        r.cycle = c->cycles;
+        r.pc = c->pc;
+        r.scanline = (s16)b->ppu.scanline;
+        r.dot = (u16)b->ppu.cycle;
+        r.opcode = Bus_Peek(b, c->pc);
+        u32 len = NesTrace_OpLength(r.opcode);
+        r.operand[0] = len > 1u ? Bus_Peek(b, (u16)(c->pc + 1)) : 0;
+        r.operand[1] = len > 2u ? Bus_Peek(b, (u16)(c->pc + 2)) : 0;
+        r.a = c->a;
+        r.x = c->x;
+        r.y = c->y;
+        r.p = c->p;
+        r.sp = c->sp;
+        NesTraceLog_Push(b->exec_log, &r);
+    }
+    // The profiler locates the instruction before it can switch banks.
+    return b->profiler ? NesProfiler_Locate(b->profiler, c->pc) : 0u;
+}
+
+static void debug_retire(Bus* b, u32 loc, u8 opcode, u32 cycles, u16 pc, u8 sp)
+{
+    if (b->profiler) NesProfiler_Retire(b->profiler, loc, opcode, cycles, pc, sp);
+}
+
+static void debug_interrupt(Bus* b, const CPU6502* c, u16 vector, u8 sp_before)
+{
+    NES_TIMELINE_INSTANT(vector == 0xFFFA ? "NMI" : "IRQ", NES_TIMELINE_NO_ARG);
+    if (b->profiler) NesProfiler_Interrupt(b->profiler, c->pc, sp_before, 7);
+}
+
+static const BusDebugHooks k_debug_hooks = { debug_exec, debug_retire, debug_interrupt };
+
+// The timeline is per thread, so this runs at the start of every frame as
+// well as when a trace or profile starts or stops.
+static void update_debug_hooks(Nes* n)
+{
+    bool on = n->bus.exec_log || n->bus.profiler || g_nes_timeline;
+    n->bus.debug = on ? &k_debug_hooks : NULL;
+}
+
 static void clock_ppu_and_nmi(Nes* n, int ppu_cycles)
 {
+    NES_TRACE_BEGIN(t0);
     for (int i = 0; i < ppu_cycles; i++) {
         PPU2C02_Clock(&n->bus.ppu);
         if (PPU2C02_PollNMI(&n->bus.ppu)) {
             CPU6502_RequestNMI(&n->cpu);
         }
     }
+    NES_TRACE_END(&n->trace, NES_TRACE_PHASE_PPU, t0);
 }
 
 static void consume_cpu_cycles_for_timing(Nes* n, int cpu_cycles)
 {
     if (!n || cpu_cycles <= 0) return;
 
-    for (int i = 0; i < cpu_cycles; i++) {
-        if (Bus_APUTick(&n->bus)) {
-            CPU6502_RequestIRQ(&n->cpu);
-        }
+    // The APU catches up lazily; the CPU samples IRQ only between steps, so
+    // one check per batch sees the same line as a check per cycle.
+    NES_TRACE_BEGIN(t0);
+    if (Bus_APUAdvance(&n->bus, (u32)cpu_cycles)) {
+        CPU6502_RequestIRQ(&n->cpu);
+    }
+    NES_TRACE_END(&n->trace, NES_TRACE_PHASE_APU, t0);
 
+    for (int i = 0; i < cpu_cycles; i++) {
         clock_ppu_and_nmi(n, 3);
         n->bus.cpu_cycle_parity ^= 1u;
     }
@@ -33,13 +87,17 @@ static void NES_Clock(Nes* n)
 
     // During OAM DMA, CPU is stalled but PPU/NMI/APU timing continues.
     if (Bus_DMATick(&n->bus)) {
+        NES_TRACE_INC(&n->trace, dma_stalls);
+        if (n->bus.profiler) NesProfiler_Stall(n->bus.profiler, 1);
         consume_cpu_cycles_for_timing(n, 1);
         return;
     }
 
     if (n->cpu.jammed) return;
 
+    NES_TRACE_BEGIN(t0);
     int cpu_cycles = CPU6502_Step(&n->cpu);
+    NES_TRACE_END(&n->trace, NES_TRACE_PHASE_CPU, t0);
     if (cpu_cycles <= 0) return;
 
     consume_cpu_cycles_for_timing(n, cpu_cycles);
@@ -53,14 +111,37 @@ bool NES_Init(Nes* n)
     if (!Cart_Init(&n->cart)) return false;
     if (!Bus_Init(&n->bus, &n->cart)) return false;
     if (!CPU6502_Init(&n->cpu, &n->bus)) return false;
+#if NES_TRACE
+    n->bus.trace = &n->trace;
+    n->bus.ppu.trace = &n->trace;
+#endif
 
     for (u32 i = 0; i < (u32)(NES_FB_W * NES_FB_H); i++) n->fb[i] = 0xFF000000u;
     return true;
 }
 
+static bool nes_is_frozen(const Nes* n, const char* what)
+{
+    if (atomic_load_explicit(&n->fork_children, memory_order_acquire) == 0) return false;
+    NES_LOGE("NES: %s refused, console has live forks", what);
+    return true;
+}
+
 void NES_Destroy(Nes* n)
 {
     if (!n) return;
+
+    if (atomic_load(&n->fork_children) > 0) {
+        NES_LOGE("NES: destroying a console that still has live forks");
+    }
+    if (n->fork_parent) {
+        atomic_fetch_sub(&n->fork_parent->fork_children, 1);
+        n->fork_parent = NULL;
+    }
+
+    NES_StopExecTrace(n);
+    NES_StopProfile(n);
+    NES_EnableAudio(n, 0);
     Cart_Destroy(&n->cart);
 }
 
@@ -68,6 +149,7 @@ bool NES_LoadROM(Nes* n, const char* path)
 {
     if (!n || !path) return false;
 
+    NES_StopProfile(n);    // sized for the old PRG ROM
     if (!Cart_LoadFromFile(&n->cart, path)) return false;
 
     Bus_SetCart(&n->bus, &n->cart);
@@ -76,34 +158,213 @@ bool NES_LoadROM(Nes* n, const char* path)
     return true;
 }
 
+bool NES_LoadROMFromMemory(Nes* n, const u8* rom, size_t rom_size)
+{
+    if (!n || !rom) return false;
+
+    NES_StopProfile(n);    // sized for the old PRG ROM
+    if (!Cart_LoadFromMemory(&n->cart, rom, rom_size)) return false;
+
+    Bus_SetCart(&n->bus, &n->cart);
+
+    if (!n->quiet) NES_LOGI("NES: ROM loaded OK (mapper %u)", n->cart.info.mapper);
+    return true;
+}
+
+bool NES_ShareROM(Nes* n, const Cart* src)
+{
+    if (!n || !src) return false;
+
+    NES_StopProfile(n);    // sized for the old PRG ROM
+    if (!Cart_Share(&n->cart, src)) return false;
+
+    Bus_SetCart(&n->bus, &n->cart);
+    return true;
+}
+
 void NES_Reset(Nes* n)
 {
-    if (!n) return;
+    if (!n || nes_is_frozen(n, "reset")) return;
 
     n->frame_count = 0;
 
     Bus_Reset(&n->bus);
+    Cart_MarkAllDirty(&n->cart);
     CPU6502_Reset(&n->cpu);
 
-    NES_LOGI("CPU reset: PC=%04X", n->cpu.pc);
+    if (!n->quiet) NES_LOGI("CPU reset: PC=%04X", n->cpu.pc);
 }
 
 void NES_RunFrame(Nes* n)
 {
-    if (!n) return;
+    if (!n || nes_is_frozen(n, "run")) return;
 
-    // Feed input to bus ($4016)
-    Bus_SetInput(&n->bus, n->input);
+    // Feed input to bus ($4016): now, or at the first strobe with a provider.
+    if (n->bus.input_poll) {
+        Bus_ArmInputPoll(&n->bus);
+    } else {
+        Bus_SetInput(&n->bus, n->input);
+    }
 
+    update_debug_hooks(n);
     PPU2C02_ClearFrameComplete(&n->bus.ppu);
+    NES_TIMELINE_BEGIN(tl_frame);
 
-    // Frame execution is driven by the PPU frame boundary.
+    // Frame execution is driven by the PPU frame boundary. On the timeline
+    // the CPU (with the PPU and APU in lockstep) runs as one segment, cut at
+    // each NMI, IRQ, DMA and bank switch.
+    NES_TIMELINE_SEGMENT_BEGIN("cpu");
     while (!PPU2C02_FrameComplete(&n->bus.ppu) && !n->cpu.jammed) {
         NES_Clock(n);
     }
+    NES_TIMELINE_SEGMENT_END();
 
     // Present PPU-rendered framebuffer.
-    memcpy(n->fb, n->bus.ppu.fb, sizeof(n->fb));
+    NES_TRACE_BEGIN(t0);
+    NES_TIMELINE_BEGIN(tl_copy);
+    if (!n->bus.ppu.skip_pixels) memcpy(n->fb, n->bus.ppu.fb, sizeof(n->fb));
+    NES_TIMELINE_END(tl_copy, "frame copy");
+    NES_TRACE_END(&n->trace, NES_TRACE_PHASE_PRESENT, t0);
 
+    NES_TRACE_BEGIN(t1);
+    NES_TIMELINE_BEGIN(tl_apu);
+    APU2A03_EndFrame(&n->bus.apu);
+    NES_TIMELINE_END(tl_apu, "apu end frame");
+    NES_TRACE_END(&n->trace, NES_TRACE_PHASE_APU, t1);
+    NES_TIMELINE_END_ARG(tl_frame, "frame", n->frame_count);
     n->frame_count++;
+
+#if NES_TRACE
+    n->trace.frames++;
+    if (n->trace_every && n->frame_count % n->trace_every == 0) NES_TraceDump(n, n->trace_out);
+#endif
+
+    // Report what the game actually read (unchanged if it never polled).
+    if (n->bus.input_poll) {
+        n->bus.input_armed = false;
+        n->input = n->bus.input;
+    }
+}
+
+bool NES_SetTraceDump(Nes* n, FILE* out, u32 every)
+{
+#if NES_TRACE
+    if (!n) return false;
+    n->trace_out = out;
+    n->trace_every = out ? every : 0u;
+    return true;
+#else
+    (void)n; (void)out; (void)every;
+    return false;
+#endif
+}
+
+void NES_TraceDump(Nes* n, FILE* out)
+{
+#if NES_TRACE
+    if (!n || !out) return;
+    NesTrace_Dump(&n->trace, out, n->frame_count);
+    NesTrace_Reset(&n->trace);
+#else
+    (void)n; (void)out;
+#endif
+}
+
+bool NES_StartExecTrace(Nes* n, const char* path)
+{
+    if (!n || !path) return false;
+    NES_StopExecTrace(n);
+    n->bus.exec_log = NesTraceLog_Open(path, 0);
+    if (!n->bus.exec_log) {
+        NES_LOGE("NES: cannot start execution trace %s", path);
+        return false;
+    }
+    update_debug_hooks(n);
+    return true;
+}
+
+bool NES_StopExecTrace(Nes* n)
+{
+    if (!n || !n->bus.exec_log) return false;
+    NesTraceLog* log = n->bus.exec_log;
+    n->bus.exec_log = NULL;
+    update_debug_hooks(n);
+
+    if (!n->quiet) {
+        NES_LOGI("NES: execution trace: %llu instructions, %llu dropped",
+                 (unsigned long long)NesTraceLog_Records(log),
+                 (unsigned long long)NesTraceLog_Dropped(log));
+    }
+    if (!NesTraceLog_Close(log)) {
+        NES_LOGE("NES: execution trace incomplete (write error)");
+        return false;
+    }
+    return true;
+}
+
+bool NES_StartProfile(Nes* n)
+{
+    if (!n || !n->cart.mapper) return false;
+    NES_StopProfile(n);
+
+    NesProfiler* p = (NesProfiler*)malloc(sizeof(NesProfiler));
+    if (!p || !NesProfiler_Init(p, &n->cart)) {
+        free(p);
+        NES_LOGE("NES: cannot start the profiler (out of memory)");
+        return false;
+    }
+    n->bus.profiler = p;
+    update_debug_hooks(n);
+    return true;
+}
+
+void NES_StopProfile(Nes* n)
+{
+    if (!n || !n->bus.profiler) return;
+    NesProfiler_Free(n->bus.profiler);
+    free(n->bus.profiler);
+    n->bus.profiler = NULL;
+    update_debug_hooks(n);
+}
+
+void NES_SetInputProvider(Nes* n, NesInputPollFn fn, void* user)
+{
+    if (!n) return;
+    Bus_SetInputProvider(&n->bus, fn, user);
+}
+
+bool NES_EnableAudio(Nes* n, int sample_rate)
+{
+    if (!n) return false;
+
+    APU2A03_SetOutput(&n->bus.apu, NULL);
+    if (n->audio) {
+        Blip_Destroy(n->audio);
+        free(n->audio);
+        n->audio = NULL;
+    }
+    if (sample_rate <= 0) return true;
+
+    Blip* b = (Blip*)malloc(sizeof(Blip));
+    if (!b) return false;
+    if (!Blip_Init(b, APU_CLOCK_RATE, (double)sample_rate, sample_rate / 5)) {
+        free(b);
+        return false;
+    }
+
+    n->audio = b;
+    APU2A03_SetOutput(&n->bus.apu, b);
+    return true;
+}
+
+void NES_PauseAudio(Nes* n, bool paused)
+{
+    if (!n || !n->audio || (n->bus.apu.out == NULL) == paused) return;
+    APU2A03_SetOutput(&n->bus.apu, paused ? NULL : n->audio);
+}
+
+int NES_ReadAudio(Nes* n, s16* out, int count)
+{
+    if (!n || !n->audio) return 0;
+    return Blip_ReadSamples(n->audio, out, count);
 }
@@ -1,5 +1,8 @@
 #include "nes/ppu/ppu2c02.h"
 #include "nes/cart.h"
+#include "nes/util/cow.h"
+#include "nes/util/dirty.h"
+#include "nes/debug/timeline.h"
 #include <string.h>
 
 enum {
@@ -67,13 +70,14 @@ static u8 ppu_mem_read(PPU2C02* p, u16 addr)
 
     if (addr <= 0x1FFFu) {
         u8 v = 0;
+        NES_TRACE_INC(p->trace, mapper_calls);
         if (p->cart && Cart_PPURead(p->cart, addr, &v)) return v;
         return 0;
     }
 
     if (addr <= 0x3EFFu) {
         u16 off = mirror_nametable_addr(p, addr);
-        return p->nametables[off];
+        return NesCow_Read(p->nametables, p->nt_borrow, off);
     }
 
     return p->palette[mirror_palette_addr(addr)];
@@ -85,6 +89,7 @@ static void ppu_mem_write(PPU2C02* p, u16 addr, u8 data)
 
     if (addr <= 0x1FFFu) {
         if (p->cart) {
+            NES_TRACE_INC(p->trace, mapper_calls);
             (void)Cart_PPUWrite(p->cart, addr, data);
         }
         return;
@@ -92,11 +97,13 @@ static void ppu_mem_write(PPU2C02* p, u16 addr, u8 data)
 
     if (addr <= 0x3EFFu) {
         u16 off = mirror_nametable_addr(p, addr);
-        p->nametables[off] = data;
+        *NesCow_WritePtr(p->nametables, p->nt_borrow, off) = data;
+        NesDirty_Mark(&p->nt_dirty, off);
         return;
     }
 
     p->palette[mirror_palette_addr(addr)] = data;
+    NesDirty_Mark(&p->palette_dirty, 0);
 }
 
 static void maybe_raise_nmi(PPU2C02* p)
@@ -226,9 +233,17 @@ static u8 bg_palette_index_from_shifters(const PPU2C02* p)
     return (u8)(((a1 << 1) | a0) << 2 | px);
 }
 
+static inline const u8* oam_data(const PPU2C02* p)
+{
+    return p->oam_borrow ? p->oam_borrow : p->oam;
+}
+
 static void evaluate_scanline_sprites(PPU2C02* p, int y)
 {
+    const u8* oam = oam_data(p);
     int sprite_height = (p->ctrl & 0x20u) ? 16 : 8;
+    NES_TRACE_INC(p->trace, sprite_evals);
+    NES_TIMELINE_BEGIN(tl_eval);
 
     p->scanline_sprite_count = 0;
     p->scanline_has_sprite0 = false;
@@ -236,7 +251,7 @@ static void evaluate_scanline_sprites(PPU2C02* p, int y)
 
     for (int i = 0; i < 64; i++) {
         int base = i * 4;
-        int sy = (int)p->oam[base] + 1;
+        int sy = (int)oam[base] + 1;
         if (y < sy || y >= sy + sprite_height) continue;
 
         if (p->scanline_sprite_count < 8) {
@@ -247,19 +262,21 @@ static void evaluate_scanline_sprites(PPU2C02* p, int y)
             break;
         }
     }
+    NES_TIMELINE_END_ARG(tl_eval, "sprite eval", y);
 }
 
 static bool sprite_palette_index_at(PPU2C02* p, int x, int y,
                                     u8* out_pal_index, bool* out_behind_bg,
                                     bool* out_sprite0)
 {
+    const u8* oam = oam_data(p);
     bool sprite_8x16 = (p->ctrl & 0x20u) != 0;
 
     for (int si = 0; si < (int)p->scanline_sprite_count; si++) {
         int i = (int)p->scanline_sprites[si];
         int base = i * 4;
-        int sy = (int)p->oam[base] + 1;
-        int tile_x = (int)p->oam[base + 3];
+        int sy = (int)oam[base] + 1;
+        int tile_x = (int)oam[base + 3];
         int sprite_height = sprite_8x16 ? 16 : 8;
 
         if (x < tile_x || x >= tile_x + 8) continue;
@@ -268,11 +285,11 @@ static bool sprite_palette_index_at(PPU2C02* p, int x, int y,
         int row = y - sy;
         int col = x - tile_x;
 
-        u8 attr = p->oam[base + 2];
+        u8 attr = oam[base + 2];
         if (attr & 0x80u) row = (sprite_height - 1) - row;
         if (attr & 0x40u) col = 7 - col;
 
-        u8 tile = p->oam[base + 1];
+        u8 tile = oam[base + 1];
         u16 patt_addr;
         if (sprite_8x16) {
             u16 table_base = (tile & 0x01u) ? 0x1000u : 0x0000u;
@@ -319,6 +336,14 @@ static void render_visible_dot(PPU2C02* p)
         p->sprite_eval_scanline = y;
     }
 
+    // Only the sprite 0 hit flag is observable without a picture, and only
+    // under sprite 0 on a line that has it.
+    if (p->skip_pixels) {
+        if (!p->scanline_has_sprite0) return;
+        int sx = (int)oam_data(p)[3];
+        if (x < sx || x >= sx + 8) return;
+    }
+
     bool show_bg = (p->mask & PPUMASK_BG_SHOW) != 0;
     bool show_spr = (p->mask & PPUMASK_SPR_SHOW) != 0;
     bool show_left_bg = (p->mask & PPUMASK_BG_LEFT) != 0;
@@ -356,7 +381,7 @@ static void render_visible_dot(PPU2C02* p)
         out_pal = bg_pal_index;
     }
 
-    p->fb[y * PPU_FB_W + x] = palette_color(p, out_pal);
+    if (!p->skip_pixels) p->fb[y * PPU_FB_W + x] = palette_color(p, out_pal);
 }
 
 bool PPU2C02_Init(PPU2C02* p, Cart* cart)
@@ -403,10 +428,30 @@ void PPU2C02_Reset(PPU2C02* p)
     p->scanline_overflow = false;
     p->sprite_eval_scanline = -2;
 
+    memset(p->nt_borrow, 0, sizeof(p->nt_borrow));
+    p->oam_borrow = NULL;
     memset(p->nametables, 0, sizeof(p->nametables));
     memset(p->palette, 0, sizeof(p->palette));
     memset(p->oam, 0, sizeof(p->oam));
     memset(p->fb, 0, sizeof(p->fb));
+
+    NesDirty_MarkAll(&p->nt_dirty, sizeof(p->nametables) >> NES_PAGE_SHIFT);
+    p->palette_dirty = 1u;
+    p->oam_dirty = 1u;
+}
+
+void PPU2C02_WriteOAM(PPU2C02* p, u8 data)
+{
+    if (!p) return;
+
+    if (p->oam_borrow) {
+        memcpy(p->oam, p->oam_borrow, sizeof(p->oam));
+        p->oam_borrow = NULL;
+    }
+
+    p->oam[p->oam_addr] = data;
+    p->oam_addr++;
+    NesDirty_Mark(&p->oam_dirty, 0);
 }
 
 void PPU2C02_SetCart(PPU2C02* p, Cart* cart)
@@ -430,7 +475,7 @@ u8 PPU2C02_CPURead(PPU2C02* p, u16 addr, u8 open_bus)
         }
 
         case 4:
-            return p->oam[p->oam_addr];
+            return oam_data(p)[p->oam_addr];
 
         case 7: {
             u8 data = ppu_mem_read(p, p->v);
@@ -476,8 +521,7 @@ void PPU2C02_CPUWrite(PPU2C02* p, u16 addr, u8 data)
             break;
 
         case 4:
-            p->oam[p->oam_addr] = data;
-            p->oam_addr++;
+            PPU2C02_WriteOAM(p, data);
             break;
 
         case 5:
@@ -521,6 +565,10 @@ void PPU2C02_Clock(PPU2C02* p)
     bool rendering = (p->mask & (PPUMASK_BG_SHOW | PPUMASK_SPR_SHOW)) != 0;
     bool visible_scanline = (p->scanline >= 0 && p->scanline < 240);
     bool prerender_scanline = (p->scanline == -1);
+    NES_TRACE_INC(p->trace, ppu_dots[visible_scanline ? NES_TRACE_LINE_VISIBLE
+                                     : prerender_scanline ? NES_TRACE_LINE_PRE
+                                     : p->scanline == 240 ? NES_TRACE_LINE_POST
+                                     : NES_TRACE_LINE_VBLANK]);
 
     if (visible_scanline && p->cycle >= 1 && p->cycle <= 256) {
         render_visible_dot(p);
@@ -579,6 +627,8 @@ void PPU2C02_Clock(PPU2C02* p)
 
     p->cycle++;
     if (p->cycle > 340) {
+        if (p->scanline_fn && visible_scanline) p->scanline_fn(p->scanline_user, p->scanline);
+
         p->cycle = 0;
         p->scanline++;
         p->sprite_eval_scanline = -2;
@@ -0,0 +1,390 @@
+#include "nes/state.h"
+#include "nes/log.h"
+#include "nes/mapper.h"
+#include "nes/util/bitops.h"
+#include "nes/util/cow.h"
+#include "nes/util/dirty.h"
+#include "nes/util/hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    NES_STATE_MAGIC   = 0x5353454Eu, // "NESS"
+    NES_STATE_VERSION = 1,
+
+    RAM_PAGES = 2048u >> NES_PAGE_SHIFT,
+    NT_PAGES  = 2048u >> NES_PAGE_SHIFT
+};
+
+typedef struct NesStateHeader {
+    u32 magic;
+    u32 version;
+    u32 size;
+    u32 mapper;
+} NesStateHeader;
+
+// Bus and PPU fields declared before their borrow tables are plain state.
+#define BUS_PLAIN_BYTES offsetof(Bus, ram_borrow)
+#define PPU_PLAIN_BYTES offsetof(PPU2C02, nt_borrow)
+
+// The APU's host-side tail (output bookkeeping and bindings) lives inside the
+// plain Bus bytes but is not emulated state.
+#define APU_HOST_OFFSET (offsetof(Bus, apu) + offsetof(APU2A03, amp))
+#define APU_HOST_BYTES  (sizeof(APU2A03) - offsetof(APU2A03, amp))
+
+static void put(u8** p, const void* src, size_t n)
+{
+    memcpy(*p, src, n);
+    *p += n;
+}
+
+static void get(const u8** p, void* dst, size_t n)
+{
+    memcpy(dst, *p, n);
+    *p += n;
+}
+
+static u32 region_pages(u32 size)
+{
+    return (size + NES_PAGE_MASK) >> NES_PAGE_SHIFT;
+}
+
+static size_t mapper_blob_size(const Mapper* m)
+{
+    return (m && m->size > sizeof(Mapper)) ? (size_t)m->size - sizeof(Mapper) : 0u;
+}
+
+static u32 cart_chr_ram_size(const Cart* c)
+{
+    return (c->chr && c->chr_is_ram) ? c->chr_size : 0u;
+}
+
+static u32 cart_prg_ram_size(const Cart* c)
+{
+    return c->prg_ram ? c->prg_ram_size : 0u;
+}
+
+// Writes a possibly fork-borrowed region of `size` bytes.
+static void put_region(u8** p, const u8* own, const u8* const* borrow, u32 size)
+{
+    if (borrow) {
+        NesCow_CopyOut(*p, own, borrow, size >> NES_PAGE_SHIFT);
+        *p += size;
+    } else {
+        put(p, own, size);
+    }
+}
+
+size_t NES_StateSize(const Nes* n)
+{
+    if (!n) return 0;
+
+    const Cart* c = &n->cart;
+    return sizeof(NesStateHeader)
+         + sizeof(CPU6502)
+         + BUS_PLAIN_BYTES + sizeof(n->bus.ram)
+         + PPU_PLAIN_BYTES + sizeof(n->bus.ppu.nametables) + sizeof(n->bus.ppu.oam)
+         + cart_prg_ram_size(c) + cart_chr_ram_size(c)
+         + mapper_blob_size(c->mapper)
+         + sizeof(n->frame_count) + sizeof(n->input);
+}
+
+bool NES_SaveState(const Nes* n, void* buf, size_t size)
+{
+    if (!n || !buf || !n->cart.mapper) return false;
+
+    size_t need = NES_StateSize(n);
+    if (size < need) {
+        NES_LOGE("NES_SaveState: buffer too small (%zu < %zu)", size, need);
+        return false;
+    }
+
+    const Cart* c = &n->cart;
+    const PPU2C02* ppu = &n->bus.ppu;
+    u8* p = (u8*)buf;
+
+    NesStateHeader h = { NES_STATE_MAGIC, NES_STATE_VERSION, (u32)need, c->mapper->id };
+    put(&p, &h, sizeof(h));
+
+    // Host pointers are zeroed so equal consoles produce equal states.
+    CPU6502 cpu = n->cpu;
+    cpu.bus = NULL;
+    put(&p, &cpu, sizeof(cpu));
+
+    u8* head = p;
+    put(&p, &n->bus, BUS_PLAIN_BYTES);
+    memset(head + offsetof(Bus, cart), 0, sizeof(n->bus.cart));
+    memset(head + APU_HOST_OFFSET, 0, APU_HOST_BYTES);
+    put_region(&p, n->bus.ram, n->bus.ram_borrow, sizeof(n->bus.ram));
+
+    head = p;
+    put(&p, ppu, PPU_PLAIN_BYTES);
+    memset(head + offsetof(PPU2C02, cart), 0, sizeof(ppu->cart));
+    put_region(&p, ppu->nametables, ppu->nt_borrow, sizeof(ppu->nametables));
+    put(&p, ppu->oam_borrow ? ppu->oam_borrow : ppu->oam, sizeof(ppu->oam));
+
+    if (c->prg_ram) put_region(&p, c->prg_ram, c->prg_ram_borrow, c->prg_ram_size);
+    if (cart_chr_ram_size(c)) put_region(&p, c->chr, c->chr_borrow, c->chr_size);
+    put(&p, (const u8*)c->mapper + sizeof(Mapper), mapper_blob_size(c->mapper));
+
+    put(&p, &n->frame_count, sizeof(n->frame_count));
+    put(&p, &n->input, sizeof(n->input));
+    return true;
+}
+
+bool NES_LoadState(Nes* n, const void* buf, size_t size)
+{
+    if (!n || !buf || !n->cart.mapper) return false;
+
+    if (atomic_load(&n->fork_children) > 0) {
+        NES_LOGE("NES_LoadState: refused, console has live forks");
+        return false;
+    }
+
+    NesStateHeader h;
+    if (size < sizeof(h)) return false;
+    memcpy(&h, buf, sizeof(h));
+
+    Cart* c = &n->cart;
+    size_t need = NES_StateSize(n);
+    if (h.magic != NES_STATE_MAGIC || h.version != NES_STATE_VERSION ||
+        h.size != need || size < need || h.mapper != c->mapper->id) {
+        NES_LOGE("NES_LoadState: state does not match this console");
+        return false;
+    }
+
+    const u8* p = (const u8*)buf + sizeof(h);
+    PPU2C02* ppu = &n->bus.ppu;
+
+    // Pointers are kept from the destination; everything else comes from buf.
+    Bus* cpu_bus = n->cpu.bus;
+    get(&p, &n->cpu, sizeof(n->cpu));
+    n->cpu.bus = cpu_bus;
+
+    Cart* bus_cart = n->bus.cart;
+    u8 apu_host[APU_HOST_BYTES];
+    memcpy(apu_host, (u8*)&n->bus + APU_HOST_OFFSET, APU_HOST_BYTES);
+    get(&p, &n->bus, BUS_PLAIN_BYTES);
+    n->bus.cart = bus_cart;
+    memcpy((u8*)&n->bus + APU_HOST_OFFSET, apu_host, APU_HOST_BYTES);
+    APU2A03_SetOutput(&n->bus.apu, n->audio);
+    memset(n->bus.ram_borrow, 0, sizeof(n->bus.ram_borrow));
+    get(&p, n->bus.ram, sizeof(n->bus.ram));
+    NesDirty_MarkAll(&n->bus.ram_dirty, RAM_PAGES);
+
+    Cart* ppu_cart = ppu->cart;
+    get(&p, ppu, PPU_PLAIN_BYTES);
+    ppu->cart = ppu_cart;
+    memset(ppu->nt_borrow, 0, sizeof(ppu->nt_borrow));
+    ppu->oam_borrow = NULL;
+    get(&p, ppu->nametables, sizeof(ppu->nametables));
+    get(&p, ppu->oam, sizeof(ppu->oam));
+    NesDirty_MarkAll(&ppu->nt_dirty, NT_PAGES);
+    ppu->palette_dirty = 1u;
+    ppu->oam_dirty = 1u;
+
+    if (c->prg_ram) {
+        free(c->prg_ram_borrow);
+        c->prg_ram_borrow = NULL;
+        get(&p, c->prg_ram, c->prg_ram_size);
+    }
+    if (cart_chr_ram_size(c)) {
+        free(c->chr_borrow);
+        c->chr_borrow = NULL;
+        get(&p, c->chr, c->chr_size);
+    }
+    Cart_MarkAllDirty(c);
+    get(&p, (u8*)c->mapper + sizeof(Mapper), mapper_blob_size(c->mapper));
+
+    get(&p, &n->frame_count, sizeof(n->frame_count));
+    get(&p, &n->input, sizeof(n->input));
+    return true;
+}
+
+static u64 hash_region(u64 h, const u8* own, const u8* const* borrow, u32 size)
+{
+    for (u32 off = 0; off < size; off += NES_PAGE_SIZE) {
+        const u8* pg = borrow ? borrow[off >> NES_PAGE_SHIFT] : NULL;
+        u32 len = size - off < NES_PAGE_SIZE ? size - off : NES_PAGE_SIZE;
+        h = Hash_Bytes64(h, pg ? pg : own + off, len);
+    }
+    return h;
+}
+
+u64 NES_StateFingerprint(const Nes* n)
+{
+    if (!n) return 0;
+
+    const CPU6502* cpu = &n->cpu;
+    const PPU2C02* ppu = &n->bus.ppu;
+    const Cart* c = &n->cart;
+
+    // Scalars little-endian, so the hash does not depend on field layout.
+    u8 regs[32];
+    u32 k = 0;
+    regs[k++] = (u8)cpu->pc;
+    regs[k++] = (u8)(cpu->pc >> 8);
+    regs[k++] = cpu->a;
+    regs[k++] = cpu->x;
+    regs[k++] = cpu->y;
+    regs[k++] = cpu->p;
+    regs[k++] = cpu->sp;
+    for (u32 i = 0; i < 8u; i++) regs[k++] = (u8)(cpu->cycles >> (i * 8u));
+    for (u32 i = 0; i < 8u; i++) regs[k++] = (u8)(n->frame_count >> (i * 8u));
+
+    u64 h = Hash_Bytes64(HASH_FNV64_SEED, regs, k);
+    h = hash_region(h, n->bus.ram, n->bus.ram_borrow, sizeof(n->bus.ram));
+    h = hash_region(h, ppu->nametables, ppu->nt_borrow, sizeof(ppu->nametables));
+    h = Hash_Bytes64(h, ppu->palette, sizeof(ppu->palette));
+    h = Hash_Bytes64(h, ppu->oam_borrow ? ppu->oam_borrow : ppu->oam, sizeof(ppu->oam));
+    if (c->prg_ram) h = hash_region(h, c->prg_ram, c->prg_ram_borrow, c->prg_ram_size);
+    if (cart_chr_ram_size(c)) h = hash_region(h, c->chr, c->chr_borrow, c->chr_size);
+    return h;
+}
+
+Nes* NES_Fork(Nes* parent)
+{
+    if (!parent || !parent->cart.mapper) return NULL;
+
+    // Not zeroed: every field except the framebuffers is written below.
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    if (!n) return NULL;
+
+    memset(&n->cart, 0, sizeof(n->cart));
+    if (!Cart_Fork(&n->cart, &parent->cart)) {
+        free(n);
+        return NULL;
+    }
+
+    n->cpu = parent->cpu;
+    n->cpu.bus = &n->bus;
+
+    memcpy(&n->bus, &parent->bus, BUS_PLAIN_BYTES);
+    n->bus.cart = &n->cart;
+    Bus_BindAPU(&n->bus);
+    n->bus.apu.out = NULL;
+    n->bus.input_poll = NULL;
+    n->bus.input_user = NULL;
+    n->bus.input_armed = false;
+    n->bus.exec_log = NULL;
+    n->bus.profiler = NULL;
+    n->bus.debug = NULL;
+    NesCow_BorrowAll(n->bus.ram_borrow, parent->bus.ram, parent->bus.ram_borrow, RAM_PAGES);
+    n->bus.ram_dirty = 0;
+
+    PPU2C02* ppu = &n->bus.ppu;
+    const PPU2C02* src = &parent->bus.ppu;
+    memcpy(ppu, src, PPU_PLAIN_BYTES);
+    ppu->cart = &n->cart;
+    NesCow_BorrowAll(ppu->nt_borrow, src->nametables, src->nt_borrow, NT_PAGES);
+    ppu->oam_borrow = src->oam_borrow ? src->oam_borrow : src->oam;
+    ppu->nt_dirty = 0;
+    ppu->palette_dirty = 0;
+    ppu->oam_dirty = 0;
+    ppu->skip_pixels = src->skip_pixels;
+    ppu->scanline_fn = NULL;
+    ppu->scanline_user = NULL;
+#if NES_TRACE
+    NesTrace_Reset(&n->trace);
+    n->trace_out = NULL;
+    n->trace_every = 0;
+    n->bus.trace = &n->trace;
+    ppu->trace = &n->trace;
+#endif
+
+    n->frame_count = parent->frame_count;
+    n->input = parent->input;
+    n->quiet = parent->quiet;
+    n->audio = NULL;
+
+    n->fork_parent = parent;
+    atomic_init(&n->fork_children, 0);
+    atomic_fetch_add(&parent->fork_children, 1);
+    return n;
+}
+
+void NES_FreeFork(Nes* child)
+{
+    if (!child) return;
+    NES_Destroy(child);
+    free(child);
+}
+
+u32 NES_ForkSharedPages(const Nes* n)
+{
+    if (!n) return 0;
+
+    const Cart* c = &n->cart;
+    const PPU2C02* ppu = &n->bus.ppu;
+
+    u32 pages = NesCow_BorrowedCount(n->bus.ram_borrow, RAM_PAGES)
+              + NesCow_BorrowedCount(ppu->nt_borrow, NT_PAGES)
+              + (ppu->oam_borrow ? 1u : 0u);
+    if (c->prg_ram) pages += NesCow_BorrowedCount(c->prg_ram_borrow, c->prg_ram_size >> NES_PAGE_SHIFT);
+    if (cart_chr_ram_size(c)) pages += NesCow_BorrowedCount(c->chr_borrow, c->chr_size >> NES_PAGE_SHIFT);
+    return pages;
+}
+
+static u64* dirty_bits(Nes* n, NesMemRegion r, u32* out_pages)
+{
+    Cart* c = &n->cart;
+    PPU2C02* ppu = &n->bus.ppu;
+    u64* bits = NULL;
+    u32 pages = 0;
+
+    switch (r) {
+        case NES_MEM_RAM:       bits = &n->bus.ram_dirty; pages = RAM_PAGES; break;
+        case NES_MEM_PRG_RAM:   bits = c->prg_ram_dirty; pages = region_pages(c->prg_ram_size); break;
+        case NES_MEM_CHR_RAM:   bits = c->chr_dirty; pages = region_pages(c->chr_size); break;
+        case NES_MEM_NAMETABLE: bits = &ppu->nt_dirty; pages = NT_PAGES; break;
+        case NES_MEM_PALETTE:   bits = &ppu->palette_dirty; pages = 1u; break;
+        case NES_MEM_OAM:       bits = &ppu->oam_dirty; pages = 1u; break;
+        default: break;
+    }
+
+    if (!bits) pages = 0;
+    if (out_pages) *out_pages = pages;
+    return bits;
+}
+
+const u64* NES_DirtyBitmap(const Nes* n, NesMemRegion r, u32* out_pages)
+{
+    if (out_pages) *out_pages = 0;
+    if (!n || !NES_DIRTY_TRACKING) return NULL;
+    return dirty_bits((Nes*)n, r, out_pages);
+}
+
+bool NES_PageDirty(const Nes* n, NesMemRegion r, u32 page)
+{
+    u32 pages = 0;
+    const u64* bits = NES_DirtyBitmap(n, r, &pages);
+    if (!bits || page >= pages) return false;
+    return (bits[page >> 6] >> (page & 63u)) & 1u;
+}
+
+u32 NES_DirtyPageCount(const Nes* n, NesMemRegion r)
+{
+    u32 pages = 0;
+    const u64* bits = NES_DirtyBitmap(n, r, &pages);
+    if (!bits) return 0;
+
+    u32 count = 0;
+    for (u32 w = 0; w < NesDirty_Words(pages); w++) {
+        count += Bit_Popcount64(bits[w]);
+    }
+    return count;
+}
+
+void NES_ClearDirty(Nes* n, NesMemRegion r)
+{
+    if (!n) return;
+
+    u32 pages = 0;
+    u64* bits = dirty_bits(n, r, &pages);
+    if (bits) memset(bits, 0, sizeof(u64) * NesDirty_Words(pages));
+}
+
+void NES_ClearAllDirty(Nes* n)
+{
+    for (int r = 0; r < NES_MEM_REGION_COUNT; r++) NES_ClearDirty(n, (NesMemRegion)r);
+}
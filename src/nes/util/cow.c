@@ -0,0 +1,43 @@
+#include "nes/util/cow.h"
+
+void NesCow_BorrowAll(const u8** dst_borrow, const u8* src_own,
+                      const u8* const* src_borrow, u32 pages)
+{
+    if (!dst_borrow) return;
+
+    for (u32 i = 0; i < pages; i++) {
+        const u8* pg = src_borrow ? src_borrow[i] : NULL;
+        dst_borrow[i] = pg ? pg : src_own + ((size_t)i << NES_PAGE_SHIFT);
+    }
+}
+
+void NesCow_Materialize(u8* own, const u8** borrow, u32 pages)
+{
+    if (!borrow) return;
+
+    for (u32 i = 0; i < pages; i++) {
+        if (!borrow[i]) continue;
+        memcpy(own + ((size_t)i << NES_PAGE_SHIFT), borrow[i], NES_PAGE_SIZE);
+        borrow[i] = NULL;
+    }
+}
+
+void NesCow_CopyOut(u8* dst, const u8* own, const u8* const* borrow, u32 pages)
+{
+    for (u32 i = 0; i < pages; i++) {
+        const u8* pg = borrow ? borrow[i] : NULL;
+        size_t off = (size_t)i << NES_PAGE_SHIFT;
+        memcpy(dst + off, pg ? pg : own + off, NES_PAGE_SIZE);
+    }
+}
+
+u32 NesCow_BorrowedCount(const u8* const* borrow, u32 pages)
+{
+    if (!borrow) return 0;
+
+    u32 n = 0;
+    for (u32 i = 0; i < pages; i++) {
+        if (borrow[i]) n++;
+    }
+    return n;
+}
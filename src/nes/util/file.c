@@ -1,7 +1,18 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // mmap, fstat
+#endif
+
 #include "nes/util/file.h"
 #include <stdio.h>
 #include <stdlib.h>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 bool File_ReadAllBytes(const char* path, unsigned char** out_data, size_t* out_size)
 {
     if (!out_data || !out_size) return false;
@@ -36,3 +47,58 @@ void File_Free(void* p)
 {
     free(p);
 }
+
+bool File_Map(const char* path, FileMapping* out)
+{
+    if (!path || !out) return false;
+    out->data = NULL;
+    out->size = 0;
+    out->mapped = false;
+
+#if !defined(_WIN32)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0) {
+        close(fd);
+        return false;
+    }
+
+    if (st.st_size > 0) {
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            close(fd);
+            out->data = (const unsigned char*)p;
+            out->size = (size_t)st.st_size;
+            out->mapped = true;
+            return true;
+        }
+    }
+    close(fd);
+#endif
+
+    unsigned char* data = NULL;
+    size_t size = 0;
+    if (!File_ReadAllBytes(path, &data, &size)) return false;
+
+    out->data = data;
+    out->size = size;
+    return true;
+}
+
+void File_Unmap(FileMapping* m)
+{
+    if (!m || !m->data) return;
+
+#if !defined(_WIN32)
+    if (m->mapped) munmap((void*)m->data, m->size);
+    else free((void*)m->data);
+#else
+    free((void*)m->data);
+#endif
+
+    m->data = NULL;
+    m->size = 0;
+    m->mapped = false;
+}
@@ -0,0 +1,31 @@
+#include "nes/util/framediff.h"
+#include "nes/util/hash.h"
+
+int FrameDiff_Update(FrameDiff* d, const u32* pixels, int w, int h, int* first, int* last)
+{
+    if (h <= 0 || w <= 0) return 0;
+
+    // Too tall to track, or a new size: everything changed.
+    bool known = d->rows == h && d->width == w;
+    if (h > FRAMEDIFF_MAX_ROWS) {
+        d->rows = 0;
+        *first = 0;
+        *last = h - 1;
+        return h;
+    }
+
+    size_t row_bytes = (size_t)w * sizeof(u32);
+    int changed = 0;
+    for (int y = 0; y < h; y++) {
+        u64 hash = Hash_Bytes64(HASH_FNV64_SEED, pixels + (size_t)y * (size_t)w, row_bytes);
+        if (known && hash == d->hashes[y]) continue;
+
+        d->hashes[y] = hash;
+        if (changed++ == 0) *first = y;
+        *last = y;
+    }
+
+    d->rows = h;
+    d->width = w;
+    return changed;
+}
@@ -0,0 +1,65 @@
+#include "nes/util/hash.h"
+#include <string.h>
+
+#define HASH_FNV64_PRIME 0x100000001B3ull
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HASH_BIG_ENDIAN 1
+#else
+#define HASH_BIG_ENDIAN 0
+#endif
+
+static inline u64 load_le64(const u8* p)
+{
+    u64 w;
+    memcpy(&w, p, sizeof(w));
+#if HASH_BIG_ENDIAN
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+u64 Hash_Bytes64(u64 seed, const void* data, size_t size)
+{
+    const u8* p = (const u8*)data;
+    u64 h = seed;
+
+    // Word at a time, 8x fewer multiplies than a byte-wise FNV-1a.
+    while (size >= 8u) {
+        h = (h ^ load_le64(p)) * HASH_FNV64_PRIME;
+        h ^= h >> 29;
+        p += 8;
+        size -= 8u;
+    }
+
+    while (size > 0u) {
+        h = (h ^ *p++) * HASH_FNV64_PRIME;
+        size--;
+    }
+
+    return h;
+}
+
+u64 Hash_U32s64(u64 seed, const u32* data, size_t count)
+{
+#if HASH_BIG_ENDIAN
+    // Serialised in pieces of a multiple of 8 bytes, which chain exactly.
+    u8 buf[1024];
+    u64 h = seed;
+    while (count > 0u) {
+        size_t n = count < sizeof(buf) / 4u ? count : sizeof(buf) / 4u;
+        for (size_t i = 0; i < n; i++) {
+            buf[i * 4u + 0u] = (u8)data[i];
+            buf[i * 4u + 1u] = (u8)(data[i] >> 8);
+            buf[i * 4u + 2u] = (u8)(data[i] >> 16);
+            buf[i * 4u + 3u] = (u8)(data[i] >> 24);
+        }
+        h = Hash_Bytes64(h, buf, n * 4u);
+        data += n;
+        count -= n;
+    }
+    return h;
+#else
+    return Hash_Bytes64(seed, data, count * sizeof(u32));
+#endif
+}
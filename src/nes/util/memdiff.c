@@ -0,0 +1,44 @@
+#include "nes/util/memdiff.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MEMDIFF_HAVE_SSE2 1
+#else
+#define MEMDIFF_HAVE_SSE2 0
+#endif
+
+size_t Mem_FirstDiff(const void* a, const void* b, size_t n)
+{
+    const u8* p = (const u8*)a;
+    const u8* q = (const u8*)b;
+    size_t i = 0;
+
+#if MEMDIFF_HAVE_SSE2
+    // Equal blocks are the common case: fold four compares into one mask
+    // and leave locating the byte to the narrower loops below.
+    for (; i + 64u <= n; i += 64u) {
+        __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)),
+                                    _mm_loadu_si128((const __m128i*)(q + i)));
+        __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 16u)),
+                                    _mm_loadu_si128((const __m128i*)(q + i + 16u)));
+        __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 32u)),
+                                    _mm_loadu_si128((const __m128i*)(q + i + 32u)));
+        __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i + 48u)),
+                                    _mm_loadu_si128((const __m128i*)(q + i + 48u)));
+        __m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+        if (_mm_movemask_epi8(all) != 0xFFFF) break;
+    }
+#endif
+
+    for (; i + 8u <= n; i += 8u) {
+        u64 x, y;
+        memcpy(&x, p + i, sizeof(x));
+        memcpy(&y, q + i, sizeof(y));
+        if (x != y) break;
+    }
+    for (; i < n; i++) {
+        if (p[i] != q[i]) return i;
+    }
+    return n;
+}
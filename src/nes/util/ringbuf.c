@@ -0,0 +1,103 @@
+#include "nes/util/ringbuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool RingBuf_Init(RingBuf* rb, u32 min_capacity, u32 elem_size)
+{
+    if (!rb || min_capacity == 0u || elem_size == 0u || min_capacity > (1u << 30)) return false;
+
+    u32 capacity = 1u;
+    while (capacity < min_capacity) capacity <<= 1;
+
+    memset(rb, 0, sizeof(*rb));
+    rb->data = (u8*)malloc((size_t)capacity * elem_size);
+    if (!rb->data) return false;
+
+    rb->capacity = capacity;
+    rb->mask = capacity - 1u;
+    rb->elem_size = elem_size;
+    atomic_init(&rb->head, 0u);
+    atomic_init(&rb->tail, 0u);
+    atomic_init(&rb->overruns, 0u);
+    atomic_init(&rb->underruns, 0u);
+    return true;
+}
+
+void RingBuf_Destroy(RingBuf* rb)
+{
+    if (!rb) return;
+    free(rb->data);
+    rb->data = NULL;
+    rb->capacity = 0;
+}
+
+// Copies `count` elements between the ring (starting at index `pos`) and a
+// linear buffer, splitting at the wrap point.
+static void copy_in(RingBuf* rb, u32 pos, const u8* src, u32 count)
+{
+    u32 at = pos & rb->mask;
+    u32 first = rb->capacity - at;
+    if (first > count) first = count;
+
+    memcpy(rb->data + (size_t)at * rb->elem_size, src, (size_t)first * rb->elem_size);
+    memcpy(rb->data, src + (size_t)first * rb->elem_size, (size_t)(count - first) * rb->elem_size);
+}
+
+static void copy_out(const RingBuf* rb, u32 pos, u8* dst, u32 count)
+{
+    u32 at = pos & rb->mask;
+    u32 first = rb->capacity - at;
+    if (first > count) first = count;
+
+    memcpy(dst, rb->data + (size_t)at * rb->elem_size, (size_t)first * rb->elem_size);
+    memcpy(dst + (size_t)first * rb->elem_size, rb->data, (size_t)(count - first) * rb->elem_size);
+}
+
+u32 RingBuf_Write(RingBuf* rb, const void* src, u32 count)
+{
+    if (!rb || !rb->data || !src) return 0;
+
+    u32 head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    u32 space = rb->capacity - (head - tail);
+
+    u32 n = (count < space) ? count : space;
+    if (n < count) atomic_fetch_add_explicit(&rb->overruns, 1u, memory_order_relaxed);
+    if (n == 0u) return 0;
+
+    copy_in(rb, head, (const u8*)src, n);
+    atomic_store_explicit(&rb->head, head + n, memory_order_release);
+    return n;
+}
+
+u32 RingBuf_Read(RingBuf* rb, void* dst, u32 count)
+{
+    if (!rb || !rb->data) return 0;
+
+    u32 tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    u32 avail = head - tail;
+
+    u32 n = (count < avail) ? count : avail;
+    if (n < count) atomic_fetch_add_explicit(&rb->underruns, 1u, memory_order_relaxed);
+    if (n == 0u) return 0;
+
+    if (dst) copy_out(rb, tail, (u8*)dst, n);
+    atomic_store_explicit(&rb->tail, tail + n, memory_order_release);
+    return n;
+}
+
+u32 RingBuf_Count(const RingBuf* rb)
+{
+    if (!rb) return 0;
+    u32 tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    u32 head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    return head - tail;
+}
+
+void RingBuf_Clear(RingBuf* rb)
+{
+    if (!rb) return;
+    u32 head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    atomic_store_explicit(&rb->tail, head, memory_order_release);
+}
@@ -0,0 +1,60 @@
+#include "nes/util/triplebuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool TripleBuf_Init(TripleBuf* tb, size_t size)
+{
+    if (!tb || size == 0) return false;
+    memset(tb, 0, sizeof(*tb));
+
+    size_t padded = (size + 63u) & ~(size_t)63u;
+    for (int i = 0; i < 3; i++) {
+        tb->slots[i] = (u8*)aligned_alloc(64, padded);
+        if (!tb->slots[i]) {
+            TripleBuf_Destroy(tb);
+            return false;
+        }
+        memset(tb->slots[i], 0, padded);
+    }
+
+    tb->size = size;
+    tb->back = 0;
+    tb->front = 2;
+    atomic_init(&tb->middle, 1u);
+    atomic_init(&tb->published, 0u);
+    atomic_init(&tb->dropped, 0u);
+    return true;
+}
+
+void TripleBuf_Destroy(TripleBuf* tb)
+{
+    if (!tb) return;
+    for (int i = 0; i < 3; i++) {
+        free(tb->slots[i]);
+        tb->slots[i] = NULL;
+    }
+}
+
+bool TripleBuf_Publish(TripleBuf* tb)
+{
+    u32 old = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLEBUF_FRESH, memory_order_acq_rel);
+    tb->back = old & 3u;
+    atomic_fetch_add_explicit(&tb->published, 1u, memory_order_relaxed);
+
+    if (old & TRIPLEBUF_FRESH) {
+        atomic_fetch_add_explicit(&tb->dropped, 1u, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+const void* TripleBuf_Acquire(TripleBuf* tb, bool* fresh)
+{
+    bool got = (atomic_load_explicit(&tb->middle, memory_order_relaxed) & TRIPLEBUF_FRESH) != 0;
+    if (got) {
+        u32 old = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = old & 3u;
+    }
+    if (fresh) *fresh = got;
+    return tb->slots[tb->front];
+}
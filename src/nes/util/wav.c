@@ -0,0 +1,97 @@
+#include "nes/util/wav.h"
+#include "nes/log.h"
+#include "nes/util/hash.h"
+#include <string.h>
+
+static void put_le(u8* p, u32 v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) p[i] = (u8)(v >> (8 * i));
+}
+
+static void encode_header(const WavWriter* w, u8 out[WAV_HEADER_BYTES])
+{
+    u64 data = w->samples * w->channels * sizeof(s16);
+    u32 data32 = data > 0xFFFFFFFFull - 36u ? 0xFFFFFFFFu - 36u : (u32)data;
+    u16 align = (u16)(w->channels * sizeof(s16));
+
+    memcpy(out, "RIFF", 4);
+    put_le(out + 4, data32 + 36u, 4);
+    memcpy(out + 8, "WAVEfmt ", 8);
+    put_le(out + 16, 16u, 4);               // fmt chunk size
+    put_le(out + 20, 1u, 2);                // PCM
+    put_le(out + 22, w->channels, 2);
+    put_le(out + 24, w->sample_rate, 4);
+    put_le(out + 28, w->sample_rate * align, 4);
+    put_le(out + 32, align, 2);
+    put_le(out + 34, 16u, 2);               // bits per sample
+    memcpy(out + 36, "data", 4);
+    put_le(out + 40, data32, 4);
+}
+
+static void flush(WavWriter* w)
+{
+    if (w->used == 0u) return;
+
+    w->hash = Hash_Bytes64(w->hash, w->buf, w->used);
+    if (!w->failed && fwrite(w->buf, 1, w->used, w->f) != w->used) {
+        NES_LOGE("Wav: write failed");
+        w->failed = true;
+    }
+    w->used = 0;
+}
+
+bool Wav_Open(WavWriter* w, const char* path, u32 sample_rate, u16 channels)
+{
+    if (!w || !path || sample_rate == 0u || channels == 0u) return false;
+    memset(w, 0, offsetof(WavWriter, buf));
+
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        NES_LOGE("Wav: cannot create %s", path);
+        return false;
+    }
+
+    w->sample_rate = sample_rate;
+    w->channels = channels;
+    w->hash = HASH_FNV64_SEED;
+
+    // Placeholder header, rewritten with the final sizes on close.
+    u8 hdr[WAV_HEADER_BYTES];
+    encode_header(w, hdr);
+    if (fwrite(hdr, 1, sizeof(hdr), w->f) != sizeof(hdr)) {
+        fclose(w->f);
+        w->f = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool Wav_Write(WavWriter* w, const s16* samples, u32 count)
+{
+    if (!w || !w->f || (!samples && count)) return false;
+
+    for (u32 i = 0; i < count; i++) {
+        if (w->used == WAV_BUFFER_BYTES) flush(w);
+        u16 v = (u16)samples[i];
+        w->buf[w->used++] = (u8)v;
+        w->buf[w->used++] = (u8)(v >> 8);
+    }
+    w->samples += count / w->channels;
+    return !w->failed;
+}
+
+bool Wav_Close(WavWriter* w)
+{
+    if (!w || !w->f) return false;
+
+    flush(w);
+
+    u8 hdr[WAV_HEADER_BYTES];
+    encode_header(w, hdr);
+    bool ok = !w->failed &&
+              fseek(w->f, 0, SEEK_SET) == 0 &&
+              fwrite(hdr, 1, sizeof(hdr), w->f) == sizeof(hdr);
+    ok = (fclose(w->f) == 0) && ok;
+    w->f = NULL;
+    return ok;
+}
@@ -0,0 +1,239 @@
+#include "nes/apu/apu2a03.h"
+#include "nes/apu/blip.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { SAMPLE_RATE = 44100 };
+
+static u8 dmc_data(void* user, u16 addr)
+{
+    (void)user;
+    return (u8)(addr * 37u);
+}
+
+static void init_apu(APU2A03* a)
+{
+    assert(APU2A03_Init(a));
+    APU2A03_SetDMCReader(a, dmc_data, NULL);
+}
+
+// Runs `cycles` CPU cycles, closing an audio frame every 29781 cycles.
+static void run_cycles(APU2A03* a, u32 cycles)
+{
+    for (u32 i = 0; i < cycles; i++) {
+        APU2A03_Advance(a, 1u);
+        if (a->cycle % 29781u == 0u) APU2A03_EndFrame(a);
+    }
+}
+
+static void start_all_channels(APU2A03* a)
+{
+    APU2A03_Write(a, 0x4015, 0x1F);
+
+    APU2A03_Write(a, 0x4000, 0xBF);     // 50% duty, constant volume 15
+    APU2A03_Write(a, 0x4002, 0xFD);     // period 253 -> ~440 Hz
+    APU2A03_Write(a, 0x4003, 0x08);
+
+    APU2A03_Write(a, 0x4004, 0x7A);
+    APU2A03_Write(a, 0x4005, 0x9A);     // sweep up
+    APU2A03_Write(a, 0x4006, 0x40);
+    APU2A03_Write(a, 0x4007, 0x09);
+
+    APU2A03_Write(a, 0x4008, 0xFF);
+    APU2A03_Write(a, 0x400A, 0x80);
+    APU2A03_Write(a, 0x400B, 0x08);
+
+    APU2A03_Write(a, 0x400C, 0x0C);     // decaying envelope
+    APU2A03_Write(a, 0x400E, 0x03);
+    APU2A03_Write(a, 0x400F, 0x08);
+
+    APU2A03_Write(a, 0x4010, 0x4F);     // loop, fastest rate
+    APU2A03_Write(a, 0x4012, 0x00);
+    APU2A03_Write(a, 0x4013, 0x04);
+    APU2A03_Write(a, 0x4015, 0x1F);
+}
+
+static void test_pulse_tone_is_band_limited(void)
+{
+    APU2A03 a;
+    Blip blip;
+    init_apu(&a);
+    assert(Blip_Init(&blip, APU_CLOCK_RATE, SAMPLE_RATE, SAMPLE_RATE / 5));
+    APU2A03_SetOutput(&a, &blip);
+
+    APU2A03_Write(&a, 0x4015, 0x01);
+    APU2A03_Write(&a, 0x4000, 0xBF);
+    APU2A03_Write(&a, 0x4002, 0xFD);
+    APU2A03_Write(&a, 0x4003, 0x08);
+    APU2A03_Write(&a, 0x4017, 0x40);    // no frame IRQ
+
+    // One second; the length counter is halted by the loop flag.
+    int crossings = 0, peak = 0, collected = 0;
+    s16 prev = 0;
+    for (int frame = 0; frame < 60; frame++) {
+        run_cycles(&a, 29830u);
+        APU2A03_EndFrame(&a);
+
+        s16 buf[2048];
+        int n = Blip_ReadSamples(&blip, buf, 2048);
+        for (int i = 0; i < n; i++) {
+            if (frame >= 10) {
+                if ((buf[i] >= 0) != (prev >= 0)) crossings++;
+                if (abs(buf[i]) > peak) peak = abs(buf[i]);
+            }
+            prev = buf[i];
+        }
+        collected += n;
+    }
+
+    // 1789773 / (16 * 254) = 440.4 Hz over 50 frames -> ~733 half periods
+    int expected = (int)(2.0 * 1789773.0 / (16.0 * 254.0) * 50.0 * 29830.0 / 1789773.0);
+    assert(abs(crossings - expected) <= 4);
+    assert(peak > 1000 && peak < 32767);
+    assert(abs(collected - SAMPLE_RATE) < SAMPLE_RATE / 50);
+
+    APU2A03_SetOutput(&a, NULL);
+    Blip_Destroy(&blip);
+}
+
+static void test_length_counters_and_status(void)
+{
+    APU2A03 a;
+    init_apu(&a);
+
+    APU2A03_Write(&a, 0x4003, 0x08);    // ignored while disabled
+    assert((APU2A03_ReadStatus(&a, 0) & 0x01u) == 0u);
+
+    APU2A03_Write(&a, 0x4015, 0x0F);
+    APU2A03_Write(&a, 0x4003, 0x18);    // length index 3 -> 2 half frames
+    APU2A03_Write(&a, 0x400B, 0x08);
+    APU2A03_Write(&a, 0x400F, 0x08);
+    assert((APU2A03_ReadStatus(&a, 0) & 0x0Du) == 0x0Du);
+
+    run_cycles(&a, 14916u);
+    assert((APU2A03_ReadStatus(&a, 0) & 0x01u) == 0u);
+    assert((APU2A03_ReadStatus(&a, 0) & 0x04u) != 0u);
+
+    APU2A03_Write(&a, 0x4015, 0x00);
+    assert((APU2A03_ReadStatus(&a, 0) & 0x1Fu) == 0u);
+}
+
+// Runs until the DMC IRQ line rises; `eager` syncs the channels every cycle.
+static u64 dmc_irq_cycle(bool eager)
+{
+    APU2A03 a;
+    init_apu(&a);
+    APU2A03_Write(&a, 0x4017, 0x40);
+    APU2A03_Write(&a, 0x4010, 0x8F);    // IRQ, rate 54
+    APU2A03_Write(&a, 0x4013, 0x01);    // 17 bytes
+    run_cycles(&a, 123u);
+    APU2A03_Write(&a, 0x4015, 0x10);
+    assert((APU2A03_ReadStatus(&a, 0) & 0x10u) != 0u);
+
+    for (u32 i = 0; i < 100000u; i++) {
+        bool irq = APU2A03_Advance(&a, 1u);
+        if (eager) APU2A03_Run(&a);
+        if (irq) {
+            u8 status = APU2A03_ReadStatus(&a, 0);
+            assert((status & 0x90u) == 0x80u);
+            APU2A03_Write(&a, 0x4015, 0x00);
+            assert((APU2A03_ReadStatus(&a, 0) & 0x80u) == 0u);
+            return a.cycle;
+        }
+    }
+    assert(!"DMC IRQ never fired");
+    return 0;
+}
+
+static void test_dmc_irq_timing(void)
+{
+    u64 lazy = dmc_irq_cycle(false);
+    u64 eager = dmc_irq_cycle(true);
+    assert(lazy == eager);
+
+    // 16 bytes after the initial fetch, 8 output clocks of 54 cycles each
+    assert(lazy >= 123u + 15u * 8u * 54u && lazy <= 123u + 17u * 8u * 54u);
+}
+
+// Advancing in instruction-sized batches must match cycle-by-cycle stepping,
+// and the predicted frame IRQ cycle must be when the line actually rises.
+static void test_batched_advance_matches_single_cycles(void)
+{
+    APU2A03 single, batched;
+    init_apu(&single);
+    init_apu(&batched);
+    start_all_channels(&single);
+    start_all_channels(&batched);
+
+    u64 predicted = APU2A03_NextIRQCycle(&single);
+    assert(predicted == 14915u);
+
+    u64 rose = 0;
+    u32 chunk = 0;
+    while (batched.cycle < 200000u) {
+        chunk = chunk % 7u + 1u;
+        bool line = false;
+        for (u32 i = 0; i < chunk; i++) {
+            line = APU2A03_Advance(&single, 1u);
+            if (line && rose == 0u) rose = single.cycle;
+        }
+        assert(APU2A03_Advance(&batched, chunk) == line);
+
+        if (batched.cycle > 60000u && batched.cycle < 60008u) {
+            // $4015 read acknowledges the frame IRQ, $4017 restarts the sequence
+            assert(APU2A03_ReadStatus(&single, 0) == APU2A03_ReadStatus(&batched, 0));
+            APU2A03_Write(&single, 0x4017, 0x80);
+            APU2A03_Write(&batched, 0x4017, 0x80);
+        }
+    }
+    APU2A03_Run(&single);
+    APU2A03_Run(&batched);
+
+    assert(rose == predicted);
+    assert(memcmp(&single, &batched, offsetof(APU2A03, amp)) == 0);
+}
+
+// Attaching an output buffer must not change emulated state (movies are
+// recorded with audio and verified without).
+static void test_audio_does_not_affect_state(void)
+{
+    APU2A03 quiet, loud;
+    Blip blip;
+    init_apu(&quiet);
+    init_apu(&loud);
+    assert(Blip_Init(&blip, APU_CLOCK_RATE, SAMPLE_RATE, SAMPLE_RATE / 5));
+    APU2A03_SetOutput(&loud, &blip);
+
+    start_all_channels(&quiet);
+    start_all_channels(&loud);
+    for (int frame = 0; frame < 30; frame++) {
+        run_cycles(&quiet, 29781u);
+        run_cycles(&loud, 29781u);
+        Blip_ReadSamples(&blip, NULL, Blip_SamplesAvail(&blip));
+
+        u8 note = (u8)(frame * 13);
+        APU2A03_Write(&quiet, 0x4006, note);
+        APU2A03_Write(&loud, 0x4006, note);
+    }
+    APU2A03_Run(&quiet);
+    APU2A03_Run(&loud);
+
+    assert(memcmp(&quiet, &loud, offsetof(APU2A03, amp)) == 0);
+
+    APU2A03_SetOutput(&loud, NULL);
+    Blip_Destroy(&blip);
+}
+
+int main(void)
+{
+    test_pulse_tone_is_band_limited();
+    test_length_counters_and_status();
+    test_dmc_irq_timing();
+    test_batched_advance_matches_single_cycles();
+    test_audio_does_not_affect_state();
+    puts("apu: OK");
+    return 0;
+}
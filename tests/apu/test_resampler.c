@@ -0,0 +1,135 @@
+#include "nes/apu/resampler.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { RATE = 48000, BLOCK = 800 };
+
+static int count_crossings(const s16* x, u32 n, u32 skip)
+{
+    int c = 0;
+    for (u32 i = skip + 1u; i < n; i++) {
+        if ((x[i] >= 0) != (x[i - 1u] >= 0)) c++;
+    }
+    return c;
+}
+
+// Resamples one second of a 1 kHz tone in frame-sized blocks.
+static u32 resample_tone(Resampler* r, s16* out, u32 out_cap)
+{
+    s16 block[BLOCK];
+    u32 total = 0;
+    for (u32 b = 0; b < RATE / BLOCK; b++) {
+        for (u32 i = 0; i < BLOCK; i++) {
+            double t = (double)(b * BLOCK + i) / RATE;
+            block[i] = (s16)lrint(20000.0 * sin(2.0 * 3.14159265358979 * 1000.0 * t));
+        }
+        assert(out_cap - total >= Resampler_MaxOutput(r, BLOCK));
+        total += Resampler_Process(r, block, BLOCK, out + total, out_cap - total);
+    }
+    return total;
+}
+
+static void test_ratio_changes_output_rate_not_pitch(void)
+{
+    Resampler r;
+    assert(Resampler_Init(&r, RATE, RATE, BLOCK));
+    u32 cap = RATE * 2u;
+    s16* a = (s16*)malloc(cap * sizeof(s16));
+    s16* b = (s16*)malloc(cap * sizeof(s16));
+    assert(a && b);
+
+    u32 n1 = resample_tone(&r, a, cap);
+    assert(abs((int)n1 - RATE) <= RESAMPLER_TAPS);
+    int c1 = count_crossings(a, n1, 100);
+    assert(abs(c1 - 2000) <= 4);
+
+    // 0.5% more output samples cover the same input: the tone has the same
+    // number of cycles, so played 0.5% faster it keeps its pitch.
+    Resampler_Clear(&r);
+    Resampler_SetRatio(&r, 1.02);
+    assert(r.ratio == 1.0 + RESAMPLER_MAX_ADJUST);
+    u32 n2 = resample_tone(&r, b, cap);
+    assert(abs((int)n2 - (int)(RATE * 1.005)) <= RESAMPLER_TAPS);
+    int c2 = count_crossings(b, n2, 100);
+    assert(abs(c2 - c1) <= 4);
+
+    // Amplitude is preserved
+    int peak = 0;
+    for (u32 i = 100; i < n2; i++) if (abs(b[i]) > peak) peak = abs(b[i]);
+    assert(peak > 19500 && peak < 20500);
+
+    free(a);
+    free(b);
+    Resampler_Destroy(&r);
+}
+
+static void test_simd_matches_scalar(void)
+{
+    Resampler v, s;
+    assert(Resampler_Init(&v, RATE, RATE, BLOCK));
+    assert(Resampler_Init(&s, RATE, RATE, BLOCK));
+    s.use_simd = false;
+    Resampler_SetRatio(&v, 0.997);
+    Resampler_SetRatio(&s, 0.997);
+
+    u32 cap = RATE * 2u;
+    s16* a = (s16*)malloc(cap * sizeof(s16));
+    s16* b = (s16*)malloc(cap * sizeof(s16));
+    assert(a && b);
+
+    u32 na = resample_tone(&v, a, cap);
+    u32 nb = resample_tone(&s, b, cap);
+    assert(na == nb);
+    for (u32 i = 0; i < na; i++) assert(abs(a[i] - b[i]) <= 1);
+
+    free(a);
+    free(b);
+    Resampler_Destroy(&v);
+    Resampler_Destroy(&s);
+}
+
+// A ramp comes out as the ramp sampled at each output's exact input position
+// (8 samples of filter delay). Truncating to the phase below would bias every
+// output late by half a phase on average, 64/512 here.
+static void test_phase_is_nearest(void)
+{
+    Resampler r;
+    assert(Resampler_Init(&r, 44100.0, 48000.0, 512));
+    s16 in[512];
+    s16 out[1024];
+    for (int i = 0; i < 512; i++) in[i] = (s16)(i * 64 - 16000);
+    u32 n = Resampler_Process(&r, in, 512, out, 1024);
+    assert(n > 500u);
+
+    double step = 44100.0 / 48000.0;
+    double bias = 0.0;
+    for (u32 j = 40; j < n - 40u; j++) {
+        double want = ((double)j * step - 8.0) * 64.0 - 16000.0;
+        assert(fabs(out[j] - want) <= 1.0);
+        bias += out[j] - want;
+    }
+    bias /= (double)(n - 80u);
+    assert(fabs(bias) < 0.03);
+
+    Resampler_Destroy(&r);
+}
+
+static void test_drc_ratio(void)
+{
+    assert(Resampler_DRCRatio(1000, 1000) == 1.0);
+    assert(Resampler_DRCRatio(0, 1000) == 1.0 + RESAMPLER_MAX_ADJUST);
+    assert(Resampler_DRCRatio(5000, 1000) == 1.0 - RESAMPLER_MAX_ADJUST);
+    assert(Resampler_DRCRatio(500, 1000) > 1.0);
+}
+
+int main(void)
+{
+    test_ratio_changes_output_rate_not_pitch();
+    test_simd_matches_scalar();
+    test_phase_is_nearest();
+    test_drc_ratio();
+    printf("resampler (%s): OK\n", Resampler_Backend());
+    return 0;
+}
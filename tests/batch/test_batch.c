@@ -0,0 +1,108 @@
+#include "nes/batch.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NROM-128 image: strobe the pad, store A-button bit to $01, count loops in $00.
+static const u8 k_prog[] = {
+    0xA9, 0x01,       // LDA #$01
+    0x8D, 0x16, 0x40, // STA $4016
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x16, 0x40, // STA $4016
+    0xAD, 0x16, 0x40, // LDA $4016
+    0x29, 0x01,       // AND #$01
+    0x85, 0x01,       // STA $01
+    0xE6, 0x00,       // INC $00
+    0x4C, 0x00, 0x80  // JMP $8000
+};
+
+static bool done_after_two_frames(const Nes* n, int index, void* user)
+{
+    (void)index; (void)user;
+    return n->frame_count >= 2;
+}
+
+static void test_step_writes_ram_observations_per_input(void)
+{
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+
+    NesBatchConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.instances = 5;
+    cfg.threads = 2;
+    cfg.obs_flags = NES_BATCH_OBS_RAM;
+
+    NesBatch* b = NesBatch_CreateFromMemory(&cfg, rom, rom_size);
+    assert(b);
+    assert(NesBatch_Count(b) == 5);
+    assert(NesBatch_ObsStride(b) == 2048u);
+
+    // Instances share the PRG image instead of copying it.
+    assert(NesBatch_Instance(b, 0)->cart.prg_rom == NesBatch_Instance(b, 4)->cart.prg_rom);
+
+    NesInput in[5];
+    memset(in, 0, sizeof(in));
+    in[1].p1 = 0x01u;
+    in[3].p1 = 0x01u;
+
+    size_t obs_size = NesBatch_ObsStride(b) * 5u;
+    u8* obs = (u8*)malloc(obs_size);
+    assert(obs);
+
+    assert(NesBatch_Step(b, in, 1, obs, obs_size, NULL));
+
+    for (int i = 0; i < 5; i++) {
+        const u8* ram = obs + (size_t)i * NesBatch_ObsStride(b);
+        assert(ram[0x01] == ((i == 1 || i == 3) ? 1u : 0u));
+        assert(memcmp(ram, NesBatch_Instance(b, i)->bus.ram, 2048u) == 0);
+        assert(NesBatch_Instance(b, i)->frame_count == 1u);
+    }
+
+    NesBatchStats st;
+    NesBatch_GetStats(b, &st);
+    assert(st.frames == 5u);
+    assert(st.threads == 2);
+
+    free(obs);
+    NesBatch_Destroy(b);
+    free(rom);
+}
+
+static void test_done_instances_are_reset(void)
+{
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+
+    NesBatchConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.instances = 3;
+    cfg.threads = 3;
+    cfg.done_fn = done_after_two_frames;
+
+    NesBatch* b = NesBatch_CreateFromMemory(&cfg, rom, rom_size);
+    assert(b);
+
+    u8 done[3] = {0, 0, 0};
+    assert(NesBatch_Step(b, NULL, 1, NULL, 0, done));
+    for (int i = 0; i < 3; i++) assert(done[i] == 0u);
+
+    assert(NesBatch_Step(b, NULL, 1, NULL, 0, done));
+    for (int i = 0; i < 3; i++) {
+        assert(done[i] == 1u);
+        assert(NesBatch_Instance(b, i)->frame_count == 0u);
+    }
+
+    NesBatch_Destroy(b);
+    free(rom);
+}
+
+int main(void)
+{
+    test_step_writes_ram_observations_per_input();
+    test_done_instances_are_reset();
+    puts("batch: OK");
+    return 0;
+}
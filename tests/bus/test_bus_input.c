@@ -0,0 +1,78 @@
+#include "nes/bus.h"
+#include <assert.h>
+#include <stdio.h>
+
+typedef struct Pad {
+    NesInput state;
+    int polls;
+} Pad;
+
+static NesInput poll_pad(void* user)
+{
+    Pad* pad = (Pad*)user;
+    pad->polls++;
+    return pad->state;
+}
+
+static u8 read_p1(Bus* b)
+{
+    u8 v = 0;
+    for (int i = 0; i < 8; i++) {
+        v |= (u8)((Bus_CPURead(b, 0x4016) & 1u) << i);
+    }
+    return v;
+}
+
+static void test_provider_polled_once_at_first_strobe(void)
+{
+    Bus b;
+    assert(Bus_Init(&b, NULL));
+
+    Pad pad = { { 0x5Au, 0x00u }, 0 };
+    Bus_SetInputProvider(&b, poll_pad, &pad);
+    Bus_ArmInputPoll(&b);
+    assert(pad.polls == 0);
+
+    Bus_CPUWrite(&b, 0x4016, 1);
+    assert(pad.polls == 1);
+    Bus_CPUWrite(&b, 0x4016, 0);
+    assert(read_p1(&b) == 0x5Au);
+
+    // A second read in the same frame sees the same state.
+    pad.state.p1 = 0xFFu;
+    Bus_CPUWrite(&b, 0x4016, 1);
+    Bus_CPUWrite(&b, 0x4016, 0);
+    assert(pad.polls == 1);
+    assert(read_p1(&b) == 0x5Au);
+
+    Bus_ArmInputPoll(&b);
+    Bus_CPUWrite(&b, 0x4016, 1);
+    Bus_CPUWrite(&b, 0x4016, 0);
+    assert(pad.polls == 2);
+    assert(read_p1(&b) == 0xFFu);
+}
+
+static void test_unarmed_or_removed_provider_not_called(void)
+{
+    Bus b;
+    assert(Bus_Init(&b, NULL));
+
+    Pad pad = { { 0x01u, 0x00u }, 0 };
+    Bus_SetInputProvider(&b, poll_pad, &pad);
+    Bus_CPUWrite(&b, 0x4016, 1);
+    assert(pad.polls == 0);
+
+    Bus_SetInputProvider(&b, NULL, NULL);
+    Bus_ArmInputPoll(&b);
+    assert(!b.input_armed);
+    Bus_CPUWrite(&b, 0x4016, 1);
+    assert(pad.polls == 0);
+}
+
+int main(void)
+{
+    test_provider_polled_once_at_first_strobe();
+    test_unarmed_or_removed_provider_not_called();
+    puts("bus input: OK");
+    return 0;
+}
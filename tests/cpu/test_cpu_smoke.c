@@ -20,7 +20,7 @@ void Bus_CPUWrite(Bus* b, u16 addr, u8 data)
 
 static CPU6502 make_cpu(void)
 {
-    Bus bus;
+    static Bus bus;     // outlives the returned CPU, which keeps a pointer to it
     memset(&bus, 0, sizeof(bus));
 
     CPU6502 cpu;
@@ -116,6 +116,7 @@ static void test_irq_masking_and_service_behavior(void)
     assert(cyc == 2);           // NOP cycles
     assert(cpu.pc == 0x8001);   // NOP executed
     assert(cpu.irq_pending);    // still pending because I masked IRQ
+    assert(cpu.instructions == 1u);
 
     // Unmask IRQ and ensure pending IRQ is serviced on the next step.
     cpu.p &= (u8)~F_I;
@@ -126,6 +127,7 @@ static void test_irq_masking_and_service_behavior(void)
     assert(cpu.sp == 0xFA);
     assert((cpu.p & F_I) != 0);
     assert(!cpu.irq_pending);
+    assert(cpu.instructions == 1u);   // interrupt entry is not an instruction
 
     // IRQ push should have B clear and U set.
     assert(g_mem[0x01FD] == 0x80); // return hi ($8001)
@@ -0,0 +1,234 @@
+#include "nes/debug/trace.h"
+#include "nes/nes.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* k_trace_path = "test_exec_trace.tmp.nestrace";
+static const char* k_trace_path_b = "test_exec_trace_b.tmp.nestrace";
+
+// NROM-128 image: a counting loop with a branch, then JMP back.
+static const u8 k_prog[] = {
+    0xA2, 0x05,       // LDX #$05
+    0xCA,             // DEX
+    0xD0, 0xFD,       // BNE $8002
+    0xE6, 0x00,       // INC $00
+    0x4C, 0x00, 0x80  // JMP $8000
+};
+
+static NesTraceRecord make_record(u32 i)
+{
+    static const u8 ops[] = { 0xA9, 0xEA, 0x4C, 0xD0 };
+    NesTraceRecord r;
+    memset(&r, 0, sizeof(r));
+    r.cycle = 7u + (u64)i * 3u;
+    r.pc = (u16)(0xC000u + i * 2u);
+    r.opcode = ops[i % 4u];
+    r.operand[0] = NesTrace_OpLength(r.opcode) > 1u ? (u8)i : 0;    // only real operands are kept
+    r.operand[1] = NesTrace_OpLength(r.opcode) > 2u ? 0xC5 : 0;
+    r.a = (u8)(i / 3u);
+    r.x = 0x10;
+    r.y = (u8)(i & 1u);
+    r.p = 0x24;
+    r.sp = 0xFD;
+    r.scanline = (s16)((i * 9u / 341u) % 262u) - 1;
+    r.dot = (u16)(i * 9u % 341u);
+    if (i % 50u == 0u) r.dot = (u16)((r.dot + 1u) % 341u);     // off the prediction
+    return r;
+}
+
+static bool same_record(const NesTraceRecord* a, const NesTraceRecord* b)
+{
+    return a->cycle == b->cycle && a->pc == b->pc && a->scanline == b->scanline && a->dot == b->dot &&
+           a->opcode == b->opcode && a->operand[0] == b->operand[0] && a->operand[1] == b->operand[1] &&
+           a->a == b->a && a->x == b->x && a->y == b->y && a->p == b->p && a->sp == b->sp;
+}
+
+static void test_round_trip(void)
+{
+    enum { COUNT = 5000 };
+    NesTraceLog* log = NesTraceLog_Open(k_trace_path, 1u << 16);
+    assert(log);
+    for (u32 i = 0; i < COUNT; i++) {
+        NesTraceRecord r = make_record(i);
+        NesTraceLog_Push(log, &r);
+    }
+    assert(NesTraceLog_Records(log) == COUNT);
+    assert(NesTraceLog_Dropped(log) == 0);
+    assert(NesTraceLog_Close(log));
+
+    NesTraceReader rd;
+    assert(NesTraceReader_Open(&rd, k_trace_path));
+    NesTraceRecord got;
+    u32 n = 0;
+    while (NesTraceReader_Next(&rd, &got)) {
+        NesTraceRecord want = make_record(n++);
+        assert(same_record(&got, &want));
+    }
+    assert(n == COUNT);
+    assert(rd.complete && rd.records == COUNT && rd.dropped == 0);
+    NesTraceReader_Close(&rd);
+
+    // Delta-encoded: well under the raw record size.
+    FILE* f = fopen(k_trace_path, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    long bytes = ftell(f);
+    fclose(f);
+    assert(bytes > 0 && (size_t)bytes < COUNT * sizeof(NesTraceRecord) / 3u);
+    remove(k_trace_path);
+}
+
+static void write_trace(const char* path, u32 count, u32 changed_at)
+{
+    NesTraceLog* log = NesTraceLog_Open(path, 0);
+    assert(log);
+    for (u32 i = 0; i < count; i++) {
+        NesTraceRecord r = make_record(i);
+        if (i == changed_at) r.y ^= 0x80u;
+        NesTraceLog_Push(log, &r);
+    }
+    assert(NesTraceLog_Close(log));
+}
+
+static void test_diff(void)
+{
+    NesTraceDiff d;
+    write_trace(k_trace_path, 3000, UINT32_MAX);
+    write_trace(k_trace_path_b, 3000, UINT32_MAX);
+    assert(NesTrace_Diff(k_trace_path, k_trace_path_b, &d));
+    assert(!d.diverged && d.index == 3000u);
+
+    write_trace(k_trace_path_b, 3000, 2345);
+    assert(NesTrace_Diff(k_trace_path, k_trace_path_b, &d));
+    assert(d.diverged && d.index == 2345u && d.has_a && d.has_b);
+    assert(d.a.y != d.b.y && d.a.cycle == d.b.cycle);
+
+    // One trace is a prefix of the other.
+    write_trace(k_trace_path_b, 2000, UINT32_MAX);
+    assert(NesTrace_Diff(k_trace_path, k_trace_path_b, &d));
+    assert(d.diverged && d.index == 2000u && d.has_a && !d.has_b);
+
+    assert(!NesTrace_Diff(k_trace_path, "no_such_file.nestrace", &d));
+    remove(k_trace_path);
+    remove(k_trace_path_b);
+}
+
+// Long traces: decoding restarts at sync points for seeks and diffs.
+static void test_sync_points(void)
+{
+    enum { COUNT = 200000, SYNC = 1 << 16 };
+    write_trace(k_trace_path, COUNT, UINT32_MAX);
+
+    NesTraceReader rd;
+    assert(NesTraceReader_Open(&rd, k_trace_path));
+    assert(rd.sync_count == COUNT / SYNC);
+    NesTraceRecord got;
+    u32 n = 0;
+    while (NesTraceReader_Next(&rd, &got)) {
+        NesTraceRecord want = make_record(n++);
+        assert(same_record(&got, &want));
+    }
+    assert(n == COUNT && rd.complete);
+
+    assert(NesTraceReader_Seek(&rd, 140000));
+    assert(rd.index == 2u * SYNC);
+    assert(NesTraceReader_Next(&rd, &got) && rd.index == 2u * SYNC + 1u);
+    NesTraceRecord want = make_record(2u * SYNC);
+    assert(same_record(&got, &want));
+    assert(NesTraceReader_Seek(&rd, 100) && rd.index == 0);
+    assert(NesTraceReader_Next(&rd, &got) && got.cycle == make_record(0).cycle);
+    NesTraceReader_Close(&rd);
+
+    NesTraceDiff d;
+    static const u32 changes[] = { 150000, SYNC, SYNC - 1, COUNT - 1 };
+    for (u32 i = 0; i < sizeof(changes) / sizeof(changes[0]); i++) {
+        write_trace(k_trace_path_b, COUNT, changes[i]);
+        assert(NesTrace_Diff(k_trace_path, k_trace_path_b, &d));
+        assert(d.diverged && d.index == changes[i] && d.has_a && d.has_b);
+        want = make_record(changes[i]);
+        assert(same_record(&d.a, &want) && d.b.y != d.a.y);
+    }
+    remove(k_trace_path);
+    remove(k_trace_path_b);
+}
+
+static void test_format(void)
+{
+    NesTraceRecord r;
+    memset(&r, 0, sizeof(r));
+    r.pc = 0xC000;
+    r.opcode = 0x4C;
+    r.operand[0] = 0xF5;
+    r.operand[1] = 0xC5;
+    r.p = 0x24;
+    r.sp = 0xFD;
+    r.dot = 21;
+    r.cycle = 7;
+
+    char line[160];
+    NesTrace_FormatNestest(&r, line, sizeof(line));
+    assert(strcmp(line, "C000  4C F5 C5  JMP $C5F5                       "
+                        "A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7") == 0);
+
+    r.pc = 0xC72D;
+    r.opcode = 0xD0;    // BNE, relative target
+    r.operand[0] = 0xFD;
+    NesTrace_FormatNestest(&r, line, sizeof(line));
+    assert(strncmp(line, "C72D  D0 FD     BNE $C72C ", 26) == 0);
+}
+
+static void test_console_trace(void)
+{
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+
+    assert(NES_StartExecTrace(n, k_trace_path));
+    u64 insn0 = n->cpu.instructions;
+    u64 cyc0 = n->cpu.cycles;
+    NES_RunFrame(n);
+    u64 insns = n->cpu.instructions - insn0;
+    assert(NES_StopExecTrace(n));
+
+    NesTraceReader rd;
+    assert(NesTraceReader_Open(&rd, k_trace_path));
+    NesTraceRecord r;
+    assert(NesTraceReader_Next(&rd, &r));
+    assert(r.pc == 0x8000 && r.opcode == 0xA2 && r.operand[0] == 0x05 && r.cycle == cyc0);
+    assert(NesTraceReader_Next(&rd, &r));
+    assert(r.pc == 0x8002 && r.opcode == 0xCA && r.x == 0x05);
+    assert(NesTraceReader_Next(&rd, &r));
+    assert(r.pc == 0x8003 && r.opcode == 0xD0 && r.x == 0x04);
+    assert(NesTraceReader_Next(&rd, &r));
+    assert(r.pc == 0x8002);                     // branch taken
+
+    u64 count = 4;
+    u64 prev_cycle = r.cycle;
+    while (NesTraceReader_Next(&rd, &r)) {
+        assert(r.cycle > prev_cycle);
+        prev_cycle = r.cycle;
+        count++;
+    }
+    assert(rd.complete && rd.dropped == 0);
+    assert(count == insns && rd.records == insns);
+    NesTraceReader_Close(&rd);
+    remove(k_trace_path);
+    assert(!NES_StopExecTrace(n));              // already stopped
+
+    TestRom_FreeConsole(n);
+    free(rom);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_diff();
+    test_sync_points();
+    test_format();
+    test_console_trace();
+    puts("exec trace: OK");
+    return 0;
+}
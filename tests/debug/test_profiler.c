@@ -0,0 +1,243 @@
+#include "nes/debug/profiler.h"
+#include "nes/nes.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* k_rom_path = "test_profiler.tmp.nes";
+static const char* k_dbg_path = "test_profiler.tmp.dbg";
+
+enum { BANK = TEST_ROM_BANK, FIXED = 3 * BANK };
+
+static void put(u8* prg, u32 off, const u8* code, size_t n)
+{
+    memcpy(prg + off, code, n);
+}
+
+// UxROM, 4 PRG banks. The fixed bank's main loop calls $8000 with bank 0
+// (a 16-iteration loop) and bank 1 (two NOPs) switched in, then a nested
+// pair of subroutines; NMIs go to an RTI.
+static u8* make_test_rom(size_t* out_size)
+{
+    static const u8 main_loop[] = {
+        0x78,               // C000 SEI
+        0xA2, 0xFF,         // C001 LDX #$FF
+        0x9A,               // C003 TXS
+        0xA9, 0x80,         // C004 LDA #$80
+        0x8D, 0x00, 0x20,   // C006 STA $2000 (NMI on)
+        0xA9, 0x00,         // C009 LDA #$00
+        0x8D, 0x00, 0x80,   // C00B STA $8000 (bank 0)
+        0x20, 0x00, 0x80,   // C00E JSR $8000
+        0xA9, 0x01,         // C011 LDA #$01
+        0x8D, 0x00, 0x80,   // C013 STA $8000 (bank 1)
+        0x20, 0x00, 0x80,   // C016 JSR $8000
+        0x20, 0x00, 0xC1,   // C019 JSR $C100
+        0x4C, 0x09, 0xC0    // C01C JMP $C009
+    };
+    static const u8 outer[] = { 0x20, 0x10, 0xC1, 0x60 };               // C100 JSR $C110; RTS
+    static const u8 slow[] = { 0xA0, 0x10, 0x88, 0xD0, 0xFD, 0x60 };    // LDY #$10; DEY; BNE; RTS
+    static const u8 fast[] = { 0xEA, 0xEA, 0x60 };                      // NOP; NOP; RTS
+
+    u8* rom = TestRom_Make(2, 4, false, out_size);
+    u8* prg = TestRom_PRG(rom);
+    put(prg, 0 * BANK, slow, sizeof(slow));
+    put(prg, 1 * BANK, fast, sizeof(fast));
+    put(prg, FIXED, main_loop, sizeof(main_loop));
+    put(prg, FIXED + 0x100u, outer, sizeof(outer));
+    prg[FIXED + 0x110u] = 0x60;     // C110 RTS
+    prg[FIXED + 0x200u] = 0x40;     // C200 RTI
+    TestRom_SetVectors(rom, 0xC200, 0xC000);
+    return rom;
+}
+
+static void write_text(const char* path, const char* text)
+{
+    FILE* f = fopen(path, "w");
+    assert(f);
+    fputs(text, f);
+    fclose(f);
+}
+
+static char* read_stream(FILE* f)
+{
+    long size = ftell(f);
+    assert(size >= 0);
+    char* text = (char*)malloc((size_t)size + 1u);
+    assert(text);
+    rewind(f);
+    size_t got = fread(text, 1, (size_t)size, f);
+    text[got] = '\0';
+    return text;
+}
+
+// Self cycles of the node reached from the top level through `path`.
+static u64 path_cycles(const NesProfiler* p, const u32* path, u32 depth)
+{
+    u32 node = 0;
+    for (u32 d = 0; d < depth; d++) {
+        u32 i = p->nodes[node].first_child;
+        while (i && p->nodes[i].loc != path[d]) i = p->nodes[i].next_sibling;
+        if (!i) return 0;
+        node = i;
+    }
+    return p->nodes[node].cycles;
+}
+
+static void test_symbols(void)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s.ram.nl", k_rom_path);
+    write_text(path, "$0000#zp_temp#\n$0300/10#buffer#array\n");
+    snprintf(path, sizeof(path), "%s.0.nl", k_rom_path);
+    write_text(path, "$8000#Slow#\n");
+    snprintf(path, sizeof(path), "%s.3.nl", k_rom_path);
+    write_text(path, "$C100#Outer#\r\n$C110#Inner#\n$C200#Nmi#\n");
+
+    NesSymbols s;
+    memset(&s, 0, sizeof(s));
+    assert(NesSymbols_LoadNL(&s, k_rom_path, 4u * BANK) == 6);
+
+    u32 off = 99;
+    const char* name = NesSymbols_Find(&s, NES_PROF_ROM_BASE + FIXED + 0x103u, &off);
+    assert(name && strcmp(name, "Outer") == 0 && off == 3);
+    name = NesSymbols_Find(&s, 0x0305, &off);
+    assert(name && strcmp(name, "buffer") == 0 && off == 5);
+    assert(NesSymbols_Find(&s, NES_PROF_ROM_BASE + 0x0004u, &off) && off == 4);
+    assert(!NesSymbols_Find(&s, NES_PROF_ROM_BASE + BANK, &off));          // bank 1: nothing in range
+    assert(!NesSymbols_Find(&s, NES_PROF_ROM_BASE + FIXED, &off));         // below Outer in bank 3
+
+    // The same names from an ld65 debug file: CODE lands in bank 3 of the
+    // image (output offset = header + 3 banks), BSS is not in the image.
+    write_text(k_dbg_path,
+               "version\tmajor=2,minor=0\n"
+               "sym\tid=0,name=\"Outer\",addrsize=absolute,scope=0,def=1,val=0xC100,seg=0,type=lab\n"
+               "sym\tid=1,name=\"count\",addrsize=zeropage,scope=0,def=2,val=0x10,seg=1,type=lab\n"
+               "sym\tid=2,name=\"LIMIT\",addrsize=zeropage,scope=0,def=3,val=0x20,type=equ\n"
+               "seg\tid=0,name=\"CODE\",start=0x00C000,size=0x0300,addrsize=absolute,type=ro,oname=\"x.nes\",ooffs=49168\n"
+               "seg\tid=1,name=\"BSS\",start=0x000010,size=0x0010,addrsize=zeropage,type=rw\n");
+    NesSymbols d;
+    memset(&d, 0, sizeof(d));
+    assert(NesSymbols_LoadDbg(&d, k_dbg_path, 4u * BANK));
+    assert(d.count == 2);
+    name = NesSymbols_Find(&d, NES_PROF_ROM_BASE + FIXED + 0x100u, &off);
+    assert(name && strcmp(name, "Outer") == 0 && off == 0);
+    name = NesSymbols_Find(&d, 0x0010, &off);
+    assert(name && strcmp(name, "count") == 0);
+    NesSymbols_Free(&d);
+    remove(k_dbg_path);
+
+    NesSymbols_Free(&s);
+}
+
+static void test_console_profile(void)
+{
+    size_t rom_size = 0;
+    u8* rom = make_test_rom(&rom_size);
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+
+    assert(NES_StartProfile(n));
+    u64 cyc0 = n->cpu.cycles;
+    NES_RunFrame(n);
+    NES_RunFrame(n);
+    const NesProfiler* p = NES_Profiler(n);
+    assert(p);
+
+    // Every CPU cycle is charged once, to a location and to a node.
+    assert(p->total_cycles == n->cpu.cycles - cyc0);
+    u64 by_loc = 0, by_node = 0;
+    for (u32 i = 0; i < p->locs; i++) by_loc += p->cycles[i];
+    for (u32 i = 0; i < p->node_count; i++) by_node += p->nodes[i].cycles;
+    assert(by_loc + 7u * p->interrupts == p->total_cycles);
+    assert(by_node == p->total_cycles);
+    assert(p->interrupts >= 1 && p->dropped_calls == 0);
+
+    // $8000 is two locations, one per bank.
+    const u32 slow = NES_PROF_ROM_BASE, fast = NES_PROF_ROM_BASE + BANK;
+    assert(p->execs[slow] > 0 && p->execs[fast] > 0);
+    assert(p->execs[slow] == p->execs[fast] || p->execs[slow] == p->execs[fast] + 1u);
+    assert(p->execs[slow + 2u] > 16u * (p->execs[slow] - 1u));   // DEY; the last call may be cut short
+    assert(p->execs[slow + 2u] <= 16u * p->execs[slow]);
+
+    const u32 outer = NES_PROF_ROM_BASE + FIXED + 0x100u, inner = outer + 0x10u;
+    const u32 in_slow[] = { slow }, in_fast[] = { fast }, nested[] = { outer, inner };
+    assert(path_cycles(p, in_slow, 1) > 4u * path_cycles(p, in_fast, 1));
+    assert(path_cycles(p, nested, 2) > 0);
+
+    NesSymbols s;
+    memset(&s, 0, sizeof(s));
+    assert(NesSymbols_LoadNL(&s, k_rom_path, 4u * BANK) == 6);
+
+    FILE* f = tmpfile();
+    assert(f);
+    NesProfiler_WriteCollapsed(p, &s, f);
+    char* text = read_stream(f);
+    fclose(f);
+    assert(strstr(text, "(top);Slow ") && strstr(text, "(top);Outer;Inner "));
+    assert(strstr(text, ";Nmi "));
+    assert(strstr(text, "(top);01:0000 "));                    // bank 1 has no symbols
+    assert(strstr(text, "(top) "));
+    free(text);
+
+    f = tmpfile();
+    assert(f);
+    NesProfiler_WriteFlat(p, &s, 10, f);
+    text = read_stream(f);
+    fclose(f);
+    assert(strstr(text, "Slow+2") && strstr(text, "(top level)"));
+    free(text);
+    NesSymbols_Free(&s);
+
+    // Restarting starts over.
+    assert(NES_StartProfile(n));
+    assert(NES_Profiler(n)->total_cycles == 0);
+    NES_StopProfile(n);
+    assert(!NES_Profiler(n));
+
+    TestRom_FreeConsole(n);
+    free(rom);
+}
+
+// The profiler's counts are sized for one PRG ROM, so a load stops it.
+static void test_load_stops_profile(void)
+{
+    static const u8 loop[] = { 0x4C, 0x00, 0x80 };     // JMP $8000
+    size_t small_size = 0, big_size = 0;
+    u8* small = TestRom_NROM(loop, sizeof(loop), 0, false, &small_size);
+    u8* big = make_test_rom(&big_size);
+    Nes* n = TestRom_NewConsole(small, small_size);
+
+    assert(NES_StartProfile(n) && NES_Profiler(n)->locs == NES_PROF_ROM_BASE + 0x8000u);   // at least $8000-$FFFF
+    assert(NES_LoadROMFromMemory(n, big, big_size));
+    assert(!NES_Profiler(n));
+    NES_Reset(n);
+    NES_RunFrame(n);
+
+    assert(NES_StartProfile(n) && NES_Profiler(n)->locs == NES_PROF_ROM_BASE + 4u * BANK);
+    NES_RunFrame(n);
+
+    TestRom_FreeConsole(n);
+    free(small);
+    free(big);
+}
+
+static void remove_symbol_files(void)
+{
+    static const char* suffixes[] = { "ram", "0", "3" };
+    char path[256];
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        snprintf(path, sizeof(path), "%s.%s.nl", k_rom_path, suffixes[i]);
+        remove(path);
+    }
+}
+
+int main(void)
+{
+    test_symbols();
+    test_console_profile();
+    test_load_stops_profile();
+    remove_symbol_files();
+    puts("profiler: OK");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "nes/debug/timeline.h"
+#include "nes/nes.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* k_json_path = "test_timeline.tmp.json";
+
+// UxROM, 2 PRG banks: NMI on, then a loop doing OAM DMA from page 2 and
+// switching the $8000 bank back and forth.
+static u8* make_test_rom(size_t* out_size)
+{
+    static const u8 prog[] = {
+        0x78,               // C000 SEI
+        0xA2, 0xFF,         // C001 LDX #$FF
+        0x9A,               // C003 TXS
+        0xA9, 0x80,         // C004 LDA #$80
+        0x8D, 0x00, 0x20,   // C006 STA $2000 (NMI on)
+        0xA9, 0x02,         // C009 LDA #$02
+        0x8D, 0x14, 0x40,   // C00B STA $4014
+        0xA9, 0x01,         // C00E LDA #$01
+        0x8D, 0x00, 0x80,   // C010 STA $8000
+        0xA9, 0x00,         // C013 LDA #$00
+        0x8D, 0x00, 0x80,   // C015 STA $8000
+        0x4C, 0x09, 0xC0    // C018 JMP $C009
+    };
+
+    u8* rom = TestRom_Make(2, 2, false, out_size);
+    u8* fixed = TestRom_PRG(rom) + TEST_ROM_BANK;
+    memcpy(fixed, prog, sizeof(prog));
+    fixed[0x100] = 0x40;                            // C100 RTI
+    TestRom_SetVectors(rom, 0xC100, 0xC000);
+    return rom;
+}
+
+static char* read_file(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    assert(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    assert(size > 0);
+    rewind(f);
+    char* text = (char*)malloc((size_t)size + 1u);
+    assert(text);
+    size_t got = fread(text, 1, (size_t)size, f);
+    text[got] = '\0';
+    fclose(f);
+    return text;
+}
+
+static u32 count(const char* text, const char* needle)
+{
+    u32 n = 0;
+    for (const char* p = strstr(text, needle); p; p = strstr(p + 1, needle)) n++;
+    return n;
+}
+
+static void test_off_by_default(void)
+{
+    assert(!g_nes_timeline);
+    assert(!NesTimeline_AttachThread("early"));     // not started
+    NES_TIMELINE_BEGIN(t0);
+    assert(t0 == 0);
+    NES_TIMELINE_END(t0, "ignored");
+    NES_TIMELINE_INSTANT("ignored", 1);
+    assert(!NesTimeline_Write(k_json_path));
+}
+
+static void test_console_timeline(void)
+{
+    size_t rom_size = 0;
+    u8* rom = make_test_rom(&rom_size);
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+
+    assert(NesTimeline_Start(0));
+    assert(!NesTimeline_Start(0));                  // already running
+    assert(NesTimeline_AttachThread("emu \"test\""));
+    NES_RunFrame(n);
+    NES_RunFrame(n);
+    NES_RunFrame(n);
+    assert(NesTimeline_Write(k_json_path));
+    assert(!g_nes_timeline);
+
+    char* json = read_file(k_json_path);
+    assert(strncmp(json, "{\"displayTimeUnit\"", 18) == 0);
+    assert(strstr(json, "\"args\":{\"name\":\"emu \\\"test\\\"\"}"));
+    assert(count(json, "\"name\":\"frame\"") == 3);
+    assert(strstr(json, "\"name\":\"frame\",\"ph\":\"X\""));
+    assert(count(json, "\"name\":\"NMI\"") >= 2);
+    assert(strstr(json, "\"name\":\"OAM DMA\",\"ph\":\"i\""));
+    assert(strstr(json, "\"args\":{\"value\":2}"));
+    assert(count(json, "\"name\":\"bank switch\"") >= 2);
+    assert(strstr(json, "\"name\":\"sprite eval\""));
+    assert(strstr(json, "\"name\":\"frame copy\"") && strstr(json, "\"name\":\"apu end frame\""));
+    // Every instant cuts the CPU segment.
+    assert(count(json, "\"name\":\"cpu\"") > count(json, "\"ph\":\"i\""));
+    assert(count(json, "{") == count(json, "}"));
+    free(json);
+    remove(k_json_path);
+
+    // Off again: no ring, hooks do nothing.
+    NES_RunFrame(n);
+    assert(!g_nes_timeline);
+
+    TestRom_FreeConsole(n);
+    free(rom);
+}
+
+static void test_ring_keeps_latest(void)
+{
+    assert(NesTimeline_Start(10));                  // rounded up to 16
+    assert(NesTimeline_AttachThread("ring"));
+    for (u32 i = 0; i < 100; i++) NES_TIMELINE_INSTANT("tick", i);
+    assert(NesTimeline_Write(k_json_path));
+
+    char* json = read_file(k_json_path);
+    assert(count(json, "\"name\":\"tick\"") == 16);
+    assert(!strstr(json, "\"value\":83}") && strstr(json, "\"value\":84}") && strstr(json, "\"value\":99}"));
+    free(json);
+    remove(k_json_path);
+}
+
+static void test_names_escaped(void)
+{
+    assert(NesTimeline_Start(0));
+    assert(NesTimeline_AttachThread("a\\b"));
+    NES_TIMELINE_INSTANT("say \"hi\"\n", NES_TIMELINE_NO_ARG);
+    assert(NesTimeline_Write(k_json_path));
+
+    char* json = read_file(k_json_path);
+    assert(strstr(json, "\"args\":{\"name\":\"a\\\\b\"}"));
+    assert(strstr(json, "\"name\":\"say \\\"hi\\\"\\u000a\",\"ph\":\"i\""));
+    free(json);
+    remove(k_json_path);
+}
+
+int main(void)
+{
+    test_off_by_default();
+    test_console_timeline();
+    test_ring_keeps_latest();
+    test_names_escaped();
+    puts("timeline: OK");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "nes/debug/trace.h"
+#include "nes/nes.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NROM-128 image: write RAM, strobe the pad, loop.
+static const u8 k_prog[] = {
+    0xE6, 0x00,       // INC $00
+    0xA9, 0x01,       // LDA #$01
+    0x8D, 0x16, 0x40, // STA $4016
+    0x4C, 0x00, 0x80  // JMP $8000
+};
+
+static void test_hooks_vanish_when_disabled(void)
+{
+#if !NES_TRACE
+    int evaluated = 0;
+    NesTrace* none = NULL;
+    NES_TRACE_INC(none, frames[evaluated++]);   // not even a valid field
+    NES_TRACE_ADD(none, nonexistent, evaluated++);
+    (void)none;
+    assert(evaluated == 0);
+#endif
+}
+
+static void test_dump_and_reset(void)
+{
+    NesTrace t;
+    NesTrace_Reset(&t);
+    t.frames = 2;
+    t.bus_reads[NES_TRACE_RAM] = 200;
+    t.opcodes[0xA9] = 30;
+    t.opcodes[0xEA] = 10;
+    t.phase_ticks[NES_TRACE_PHASE_CPU] = 3;
+    t.phase_ticks[NES_TRACE_PHASE_PPU] = 1;
+
+    FILE* f = tmpfile();
+    assert(f);
+    NesTrace_Dump(&t, f, 10);
+    rewind(f);
+    char text[2048];
+    size_t n = fread(text, 1, sizeof(text) - 1, f);
+    text[n] = '\0';
+    fclose(f);
+
+    assert(strstr(text, "frames 8-10"));
+    assert(strstr(text, "ram 100"));                // per frame
+    assert(strstr(text, "A9 LDA 75.0%"));
+    assert(strstr(text, "cpu") && strstr(text, "(75%)"));
+
+    NesTrace_Reset(&t);
+    assert(t.frames == 0 && t.opcodes[0xA9] == 0);
+}
+
+static void test_console_counts(void)
+{
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+
+#if NES_TRACE
+    assert(NES_SetTraceDump(n, NULL, 0));
+    NesTrace_Reset(&n->trace);
+    u64 insn0 = n->cpu.instructions;
+    NES_RunFrame(n);
+    NES_RunFrame(n);
+
+    const NesTrace* t = &n->trace;
+    u64 ops = 0;
+    for (int i = 0; i < 256; i++) ops += t->opcodes[i];
+    assert(t->frames == 2u);
+    assert(ops == n->cpu.instructions - insn0);
+    assert(t->opcodes[0xE6] > 0 && t->opcodes[0x8D] > 0);
+    assert(t->bus_writes[NES_TRACE_RAM] > 0);
+    assert(t->bus_writes[NES_TRACE_APU] == t->opcodes[0x8D]);
+    assert(t->bus_reads[NES_TRACE_CART] > 0 && t->mapper_calls > 0);
+    assert(t->ppu_dots[NES_TRACE_LINE_VISIBLE] > 0 && t->ppu_dots[NES_TRACE_LINE_VBLANK] > 0);
+    assert(t->phase_ticks[NES_TRACE_PHASE_CPU] > 0);
+#else
+    assert(!NES_SetTraceDump(n, stderr, 1));
+    NES_RunFrame(n);
+#endif
+
+    TestRom_FreeConsole(n);
+    free(rom);
+}
+
+int main(void)
+{
+    test_hooks_vanish_when_disabled();
+    test_dump_and_reset();
+    test_console_counts();
+    puts("trace: OK");
+    return 0;
+}
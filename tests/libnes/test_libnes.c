@@ -0,0 +1,96 @@
+#include "nes/libnes.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NROM-128 image: strobe the pad, store A-button bit to $01, count loops in $00.
+static const uint8_t k_prog[] = {
+    0xA9, 0x01,       // LDA #$01
+    0x8D, 0x16, 0x40, // STA $4016
+    0xA9, 0x00,       // LDA #$00
+    0x8D, 0x16, 0x40, // STA $4016
+    0xAD, 0x16, 0x40, // LDA $4016
+    0x29, 0x01,       // AND #$01
+    0x85, 0x01,       // STA $01
+    0xE6, 0x00,       // INC $00
+    0x4C, 0x00, 0x80  // JMP $8000
+};
+
+static void test_run_input_and_ram(void)
+{
+    assert(LibNes_APIVersion() == LIBNES_API_VERSION);
+
+    LibNes* h = LibNes_Create();
+    assert(h);
+    assert(LibNes_RunFrames(h, 1) == 0);    // no ROM yet
+
+    size_t rom_size = 0;
+    uint8_t* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+    assert(LibNes_LoadROMFromMemory(h, rom, rom_size));
+
+    LibNes_SetInput(h, LIBNES_BTN_A, 0);
+    assert(LibNes_RunFrames(h, 2) == 2);
+    assert(LibNes_FrameCount(h) == 2u);
+    assert(!LibNes_CPUJammed(h));
+    assert(LibNes_MovieState(h, NULL) == LIBNES_MOVIE_NONE);
+    uint64_t desync_frame = 0;
+    assert(LibNes_MovieState(h, &desync_frame) == LIBNES_MOVIE_NONE);
+    assert(desync_frame == UINT64_MAX);
+
+    uint8_t ram[LIBNES_RAM_SIZE];
+    LibNes_CopyRAM(h, ram);
+    assert(ram[1] == 1u);
+    assert(ram[0] != 0u);
+
+    LibNes_SetInput(h, 0, 0);
+    assert(LibNes_RunFrames(h, 1) == 1);
+    LibNes_CopyRAM(h, ram);
+    assert(ram[1] == 0u);
+
+    assert(LibNes_Framebuffer(h) != NULL);
+    assert(LibNes_FramebufferHash(h) == LibNes_FramebufferHash(h));
+
+    LibNes_Destroy(h);
+    free(rom);
+}
+
+static void test_state_round_trip(void)
+{
+    size_t rom_size = 0;
+    uint8_t* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+
+    LibNes* h = LibNes_Create();
+    assert(h);
+    assert(LibNes_LoadROMFromMemory(h, rom, rom_size));
+    assert(LibNes_RunFrames(h, 3) == 3);
+
+    size_t size = LibNes_StateSize(h);
+    assert(size > 0);
+    void* state = malloc(size);
+    assert(state);
+    assert(LibNes_SaveState(h, state, size));
+
+    uint8_t before[LIBNES_RAM_SIZE], after[LIBNES_RAM_SIZE];
+    assert(LibNes_RunFrames(h, 5) == 5);
+    LibNes_CopyRAM(h, before);
+
+    assert(LibNes_LoadState(h, state, size));
+    assert(LibNes_FrameCount(h) == 3u);
+    assert(LibNes_RunFrames(h, 5) == 5);
+    LibNes_CopyRAM(h, after);
+    assert(memcmp(before, after, sizeof(before)) == 0);
+
+    free(state);
+    LibNes_Destroy(h);
+    free(rom);
+}
+
+int main(void)
+{
+    test_run_input_and_ram();
+    test_state_round_trip();
+    puts("libnes: OK");
+    return 0;
+}
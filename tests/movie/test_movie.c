@@ -0,0 +1,157 @@
+#include "nes/movie.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* k_movie_path = "test_movie.tmp.nesm";
+
+// NROM-128 image: read the pad every loop, fold it into a RAM accumulator.
+static const u8 k_prog[] = {
+    0xA9, 0x01, 0x8D, 0x16, 0x40, // LDA #$01 / STA $4016
+    0xA9, 0x00, 0x8D, 0x16, 0x40, // LDA #$00 / STA $4016
+    0xAD, 0x16, 0x40,             // LDA $4016
+    0x29, 0x01,                   // AND #$01
+    0x65, 0x00, 0x85, 0x00,       // ADC $00 / STA $00
+    0xE6, 0x01,                   // INC $01
+    0x4C, 0x00, 0x80              // JMP $8000
+};
+
+static NesInput input_for_frame(int f)
+{
+    NesInput in;
+    in.p1 = (u8)((f / 7) & 1 ? 0x01u : 0x00u);
+    in.p2 = (u8)(f >= 20 ? 0x80u : 0x00u);
+    return in;
+}
+
+static void record(const u8* rom, size_t rom_size, int frames, bool checksums)
+{
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+
+    NesMovieRecorder r;
+    assert(NesMovie_RecordBegin(&r, k_movie_path, n, checksums));
+    for (int f = 0; f < frames; f++) {
+        n->input = input_for_frame(f);
+        NES_RunFrame(n);
+        assert(NesMovie_RecordFrame(&r, n, n->input));
+    }
+    assert(NesMovie_RecordEnd(&r));
+
+    TestRom_FreeConsole(n);
+}
+
+static void test_roundtrip_and_verify(const u8* rom, size_t rom_size)
+{
+    record(rom, rom_size, 40, true);
+
+    NesMoviePlayer p;
+    assert(NesMovie_Open(&p, k_movie_path));
+    assert(p.hdr.frames == 40u);
+    assert(p.hdr.flags & NES_MOVIE_FLAG_CHECKSUMS);
+
+    // 40 frames collapse into a handful of runs.
+    assert(p.hdr.input_size < 40u);
+
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+    assert(NesMovie_CheckROM(&p, n));
+
+    NesInput in;
+    int f = 0;
+    while (NesMovie_NextInput(&p, &in)) {
+        NesInput want = input_for_frame(f);
+        assert(in.p1 == want.p1 && in.p2 == want.p2);
+        n->input = in;
+        NES_RunFrame(n);
+        assert(NesMovie_Verify(&p, n));
+        f++;
+    }
+    assert(f == 40);
+    assert(p.desync_frame == UINT64_MAX);
+
+    TestRom_FreeConsole(n);
+    NesMovie_Close(&p);
+}
+
+static void test_desync_reports_first_frame(const u8* rom, size_t rom_size)
+{
+    record(rom, rom_size, 40, true);
+
+    NesMoviePlayer p;
+    assert(NesMovie_Open(&p, k_movie_path));
+
+    Nes* n = TestRom_NewConsole(rom, rom_size);
+    NesInput in;
+    bool desynced = false;
+    while (!desynced && NesMovie_NextInput(&p, &in)) {
+        // Diverge from the recording at frame 25.
+        if (p.frame - 1u == 25u) in.p1 ^= 0x01u;
+        n->input = in;
+        NES_RunFrame(n);
+        desynced = !NesMovie_Verify(&p, n);
+    }
+    assert(desynced);
+    assert(p.desync_frame == 25u);
+
+    TestRom_FreeConsole(n);
+    NesMovie_Close(&p);
+}
+
+static void test_rom_mismatch_and_plain_movies(const u8* rom, size_t rom_size)
+{
+    record(rom, rom_size, 10, false);
+
+    NesMoviePlayer p;
+    assert(NesMovie_Open(&p, k_movie_path));
+    assert(!(p.hdr.flags & NES_MOVIE_FLAG_CHECKSUMS));
+
+    u8* other = (u8*)malloc(rom_size);
+    assert(other);
+    memcpy(other, rom, rom_size);
+    other[16 + 0x100] ^= 0xFFu;
+
+    Nes* n = TestRom_NewConsole(other, rom_size);
+    assert(!NesMovie_CheckROM(&p, n));
+
+    // Without checksums verification always passes.
+    NesInput in;
+    assert(NesMovie_NextInput(&p, &in));
+    NES_RunFrame(n);
+    assert(NesMovie_Verify(&p, n));
+
+    TestRom_FreeConsole(n);
+    free(other);
+    NesMovie_Close(&p);
+}
+
+// Version 1 checksummed the raw savestate, which changes with the build.
+static void test_old_version_rejected(const u8* rom, size_t rom_size)
+{
+    record(rom, rom_size, 5, true);
+
+    FILE* f = fopen(k_movie_path, "r+b");
+    assert(f);
+    const u8 v1[2] = { 1, 0 };
+    assert(fseek(f, 4, SEEK_SET) == 0 && fwrite(v1, 1, sizeof(v1), f) == sizeof(v1));
+    fclose(f);
+
+    NesMoviePlayer p;
+    assert(!NesMovie_Open(&p, k_movie_path));
+}
+
+int main(void)
+{
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, false, &rom_size);
+
+    test_roundtrip_and_verify(rom, rom_size);
+    test_desync_reports_first_frame(rom, rom_size);
+    test_rom_mismatch_and_plain_movies(rom, rom_size);
+    test_old_version_rejected(rom, rom_size);
+
+    remove(k_movie_path);
+    free(rom);
+    printf("movie: OK\n");
+    return 0;
+}
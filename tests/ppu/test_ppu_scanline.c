@@ -0,0 +1,80 @@
+#include "nes/ppu/ppu2c02.h"
+#include "nes/cart.h"
+#include "nes/mapper.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { DOTS_PER_FRAME = 341 * 262 };
+
+typedef struct TestCartCtx {
+    Cart cart;
+    Mapper mapper;
+    u8 chr[0x2000];
+} TestCartCtx;
+
+typedef struct Rows {
+    int calls;
+    int next;
+    u32 copy[PPU_FB_W * PPU_FB_H];   // rows as they were when reported
+    const PPU2C02* ppu;
+} Rows;
+
+static bool test_ppu_read(Mapper* m, u16 addr, u8* out)
+{
+    TestCartCtx* tc = (TestCartCtx*)m->cart;
+    if (addr <= 0x1FFFu) {
+        *out = tc->chr[addr & 0x1FFFu];
+        return true;
+    }
+    return false;
+}
+
+static void on_scanline(void* user, int y)
+{
+    Rows* r = (Rows*)user;
+    assert(y == r->next);
+    r->next = (y + 1) % PPU_FB_H;
+    r->calls++;
+    memcpy(r->copy + y * PPU_FB_W, r->ppu->fb + y * PPU_FB_W, PPU_FB_W * sizeof(u32));
+}
+
+static void test_scanlines_reported_in_order_once_complete(void)
+{
+    TestCartCtx* tc = (TestCartCtx*)calloc(1, sizeof(TestCartCtx));
+    PPU2C02* p = (PPU2C02*)malloc(sizeof(PPU2C02));
+    Rows* r = (Rows*)calloc(1, sizeof(Rows));
+    assert(tc && p && r);
+
+    tc->mapper.cart = &tc->cart;
+    tc->mapper.ppu_read = test_ppu_read;
+    tc->cart.mapper = &tc->mapper;
+    tc->cart.info.mirroring = NES_MIRROR_HORIZONTAL;
+    for (int i = 0; i < 0x2000; i++) tc->chr[i] = (u8)((u32)i * 37u);
+
+    assert(PPU2C02_Init(p, &tc->cart));
+    for (int i = 0; i < 0x3C0; i++) p->nametables[i] = (u8)i;
+    for (int i = 0; i < 32; i++) p->palette[i] = (u8)((u32)i * 3u);
+    p->mask = 0x1Eu;
+
+    r->ppu = p;
+    p->scanline_fn = on_scanline;
+    p->scanline_user = r;
+
+    for (long d = 0; d < 2L * DOTS_PER_FRAME; d++) PPU2C02_Clock(p);
+
+    assert(r->calls == 2 * PPU_FB_H);
+    assert(memcmp(r->copy, p->fb, sizeof(r->copy)) == 0);
+
+    free(r);
+    free(p);
+    free(tc);
+}
+
+int main(void)
+{
+    test_scanlines_reported_in_order_once_complete();
+    puts("ppu scanline: OK");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "nes/ppu/ppu2c02.h"
+#include "nes/cart.h"
+#include "nes/mapper.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { DOTS_PER_FRAME = 341 * 262 };
+
+typedef struct TestCartCtx {
+    Cart cart;
+    Mapper mapper;
+    u8 chr[0x2000];
+} TestCartCtx;
+
+static bool test_ppu_read(Mapper* m, u16 addr, u8* out)
+{
+    TestCartCtx* tc = (TestCartCtx*)m->cart;
+    if (addr <= 0x1FFFu) {
+        *out = tc->chr[addr & 0x1FFFu];
+        return true;
+    }
+    return false;
+}
+
+// Tile 1 is solid colour 1; the whole background and sprite 0 use it.
+static void setup(TestCartCtx* tc, PPU2C02* p)
+{
+    memset(tc, 0, sizeof(*tc));
+    tc->mapper.cart = &tc->cart;
+    tc->mapper.ppu_read = test_ppu_read;
+    tc->cart.mapper = &tc->mapper;
+    tc->cart.info.mirroring = NES_MIRROR_HORIZONTAL;
+    memset(tc->chr + 16, 0xFF, 8);
+
+    assert(PPU2C02_Init(p, &tc->cart));
+    memset(p->nametables, 0x01, 0x3C0);
+    p->palette[1] = 0x16u;
+    p->palette[0x11] = 0x2Au;
+    p->oam[0] = 49;     // top row 50
+    p->oam[1] = 1;
+    p->oam[3] = 100;
+    for (int i = 4; i < 256; i += 4) p->oam[i] = 0xF0u;   // off screen
+    p->mask = 0x1Eu;
+}
+
+// Returns the dot (from power-on) at which sprite 0 hit was first set.
+static long run_frames(PPU2C02* p, int frames)
+{
+    long hit = -1;
+    for (long d = 0; d < (long)frames * DOTS_PER_FRAME; d++) {
+        PPU2C02_Clock(p);
+        if (hit < 0 && (p->status & 0x40u)) hit = d;   // sprite 0 hit
+    }
+    return hit;
+}
+
+static void test_skip_keeps_timing_and_sprite0_hit(void)
+{
+    TestCartCtx* tc = (TestCartCtx*)malloc(2 * sizeof(TestCartCtx));
+    PPU2C02* p = (PPU2C02*)malloc(2 * sizeof(PPU2C02));
+    assert(tc && p);
+
+    setup(&tc[0], &p[0]);
+    setup(&tc[1], &p[1]);
+    p[1].skip_pixels = true;
+
+    long hit_drawn = run_frames(&p[0], 2);
+    long hit_skipped = run_frames(&p[1], 2);
+    assert(hit_drawn > 0);
+    assert(hit_drawn == hit_skipped);
+
+    // Identical register and pipeline state up to the internal memory.
+    size_t from = offsetof(PPU2C02, ctrl);
+    size_t to = offsetof(PPU2C02, palette);
+    assert(memcmp((u8*)&p[0] + from, (u8*)&p[1] + from, to - from) == 0);
+
+    // The drawn frame has pixels; the skipped one stays cleared.
+    assert(p[0].fb[10 * PPU_FB_W + 10] != 0u);
+    assert(p[1].fb[10 * PPU_FB_W + 10] == 0u);
+
+    free(p);
+    free(tc);
+}
+
+int main(void)
+{
+    test_skip_keeps_timing_and_sprite0_hit();
+    puts("ppu skip: OK");
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "nes/state.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NROM-128 image with 8KB CHR RAM. Each loop reads the A button into $01 and
+// writes a counter-derived value to RAM, PRG RAM, a nametable, CHR RAM and OAM.
+static const u8 k_prog[] = {
+    0xA9, 0x01, 0x8D, 0x16, 0x40, // LDA #$01 / STA $4016
+    0xA9, 0x00, 0x8D, 0x16, 0x40, // LDA #$00 / STA $4016
+    0xAD, 0x16, 0x40,             // LDA $4016
+    0x29, 0x01, 0x85, 0x01,       // AND #$01 / STA $01
+    0xE6, 0x00,                   // INC $00
+    0xA5, 0x00, 0x8D, 0x00, 0x60, // LDA $00 / STA $6000
+    0x18, 0x65, 0x01,             // CLC / ADC $01
+    0x8D, 0x00, 0x03,             // STA $0300
+    0xA9, 0x20, 0x8D, 0x06, 0x20, // LDA #$20 / STA $2006
+    0xA9, 0x00, 0x8D, 0x06, 0x20, // LDA #$00 / STA $2006
+    0xA5, 0x00, 0x8D, 0x07, 0x20, // LDA $00 / STA $2007   (nametable)
+    0xA9, 0x00, 0x8D, 0x06, 0x20, // LDA #$00 / STA $2006
+    0x8D, 0x06, 0x20,             // STA $2006
+    0xA5, 0x01, 0x8D, 0x07, 0x20, // LDA $01 / STA $2007   (CHR RAM)
+    0xA5, 0x00, 0x8D, 0x04, 0x20, // LDA $00 / STA $2004   (OAM)
+    0x4C, 0x00, 0x80              // JMP $8000
+};
+
+static void test_writes_mark_pages(const u8* rom, size_t rom_size)
+{
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    assert(n);
+    TestRom_LoadConsole(n, rom, rom_size);
+
+    // Reset marks everything that was cleared.
+    assert(NES_DirtyPageCount(n, NES_MEM_RAM) == 8u);
+    assert(NES_DirtyPageCount(n, NES_MEM_OAM) == 1u);
+
+    NES_RunFrame(n);
+    NES_ClearAllDirty(n);
+    for (int r = 0; r < NES_MEM_REGION_COUNT; r++) {
+        assert(NES_DirtyPageCount(n, (NesMemRegion)r) == 0u);
+    }
+
+    NES_RunFrame(n);
+
+    u32 pages = 0;
+    const u64* ram = NES_DirtyBitmap(n, NES_MEM_RAM, &pages);
+    assert(ram && pages == 8u);
+    assert(ram[0] == ((1u << 0) | (1u << 3)));
+
+    assert(NES_DirtyPageCount(n, NES_MEM_PRG_RAM) == 1u && NES_PageDirty(n, NES_MEM_PRG_RAM, 0));
+    assert(NES_DirtyPageCount(n, NES_MEM_CHR_RAM) == 1u && NES_PageDirty(n, NES_MEM_CHR_RAM, 0));
+    assert(NES_DirtyPageCount(n, NES_MEM_NAMETABLE) == 1u && NES_PageDirty(n, NES_MEM_NAMETABLE, 0));
+    assert(NES_PageDirty(n, NES_MEM_OAM, 0));
+    assert(!NES_PageDirty(n, NES_MEM_PALETTE, 0));
+    assert(!NES_PageDirty(n, NES_MEM_RAM, 99));
+
+    NES_ClearDirty(n, NES_MEM_RAM);
+    assert(NES_DirtyPageCount(n, NES_MEM_RAM) == 0u);
+    assert(NES_DirtyPageCount(n, NES_MEM_PRG_RAM) == 1u);
+
+    // Reset marks every region, cart RAM included although it is kept.
+    NES_ClearAllDirty(n);
+    NES_Reset(n);
+    for (int r = 0; r < NES_MEM_REGION_COUNT; r++) {
+        u32 region_pages = 0;
+        assert(NES_DirtyBitmap(n, (NesMemRegion)r, &region_pages));
+        assert(region_pages > 0u && NES_DirtyPageCount(n, (NesMemRegion)r) == region_pages);
+    }
+
+    NES_Destroy(n);
+    free(n);
+}
+
+static void test_fork_starts_clean_and_load_marks_all(const u8* rom, size_t rom_size)
+{
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    assert(n);
+    TestRom_LoadConsole(n, rom, rom_size);
+    NES_RunFrame(n);
+
+    Nes* child = NES_Fork(n);
+    assert(child);
+    for (int r = 0; r < NES_MEM_REGION_COUNT; r++) {
+        assert(NES_DirtyPageCount(child, (NesMemRegion)r) == 0u);
+    }
+    NES_RunFrame(child);
+    assert(NES_DirtyPageCount(child, NES_MEM_RAM) == 2u);
+    NES_FreeFork(child);
+
+    size_t size = NES_StateSize(n);
+    u8* state = (u8*)malloc(size);
+    assert(state);
+    assert(NES_SaveState(n, state, size));
+
+    NES_ClearAllDirty(n);
+    assert(NES_LoadState(n, state, size));
+    assert(NES_DirtyPageCount(n, NES_MEM_RAM) == 8u);
+    assert(NES_DirtyPageCount(n, NES_MEM_PRG_RAM) == 32u);
+    assert(NES_DirtyPageCount(n, NES_MEM_CHR_RAM) == 32u);
+    assert(NES_DirtyPageCount(n, NES_MEM_NAMETABLE) == 8u);
+
+    free(state);
+    NES_Destroy(n);
+    free(n);
+}
+
+int main(void)
+{
+    if (!NES_DIRTY_TRACKING) {
+        printf("state dirty: skipped (NES_DIRTY_TRACKING=0)\n");
+        return 0;
+    }
+
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, true, &rom_size);
+
+    test_writes_mark_pages(rom, rom_size);
+    test_fork_starts_clean_and_load_marks_all(rom, rom_size);
+
+    free(rom);
+    printf("state dirty: OK\n");
+    return 0;
+}
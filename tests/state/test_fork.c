@@ -0,0 +1,191 @@
+#include "nes/state.h"
+#include "../test_rom.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NROM-128 image with 8KB CHR RAM. Each loop reads the A button into $01 and
+// writes a counter-derived value to RAM, PRG RAM, a nametable, CHR RAM and OAM.
+static const u8 k_prog[] = {
+    0xA9, 0x01, 0x8D, 0x16, 0x40, // LDA #$01 / STA $4016
+    0xA9, 0x00, 0x8D, 0x16, 0x40, // LDA #$00 / STA $4016
+    0xAD, 0x16, 0x40,             // LDA $4016
+    0x29, 0x01, 0x85, 0x01,       // AND #$01 / STA $01
+    0xE6, 0x00,                   // INC $00
+    0xA5, 0x00, 0x8D, 0x00, 0x60, // LDA $00 / STA $6000
+    0x18, 0x65, 0x01,             // CLC / ADC $01
+    0x8D, 0x00, 0x03,             // STA $0300
+    0xA9, 0x20, 0x8D, 0x06, 0x20, // LDA #$20 / STA $2006
+    0xA9, 0x00, 0x8D, 0x06, 0x20, // LDA #$00 / STA $2006
+    0xA5, 0x00, 0x8D, 0x07, 0x20, // LDA $00 / STA $2007   (nametable)
+    0xA9, 0x00, 0x8D, 0x06, 0x20, // LDA #$00 / STA $2006
+    0x8D, 0x06, 0x20,             // STA $2006
+    0xA5, 0x01, 0x8D, 0x07, 0x20, // LDA $01 / STA $2007   (CHR RAM)
+    0xA5, 0x00, 0x8D, 0x04, 0x20, // LDA $00 / STA $2004   (OAM)
+    0x4C, 0x00, 0x80              // JMP $8000
+};
+
+static u8* save(const Nes* n, size_t* out_size)
+{
+    size_t size = NES_StateSize(n);
+    u8* buf = (u8*)malloc(size);
+    assert(buf);
+    assert(NES_SaveState(n, buf, size));
+    *out_size = size;
+    return buf;
+}
+
+static void test_savestate_roundtrip_is_deterministic(const u8* rom, size_t rom_size)
+{
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    assert(n);
+    TestRom_LoadConsole(n, rom, rom_size);
+    NES_RunFrame(n);
+
+    size_t size = 0;
+    u8* s0 = save(n, &size);
+
+    n->input.p1 = 0x01u;
+    for (int i = 0; i < 3; i++) NES_RunFrame(n);
+    u8* s1 = save(n, &size);
+
+    assert(NES_LoadState(n, s0, size));
+    n->input.p1 = 0x01u;
+    for (int i = 0; i < 3; i++) NES_RunFrame(n);
+    u8* s2 = save(n, &size);
+
+    assert(memcmp(s1, s2, size) == 0);
+
+    // Truncated or foreign buffers are rejected.
+    assert(!NES_LoadState(n, s0, size - 1u));
+    s0[0] ^= 0xFFu;
+    assert(!NES_LoadState(n, s0, size));
+
+    free(s2);
+    free(s1);
+    free(s0);
+    NES_Destroy(n);
+    free(n);
+}
+
+static void test_fork_shares_pages_until_written(const u8* rom, size_t rom_size)
+{
+    Nes* parent = (Nes*)malloc(sizeof(Nes));
+    assert(parent);
+    TestRom_LoadConsole(parent, rom, rom_size);
+    NES_RunFrame(parent);
+
+    size_t size = 0;
+    u8* before = save(parent, &size);
+
+    Nes* child = NES_Fork(parent);
+    assert(child);
+    assert(child->cart.prg_rom == parent->cart.prg_rom);
+
+    // RAM 8 + nametables 8 + OAM 1 + PRG RAM 32 + CHR RAM 32 pages
+    assert(NES_ForkSharedPages(child) == 81u);
+
+    size_t child_size = 0;
+    u8* forked = save(child, &child_size);
+    assert(child_size == size);
+    assert(memcmp(forked, before, size) == 0);
+
+    child->input.p1 = 0x01u;
+    NES_RunFrame(child);
+
+    // The program dirties RAM pages 0 and 3 and one page of every other
+    // region; the rest is still shared.
+    assert(NES_ForkSharedPages(child) == 75u);
+    assert(child->bus.ram_borrow[3] == NULL);
+    assert(child->bus.ram_borrow[7] == parent->bus.ram + 0x700);
+    assert(Bus_CPURead(&child->bus, 0x0001) == 1u);
+
+    // The parent is frozen and untouched.
+    NES_RunFrame(parent);
+    assert(parent->frame_count == 1u);
+    u8* after = save(parent, &size);
+    assert(memcmp(after, before, size) == 0);
+
+    NES_FreeFork(child);
+    NES_RunFrame(parent);
+    assert(parent->frame_count == 2u);
+
+    free(after);
+    free(forked);
+    free(before);
+    NES_Destroy(parent);
+    free(parent);
+}
+
+static void test_forks_match_savestate_copies(const u8* rom, size_t rom_size)
+{
+    Nes* parent = (Nes*)malloc(sizeof(Nes));
+    Nes* ref = (Nes*)malloc(sizeof(Nes));
+    assert(parent && ref);
+    TestRom_LoadConsole(parent, rom, rom_size);
+    TestRom_LoadConsole(ref, rom, rom_size);
+    for (int i = 0; i < 2; i++) NES_RunFrame(parent);
+
+    size_t size = 0;
+    u8* base = save(parent, &size);
+
+    Nes* a = NES_Fork(parent);
+    Nes* b = NES_Fork(parent);
+    assert(a && b);
+    a->input.p1 = 0x01u;
+    b->input.p1 = 0x00u;
+
+    // Forks of forks see the intermediate state, and freeze their parent.
+    NES_RunFrame(a);
+    Nes* a2 = NES_Fork(a);
+    assert(a2);
+    NES_RunFrame(a);
+    assert(a->frame_count == 3u);
+    for (int i = 0; i < 2; i++) NES_RunFrame(a2);
+    for (int i = 0; i < 3; i++) NES_RunFrame(b);
+
+    const Nes* forks[3] = { a2, b, a };
+    const u8 inputs[3] = { 0x01u, 0x00u, 0x01u };
+    const int frames[3] = { 3, 3, 1 };
+
+    for (int k = 0; k < 3; k++) {
+        assert(NES_LoadState(ref, base, size));
+        ref->input.p1 = inputs[k];
+        for (int i = 0; i < frames[k]; i++) NES_RunFrame(ref);
+
+        size_t s = 0;
+        u8* want = save(ref, &s);
+        u8* got = save(forks[k], &s);
+        assert(memcmp(want, got, s) == 0);
+        assert(memcmp(ref->fb, forks[k]->fb, sizeof(ref->fb)) == 0);
+        assert(NES_StateFingerprint(ref) == NES_StateFingerprint(forks[k]));  // through borrowed pages
+        free(got);
+        free(want);
+    }
+
+    assert(NES_StateFingerprint(a) != NES_StateFingerprint(b));
+    NES_FreeFork(a2);
+    NES_FreeFork(b);
+    NES_FreeFork(a);
+
+    free(base);
+    NES_Destroy(ref);
+    NES_Destroy(parent);
+    free(ref);
+    free(parent);
+}
+
+int main(void)
+{
+    size_t rom_size = 0;
+    u8* rom = TestRom_NROM(k_prog, sizeof(k_prog), 0, true, &rom_size);
+
+    test_savestate_roundtrip_is_deterministic(rom, rom_size);
+    test_fork_shares_pages_until_written(rom, rom_size);
+    test_forks_match_savestate_copies(rom, rom_size);
+
+    free(rom);
+    printf("state fork: OK\n");
+    return 0;
+}
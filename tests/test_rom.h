@@ -0,0 +1,82 @@
+#pragma once
+// Shared test fixtures: iNES images built around a small program, and
+// consoles brought up from them. Header-only; tests include it as
+// "../test_rom.h".
+
+#include "nes/nes.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    TEST_ROM_HEADER = 16,
+    TEST_ROM_BANK   = 16 * 1024,    // PRG bank
+    TEST_ROM_CHR    = 8 * 1024      // one CHR ROM bank
+};
+
+// Zeroed image with `prg_banks` 16KB PRG banks and either 8KB of CHR ROM or
+// CHR RAM. Free with free().
+static inline u8* TestRom_Make(u8 mapper, u32 prg_banks, bool chr_ram, size_t* out_size)
+{
+    size_t size = TEST_ROM_HEADER + (size_t)prg_banks * TEST_ROM_BANK + (chr_ram ? 0u : TEST_ROM_CHR);
+    u8* rom = (u8*)calloc(1, size);
+    assert(rom);
+
+    rom[0] = 'N'; rom[1] = 'E'; rom[2] = 'S'; rom[3] = 0x1A;
+    rom[4] = (u8)prg_banks;
+    rom[5] = (u8)(chr_ram ? 0u : 1u);
+    rom[6] = (u8)((mapper & 0x0Fu) << 4);
+    rom[7] = (u8)(mapper & 0xF0u);
+
+    *out_size = size;
+    return rom;
+}
+
+static inline u8* TestRom_PRG(u8* rom)
+{
+    return rom + TEST_ROM_HEADER;
+}
+
+// NMI and RESET vectors, at the end of the last PRG bank (the one every
+// supported mapper keeps at $C000-$FFFF).
+static inline void TestRom_SetVectors(u8* rom, u16 nmi, u16 reset)
+{
+    u8* end = TestRom_PRG(rom) + (size_t)rom[4] * TEST_ROM_BANK;
+    end[-6] = (u8)nmi;   end[-5] = (u8)(nmi >> 8);
+    end[-4] = (u8)reset; end[-3] = (u8)(reset >> 8);
+}
+
+// NROM-128: prog at $8000 (mirrored at $C000), RESET -> $8000 and
+// NMI -> $8000 + nmi_offset.
+static inline u8* TestRom_NROM(const u8* prog, size_t prog_size, u16 nmi_offset, bool chr_ram,
+                               size_t* out_size)
+{
+    assert(prog_size <= TEST_ROM_BANK - 6u);
+    u8* rom = TestRom_Make(0, 1, chr_ram, out_size);
+    memcpy(TestRom_PRG(rom), prog, prog_size);
+    TestRom_SetVectors(rom, (u16)(0x8000u + nmi_offset), 0x8000u);
+    return rom;
+}
+
+// Initialises n, loads the image and resets it.
+static inline void TestRom_LoadConsole(Nes* n, const u8* rom, size_t rom_size)
+{
+    assert(NES_Init(n));
+    n->quiet = true;
+    assert(NES_LoadROMFromMemory(n, rom, rom_size));
+    NES_Reset(n);
+}
+
+static inline Nes* TestRom_NewConsole(const u8* rom, size_t rom_size)
+{
+    Nes* n = (Nes*)malloc(sizeof(Nes));
+    assert(n);
+    TestRom_LoadConsole(n, rom, rom_size);
+    return n;
+}
+
+static inline void TestRom_FreeConsole(Nes* n)
+{
+    NES_Destroy(n);
+    free(n);
+}
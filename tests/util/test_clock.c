@@ -0,0 +1,47 @@
+#include "nes/clock.h"
+#include <assert.h>
+#include <stdio.h>
+
+static void test_grid(void)
+{
+    NesClock c;
+    NesClock_Init(&c, NES_NTSC_FRAME_HZ, NES_CLOCK_DEFAULT_SPIN_NS);
+    assert(c.period_ns > 16638000.0 && c.period_ns < 16640000.0);
+
+    // 60.0988 boundaries per second: frame 60099 is just past 1000 s
+    u64 t = NesClock_Deadline(&c, 60099u) - c.epoch_ns;
+    assert(t > 1000000000000ull && t < 1000000000000ull + 20000000ull);
+
+    for (u64 f = 0; f < 1000u; f += 37u) {
+        u64 d = NesClock_Deadline(&c, f);
+        assert(NesClock_FrameAt(&c, d) == f);
+        assert(NesClock_FrameAt(&c, d + 1u) == f + 1u);
+    }
+}
+
+static void test_sleep_is_accurate(void)
+{
+    NesClock c;
+    NesClock_Init(&c, 1000.0, NES_CLOCK_DEFAULT_SPIN_NS);
+
+    NesJitter j = { 0 };
+    u64 start = NesClock_FrameAt(&c, NesClock_Now()) + 1u;
+    for (u64 f = start; f < start + 50u; f++) {
+        u64 late = NesClock_SleepUntil(&c, NesClock_Deadline(&c, f));
+        NesJitter_Add(&j, late);
+        assert(NesClock_Now() >= NesClock_Deadline(&c, f));
+    }
+    assert(j.samples == 50u);
+
+    // Generous bound: shared CI hosts get preempted.
+    assert(j.avg_ns < 2000000u);
+    printf("clock: avg late %.1f us, max %.1f us\n", (double)j.avg_ns * 1e-3, (double)j.max_ns * 1e-3);
+}
+
+int main(void)
+{
+    test_grid();
+    test_sleep_is_accurate();
+    puts("clock: OK");
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "nes/util/framediff.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+enum { W = 256, H = 240 };
+
+static u32 g_px[W * H];
+
+static void test_first_frame_and_unchanged_frames(void)
+{
+    FrameDiff d;
+    FrameDiff_Reset(&d);
+
+    int first = -1, last = -1;
+    assert(FrameDiff_Update(&d, g_px, W, H, &first, &last) == H);
+    assert(first == 0 && last == H - 1);
+
+    first = last = -1;
+    assert(FrameDiff_Update(&d, g_px, W, H, &first, &last) == 0);
+    assert(first == -1 && last == -1);
+
+    FrameDiff_Reset(&d);
+    assert(FrameDiff_Update(&d, g_px, W, H, &first, &last) == H);
+}
+
+static void test_changed_rows_span(void)
+{
+    FrameDiff d;
+    FrameDiff_Reset(&d);
+
+    int first = 0, last = 0;
+    FrameDiff_Update(&d, g_px, W, H, &first, &last);
+
+    g_px[37 * W + 255] = 0xFF00FF00u;
+    g_px[120 * W] = 0xFF0000FFu;
+    assert(FrameDiff_Update(&d, g_px, W, H, &first, &last) == 2);
+    assert(first == 37 && last == 120);
+
+    // Reverting a row is a change too.
+    g_px[37 * W + 255] = 0;
+    assert(FrameDiff_Update(&d, g_px, W, H, &first, &last) == 1);
+    assert(first == 37 && last == 37);
+
+    // A different size invalidates every row.
+    assert(FrameDiff_Update(&d, g_px, W, H / 2, &first, &last) == H / 2);
+}
+
+int main(void)
+{
+    test_first_frame_and_unchanged_frames();
+    test_changed_rows_span();
+    puts("framediff: OK");
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "nes/util/hash.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+int main(void)
+{
+    // Pinned: the value must not depend on the host's byte order.
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    assert(Hash_Bytes64(HASH_FNV64_SEED, text, sizeof(text) - 1u) == 0x0D97AA5F5531D707ull);
+    assert(Hash_Bytes64(HASH_FNV64_SEED, text, 0) == HASH_FNV64_SEED);
+
+    // Chaining at a multiple of 8 bytes equals one pass.
+    u64 chained = Hash_Bytes64(Hash_Bytes64(HASH_FNV64_SEED, text, 16), text + 16, sizeof(text) - 17u);
+    assert(chained == Hash_Bytes64(HASH_FNV64_SEED, text, sizeof(text) - 1u));
+
+    // Words hash as their little-endian bytes.
+    static u32 px[300];
+    static u8 bytes[sizeof(px)];
+    for (u32 i = 0; i < 300u; i++) {
+        px[i] = 0xFF000000u | i * 2654435761u;
+        bytes[i * 4u + 0u] = (u8)px[i];
+        bytes[i * 4u + 1u] = (u8)(px[i] >> 8);
+        bytes[i * 4u + 2u] = (u8)(px[i] >> 16);
+        bytes[i * 4u + 3u] = (u8)(px[i] >> 24);
+    }
+    assert(Hash_U32s64(HASH_FNV64_SEED, px, 300) == Hash_Bytes64(HASH_FNV64_SEED, bytes, sizeof(bytes)));
+    px[299] ^= 1u;
+    assert(Hash_U32s64(HASH_FNV64_SEED, px, 300) != Hash_Bytes64(HASH_FNV64_SEED, bytes, sizeof(bytes)));
+
+    printf("hash: OK\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "nes/util/memdiff.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+int main(void)
+{
+    static u8 a[1000], b[1000];
+    for (u32 i = 0; i < sizeof(a); i++) a[i] = b[i] = (u8)(i * 7u);
+
+    assert(Mem_FirstDiff(a, b, sizeof(a)) == sizeof(a));
+    assert(Mem_FirstDiff(a, b, 0) == 0u);
+
+    // Every position, including inside and at the edges of the wide blocks,
+    // and with unaligned starts.
+    for (u32 at = 0; at < sizeof(a); at++) {
+        b[at] ^= 0x10u;
+        assert(Mem_FirstDiff(a, b, sizeof(a)) == at);
+        assert(Mem_FirstDiff(a + 3, b + 3, sizeof(a) - 3u) == (at >= 3u ? at - 3u : sizeof(a) - 3u));
+        b[at] ^= 0x10u;
+    }
+
+    // The earliest of several differences wins.
+    b[700] = (u8)~b[700];
+    b[130] = (u8)~b[130];
+    assert(Mem_FirstDiff(a, b, sizeof(a)) == 130u);
+    assert(Mem_FirstDiff(a, b, 130) == 130u);
+
+    puts("memdiff: OK");
+    return 0;
+}
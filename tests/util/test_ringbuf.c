@@ -0,0 +1,88 @@
+#include "nes/util/ringbuf.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+static void test_wrap_and_counters(void)
+{
+    RingBuf rb;
+    assert(RingBuf_Init(&rb, 6, sizeof(s16)));
+    assert(rb.capacity == 8u);
+
+    s16 in[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    s16 out[8] = { 0 };
+
+    assert(RingBuf_Write(&rb, in, 5) == 5u);
+    assert(RingBuf_Read(&rb, out, 3) == 3u);
+    assert(out[0] == 1 && out[2] == 3);
+
+    // Wraps around the end of the storage
+    assert(RingBuf_Write(&rb, in, 6) == 6u);
+    assert(RingBuf_Count(&rb) == 8u);
+    assert(RingBuf_Overruns(&rb) == 0u);
+
+    assert(RingBuf_Write(&rb, in, 1) == 0u);
+    assert(RingBuf_Overruns(&rb) == 1u);
+
+    assert(RingBuf_Read(&rb, out, 8) == 8u);
+    assert(out[0] == 4 && out[1] == 5 && out[2] == 1 && out[7] == 6);
+    assert(RingBuf_Underruns(&rb) == 0u);
+
+    assert(RingBuf_Read(&rb, out, 1) == 0u);
+    assert(RingBuf_Underruns(&rb) == 1u);
+
+    RingBuf_Destroy(&rb);
+}
+
+enum { STRESS_SAMPLES = 2000000 };
+
+static void* producer(void* arg)
+{
+    RingBuf* rb = (RingBuf*)arg;
+    float chunk[37];
+    u32 next = 0;
+
+    while (next < STRESS_SAMPLES) {
+        u32 n = 0;
+        while (n < 37u && next + n < STRESS_SAMPLES) {
+            chunk[n] = (float)(next + n);
+            n++;
+        }
+        // Retry whatever did not fit
+        u32 done = 0;
+        while (done < n) done += RingBuf_Write(rb, chunk + done, n - done);
+        next += n;
+    }
+    return NULL;
+}
+
+static void test_spsc_stress(void)
+{
+    RingBuf rb;
+    assert(RingBuf_Init(&rb, 256, sizeof(float)));
+
+    pthread_t t;
+    assert(pthread_create(&t, NULL, producer, &rb) == 0);
+
+    float buf[53];
+    u32 expect = 0;
+    while (expect < STRESS_SAMPLES) {
+        u32 got = RingBuf_Read(&rb, buf, 53);
+        for (u32 i = 0; i < got; i++) {
+            assert(buf[i] == (float)expect);
+            expect++;
+        }
+    }
+
+    pthread_join(t, NULL);
+    assert(RingBuf_Count(&rb) == 0u);
+    RingBuf_Destroy(&rb);
+}
+
+int main(void)
+{
+    test_wrap_and_counters();
+    test_spsc_stress();
+    puts("ringbuf: OK");
+    return 0;
+}
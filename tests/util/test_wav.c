@@ -0,0 +1,82 @@
+#include "nes/util/wav.h"
+#include "nes/util/file.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* k_wav_a = "test_wav_a.tmp.wav";
+static const char* k_wav_b = "test_wav_b.tmp.wav";
+
+static u32 get_le(const u8* p, int bytes)
+{
+    u32 v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+enum { SAMPLES = 100000 };
+
+static s16 sample(u32 i)
+{
+    return (s16)((i * 2654435761u) >> 16);
+}
+
+// Writes the same stream in chunks of `chunk` samples.
+static u64 write_stream(const char* path, u32 chunk)
+{
+    static s16 buf[SAMPLES];
+    for (u32 i = 0; i < SAMPLES; i++) buf[i] = sample(i);
+
+    static WavWriter w;
+    assert(Wav_Open(&w, path, 44100, 2));
+    for (u32 at = 0; at < SAMPLES; at += chunk) {
+        u32 n = (SAMPLES - at < chunk) ? SAMPLES - at : chunk;
+        assert(Wav_Write(&w, buf + at, n));
+    }
+    assert(w.samples == SAMPLES / 2);
+    u64 hash = w.hash;
+    assert(Wav_Close(&w));
+    return hash;
+}
+
+static void test_header_and_chunking(void)
+{
+    u64 ha = write_stream(k_wav_a, SAMPLES);
+    u64 hb = write_stream(k_wav_b, 6);
+    assert(ha == hb);
+
+    unsigned char* a = NULL;
+    unsigned char* b = NULL;
+    size_t na = 0, nb = 0;
+    assert(File_ReadAllBytes(k_wav_a, &a, &na));
+    assert(File_ReadAllBytes(k_wav_b, &b, &nb));
+    assert(na == nb && memcmp(a, b, na) == 0);
+
+    assert(na == WAV_HEADER_BYTES + SAMPLES * 2u);
+    assert(memcmp(a, "RIFF", 4) == 0 && memcmp(a + 8, "WAVEfmt ", 8) == 0);
+    assert(get_le(a + 4, 4) == na - 8u);
+    assert(get_le(a + 20, 2) == 1u);            // PCM
+    assert(get_le(a + 22, 2) == 2u);            // channels
+    assert(get_le(a + 24, 4) == 44100u);
+    assert(get_le(a + 28, 4) == 44100u * 4u);
+    assert(get_le(a + 32, 2) == 4u);
+    assert(get_le(a + 34, 2) == 16u);
+    assert(memcmp(a + 36, "data", 4) == 0);
+    assert(get_le(a + 40, 4) == SAMPLES * 2u);
+
+    for (u32 i = 0; i < SAMPLES; i += 997u) {
+        assert((s16)get_le(a + WAV_HEADER_BYTES + i * 2u, 2) == sample(i));
+    }
+
+    File_Free(a);
+    File_Free(b);
+    remove(k_wav_a);
+    remove(k_wav_b);
+}
+
+int main(void)
+{
+    test_header_and_chunking();
+    puts("wav: OK");
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Headless movie playback at uncapped speed.
+//
+// Usage: movieplay rom.nes movie.nesm [--no-verify] [--frames N] [--timeline out.json]
+// Exit status: 0 = played to the end, 2 = desync, 1 = error.
+
+#include "nes/clock.h"
+#include "nes/debug/timeline.h"
+#include "nes/log.h"
+#include "nes/movie.h"
+#include "nes/nes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_seconds(void)
+{
+    return (double)NesClock_Now() * 1e-9;
+}
+
+static void usage(const char* exe)
+{
+    fprintf(stderr, "Usage: %s rom.nes movie.nesm [--no-verify] [--frames N] [--timeline out.json]\n", exe);
+}
+
+static int play(Nes* nes, NesMoviePlayer* movie, bool verify, u64 max_frames)
+{
+    verify = verify && (movie->hdr.flags & NES_MOVIE_FLAG_CHECKSUMS);
+    NES_Reset(nes);
+    NES_SetSkipRender(nes, true);   // checksums cover state, not pixels
+
+    int status = 0;
+    double t0 = now_seconds();
+    NesInput in;
+    while (movie->frame < max_frames && NesMovie_NextInput(movie, &in)) {
+        nes->input = in;
+        NES_RunFrame(nes);
+
+        if (verify && !NesMovie_Verify(movie, nes)) {
+            printf("desync at frame %llu\n", (unsigned long long)movie->desync_frame);
+            status = 2;
+            break;
+        }
+    }
+    double dt = now_seconds() - t0;
+
+    if (status == 0 && movie->frame < movie->hdr.frames && movie->frame < max_frames) status = 1;
+
+    printf("played %llu/%llu frames in %.3f s (%.1f fps)%s\n",
+           (unsigned long long)movie->frame, (unsigned long long)movie->hdr.frames,
+           dt, dt > 0.0 ? (double)movie->frame / dt : 0.0,
+           verify ? ", checksums verified" : "");
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char* rom_path = argv[1];
+    const char* movie_path = argv[2];
+    bool verify = true;
+    u64 max_frames = UINT64_MAX;
+    const char* timeline_path = NULL;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--no-verify") == 0) {
+            verify = false;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            max_frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+            timeline_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    NesMoviePlayer movie;
+    if (!NesMovie_Open(&movie, movie_path)) return 1;
+
+    Nes* nes = (Nes*)malloc(sizeof(Nes));
+    if (!nes || !NES_Init(nes)) {
+        NesMovie_Close(&movie);
+        free(nes);
+        return 1;
+    }
+    nes->quiet = true;
+
+    int status = 1;
+    if (!NES_LoadROM(nes, rom_path)) {
+        // Cart already logged the reason.
+    } else if (!NesMovie_CheckROM(&movie, nes)) {
+        NES_LOGE("movieplay: %s was recorded with a different ROM", movie_path);
+    } else {
+        if (timeline_path && NesTimeline_Start(0)) NesTimeline_AttachThread("movieplay");
+        status = play(nes, &movie, verify, max_frames);
+        if (timeline_path && !NesTimeline_Write(timeline_path) && status == 0) status = 1;
+    }
+
+    NES_Destroy(nes);
+    free(nes);
+    NesMovie_Close(&movie);
+    return status;
+}
@@ -0,0 +1,207 @@
+// Headless runner on top of libnes: runs a ROM (optionally under a movie)
+// for a number of frames and reports framebuffer hashes as key=value lines,
+// for scripts such as scripts/rom_runtime_smoke.py.
+//
+// Usage: nes_headless rom.nes [--frames N] [--movie m.nesm] [--hash-every K]
+//                     [--dump-frame out.ppm] [--dump-ram out.bin] [--skip-render]
+// Exit status: 0 = ok, 2 = movie desync, 1 = error.
+
+#include "nes/libnes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Options {
+    const char* rom;
+    const char* movie;
+    const char* dump_frame;
+    const char* dump_ram;
+    uint64_t frames;        // 0 = default (120, or the whole movie)
+    uint64_t hash_every;    // 0 = off
+    bool skip_render;
+} Options;
+
+static void usage(const char* exe)
+{
+    fprintf(stderr,
+            "Usage: %s rom.nes [--frames N] [--movie m.nesm] [--hash-every K]\n"
+            "       [--dump-frame out.ppm] [--dump-ram out.bin] [--skip-render]\n",
+            exe);
+}
+
+static bool parse_args(int argc, char** argv, Options* o)
+{
+    memset(o, 0, sizeof(*o));
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--frames") == 0 && has_value) {
+            o->frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--movie") == 0 && has_value) {
+            o->movie = argv[++i];
+        } else if (strcmp(a, "--hash-every") == 0 && has_value) {
+            o->hash_every = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--dump-frame") == 0 && has_value) {
+            o->dump_frame = argv[++i];
+        } else if (strcmp(a, "--dump-ram") == 0 && has_value) {
+            o->dump_ram = argv[++i];
+        } else if (strcmp(a, "--skip-render") == 0) {
+            o->skip_render = true;
+        } else if (a[0] != '-' && !o->rom) {
+            o->rom = a;
+        } else {
+            return false;
+        }
+    }
+    return o->rom != NULL;
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t count_unique(uint64_t* hashes, uint64_t n)
+{
+    if (n == 0) return 0;
+    qsort(hashes, (size_t)n, sizeof(hashes[0]), cmp_u64);
+    uint64_t unique = 1;
+    for (uint64_t i = 1; i < n; i++) {
+        if (hashes[i] != hashes[i - 1u]) unique++;
+    }
+    return unique;
+}
+
+static bool write_ppm(const char* path, const uint32_t* argb)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    fprintf(f, "P6\n%d %d\n255\n", LIBNES_FB_W, LIBNES_FB_H);
+    unsigned char row[LIBNES_FB_W * 3];
+    for (int y = 0; y < LIBNES_FB_H; y++) {
+        for (int x = 0; x < LIBNES_FB_W; x++) {
+            uint32_t c = argb[y * LIBNES_FB_W + x];
+            row[x * 3 + 0] = (unsigned char)(c >> 16);
+            row[x * 3 + 1] = (unsigned char)(c >> 8);
+            row[x * 3 + 2] = (unsigned char)c;
+        }
+        fwrite(row, 1, sizeof(row), f);
+    }
+    return fclose(f) == 0;
+}
+
+static bool write_ram(const char* path, const LibNes* h)
+{
+    uint8_t ram[LIBNES_RAM_SIZE];
+    LibNes_CopyRAM(h, ram);
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t n = fwrite(ram, 1, sizeof(ram), f);
+    return fclose(f) == 0 && n == sizeof(ram);
+}
+
+static const char* movie_state_name(LibNesMovieState s)
+{
+    switch (s) {
+    case LIBNES_MOVIE_PLAYING: return "playing";
+    case LIBNES_MOVIE_ENDED:   return "ended";
+    case LIBNES_MOVIE_DESYNC:  return "desync";
+    default:                   return "none";
+    }
+}
+
+static int run(LibNes* h, const Options* o)
+{
+    // A movie runs to its end unless --frames caps it.
+    uint64_t frames = o->frames ? o->frames : (o->movie ? UINT64_MAX : 120u);
+    uint64_t cap = frames == UINT64_MAX ? 4096u : frames;
+    uint64_t* hashes = (uint64_t*)malloc((size_t)cap * sizeof(uint64_t));
+    if (!hashes) return 1;
+
+    LibNes_SetSkipRender(h, o->skip_render);
+
+    uint64_t done = 0, changed = 0;
+    uint64_t first_hash = 0, last_hash = 0;
+    while (done < frames && LibNes_RunFrames(h, 1) == 1) {
+        uint64_t hash = LibNes_FramebufferHash(h);
+        if (done == 0) first_hash = hash;
+        if (hash != first_hash) changed++;
+        last_hash = hash;
+
+        if (done == cap) {
+            uint64_t* grown = (uint64_t*)realloc(hashes, (size_t)cap * 2u * sizeof(uint64_t));
+            if (!grown) {
+                free(hashes);
+                return 1;
+            }
+            hashes = grown;
+            cap *= 2u;
+        }
+        hashes[done++] = hash;
+
+        if (o->hash_every && done % o->hash_every == 0) {
+            printf("hash_%llu=%llu\n", (unsigned long long)done, (unsigned long long)hash);
+        }
+    }
+
+    printf("status=ok\n");
+    printf("jammed=%d\n", LibNes_CPUJammed(h) ? 1 : 0);
+    printf("frames=%llu\n", (unsigned long long)done);
+    printf("changed_frames=%llu\n", (unsigned long long)changed);
+    printf("unique_hashes=%llu\n", (unsigned long long)count_unique(hashes, done));
+    printf("first_hash=%llu\n", (unsigned long long)first_hash);
+    printf("last_hash=%llu\n", (unsigned long long)last_hash);
+    free(hashes);
+
+    int status = 0;
+    if (o->movie) {
+        uint64_t desync_frame = 0;
+        LibNesMovieState ms = LibNes_MovieState(h, &desync_frame);
+        printf("movie=%s\n", movie_state_name(ms));
+        if (ms == LIBNES_MOVIE_DESYNC) {
+            printf("desync_frame=%llu\n", (unsigned long long)desync_frame);
+            status = 2;
+        }
+    }
+
+    if (o->dump_frame && !write_ppm(o->dump_frame, LibNes_Framebuffer(h))) {
+        fprintf(stderr, "nes_headless: cannot write %s\n", o->dump_frame);
+        status = 1;
+    }
+    if (o->dump_ram && !write_ram(o->dump_ram, h)) {
+        fprintf(stderr, "nes_headless: cannot write %s\n", o->dump_ram);
+        status = 1;
+    }
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    Options o;
+    if (!parse_args(argc, argv, &o)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    LibNes* h = LibNes_Create();
+    if (!h) {
+        printf("status=init_fail\n");
+        return 1;
+    }
+
+    int status = 1;
+    if (!LibNes_LoadROM(h, o.rom)) {
+        printf("status=load_fail\n");
+    } else if (o.movie && !LibNes_PlayMovie(h, o.movie)) {
+        printf("status=movie_fail\n");
+    } else {
+        status = run(h, &o);
+    }
+
+    LibNes_Destroy(h);
+    return status;
+}
@@ -0,0 +1,159 @@
+// Headless guest-code profiler: runs a ROM (or a movie) with the profiler
+// on and writes its reports.
+//
+// Usage: nesprof rom.nes [--movie m.nesm] [--frames N] [--dbg file.dbg]
+//                [--top N] [--folded out.folded] [--report out.txt]
+//
+// Symbols come from FCEUX .nl files next to the ROM (rom.nes.0.nl, ...)
+// and/or an ld65 debug file. The flat report goes to stdout unless
+// --report is given; --folded writes collapsed stacks for flamegraph.pl.
+// Without a movie it runs 600 frames with no input.
+
+#include "nes/clock.h"
+#include "nes/debug/profiler.h"
+#include "nes/log.h"
+#include "nes/movie.h"
+#include "nes/nes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ProfOptions {
+    const char* rom_path;
+    const char* movie_path;
+    const char* dbg_path;
+    const char* folded_path;
+    const char* report_path;
+    u64 frames;
+    u32 top;
+} ProfOptions;
+
+static double now_seconds(void)
+{
+    return (double)NesClock_Now() * 1e-9;
+}
+
+static void usage(const char* exe)
+{
+    fprintf(stderr, "Usage: %s rom.nes [--movie m.nesm] [--frames N] [--dbg file.dbg]\n", exe);
+    fprintf(stderr, "       [--top N] [--folded out.folded] [--report out.txt]\n");
+}
+
+static bool write_reports(const NesProfiler* p, NesSymbols* syms, const ProfOptions* o)
+{
+    bool ok = true;
+    FILE* report = o->report_path ? fopen(o->report_path, "w") : stdout;
+    if (!report) {
+        NES_LOGE("nesprof: cannot write %s", o->report_path);
+        ok = false;
+    } else {
+        NesProfiler_WriteFlat(p, syms, o->top, report);
+        if (report != stdout) fclose(report);
+    }
+
+    if (o->folded_path) {
+        FILE* folded = fopen(o->folded_path, "w");
+        if (!folded) {
+            NES_LOGE("nesprof: cannot write %s", o->folded_path);
+            ok = false;
+        } else {
+            NesProfiler_WriteCollapsed(p, syms, folded);
+            fclose(folded);
+        }
+    }
+    return ok;
+}
+
+// Runs the profiled frames; movie may be NULL.
+static int profile(Nes* nes, NesMoviePlayer* movie, const ProfOptions* o)
+{
+    NES_Reset(nes);
+    NES_SetSkipRender(nes, true);
+    if (!NES_StartProfile(nes)) return 1;
+
+    double t0 = now_seconds();
+    u64 frames = 0;
+    NesInput in;
+    memset(&in, 0, sizeof(in));
+    while (frames < o->frames && (!movie || NesMovie_NextInput(movie, &in))) {
+        nes->input = in;
+        NES_RunFrame(nes);
+        frames++;
+    }
+    double dt = now_seconds() - t0;
+    fprintf(stderr, "profiled %llu frames in %.3f s (%.1f fps)\n",
+            (unsigned long long)frames, dt, dt > 0.0 ? (double)frames / dt : 0.0);
+
+    NesSymbols syms;
+    memset(&syms, 0, sizeof(syms));
+    u32 prg_size = nes->cart.prg_rom_size;
+    u32 nl = NesSymbols_LoadNL(&syms, o->rom_path, prg_size);
+    if (nl) fprintf(stderr, "%u symbols from .nl files\n", nl);
+    if (o->dbg_path && !NesSymbols_LoadDbg(&syms, o->dbg_path, prg_size)) {
+        NES_LOGW("nesprof: cannot read %s", o->dbg_path);
+    }
+
+    int status = write_reports(NES_Profiler(nes), &syms, o) ? 0 : 1;
+    NesSymbols_Free(&syms);
+    NES_StopProfile(nes);
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ProfOptions o;
+    memset(&o, 0, sizeof(o));
+    o.rom_path = argv[1];
+    o.frames = UINT64_MAX;
+    o.top = 40;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--movie") == 0 && i + 1 < argc) {
+            o.movie_path = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            o.frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dbg") == 0 && i + 1 < argc) {
+            o.dbg_path = argv[++i];
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            o.top = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--folded") == 0 && i + 1 < argc) {
+            o.folded_path = argv[++i];
+        } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            o.report_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!o.movie_path && o.frames == UINT64_MAX) o.frames = 600;
+
+    NesMoviePlayer movie;
+    if (o.movie_path && !NesMovie_Open(&movie, o.movie_path)) return 1;
+
+    Nes* nes = (Nes*)malloc(sizeof(Nes));
+    if (!nes || !NES_Init(nes)) {
+        if (o.movie_path) NesMovie_Close(&movie);
+        free(nes);
+        return 1;
+    }
+    nes->quiet = true;
+
+    int status = 1;
+    if (!NES_LoadROM(nes, o.rom_path)) {
+        // Cart already logged the reason.
+    } else if (o.movie_path && !NesMovie_CheckROM(&movie, nes)) {
+        NES_LOGE("nesprof: %s was recorded with a different ROM", o.movie_path);
+    } else {
+        status = profile(nes, o.movie_path ? &movie : NULL, &o);
+    }
+
+    NES_Destroy(nes);
+    free(nes);
+    if (o.movie_path) NesMovie_Close(&movie);
+    return status;
+}
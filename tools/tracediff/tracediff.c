@@ -0,0 +1,375 @@
+// Finds where two builds of the core diverge.
+//
+// Usage: tracediff diff a.nestrace b.nestrace [--context N]
+//        tracediff keyframes rom.nes dir [--movie m.nesm] [--frames N] [--every K]
+//        tracediff bisect dir_a dir_b
+//        tracediff replay rom.nes dir FRAME out.nestrace [--movie m.nesm] [--frames K]
+//
+// diff compares two execution traces (nes_emu --exec-trace, NES_StartExecTrace)
+// and prints the first differing instruction with the lines before it.
+//
+// For long runs, tracing everything from power-on is the slow part. Instead
+// run `keyframes` with each build: it plays the ROM (and movie) untraced and
+// saves a savestate plus a build-independent fingerprint (NES_StateFingerprint)
+// every K frames. `bisect` then scans the two fingerprint lists for the first
+// keyframe where the builds disagree, and `replay` (again with each build, from
+// its own keyframe before that) traces only the frames up to it. diff the two
+// short traces.
+//
+// Exit status: 0 = no divergence, 2 = divergence, 1 = error.
+
+#include "nes/debug/trace.h"
+#include "nes/log.h"
+#include "nes/movie.h"
+#include "nes/nes.h"
+#include "nes/state.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+enum {
+    DEFAULT_EVERY = 600,
+    DEFAULT_FRAMES = 3600,
+    DEFAULT_REPLAY_FRAMES = 60,
+    MAX_CONTEXT = 64
+};
+
+typedef struct Keyframe {
+    u64 frame;
+    u64 cycle;
+    u64 fingerprint;
+} Keyframe;
+
+static void usage(const char* exe)
+{
+    fprintf(stderr,
+            "Usage: %s diff a.nestrace b.nestrace [--context N]\n"
+            "       %s keyframes rom.nes dir [--movie m.nesm] [--frames N] [--every K]\n"
+            "       %s bisect dir_a dir_b\n"
+            "       %s replay rom.nes dir FRAME out.nestrace [--movie m.nesm] [--frames K]\n",
+            exe, exe, exe, exe);
+}
+
+static void print_record(const char* tag, const NesTraceRecord* r)
+{
+    char line[160];
+    NesTrace_FormatNestest(r, line, sizeof(line));
+    printf("%s%s\n", tag, line);
+}
+
+// ---------------------------------------------------------------------------
+// diff
+// ---------------------------------------------------------------------------
+
+static int cmd_diff(const char* path_a, const char* path_b, u32 context)
+{
+    NesTraceDiff d;
+    if (!NesTrace_Diff(path_a, path_b, &d)) {
+        fprintf(stderr, "tracediff: cannot read %s or %s as traces\n", path_a, path_b);
+        return 1;
+    }
+    if (!d.diverged) {
+        printf("identical: %llu instructions\n", (unsigned long long)d.index);
+        return 0;
+    }
+
+    printf("first difference at instruction %llu\n", (unsigned long long)d.index);
+
+    // Context comes from trace a, decoded again from the sync point before it.
+    if (context > MAX_CONTEXT) context = MAX_CONTEXT;
+    NesTraceRecord ring[MAX_CONTEXT];
+    NesTraceReader r;
+    if (context && NesTraceReader_Open(&r, path_a)) {
+        u64 first = d.index > context ? d.index - context : 0;
+        NesTraceRecord rec;
+        NesTraceReader_Seek(&r, first);
+        while (r.index < d.index && NesTraceReader_Next(&r, &rec)) ring[(r.index - 1u) % context] = rec;
+        u64 seen = r.index;
+        NesTraceReader_Close(&r);
+        if (first > seen) first = seen;
+        for (u64 i = first; i < seen; i++) print_record("   ", &ring[i % context]);
+    }
+
+    if (d.has_a) print_record("a: ", &d.a);
+    else printf("a: (trace ends)\n");
+    if (d.has_b) print_record("b: ", &d.b);
+    else printf("b: (trace ends)\n");
+    return 2;
+}
+
+// ---------------------------------------------------------------------------
+// Keyframes: dir/keyframes.txt lists "frame cycle fingerprint" per line and
+// dir/kf_<frame>.state holds the savestate (only loadable by the same build).
+// ---------------------------------------------------------------------------
+
+static void keyframe_path(char* out, size_t cap, const char* dir, u64 frame)
+{
+    snprintf(out, cap, "%s/kf_%08llu.state", dir, (unsigned long long)frame);
+}
+
+static bool load_index(const char* dir, Keyframe** out, u32* out_count)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/keyframes.txt", dir);
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "tracediff: cannot open %s\n", path);
+        return false;
+    }
+
+    Keyframe* list = NULL;
+    u32 count = 0, cap = 0;
+    unsigned long long frame, cycle, fp;
+    while (fscanf(f, "%llu %llu %llx", &frame, &cycle, &fp) == 3) {
+        if (count == cap) {
+            cap = cap ? cap * 2u : 64u;
+            Keyframe* grown = (Keyframe*)realloc(list, (size_t)cap * sizeof(Keyframe));
+            if (!grown) {
+                free(list);
+                fclose(f);
+                return false;
+            }
+            list = grown;
+        }
+        list[count++] = (Keyframe){ frame, cycle, fp };
+    }
+    fclose(f);
+
+    *out = list;
+    *out_count = count;
+    return count > 0;
+}
+
+// Brings a console up from power-on with the ROM (and movie) loaded.
+static bool open_console(Nes* nes, const char* rom_path, const char* movie_path, NesMoviePlayer* movie)
+{
+    if (!NES_Init(nes)) return false;
+    nes->quiet = true;
+    if (!NES_LoadROM(nes, rom_path)) return false;
+    if (movie_path) {
+        if (!NesMovie_Open(movie, movie_path)) return false;
+        if (!NesMovie_CheckROM(movie, nes)) {
+            NES_LOGE("tracediff: %s was recorded with a different ROM", movie_path);
+            return false;
+        }
+    }
+    NES_Reset(nes);
+    NES_SetSkipRender(nes, true);
+    return true;
+}
+
+static bool run_frame(Nes* nes, NesMoviePlayer* movie)
+{
+    if (movie->file.data) {
+        NesInput in;
+        if (!NesMovie_NextInput(movie, &in)) return false;
+        nes->input = in;
+    }
+    NES_RunFrame(nes);
+    return true;
+}
+
+static bool save_keyframe(const Nes* nes, const char* dir, FILE* index, u8* buf, size_t size)
+{
+    char path[1024];
+    keyframe_path(path, sizeof(path), dir, nes->frame_count);
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = NES_SaveState(nes, buf, size) && fwrite(buf, 1, size, f) == size;
+    if (fclose(f) != 0) ok = false;
+
+    fprintf(index, "%llu %llu %016llx\n", (unsigned long long)nes->frame_count,
+            (unsigned long long)nes->cpu.cycles, (unsigned long long)NES_StateFingerprint(nes));
+    return ok;
+}
+
+static int write_keyframes(Nes* nes, NesMoviePlayer* movie, const char* dir, u64 frames, u64 every)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/keyframes.txt", dir);
+    FILE* index = fopen(path, "w");
+    size_t size = NES_StateSize(nes);
+    u8* buf = (u8*)malloc(size);
+
+    bool ok = index && buf;
+    u64 saved = 0;
+    for (u64 f = 0; ok; f++) {
+        if (f % every == 0) {
+            ok = save_keyframe(nes, dir, index, buf, size);
+            saved++;
+        }
+        if (f == frames || !run_frame(nes, movie)) break;
+    }
+
+    if (index && fclose(index) != 0) ok = false;
+    free(buf);
+    if (!ok) {
+        fprintf(stderr, "tracediff: cannot write keyframes to %s\n", dir);
+        return 1;
+    }
+    printf("%llu keyframes in %s\n", (unsigned long long)saved, dir);
+    return 0;
+}
+
+static int cmd_keyframes(const char* rom_path, const char* dir, const char* movie_path, u64 frames, u64 every)
+{
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "tracediff: cannot create %s\n", dir);
+        return 1;
+    }
+
+    Nes* nes = (Nes*)malloc(sizeof(Nes));
+    NesMoviePlayer movie;
+    memset(&movie, 0, sizeof(movie));
+
+    int status = 1;
+    if (nes && open_console(nes, rom_path, movie_path, &movie)) {
+        if (!frames) frames = movie_path ? movie.hdr.frames : DEFAULT_FRAMES;
+        status = write_keyframes(nes, &movie, dir, frames, every ? every : DEFAULT_EVERY);
+    }
+
+    if (movie.file.data) NesMovie_Close(&movie);
+    if (nes) NES_Destroy(nes);
+    free(nes);
+    return status;
+}
+
+static int cmd_bisect(const char* dir_a, const char* dir_b)
+{
+    Keyframe* a = NULL;
+    Keyframe* b = NULL;
+    u32 na = 0, nb = 0;
+    if (!load_index(dir_a, &a, &na) || !load_index(dir_b, &b, &nb)) {
+        free(a);
+        free(b);
+        return 1;
+    }
+
+    // The lists are already loaded, so a linear scan costs nothing and does
+    // not assume that a divergence stays diverged. Both runs save at the
+    // same frames; only their common length counts.
+    u32 n = na < nb ? na : nb;
+    u32 first = 0;
+    while (first < n && a[first].frame == b[first].frame && a[first].fingerprint == b[first].fingerprint) first++;
+
+    int status = 2;
+    if (first < n && a[first].frame != b[first].frame) {
+        fprintf(stderr, "tracediff: keyframes were taken at different frames\n");
+        status = 1;
+    } else if (first == 0) {
+        printf("differ already at keyframe frame %llu\n", (unsigned long long)a[0].frame);
+    } else if (first == n) {
+        printf("all %u keyframes match (up to frame %llu)\n", n, (unsigned long long)a[n - 1u].frame);
+        status = 0;
+    } else {
+        const Keyframe* last = &a[first - 1u];
+        printf("last common keyframe: frame %llu (cycle %llu)\n",
+               (unsigned long long)last->frame, (unsigned long long)last->cycle);
+        printf("first different keyframe: frame %llu\n", (unsigned long long)a[first].frame);
+        printf("next, with each build: tracediff replay ROM DIR %llu out.nestrace --frames %llu\n",
+               (unsigned long long)last->frame, (unsigned long long)(a[first].frame - last->frame));
+    }
+
+    free(a);
+    free(b);
+    return status;
+}
+
+static int replay(Nes* nes, NesMoviePlayer* movie, const u8* state, size_t state_size,
+                  u64 frame, const char* out_path, u64 frames)
+{
+    if (!NES_LoadState(nes, state, state_size)) {
+        fprintf(stderr, "tracediff: the keyframe was saved by a different build or ROM\n");
+        return 1;
+    }
+    // Movie input resumes where the keyframe was taken.
+    NesInput skipped;
+    for (u64 i = 0; movie->file.data && i < frame; i++) {
+        if (!NesMovie_NextInput(movie, &skipped)) return 1;
+    }
+
+    if (!NES_StartExecTrace(nes, out_path)) return 1;
+    u64 done = 0;
+    while (done < frames && run_frame(nes, movie)) done++;
+    if (!NES_StopExecTrace(nes)) return 1;
+
+    printf("traced frames %llu-%llu to %s\n", (unsigned long long)frame,
+           (unsigned long long)(frame + done), out_path);
+    return 0;
+}
+
+static int cmd_replay(const char* rom_path, const char* dir, u64 frame, const char* out_path,
+                      const char* movie_path, u64 frames)
+{
+    char path[1024];
+    keyframe_path(path, sizeof(path), dir, frame);
+    unsigned char* state = NULL;
+    size_t state_size = 0;
+    if (!File_ReadAllBytes(path, &state, &state_size)) {
+        fprintf(stderr, "tracediff: cannot read %s\n", path);
+        return 1;
+    }
+
+    Nes* nes = (Nes*)malloc(sizeof(Nes));
+    NesMoviePlayer movie;
+    memset(&movie, 0, sizeof(movie));
+
+    int status = 1;
+    if (nes && open_console(nes, rom_path, movie_path, &movie)) {
+        status = replay(nes, &movie, state, state_size, frame, out_path,
+                        frames ? frames : DEFAULT_REPLAY_FRAMES);
+    }
+
+    File_Free(state);
+    if (movie.file.data) NesMovie_Close(&movie);
+    if (nes) NES_Destroy(nes);
+    free(nes);
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char* cmd = argv[1];
+    const char* movie_path = NULL;
+    u64 frames = 0, every = 0;
+    u32 context = 8;
+
+    // Positional arguments first, then options.
+    int npos = 0;
+    const char* pos[4] = { NULL, NULL, NULL, NULL };
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--movie") == 0 && has_value) {
+            movie_path = argv[++i];
+        } else if (strcmp(a, "--frames") == 0 && has_value) {
+            frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--every") == 0 && has_value) {
+            every = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--context") == 0 && has_value) {
+            context = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (a[0] != '-' && npos < 4) {
+            pos[npos++] = a;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (strcmp(cmd, "diff") == 0 && npos == 2) return cmd_diff(pos[0], pos[1], context);
+    if (strcmp(cmd, "keyframes") == 0 && npos == 2) return cmd_keyframes(pos[0], pos[1], movie_path, frames, every);
+    if (strcmp(cmd, "bisect") == 0 && npos == 2) return cmd_bisect(pos[0], pos[1]);
+    if (strcmp(cmd, "replay") == 0 && npos == 4) {
+        return cmd_replay(pos[0], pos[1], strtoull(pos[2], NULL, 10), pos[3], movie_path, frames);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,88 @@
+// Converts an execution trace (nes_emu --exec-trace, NES_StartExecTrace) to
+// nestest.log-style text, one line per instruction.
+//
+// Usage: tracefmt in.nestrace [out.log] [--skip N] [--count N]
+// Writes to stdout without out.log. The record/drop totals from the file's
+// trailer go to stderr; a trace without one was not closed cleanly and is
+// converted up to where it ends.
+
+#include "nes/debug/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char* exe)
+{
+    fprintf(stderr, "Usage: %s in.nestrace [out.log] [--skip N] [--count N]\n", exe);
+}
+
+int main(int argc, char** argv)
+{
+    const char* in_path = NULL;
+    const char* out_path = NULL;
+    u64 skip = 0;
+    u64 count = UINT64_MAX;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc) {
+            skip = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = strtoull(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && !in_path) {
+            in_path = argv[i];
+        } else if (argv[i][0] != '-' && !out_path) {
+            out_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!in_path) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    NesTraceReader r;
+    if (!NesTraceReader_Open(&r, in_path)) {
+        fprintf(stderr, "tracefmt: %s is not a trace file\n", in_path);
+        return 1;
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "tracefmt: cannot write %s\n", out_path);
+        NesTraceReader_Close(&r);
+        return 1;
+    }
+
+    NesTraceRecord rec;
+    u64 index = 0, written = 0;
+    char line[160];
+    while (written < count && NesTraceReader_Next(&r, &rec)) {
+        if (index++ < skip) continue;
+        NesTrace_FormatNestest(&rec, line, sizeof(line));
+        fputs(line, out);
+        fputc('\n', out);
+        written++;
+    }
+    // Reach the trailer even when --count stopped early.
+    while (NesTraceReader_Next(&r, &rec)) {}
+
+    int status = 0;
+    if (out != stdout && fclose(out) != 0) {
+        fprintf(stderr, "tracefmt: cannot write %s\n", out_path);
+        status = 1;
+    }
+
+    if (r.complete) {
+        fprintf(stderr, "tracefmt: %llu lines written, %llu records in trace, %llu dropped\n",
+                (unsigned long long)written, (unsigned long long)r.records,
+                (unsigned long long)r.dropped);
+    } else {
+        fprintf(stderr, "tracefmt: %llu lines written; trace is truncated or damaged\n",
+                (unsigned long long)written);
+        status = 1;
+    }
+    NesTraceReader_Close(&r);
+    return status;
+}